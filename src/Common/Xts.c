@@ -95,7 +95,7 @@ static void EncryptBufferXTSParallel (unsigned __int8 *buffer,
 	// Process all blocks in the buffer
 	while (blockCount > 0)
 	{
-		if (blockCount < BLOCKS_PER_XTS_DATA_UNIT)
+		if (startBlock + blockCount < BLOCKS_PER_XTS_DATA_UNIT)
 			endBlock = startBlock + (unsigned int) blockCount;
 		else
 			endBlock = BLOCKS_PER_XTS_DATA_UNIT;
@@ -232,7 +232,7 @@ static void EncryptBufferXTSNonParallel (unsigned __int8 *buffer,
 	// Process all blocks in the buffer
 	while (blockCount > 0)
 	{
-		if (blockCount < BLOCKS_PER_XTS_DATA_UNIT)
+		if (startBlock + blockCount < BLOCKS_PER_XTS_DATA_UNIT)
 			endBlock = startBlock + (unsigned int) blockCount;
 		else
 			endBlock = BLOCKS_PER_XTS_DATA_UNIT;
@@ -363,7 +363,7 @@ static void DecryptBufferXTSParallel (unsigned __int8 *buffer,
 	// Process all blocks in the buffer
 	while (blockCount > 0)
 	{
-		if (blockCount < BLOCKS_PER_XTS_DATA_UNIT)
+		if (startBlock + blockCount < BLOCKS_PER_XTS_DATA_UNIT)
 			endBlock = startBlock + (unsigned int) blockCount;
 		else
 			endBlock = BLOCKS_PER_XTS_DATA_UNIT;
@@ -491,7 +491,7 @@ static void DecryptBufferXTSNonParallel (unsigned __int8 *buffer,
 	// Process all blocks in the buffer
 	while (blockCount > 0)
 	{
-		if (blockCount < BLOCKS_PER_XTS_DATA_UNIT)
+		if (startBlock + blockCount < BLOCKS_PER_XTS_DATA_UNIT)
 			endBlock = startBlock + (unsigned int) blockCount;
 		else
 			endBlock = BLOCKS_PER_XTS_DATA_UNIT;
@@ -630,7 +630,7 @@ static void EncryptDecryptBufferXTS32 (const unsigned __int8 *buffer,
 	// Generate whitening values for all blocks in the buffer
 	while (blockCount > 0)
 	{
-		if (blockCount < BLOCKS_PER_XTS_DATA_UNIT)
+		if (startBlock + blockCount < BLOCKS_PER_XTS_DATA_UNIT)
 			endBlock = startBlock + (unsigned int) blockCount;
 		else
 			endBlock = BLOCKS_PER_XTS_DATA_UNIT;
@@ -41,7 +41,7 @@ extern "C" {
 
 // Custom data types
 
-#ifndef TC_LARGEST_COMPILER_UINT
+#if !defined (TC_LARGEST_COMPILER_UINT) && !defined (TC_INT_TYPES_DEFINED)
 #	ifdef TC_NO_COMPILER_INT64
 		typedef unsigned __int32	TC_LARGEST_COMPILER_UINT;
 #	else
@@ -0,0 +1,246 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#include <sstream>
+#include "BatchFile.h"
+#include "../Platform/StringConverter.h"
+
+namespace CipherShed
+{
+	BatchFile::BatchFile (CoreBase &core, MountOptions &options, bool ignoreOpenFiles)
+		: Core (core), ErrorCount (0), IgnoreOpenFiles (ignoreOpenFiles), Options (options)
+	{
+	}
+
+	BatchFile::~BatchFile ()
+	{
+	}
+
+	void BatchFile::Flush ()
+	{
+		FlushMountQueue();
+		FlushDismountQueue();
+	}
+
+	void BatchFile::FlushDismountQueue ()
+	{
+		if (DismountVolumes.empty())
+			return;
+
+		try
+		{
+			foreach (shared_ptr <DismountResult> result, Core.DismountVolumes (DismountVolumes, IgnoreOpenFiles))
+			{
+				if (result->DismountedVolume)
+					WriteResult (DismountLines.front(), L"dismount", *result->DismountedVolume);
+				else
+					WriteError (DismountLines.front(), L"dismount", result->MountedVolume->Path, *result->Error);
+
+				DismountLines.pop_front();
+				DismountVolumes.pop_front();
+			}
+		}
+		catch (exception &e)
+		{
+			// Volumes without a result have not been dismounted
+			foreach (shared_ptr <VolumeInfo> volume, DismountVolumes)
+			{
+				WriteError (DismountLines.front(), L"dismount", volume->Path, e);
+				DismountLines.pop_front();
+			}
+		}
+
+		DismountLines.clear();
+		DismountVolumes.clear();
+	}
+
+	void BatchFile::FlushMountQueue ()
+	{
+		if (MountPaths.empty())
+			return;
+
+		struct ResultFunctor : public MountResultFunctor
+		{
+			ResultFunctor (BatchFile &batchFile) : Batch (batchFile) { }
+
+			virtual void operator() (shared_ptr <MountResult> result)
+			{
+				Batch.WriteMountResult (*result);
+			}
+
+			BatchFile &Batch;
+		};
+
+		try
+		{
+			// Results are written as soon as they are known
+			VolumePathList volumePaths = MountPaths;
+			ResultFunctor resultFunctor (*this);
+			Core.MountVolumes (Options, volumePaths, &resultFunctor);
+		}
+		catch (exception &e)
+		{
+			// Volumes without a result have not been mounted
+			foreach (const VolumePath &volumePath, MountPaths)
+			{
+				WriteError (MountLines.front(), L"mount", volumePath, e);
+				MountLines.pop_front();
+			}
+		}
+
+		MountLines.clear();
+		MountPaths.clear();
+	}
+
+	void BatchFile::Process (TextReader &reader)
+	{
+		string line;
+		for (uint32 lineNumber = 1; reader.ReadLine (line); ++lineNumber)
+			ProcessLine (lineNumber, line);
+
+		Flush();
+	}
+
+	void BatchFile::ProcessLine (uint32 lineNumber, const string &line)
+	{
+		// Fields are separated by tabs or, if the line contains no tab, by spaces
+		vector <string> fields = StringConverter::Split (line, line.find ('\t') != string::npos ? "\t\r\n" : " \t\r\n");
+
+		if (fields.empty())
+		{
+			// An empty line executes all pending commands, which allows a controlling process to wait for their results
+			Flush();
+			return;
+		}
+
+		if (fields[0][0] == '#')
+			return;
+
+		wstring command = StringConverter::ToWide (fields[0]);
+		wstring argument = fields.size() > 1 ? StringConverter::ToWide (fields[1]) : wstring();
+
+		try
+		{
+			if (command == L"mount" && (fields.size() == 2 || fields.size() == 3))
+			{
+				FlushDismountQueue();
+
+				wstring volumePath = GetAbsolutePath (argument);
+
+				if (fields.size() == 2)
+				{
+					MountLines.push_back (lineNumber);
+					MountPaths.push_back (VolumePath (volumePath));
+				}
+				else
+				{
+					// Volumes mounted to a specified directory are not queued in order to preserve the order of slot assignment
+					FlushMountQueue();
+
+					wstring mountPoint = GetAbsolutePath (StringConverter::ToWide (fields[2]));
+					while (mountPoint.size() > 1 && mountPoint[mountPoint.size() - 1] == L'/')
+						mountPoint.erase (mountPoint.size() - 1);
+
+					MountOptions mountOptions (Options);
+					mountOptions.Path.reset (new VolumePath (volumePath));
+					mountOptions.MountPoint.reset (new DirectoryPath (mountPoint));
+
+					WriteResult (lineNumber, command, *Core.MountVolume (mountOptions));
+				}
+			}
+			else if (command == L"dismount" && fields.size() == 2)
+			{
+				FlushMountQueue();
+
+				// Mounted volumes are enumerated once for each run of dismount commands
+				if (DismountVolumes.empty())
+					MountedVolumes = Core.GetMountedVolumes();
+
+				VolumeInfoList volumes;
+				if (argument == L"all")
+				{
+					volumes = MountedVolumes;
+					volumes.sort (VolumeInfo::FirstVolumeMountedAfterSecond);
+				}
+				else
+				{
+					wstring pathFilter = GetAbsolutePath (argument);
+
+					foreach (shared_ptr <VolumeInfo> volume, MountedVolumes)
+					{
+						if (wstring (volume->Path) == pathFilter
+							|| wstring (volume->MountPoint) == pathFilter
+							|| wstring (volume->MountPoint) + L"/" == pathFilter)
+						{
+							volumes.push_back (volume);
+						}
+					}
+
+					if (volumes.empty())
+						throw VolumeNotMounted (SRC_POS);
+				}
+
+				foreach (shared_ptr <VolumeInfo> volume, volumes)
+				{
+					DismountLines.push_back (lineNumber);
+					DismountVolumes.push_back (volume);
+				}
+			}
+			else
+				throw BatchCommandIncorrect (SRC_POS, StringConverter::ToWide (line));
+		}
+		catch (exception &e)
+		{
+			WriteError (lineNumber, command, argument, e);
+		}
+	}
+
+	void BatchFile::WriteError (uint32 lineNumber, const wstring &command, const wstring &volumePath, const exception &error)
+	{
+		// Each result must fit on a single line of tab-separated fields
+		wstring message = GetErrorMessage (error);
+		for (size_t i = 0; i < message.size(); ++i)
+		{
+			if (message[i] == L'\t' || message[i] == L'\n' || message[i] == L'\r')
+				message[i] = L' ';
+		}
+
+		wstringstream resultLine;
+		resultLine << lineNumber << L"\t" << command << L"\terror\t" << volumePath << L"\t-\t" << message << L"\n";
+		WriteLine (resultLine.str());
+
+		++ErrorCount;
+	}
+
+	void BatchFile::WriteMountResult (const MountResult &result)
+	{
+		// Results may arrive in any order. Volumes queued more than once are reported in the order of their lines.
+		list <uint32>::iterator lineNumber = MountLines.begin();
+		for (VolumePathList::iterator volumePath = MountPaths.begin(); volumePath != MountPaths.end(); ++volumePath, ++lineNumber)
+		{
+			if (*volumePath == result.Path)
+			{
+				if (result.MountedVolume)
+					WriteResult (*lineNumber, L"mount", *result.MountedVolume);
+				else
+					WriteError (*lineNumber, L"mount", result.Path, *result.Error);
+
+				MountLines.erase (lineNumber);
+				MountPaths.erase (volumePath);
+				return;
+			}
+		}
+	}
+
+	void BatchFile::WriteResult (uint32 lineNumber, const wstring &command, const VolumeInfo &volume)
+	{
+		wstringstream resultLine;
+		resultLine << lineNumber << L"\t" << command << L"\tok\t" << wstring (volume.Path) << L"\t" << volume.SlotNumber << L"\t" << wstring (volume.MountPoint) << L"\n";
+		WriteLine (resultLine.str());
+	}
+}
@@ -0,0 +1,58 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#ifndef TC_HEADER_Core_BatchFile
+#define TC_HEADER_Core_BatchFile
+
+#include "../Platform/Platform.h"
+#include "../Platform/TextReader.h"
+#include "CoreBase.h"
+
+namespace CipherShed
+{
+	// Executes the mount and dismount commands of a batch file. Consecutive mount commands without a mount
+	// directory and consecutive dismount commands are queued and executed by a single core request, which
+	// tries the headers of all queued volumes concurrently. One result line is written for each volume.
+	class BatchFile
+	{
+	public:
+		BatchFile (CoreBase &core, MountOptions &options, bool ignoreOpenFiles);
+		virtual ~BatchFile ();
+
+		int GetErrorCount () const { return ErrorCount; }
+		void Process (TextReader &reader);
+		void ProcessLine (uint32 lineNumber, const string &line);
+
+	protected:
+		void Flush ();
+		void FlushDismountQueue ();
+		void FlushMountQueue ();
+		virtual wstring GetAbsolutePath (const wstring &path) const = 0;
+		virtual wstring GetErrorMessage (const exception &e) const = 0;
+		void WriteError (uint32 lineNumber, const wstring &command, const wstring &volumePath, const exception &error);
+		virtual void WriteLine (const wstring &line) = 0;
+		void WriteMountResult (const MountResult &result);
+		void WriteResult (uint32 lineNumber, const wstring &command, const VolumeInfo &volume);
+
+		CoreBase &Core;
+		list <uint32> DismountLines;
+		VolumeInfoList DismountVolumes;
+		int ErrorCount;
+		bool IgnoreOpenFiles;
+		list <uint32> MountLines;
+		VolumeInfoList MountedVolumes;
+		VolumePathList MountPaths;
+		MountOptions &Options;
+
+	private:
+		BatchFile (const BatchFile &);
+		BatchFile &operator= (const BatchFile &);
+	};
+}
+
+#endif // TC_HEADER_Core_BatchFile
@@ -0,0 +1,371 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "../Platform/Finally.h"
+#include "../Platform/Time.h"
+#include "../Volume/EncryptionModeCBC.h"
+#include "../Volume/EncryptionModeLRW.h"
+#include "../Volume/EncryptionModeXTS.h"
+#include "../Volume/EncryptionThreadPool.h"
+#include "../Volume/VolumeHeader.h"
+#include "../Volume/VolumePassword.h"
+#include "Benchmark.h"
+
+namespace CipherShed
+{
+	BenchmarkStatistics::BenchmarkStatistics (const vector <double> &samples) : ConfidenceInterval (0), Mean (0), StandardDeviation (0), TrialCount (samples.size())
+	{
+		// Two-sided 95% critical values of Student's t-distribution for 1-30 degrees of freedom
+		static const double tDistribution[] =
+		{
+			12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+			2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+			2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+		};
+
+		if (samples.empty())
+			return;
+
+		foreach (double sample, samples)
+			Mean += sample;
+
+		Mean /= samples.size();
+
+		if (samples.size() < 2)
+			return;
+
+		double sumOfSquares = 0;
+		foreach (double sample, samples)
+			sumOfSquares += (sample - Mean) * (sample - Mean);
+
+		StandardDeviation = sqrt (sumOfSquares / (samples.size() - 1));
+
+		size_t degreesOfFreedom = samples.size() - 1;
+		double t = degreesOfFreedom <= array_capacity (tDistribution) ? tDistribution[degreesOfFreedom - 1] : 1.960;
+
+		ConfidenceInterval = t * StandardDeviation / sqrt ((double) samples.size());
+	}
+
+	BenchmarkOptions::BenchmarkOptions () : MinTrialTime (25 * 1000 * 1000), TrialCount (5)
+	{
+		for (size_t size = 4 * 1024; size <= 16 * 1024 * 1024; size *= 16)
+			BufferSizes.push_back (size);
+
+		BufferSizes.push_back (64 * 1024 * 1024);
+
+		size_t cpuCount = EncryptionThreadPool::GetCpuCount();
+		for (size_t threadCount = 1; threadCount < cpuCount; threadCount *= 2)
+			ThreadCounts.push_back (threadCount);
+
+		ThreadCounts.push_back (cpuCount);
+	}
+
+	string Benchmark::EscapeJson (const wstring &str)
+	{
+		string escaped;
+
+		foreach (wchar_t c, str)
+		{
+			if (c == L'"' || c == L'\\')
+			{
+				escaped += '\\';
+				escaped += (char) c;
+			}
+			else if (c < 0x20 || c > 0x7e)
+			{
+				char buf[8];
+				snprintf (buf, sizeof (buf), "\\u%04x", (unsigned int) (c & 0xffff));
+				escaped += buf;
+			}
+			else
+				escaped += (char) c;
+		}
+
+		return escaped;
+	}
+
+	bool Benchmark::IsHwAccelerated (const EncryptionAlgorithm &ea)
+	{
+		foreach_ref (const Cipher &cipher, ea.GetCiphers())
+		{
+			if (cipher.IsHwSupportAvailable())
+				return true;
+		}
+
+		return false;
+	}
+
+	BenchmarkStatistics Benchmark::MeasureEncryption (const EncryptionAlgorithm &ea, const BufferPtr &buffer, bool decrypt, const BenchmarkOptions &options)
+	{
+		vector <double> samples;
+		uint64 unitCount = buffer.Size() / ENCRYPTION_DATA_UNIT_SIZE;
+
+		// The first trial warms up caches and lets the CPU reach its working frequency
+		for (size_t trial = 0; trial <= options.TrialCount; ++trial)
+		{
+			uint64 startTime = Time::GetMonotonicNanoseconds();
+			uint64 elapsedTime;
+			uint64 size = 0;
+
+			do
+			{
+				if (decrypt)
+					ea.DecryptSectors (buffer, 0, unitCount, ENCRYPTION_DATA_UNIT_SIZE);
+				else
+					ea.EncryptSectors (buffer, 0, unitCount, ENCRYPTION_DATA_UNIT_SIZE);
+
+				size += buffer.Size();
+				elapsedTime = Time::GetMonotonicNanoseconds() - startTime;
+			}
+			while (elapsedTime < options.MinTrialTime);
+
+			if (trial > 0)
+				samples.push_back (size * 1e9 / (elapsedTime > 0 ? elapsedTime : 1));
+		}
+
+		return BenchmarkStatistics (samples);
+	}
+
+	EncryptionBenchmarkResultList Benchmark::RunEncryption (const BenchmarkOptions &options)
+	{
+		EncryptionBenchmarkResultList results;
+
+		EncryptionAlgorithmList algorithms = options.Algorithms;
+		if (algorithms.empty())
+		{
+			foreach (shared_ptr <EncryptionAlgorithm> ea, EncryptionAlgorithm::GetAvailableAlgorithms())
+			{
+				if (!ea->IsDeprecated())
+					algorithms.push_back (ea);
+			}
+		}
+
+		// Thread pool and hardware acceleration are restored when the benchmark ends
+		size_t origThreadCount = EncryptionThreadPool::IsRunning() ? EncryptionThreadPool::GetThreadCount() : 0;
+		bool origHwSupportEnabled = Cipher::IsHwSupportEnabled();
+
+		finally_do_arg2 (size_t, origThreadCount, bool, origHwSupportEnabled,
+		{
+			Cipher::EnableHwSupport (finally_arg2);
+			EncryptionThreadPool::Stop();
+
+			if (finally_arg > 0)
+				EncryptionThreadPool::Start (finally_arg);
+		});
+
+		Cipher::EnableHwSupport (true);
+		bool hwSupportAvailable = CipherAES().IsHwSupportAvailable();
+
+		list <bool> hwAccelerationStates;
+		hwAccelerationStates.push_back (false);
+		if (hwSupportAvailable)
+			hwAccelerationStates.push_back (true);
+
+		foreach (size_t threadCount, options.ThreadCounts)
+		{
+			EncryptionThreadPool::Stop();
+
+			// A single thread encrypts the data in the calling thread
+			if (threadCount > 1)
+				EncryptionThreadPool::Start (threadCount);
+
+			foreach (bool hwAcceleration, hwAccelerationStates)
+			{
+				Cipher::EnableHwSupport (hwAcceleration);
+
+				foreach (size_t bufferSize, options.BufferSizes)
+				{
+					if (bufferSize < ENCRYPTION_DATA_UNIT_SIZE || bufferSize % ENCRYPTION_DATA_UNIT_SIZE != 0)
+						throw ParameterIncorrect (SRC_POS);
+
+					Buffer buffer (bufferSize);
+					buffer.Zero();
+
+					foreach (shared_ptr <EncryptionAlgorithm> algorithm, algorithms)
+					{
+						shared_ptr <EncryptionAlgorithm> ea = algorithm->GetNew();
+
+						// Results with hardware acceleration enabled are measured only for algorithms which use it
+						if (hwAcceleration && !IsHwAccelerated (*ea))
+							continue;
+
+						SecureBuffer key (ea->GetKeySize());
+						key.Zero();
+						ea->SetKey (key);
+
+						list < shared_ptr <EncryptionMode> > modes;
+						modes.push_back (shared_ptr <EncryptionMode> (new EncryptionModeXTS));
+						modes.push_back (shared_ptr <EncryptionMode> (new EncryptionModeLRW));
+						modes.push_back (shared_ptr <EncryptionMode> (new EncryptionModeCBC));
+
+						foreach (shared_ptr <EncryptionMode> mode, modes)
+						{
+							if (!ea->IsModeSupported (mode))
+								continue;
+
+							ea->SetMode (mode);
+
+							SecureBuffer modeKey (mode->GetKeySize());
+							modeKey.Zero();
+							mode->SetKey (modeKey);
+
+							EncryptionBenchmarkResult result;
+							result.Algorithm = ea->GetName();
+							result.Mode = mode->GetName();
+							result.BufferSize = bufferSize;
+							result.ThreadCount = EncryptionThreadPool::GetThreadCount();
+							result.HwAcceleration = hwAcceleration;
+							result.EncryptionSpeed = MeasureEncryption (*ea, buffer, false, options);
+							result.DecryptionSpeed = MeasureEncryption (*ea, buffer, true, options);
+
+							results.push_back (result);
+						}
+					}
+				}
+			}
+		}
+
+		return results;
+	}
+
+	KdfBenchmarkResultList Benchmark::RunKdf (const BenchmarkOptions &options)
+	{
+		KdfBenchmarkResultList results;
+
+		Pkcs5KdfList prfs = options.Prfs;
+		if (prfs.empty())
+			prfs = Pkcs5Kdf::GetAvailableAlgorithms();
+
+		VolumePassword password (L"benchmark", 9);
+		SecureBuffer salt (VolumeHeader::GetSaltSize());
+		salt.Zero();
+		SecureBuffer headerKey (VolumeHeader::GetLargestSerializedKeySize());
+
+		foreach (shared_ptr <Pkcs5Kdf> kdf, prfs)
+		{
+			vector <double> samples;
+
+			for (size_t trial = 0; trial <= options.TrialCount; ++trial)
+			{
+				uint64 startTime = Time::GetMonotonicNanoseconds();
+				uint64 elapsedTime;
+				uint64 derivationCount = 0;
+
+				do
+				{
+					kdf->DeriveKey (headerKey, password, salt);
+					++derivationCount;
+					elapsedTime = Time::GetMonotonicNanoseconds() - startTime;
+				}
+				while (elapsedTime < options.MinTrialTime);
+
+				if (trial > 0)
+					samples.push_back (derivationCount * 1e9 / (elapsedTime > 0 ? elapsedTime : 1));
+			}
+
+			KdfBenchmarkResult result;
+			result.Prf = kdf->GetName();
+			result.IterationCount = kdf->GetIterationCount();
+			result.DerivationSpeed = BenchmarkStatistics (samples);
+
+			results.push_back (result);
+		}
+
+		return results;
+	}
+
+	string Benchmark::ToCsv (const EncryptionBenchmarkResultList &encryptionResults, const KdfBenchmarkResultList &kdfResults)
+	{
+		// One row per measured operation
+		string csv = "benchmark,algorithm,mode,buffer_size,threads,hw_acceleration,iterations,operation,unit,trials,mean,stddev,ci95\n";
+		char row[512];
+
+		foreach (const EncryptionBenchmarkResult &result, encryptionResults)
+		{
+			for (int decrypt = 0; decrypt < 2; ++decrypt)
+			{
+				const BenchmarkStatistics &speed = decrypt ? result.DecryptionSpeed : result.EncryptionSpeed;
+
+				snprintf (row, sizeof (row), "encryption,%s,%s,%llu,%llu,%d,,%s,bytes/s,%llu,%.0f,%.0f,%.0f\n",
+					StringConverter::ToSingle (result.Algorithm).c_str(), StringConverter::ToSingle (result.Mode).c_str(),
+					(unsigned long long) result.BufferSize, (unsigned long long) result.ThreadCount, result.HwAcceleration ? 1 : 0,
+					decrypt ? "decrypt" : "encrypt", (unsigned long long) speed.TrialCount, speed.Mean, speed.StandardDeviation, speed.ConfidenceInterval);
+
+				csv += row;
+			}
+		}
+
+		foreach (const KdfBenchmarkResult &result, kdfResults)
+		{
+			const BenchmarkStatistics &speed = result.DerivationSpeed;
+
+			snprintf (row, sizeof (row), "kdf,%s,,,1,0,%d,derive,derivations/s,%llu,%.3f,%.3f,%.3f\n",
+				StringConverter::ToSingle (result.Prf).c_str(), result.IterationCount,
+				(unsigned long long) speed.TrialCount, speed.Mean, speed.StandardDeviation, speed.ConfidenceInterval);
+
+			csv += row;
+		}
+
+		return csv;
+	}
+
+	string Benchmark::ToJson (const BenchmarkStatistics &statistics)
+	{
+		char json[256];
+		snprintf (json, sizeof (json), "{ \"trials\": %llu, \"mean\": %.3f, \"stddev\": %.3f, \"ci95\": %.3f }",
+			(unsigned long long) statistics.TrialCount, statistics.Mean, statistics.StandardDeviation, statistics.ConfidenceInterval);
+
+		return json;
+	}
+
+	string Benchmark::ToJson (const EncryptionBenchmarkResultList &encryptionResults, const KdfBenchmarkResultList &kdfResults)
+	{
+		char hostName[256];
+		if (gethostname (hostName, sizeof (hostName)) != 0)
+			hostName[0] = 0;
+		hostName[sizeof (hostName) - 1] = 0;
+
+		char str[512];
+		snprintf (str, sizeof (str), "{\n  \"host\": \"%s\",\n  \"cpu_count\": %llu,\n  \"encryption\": [",
+			EscapeJson (StringConverter::ToWide (string (hostName))).c_str(), (unsigned long long) EncryptionThreadPool::GetCpuCount());
+
+		string json = str;
+		bool first = true;
+
+		foreach (const EncryptionBenchmarkResult &result, encryptionResults)
+		{
+			snprintf (str, sizeof (str), "%s\n    { \"algorithm\": \"%s\", \"mode\": \"%s\", \"buffer_size\": %llu, \"threads\": %llu, \"hw_acceleration\": %s, ",
+				first ? "" : ",", EscapeJson (result.Algorithm).c_str(), EscapeJson (result.Mode).c_str(),
+				(unsigned long long) result.BufferSize, (unsigned long long) result.ThreadCount, result.HwAcceleration ? "true" : "false");
+
+			json += str;
+			json += "\"encryption_bytes_per_second\": " + ToJson (result.EncryptionSpeed) + ", ";
+			json += "\"decryption_bytes_per_second\": " + ToJson (result.DecryptionSpeed) + " }";
+			first = false;
+		}
+
+		json += "\n  ],\n  \"kdf\": [";
+		first = true;
+
+		foreach (const KdfBenchmarkResult &result, kdfResults)
+		{
+			snprintf (str, sizeof (str), "%s\n    { \"prf\": \"%s\", \"iterations\": %d, ",
+				first ? "" : ",", EscapeJson (result.Prf).c_str(), result.IterationCount);
+
+			json += str;
+			json += "\"derivations_per_second\": " + ToJson (result.DerivationSpeed) + " }";
+			first = false;
+		}
+
+		json += "\n  ]\n}\n";
+		return json;
+	}
+}
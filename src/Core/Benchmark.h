@@ -0,0 +1,81 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#ifndef TC_HEADER_Core_Benchmark
+#define TC_HEADER_Core_Benchmark
+
+#include "../Platform/Platform.h"
+#include "../Volume/EncryptionAlgorithm.h"
+#include "../Volume/Pkcs5Kdf.h"
+
+namespace CipherShed
+{
+	struct BenchmarkStatistics
+	{
+		BenchmarkStatistics () : ConfidenceInterval (0), Mean (0), StandardDeviation (0), TrialCount (0) { }
+		BenchmarkStatistics (const vector <double> &samples);
+
+		double ConfidenceInterval;	// Half-width of the 95% confidence interval of the mean
+		double Mean;
+		double StandardDeviation;
+		size_t TrialCount;
+	};
+
+	struct EncryptionBenchmarkResult
+	{
+		wstring Algorithm;
+		wstring Mode;
+		size_t BufferSize;
+		size_t ThreadCount;
+		bool HwAcceleration;
+		BenchmarkStatistics EncryptionSpeed;	// Bytes per second
+		BenchmarkStatistics DecryptionSpeed;	// Bytes per second
+	};
+
+	struct KdfBenchmarkResult
+	{
+		wstring Prf;
+		int IterationCount;
+		BenchmarkStatistics DerivationSpeed;	// Header key derivations per second
+	};
+
+	typedef list <EncryptionBenchmarkResult> EncryptionBenchmarkResultList;
+	typedef list <KdfBenchmarkResult> KdfBenchmarkResultList;
+
+	struct BenchmarkOptions
+	{
+		BenchmarkOptions ();
+
+		EncryptionAlgorithmList Algorithms;	// Non-deprecated algorithms if empty
+		list <size_t> BufferSizes;
+		uint64 MinTrialTime;				// Nanoseconds
+		Pkcs5KdfList Prfs;					// All PRFs if empty
+		list <size_t> ThreadCounts;
+		size_t TrialCount;
+	};
+
+	class Benchmark
+	{
+	public:
+		static EncryptionBenchmarkResultList RunEncryption (const BenchmarkOptions &options);
+		static KdfBenchmarkResultList RunKdf (const BenchmarkOptions &options);
+		static string ToCsv (const EncryptionBenchmarkResultList &encryptionResults, const KdfBenchmarkResultList &kdfResults);
+		static string ToJson (const EncryptionBenchmarkResultList &encryptionResults, const KdfBenchmarkResultList &kdfResults);
+
+	protected:
+		static string EscapeJson (const wstring &str);
+		static bool IsHwAccelerated (const EncryptionAlgorithm &ea);
+		static BenchmarkStatistics MeasureEncryption (const EncryptionAlgorithm &ea, const BufferPtr &buffer, bool decrypt, const BenchmarkOptions &options);
+		static string ToJson (const BenchmarkStatistics &statistics);
+
+	private:
+		Benchmark ();
+	};
+}
+
+#endif // TC_HEADER_Core_Benchmark
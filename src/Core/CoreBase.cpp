@@ -104,6 +104,38 @@ namespace CipherShed
 		keyfile.Write (keyfileBuffer);
 	}
 
+	DismountResultList CoreBase::DismountVolumes (const VolumeInfoList &mountedVolumes, bool ignoreOpenFiles)
+	{
+		DismountResultList results;
+
+		foreach (shared_ptr <VolumeInfo> mountedVolume, mountedVolumes)
+		{
+			make_shared_auto (DismountResult, result);
+			result->MountedVolume = mountedVolume;
+
+			try
+			{
+				result->DismountedVolume = DismountVolume (mountedVolume, ignoreOpenFiles);
+			}
+			catch (Exception &e)
+			{
+				result->Error.reset (e.CloneNew());
+			}
+			catch (exception &e)
+			{
+				result->Error.reset (new ExternalException (SRC_POS, StringConverter::ToExceptionString (e)));
+			}
+			catch (...)
+			{
+				result->Error.reset (new UnknownException (SRC_POS));
+			}
+
+			results.push_back (result);
+		}
+
+		return results;
+	}
+
 	VolumeSlotNumber CoreBase::GetFirstFreeSlotNumber (VolumeSlotNumber startFrom) const
 	{
 		if (startFrom < GetFirstSlotNumber())
@@ -242,10 +274,63 @@ namespace CipherShed
 		return GetMountedVolume (volumePath);
 	}
 
-	shared_ptr <Volume> CoreBase::OpenVolume (shared_ptr <VolumePath> volumePath, bool preserveTimestamps, shared_ptr <VolumePassword> password, shared_ptr <KeyfileList> keyfiles, VolumeProtection::Enum protection, shared_ptr <VolumePassword> protectionPassword, shared_ptr <KeyfileList> protectionKeyfiles, bool sharedAccessAllowed, VolumeType::Enum volumeType, bool useBackupHeaders, bool partitionInSystemEncryptionScope) const
+	MountResultList CoreBase::MountVolumes (MountOptions &options, const VolumePathList &volumePaths, MountResultFunctor *resultFunctor)
+	{
+		MountResultList results;
+
+		foreach (const VolumePath &volumePath, volumePaths)
+		{
+			make_shared_auto (MountResult, result);
+			result->Path = volumePath;
+
+			MountOptions mountOptions (options);
+			mountOptions.Path.reset (new VolumePath (volumePath));
+			mountOptions.MountPoint.reset (new DirectoryPath);
+
+			try
+			{
+				mountOptions.SlotNumber = GetFirstFreeSlotNumber (options.SlotNumber);
+
+				try
+				{
+					result->MountedVolume = MountVolume (mountOptions);
+				}
+				catch (VolumeHostInUse&)
+				{
+					if (options.SharedAccessAllowed)
+						throw;
+
+					mountOptions.SharedAccessAllowed = true;
+					result->MountedVolume = MountVolume (mountOptions);
+					result->SharedAccessUsed = true;
+				}
+			}
+			catch (Exception &e)
+			{
+				result->Error.reset (e.CloneNew());
+			}
+			catch (exception &e)
+			{
+				result->Error.reset (new ExternalException (SRC_POS, StringConverter::ToExceptionString (e)));
+			}
+			catch (...)
+			{
+				result->Error.reset (new UnknownException (SRC_POS));
+			}
+
+			results.push_back (result);
+
+			if (resultFunctor)
+				(*resultFunctor) (result);
+		}
+
+		return results;
+	}
+
+	shared_ptr <Volume> CoreBase::OpenVolume (shared_ptr <VolumePath> volumePath, bool preserveTimestamps, shared_ptr <VolumePassword> password, shared_ptr <KeyfileList> keyfiles, VolumeProtection::Enum protection, shared_ptr <VolumePassword> protectionPassword, shared_ptr <KeyfileList> protectionKeyfiles, bool sharedAccessAllowed, VolumeType::Enum volumeType, bool useBackupHeaders, bool partitionInSystemEncryptionScope, bool useHeaderKeyCache, const VolumeOpenHint &openHint) const
 	{
 		make_shared_auto (Volume, volume);
-		volume->Open (*volumePath, preserveTimestamps, password, keyfiles, protection, protectionPassword, protectionKeyfiles, sharedAccessAllowed, volumeType, useBackupHeaders, partitionInSystemEncryptionScope);
+		volume->Open (*volumePath, preserveTimestamps, password, keyfiles, protection, protectionPassword, protectionKeyfiles, sharedAccessAllowed, volumeType, useBackupHeaders, partitionInSystemEncryptionScope, useHeaderKeyCache, openHint);
 		return volume;
 	}
 	
@@ -260,6 +345,13 @@ namespace CipherShed
 		encryptionAlgorithm->GetMode()->SetKey (modeKey);
 	}
 
+	void CoreBase::RandomizeKeystreamKey (RandomKeystream &keystream) const
+	{
+		SecureBuffer key (keystream.GetKeySize());
+		RandomNumberGenerator::GetData (key);
+		keystream.SetKey (key);
+	}
+
 	void CoreBase::ReEncryptVolumeHeaderWithNewSalt (const BufferPtr &newHeaderBuffer, shared_ptr <VolumeHeader> header, shared_ptr <VolumePassword> password, shared_ptr <KeyfileList> keyfiles) const
 	{
 		shared_ptr <Pkcs5Kdf> pkcs5Kdf = header->GetPkcs5Kdf();
@@ -29,6 +29,7 @@ namespace CipherShed
 #define TC_EXCEPTION_SET \
 	TC_EXCEPTION_NODECL (ElevationFailed); \
 	TC_EXCEPTION_NODECL (RootDeviceUnavailable); \
+	TC_EXCEPTION (BatchCommandIncorrect); \
 	TC_EXCEPTION (DriveLetterUnavailable); \
 	TC_EXCEPTION (DriverError); \
 	TC_EXCEPTION (EncryptedSystemRequired); \
@@ -42,6 +43,7 @@ namespace CipherShed
 	TC_EXCEPTION (UnsupportedSectorSizeHiddenVolumeProtection); \
 	TC_EXCEPTION (UnsupportedSectorSizeNoKernelCrypto); \
 	TC_EXCEPTION (VolumeAlreadyMounted); \
+	TC_EXCEPTION (VolumeNotMounted); \
 	TC_EXCEPTION (VolumeSlotUnavailable);
 
 	TC_EXCEPTION_SET;
@@ -0,0 +1,49 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#include "DismountResult.h"
+#include "../Platform/SerializerFactory.h"
+using namespace std;
+
+namespace CipherShed
+{
+	void DismountResult::Deserialize (shared_ptr <Stream> stream)
+	{
+		Serializer sr (stream);
+
+		if (!sr.DeserializeBool ("DismountedVolumeNull"))
+			DismountedVolume = Serializable::DeserializeNew <VolumeInfo> (stream);
+		else
+			DismountedVolume.reset();
+
+		if (!sr.DeserializeBool ("ErrorNull"))
+			Error = Serializable::DeserializeNew <Exception> (stream);
+		else
+			Error.reset();
+
+		MountedVolume = Serializable::DeserializeNew <VolumeInfo> (stream);
+	}
+
+	void DismountResult::Serialize (shared_ptr <Stream> stream) const
+	{
+		Serializable::Serialize (stream);
+		Serializer sr (stream);
+
+		sr.Serialize ("DismountedVolumeNull", DismountedVolume == nullptr);
+		if (DismountedVolume)
+			DismountedVolume->Serialize (stream);
+
+		sr.Serialize ("ErrorNull", Error == nullptr);
+		if (Error)
+			Error->Serialize (stream);
+
+		MountedVolume->Serialize (stream);
+	}
+
+	TC_SERIALIZER_FACTORY_ADD_CLASS (DismountResult);
+}
@@ -0,0 +1,45 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#ifndef TC_HEADER_Core_DismountResult
+#define TC_HEADER_Core_DismountResult
+
+#include "../Platform/Platform.h"
+#include "../Platform/Serializable.h"
+#include "../Volume/VolumeInfo.h"
+
+namespace CipherShed
+{
+	struct DismountResult;
+	typedef list < shared_ptr <DismountResult> > DismountResultList;
+
+	// Outcome of dismounting one of the volumes passed to CoreBase::DismountVolumes()
+	struct DismountResult : public Serializable
+	{
+		DismountResult ()
+		{
+		}
+
+		DismountResult (shared_ptr <VolumeInfo> mountedVolume)
+			: MountedVolume (mountedVolume)
+		{
+		}
+
+		virtual ~DismountResult ()
+		{
+		}
+
+		TC_SERIALIZABLE (DismountResult);
+
+		shared_ptr <VolumeInfo> DismountedVolume;
+		shared_ptr <Exception> Error;
+		shared_ptr <VolumeInfo> MountedVolume;
+	};
+}
+
+#endif // TC_HEADER_Core_DismountResult
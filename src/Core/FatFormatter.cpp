@@ -266,7 +266,7 @@ namespace CipherShed
 		sector[508+0] = 0x00;
 	}
 
-	void FatFormatter::Format (WriteSectorCallback &writeSector, uint64 deviceSize, uint32 clusterSize, uint32 sectorSize)
+	void FatFormatter::Format (WriteExtentCallback &writeExtent, uint64 deviceSize, uint32 clusterSize, uint32 sectorSize)
 	{
 		fatparams fatParams;
 
@@ -284,101 +284,105 @@ namespace CipherShed
 		GetFatParams (&fatParams); 
 		fatparams *ft = &fatParams;
 
-		SecureBuffer sector (ft->sector_size);
-		uint32 sectorNumber = 0;
+		uint64 offset = 0;
 
-		/* Write the data area */
-
-		sector.Zero();
+		/* Boot area */
+		uint32 bootSectorCount = (ft->size_fat == 32 ? 8 : 1);
+		SecureBuffer bootArea (bootSectorCount * ft->sector_size);
+		bootArea.Zero();
 
 		uint32 volumeId;
 		RandomNumberGenerator::GetDataFast (BufferPtr ((byte *) &volumeId, sizeof (volumeId)));
 
-		PutBoot (ft, (byte *) sector, volumeId);
-		writeSector (sector); ++sectorNumber;
+		PutBoot (ft, (byte *) bootArea, volumeId);
 
 		/* fat32 boot area */
-		if (ft->size_fat == 32)				
+		if (ft->size_fat == 32)
 		{
 			/* fsinfo */
-			PutFSInfo((byte *) sector, ft);
-			writeSector (sector); ++sectorNumber;
+			PutFSInfo ((byte *) bootArea + ft->sector_size, ft);
 
 			/* reserved */
-			while (sectorNumber < 6)
+			for (uint32 n = 2; n < 6; n++)
 			{
-				sector.Zero();
-				sector[508+3] = 0xaa; /* TrailSig */
-				sector[508+2] = 0x55;
-				writeSector (sector); ++sectorNumber;
+				bootArea[n * ft->sector_size + 508+3] = 0xaa; /* TrailSig */
+				bootArea[n * ft->sector_size + 508+2] = 0x55;
 			}
 
 			/* bootsector backup */
-			sector.Zero();
-			PutBoot (ft, (byte *) sector, volumeId);
-			writeSector (sector); ++sectorNumber;
-
-			PutFSInfo((byte *) sector, ft);
-			writeSector (sector); ++sectorNumber;
+			PutBoot (ft, (byte *) bootArea + 6 * ft->sector_size, volumeId);
+			PutFSInfo ((byte *) bootArea + 7 * ft->sector_size, ft);
 		}
 
+		if (!writeExtent (offset, bootArea.Size(), bootArea))
+			return;
+		offset += bootArea.Size();
+
 		/* reserved */
-		while (sectorNumber < (uint32)ft->reserved)
+		if (ft->reserved > bootSectorCount)
 		{
-			sector.Zero();
-			writeSector (sector); ++sectorNumber;
+			uint64 length = (uint64) (ft->reserved - bootSectorCount) * ft->sector_size;
+			if (!writeExtent (offset, length, ConstBufferPtr()))
+				return;
+			offset += length;
 		}
 
 		/* write fat */
+		SecureBuffer fatSector (ft->sector_size);
+		fatSector.Zero();
+
+		byte fat_sig[12];
+		size_t fatSigSize = 0;
+
+		if (ft->size_fat == 32)
+		{
+			fat_sig[0] = (byte) ft->media;
+			fat_sig[1] = fat_sig[2] = 0xff;
+			fat_sig[3] = 0x0f;
+			fat_sig[4] = fat_sig[5] = fat_sig[6] = 0xff;
+			fat_sig[7] = 0x0f;
+			fat_sig[8] = fat_sig[9] = fat_sig[10] = 0xff;
+			fat_sig[11] = 0x0f;
+			fatSigSize = 12;
+		}
+		else if (ft->size_fat == 16)
+		{
+			fat_sig[0] = (byte) ft->media;
+			fat_sig[1] = 0xff;
+			fat_sig[2] = 0xff;
+			fat_sig[3] = 0xff;
+			fatSigSize = 4;
+		}
+		else if (ft->size_fat == 12)
+		{
+			fat_sig[0] = (byte) ft->media;
+			fat_sig[1] = 0xff;
+			fat_sig[2] = 0xff;
+			fat_sig[3] = 0x00;
+			fatSigSize = 4;
+		}
+
+		memcpy (fatSector, fat_sig, fatSigSize);
+
 		for (uint32 x = 1; x <= ft->fats; x++)
 		{
-			for (uint32 n = 0; n < ft->fat_length; n++)
+			// Only the first sector of each FAT contains non-zero entries
+			if (!writeExtent (offset, fatSector.Size(), fatSector))
+				return;
+			offset += fatSector.Size();
+
+			if (ft->fat_length > 1)
 			{
-				sector.Zero();
-
-				if (n == 0)
-				{
-					byte fat_sig[12];
-					if (ft->size_fat == 32)
-					{
-						fat_sig[0] = (byte) ft->media;
-						fat_sig[1] = fat_sig[2] = 0xff;
-						fat_sig[3] = 0x0f;
-						fat_sig[4] = fat_sig[5] = fat_sig[6] = 0xff;
-						fat_sig[7] = 0x0f;
-						fat_sig[8] = fat_sig[9] = fat_sig[10] = 0xff;
-						fat_sig[11] = 0x0f;
-						memcpy (sector, fat_sig, 12);
-					}				
-					else if (ft->size_fat == 16)
-					{
-						fat_sig[0] = (byte) ft->media;
-						fat_sig[1] = 0xff;
-						fat_sig[2] = 0xff;
-						fat_sig[3] = 0xff;
-						memcpy (sector, fat_sig, 4);
-					}
-					else if (ft->size_fat == 12)
-					{
-						fat_sig[0] = (byte) ft->media;
-						fat_sig[1] = 0xff;
-						fat_sig[2] = 0xff;
-						fat_sig[3] = 0x00;
-						memcpy (sector, fat_sig, 4);
-					}
-				}
-
-				if (!writeSector (sector))
+				uint64 length = (uint64) (ft->fat_length - 1) * ft->sector_size;
+				if (!writeExtent (offset, length, ConstBufferPtr()))
 					return;
+				offset += length;
 			}
 		}
 
 		/* write rootdir */
-		for (uint32 x = 0; x < ft->size_root_dir / ft->sector_size; x++)
-		{
-			sector.Zero();
-			if (!writeSector (sector))
-				return;
-		}
+		uint64 rootDirLength = (uint64) (ft->size_root_dir / ft->sector_size) * ft->sector_size;
+		if (rootDirLength > 0)
+			writeExtent (offset, rootDirLength, ConstBufferPtr());
 	}
 }
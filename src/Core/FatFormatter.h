@@ -16,13 +16,15 @@ namespace CipherShed
 	class FatFormatter
 	{
 	public:
-		struct WriteSectorCallback
+		struct WriteExtentCallback
 		{
-			virtual ~WriteSectorCallback () { }
-			virtual bool operator() (const BufferPtr &sector) = 0;
+			virtual ~WriteExtentCallback () { }
+
+			// Extents are passed in ascending order without gaps. Data is empty if the extent is filled with zeros.
+			virtual bool operator() (uint64 offset, uint64 length, const ConstBufferPtr &data) = 0;
 		};
 
-		static void Format (WriteSectorCallback &writeSector, uint64 deviceSize, uint32 clusterSize, uint32 sectorSize);
+		static void Format (WriteExtentCallback &writeExtent, uint64 deviceSize, uint32 clusterSize, uint32 sectorSize);
 	};
 }
 
@@ -0,0 +1,143 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#include "HmacDrbg.h"
+
+namespace CipherShed
+{
+	HmacDrbg::HmacDrbg (shared_ptr <Hash> hash) : Instantiated (false), MacHash (hash), ReseedCounter (0)
+	{
+		if (MacHash->GetDigestSize() > MacHash->GetBlockSize())
+			throw ParameterIncorrect (SRC_POS);
+
+		InnerDigest.Allocate (MacHash->GetDigestSize());
+		InnerKeyPad.Allocate (MacHash->GetBlockSize());
+		OuterKeyPad.Allocate (MacHash->GetBlockSize());
+		V.Allocate (MacHash->GetDigestSize());
+	}
+
+	void HmacDrbg::Generate (const BufferPtr &buffer, const ConstBufferPtr &additionalInput)
+	{
+		if (!Instantiated)
+			throw NotInitialized (SRC_POS);
+
+		if (buffer.Size() > MaxBytesPerRequest)
+			throw ParameterTooLarge (SRC_POS);
+
+		if (additionalInput.Size() > 0)
+			Update (additionalInput);
+
+		for (size_t offset = 0; offset < buffer.Size(); offset += V.Size())
+		{
+			MacBegin();
+			MacData (V);
+			MacEnd (V);
+
+			size_t size = min (V.Size(), buffer.Size() - offset);
+			buffer.GetRange (offset, size).CopyFrom (V.GetRange (0, size));
+		}
+
+		Update (additionalInput);
+		++ReseedCounter;
+	}
+
+	void HmacDrbg::Instantiate (const ConstBufferPtr &entropy, const ConstBufferPtr &nonce, const ConstBufferPtr &personalization)
+	{
+		SecureBuffer key (V.Size());
+		key.Zero();
+		SetKey (key);
+
+		for (size_t i = 0; i < V.Size(); ++i)
+			V[i] = 0x01;
+
+		Update (entropy, nonce, personalization);
+
+		ReseedCounter = 1;
+		Instantiated = true;
+	}
+
+	void HmacDrbg::MacBegin ()
+	{
+		MacHash->Init();
+		MacHash->ProcessData (InnerKeyPad);
+	}
+
+	void HmacDrbg::MacData (const ConstBufferPtr &data)
+	{
+		if (data.Size() > 0)
+			MacHash->ProcessData (data);
+	}
+
+	void HmacDrbg::MacEnd (const BufferPtr &mac)
+	{
+		MacHash->GetDigest (InnerDigest);
+
+		MacHash->Init();
+		MacHash->ProcessData (OuterKeyPad);
+		MacHash->ProcessData (InnerDigest);
+		MacHash->GetDigest (mac);
+	}
+
+	void HmacDrbg::Reseed (const ConstBufferPtr &entropy, const ConstBufferPtr &additionalInput)
+	{
+		if (!Instantiated)
+			throw NotInitialized (SRC_POS);
+
+		Update (entropy, additionalInput);
+		ReseedCounter = 1;
+	}
+
+	void HmacDrbg::SetKey (const ConstBufferPtr &key)
+	{
+		// Key is never longer than the block size of the hash function
+		for (size_t i = 0; i < InnerKeyPad.Size(); ++i)
+		{
+			byte k = i < key.Size() ? key[i] : 0;
+			InnerKeyPad[i] = k ^ 0x36;
+			OuterKeyPad[i] = k ^ 0x5c;
+		}
+	}
+
+	void HmacDrbg::Uninstantiate ()
+	{
+		InnerDigest.Erase();
+		InnerKeyPad.Erase();
+		OuterKeyPad.Erase();
+		V.Erase();
+
+		ReseedCounter = 0;
+		Instantiated = false;
+	}
+
+	void HmacDrbg::Update (const ConstBufferPtr &data1, const ConstBufferPtr &data2, const ConstBufferPtr &data3)
+	{
+		SecureBuffer key (V.Size());
+		byte separator = 0x00;
+
+		while (true)
+		{
+			MacBegin();
+			MacData (V);
+			MacData (ConstBufferPtr (&separator, 1));
+			MacData (data1);
+			MacData (data2);
+			MacData (data3);
+			MacEnd (key);
+			SetKey (key);
+
+			MacBegin();
+			MacData (V);
+			MacEnd (V);
+
+			if (separator == 0x01 || data1.Size() + data2.Size() + data3.Size() == 0)
+				break;
+
+			separator = 0x01;
+		}
+	}
+}
@@ -0,0 +1,54 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#ifndef TC_HEADER_Core_HmacDrbg
+#define TC_HEADER_Core_HmacDrbg
+
+#include "../Platform/Platform.h"
+#include "../Volume/Hash.h"
+
+namespace CipherShed
+{
+	// HMAC_DRBG deterministic random bit generator as specified in NIST SP 800-90A
+	class HmacDrbg
+	{
+	public:
+		HmacDrbg (shared_ptr <Hash> hash = shared_ptr <Hash> (new Sha512));
+		virtual ~HmacDrbg () { }
+
+		void Generate (const BufferPtr &buffer, const ConstBufferPtr &additionalInput = ConstBufferPtr());
+		uint64 GetReseedCounter () const { return ReseedCounter; }
+		void Instantiate (const ConstBufferPtr &entropy, const ConstBufferPtr &nonce, const ConstBufferPtr &personalization = ConstBufferPtr());
+		bool IsInstantiated () const { return Instantiated; }
+		void Reseed (const ConstBufferPtr &entropy, const ConstBufferPtr &additionalInput = ConstBufferPtr());
+		void Uninstantiate ();
+
+		static const size_t MaxBytesPerRequest = 65536;
+
+	protected:
+		void MacBegin ();
+		void MacData (const ConstBufferPtr &data);
+		void MacEnd (const BufferPtr &mac);
+		void SetKey (const ConstBufferPtr &key);
+		void Update (const ConstBufferPtr &data1, const ConstBufferPtr &data2 = ConstBufferPtr(), const ConstBufferPtr &data3 = ConstBufferPtr());
+
+		bool Instantiated;
+		SecureBuffer InnerDigest;
+		SecureBuffer InnerKeyPad;
+		shared_ptr <Hash> MacHash;
+		SecureBuffer OuterKeyPad;
+		uint64 ReseedCounter;
+		SecureBuffer V;
+
+	private:
+		HmacDrbg (const HmacDrbg &);
+		HmacDrbg &operator= (const HmacDrbg &);
+	};
+}
+
+#endif // TC_HEADER_Core_HmacDrbg
@@ -18,6 +18,7 @@ namespace CipherShed
 #define TC_CLONE(NAME) NAME = other.NAME
 #define TC_CLONE_SHARED(TYPE,NAME) NAME = other.NAME ? make_shared <TYPE> (*other.NAME) : shared_ptr <TYPE> ()
 
+		TC_CLONE (CacheHeaderKeys);
 		TC_CLONE (CachePassword);
 		TC_CLONE (FilesystemOptions);
 		TC_CLONE (FilesystemType);
@@ -26,6 +27,8 @@ namespace CipherShed
 		TC_CLONE (NoFilesystem);
 		TC_CLONE (NoHardwareCrypto);
 		TC_CLONE (NoKernelCrypto);
+		TC_CLONE (OpenHint);
+		TC_CLONE (OpenHints);
 		TC_CLONE_SHARED (VolumePassword, Password);
 		TC_CLONE_SHARED (VolumePath, Path);
 		TC_CLONE (PartitionInSystemEncryptionScope);
@@ -35,6 +38,7 @@ namespace CipherShed
 		TC_CLONE_SHARED (KeyfileList, ProtectionKeyfiles);
 		TC_CLONE (Removable);
 		TC_CLONE (SharedAccessAllowed);
+		TC_CLONE (SharedFuseService);
 		TC_CLONE (SlotNumber);
 		TC_CLONE (UseBackupHeaders);
 	}
@@ -43,6 +47,7 @@ namespace CipherShed
 	{
 		Serializer sr (stream);
 
+		sr.Deserialize ("CacheHeaderKeys", CacheHeaderKeys);
 		sr.Deserialize ("CachePassword", CachePassword);
 		sr.Deserialize ("FilesystemOptions", FilesystemOptions);
 		sr.Deserialize ("FilesystemType", FilesystemType);
@@ -57,6 +62,22 @@ namespace CipherShed
 		sr.Deserialize ("NoFilesystem", NoFilesystem);
 		sr.Deserialize ("NoHardwareCrypto", NoHardwareCrypto);
 		sr.Deserialize ("NoKernelCrypto", NoKernelCrypto);
+		sr.Deserialize ("OpenHintEncryptionAlgorithmName", OpenHint.EncryptionAlgorithmName);
+		sr.Deserialize ("OpenHintPkcs5PrfName", OpenHint.Pkcs5PrfName);
+
+		OpenHints.clear();
+		list <wstring> openHintPaths = sr.DeserializeWStringList ("OpenHintPaths");
+		list <wstring> openHintEncryptionAlgorithmNames = sr.DeserializeWStringList ("OpenHintEncryptionAlgorithmNames");
+		list <wstring> openHintPkcs5PrfNames = sr.DeserializeWStringList ("OpenHintPkcs5PrfNames");
+
+		if (openHintPaths.size() != openHintEncryptionAlgorithmNames.size() || openHintPaths.size() != openHintPkcs5PrfNames.size())
+			throw ParameterIncorrect (SRC_POS);
+
+		list <wstring>::const_iterator encryptionAlgorithmName = openHintEncryptionAlgorithmNames.begin();
+		list <wstring>::const_iterator pkcs5PrfName = openHintPkcs5PrfNames.begin();
+
+		foreach (const wstring &path, openHintPaths)
+			OpenHints[path] = VolumeOpenHint (*pkcs5PrfName++, *encryptionAlgorithmName++);
 
 		if (!sr.DeserializeBool ("PasswordNull"))
 			Password = Serializable::DeserializeNew <VolumePassword> (stream);
@@ -81,6 +102,7 @@ namespace CipherShed
 		ProtectionKeyfiles = Keyfile::DeserializeList (stream, "ProtectionKeyfiles");
 		sr.Deserialize ("Removable", Removable);
 		sr.Deserialize ("SharedAccessAllowed", SharedAccessAllowed);
+		sr.Deserialize ("SharedFuseService", SharedFuseService);
 		sr.Deserialize ("SlotNumber", SlotNumber);
 		sr.Deserialize ("UseBackupHeaders", UseBackupHeaders);
 	}
@@ -90,6 +112,7 @@ namespace CipherShed
 		Serializable::Serialize (stream);
 		Serializer sr (stream);
 
+		sr.Serialize ("CacheHeaderKeys", CacheHeaderKeys);
 		sr.Serialize ("CachePassword", CachePassword);
 		sr.Serialize ("FilesystemOptions", FilesystemOptions);
 		sr.Serialize ("FilesystemType", FilesystemType);
@@ -102,6 +125,23 @@ namespace CipherShed
 		sr.Serialize ("NoFilesystem", NoFilesystem);
 		sr.Serialize ("NoHardwareCrypto", NoHardwareCrypto);
 		sr.Serialize ("NoKernelCrypto", NoKernelCrypto);
+		sr.Serialize ("OpenHintEncryptionAlgorithmName", OpenHint.EncryptionAlgorithmName);
+		sr.Serialize ("OpenHintPkcs5PrfName", OpenHint.Pkcs5PrfName);
+
+		list <wstring> openHintPaths;
+		list <wstring> openHintEncryptionAlgorithmNames;
+		list <wstring> openHintPkcs5PrfNames;
+
+		for (VolumeOpenHintMap::const_iterator i = OpenHints.begin(); i != OpenHints.end(); ++i)
+		{
+			openHintPaths.push_back (i->first);
+			openHintEncryptionAlgorithmNames.push_back (i->second.EncryptionAlgorithmName);
+			openHintPkcs5PrfNames.push_back (i->second.Pkcs5PrfName);
+		}
+
+		sr.Serialize ("OpenHintPaths", openHintPaths);
+		sr.Serialize ("OpenHintEncryptionAlgorithmNames", openHintEncryptionAlgorithmNames);
+		sr.Serialize ("OpenHintPkcs5PrfNames", openHintPkcs5PrfNames);
 		
 		sr.Serialize ("PasswordNull", Password == nullptr);
 		if (Password)
@@ -122,6 +162,7 @@ namespace CipherShed
 		Keyfile::SerializeList (stream, "ProtectionKeyfiles", ProtectionKeyfiles);
 		sr.Serialize ("Removable", Removable);
 		sr.Serialize ("SharedAccessAllowed", SharedAccessAllowed);
+		sr.Serialize ("SharedFuseService", SharedFuseService);
 		sr.Serialize ("SlotNumber", SlotNumber);
 		sr.Serialize ("UseBackupHeaders", UseBackupHeaders);
 	}
@@ -21,6 +21,7 @@ namespace CipherShed
 	{
 		MountOptions ()
 			:
+			CacheHeaderKeys (false),
 			CachePassword (false),
 			NoFilesystem (false),
 			NoHardwareCrypto (false),
@@ -30,6 +31,7 @@ namespace CipherShed
 			Protection (VolumeProtection::None),
 			Removable (false),
 			SharedAccessAllowed (false),
+			SharedFuseService (false),
 			SlotNumber (0),
 			UseBackupHeaders (false)
 		{
@@ -42,6 +44,7 @@ namespace CipherShed
 
 		TC_SERIALIZABLE (MountOptions);
 
+		bool CacheHeaderKeys;
 		bool CachePassword;
 		wstring FilesystemOptions;
 		wstring FilesystemType;
@@ -50,6 +53,8 @@ namespace CipherShed
 		bool NoFilesystem;
 		bool NoHardwareCrypto;
 		bool NoKernelCrypto;
+		VolumeOpenHint OpenHint;
+		VolumeOpenHintMap OpenHints;
 		shared_ptr <VolumePassword> Password;
 		bool PartitionInSystemEncryptionScope;
 		shared_ptr <VolumePath> Path;
@@ -59,6 +64,7 @@ namespace CipherShed
 		shared_ptr <KeyfileList> ProtectionKeyfiles;
 		bool Removable;
 		bool SharedAccessAllowed;
+		bool SharedFuseService;
 		VolumeSlotNumber SlotNumber;
 		bool UseBackupHeaders;
 
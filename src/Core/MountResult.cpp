@@ -0,0 +1,51 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#include "MountResult.h"
+#include "../Platform/SerializerFactory.h"
+using namespace std;
+
+namespace CipherShed
+{
+	void MountResult::Deserialize (shared_ptr <Stream> stream)
+	{
+		Serializer sr (stream);
+
+		if (!sr.DeserializeBool ("ErrorNull"))
+			Error = Serializable::DeserializeNew <Exception> (stream);
+		else
+			Error.reset();
+
+		if (!sr.DeserializeBool ("MountedVolumeNull"))
+			MountedVolume = Serializable::DeserializeNew <VolumeInfo> (stream);
+		else
+			MountedVolume.reset();
+
+		Path = sr.DeserializeWString ("Path");
+		sr.Deserialize ("SharedAccessUsed", SharedAccessUsed);
+	}
+
+	void MountResult::Serialize (shared_ptr <Stream> stream) const
+	{
+		Serializable::Serialize (stream);
+		Serializer sr (stream);
+
+		sr.Serialize ("ErrorNull", Error == nullptr);
+		if (Error)
+			Error->Serialize (stream);
+
+		sr.Serialize ("MountedVolumeNull", MountedVolume == nullptr);
+		if (MountedVolume)
+			MountedVolume->Serialize (stream);
+
+		sr.Serialize ("Path", wstring (Path));
+		sr.Serialize ("SharedAccessUsed", SharedAccessUsed);
+	}
+
+	TC_SERIALIZER_FACTORY_ADD_CLASS (MountResult);
+}
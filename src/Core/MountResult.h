@@ -0,0 +1,56 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#ifndef TC_HEADER_Core_MountResult
+#define TC_HEADER_Core_MountResult
+
+#include "../Platform/Platform.h"
+#include "../Platform/Serializable.h"
+#include "../Volume/Volume.h"
+#include "../Volume/VolumeInfo.h"
+
+namespace CipherShed
+{
+	struct MountResult;
+	typedef list < shared_ptr <MountResult> > MountResultList;
+
+	// Outcome of mounting one of the volumes passed to CoreBase::MountVolumes()
+	struct MountResult : public Serializable
+	{
+		MountResult ()
+			: SharedAccessUsed (false)
+		{
+		}
+
+		MountResult (const VolumePath &path)
+			: Path (path),
+			SharedAccessUsed (false)
+		{
+		}
+
+		virtual ~MountResult ()
+		{
+		}
+
+		TC_SERIALIZABLE (MountResult);
+
+		shared_ptr <Exception> Error;
+		shared_ptr <VolumeInfo> MountedVolume;
+		VolumePath Path;
+		bool SharedAccessUsed;
+	};
+
+	// Receives the outcome of each volume passed to CoreBase::MountVolumes() as soon as it is known
+	struct MountResultFunctor
+	{
+		virtual ~MountResultFunctor () { }
+		virtual void operator() (shared_ptr <MountResult> result) = 0;
+	};
+}
+
+#endif // TC_HEADER_Core_MountResult
@@ -10,10 +10,11 @@
 #include <sys/types.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <unistd.h>
 #endif
 
-#ifdef CS_UNITTESTING
-#include <unistd.h>
+#ifdef TC_LINUX
+#include <sys/syscall.h>
 #endif
 
 #include "RandomNumberGenerator.h"
@@ -21,6 +22,16 @@
 
 namespace CipherShed
 {
+	// Per-thread DRBG instance seeded from the system and from the pool
+	struct RandomNumberGenerator::DrbgState
+	{
+		DrbgState () : PoolGeneration (0), ProcessId (0) { }
+
+		HmacDrbg Drbg;
+		size_t PoolGeneration;
+		pid_t ProcessId;
+	};
+
 	void RandomNumberGenerator::AddSystemDataToPool (bool fast)
 	{
 		SecureBuffer buffer (PoolSize);
@@ -35,7 +46,7 @@ namespace CipherShed
 		finally_do_arg (int, urandom, { close (finally_arg); });
 
 		throw_sys_sub_if (read (urandom, buffer, buffer.Size()) == -1, L"/dev/urandom");
-		AddToPool (buffer);
+		MixIntoPool (buffer);
 
 		if (!fast)
 		{
@@ -45,7 +56,7 @@ namespace CipherShed
 			finally_do_arg (int, random, { close (finally_arg); });
 
 			throw_sys_sub_if (read (random, buffer, buffer.Size()) == -1 && errno != EAGAIN, L"/dev/random");
-			AddToPool (buffer);
+			MixIntoPool (buffer);
 		}
 #endif
 	}
@@ -57,16 +68,14 @@ namespace CipherShed
 
 		ScopeLock lock (AccessMutex);
 
-		for (size_t i = 0; i < data.Size(); ++i)
-		{
-			Pool[WriteOffset++] += data[i];
-
-			if (WriteOffset >= PoolSize)
-				WriteOffset = 0;
+		// Data from outside the generator forces all DRBG instances to reseed
+		++PoolGeneration;
+		MixIntoPool (data);
+	}
 
-			if (++BytesAddedSincePoolHashMix >= MaxBytesAddedBeforePoolHashMix)
-				HashMixPool();
-		}
+	void RandomNumberGenerator::DeleteDrbgState (void *state)
+	{
+		delete (DrbgState *) state;
 	}
 
 	void RandomNumberGenerator::GetData (const BufferPtr &buffer, bool fast)
@@ -74,6 +83,46 @@ namespace CipherShed
 		if (!Running)
 			throw NotInitialized (SRC_POS);
 
+		DrbgState &state = GetDrbgState();
+
+		for (size_t offset = 0; offset < buffer.Size(); offset += HmacDrbg::MaxBytesPerRequest)
+		{
+			// Requests for key material (!fast) are always served from a freshly reseeded DRBG
+			if (!fast
+				|| !state.Drbg.IsInstantiated()
+				|| state.Drbg.GetReseedCounter() > MaxDrbgRequestsBeforeReseed
+				|| state.PoolGeneration != PoolGeneration
+				|| state.ProcessId != getpid())
+			{
+				SeedDrbg (state, fast);
+				fast = true;
+			}
+
+			state.Drbg.Generate (buffer.GetRange (offset, min (HmacDrbg::MaxBytesPerRequest, buffer.Size() - offset)));
+		}
+	}
+
+	RandomNumberGenerator::DrbgState &RandomNumberGenerator::GetDrbgState ()
+	{
+		DrbgState *state = (DrbgState *) pthread_getspecific (DrbgStateKey);
+
+		if (!state)
+		{
+			state = new DrbgState;
+
+			int status = pthread_setspecific (DrbgStateKey, state);
+			if (status != 0)
+			{
+				delete state;
+				throw SystemException (SRC_POS, status);
+			}
+		}
+
+		return *state;
+	}
+
+	void RandomNumberGenerator::GetPoolData (const BufferPtr &buffer, bool fast)
+	{
 		if (buffer.Size() > PoolSize)
 			throw ParameterIncorrect (SRC_POS);
 
@@ -111,6 +160,45 @@ namespace CipherShed
 		}
 	}
 
+	void RandomNumberGenerator::GetSystemEntropy (const BufferPtr &buffer)
+	{
+		size_t offset = 0;
+
+#if defined (TC_LINUX) && defined (SYS_getrandom)
+		while (offset < buffer.Size())
+		{
+			long count = syscall (SYS_getrandom, buffer.Get() + offset, buffer.Size() - offset, 0);
+
+			if (count == -1)
+			{
+				if (errno == EINTR)
+					continue;
+
+				// Kernels older than 3.17 do not support getrandom()
+				throw_sys_sub_if (errno != ENOSYS, L"getrandom");
+				break;
+			}
+
+			offset += count;
+		}
+#endif
+		if (offset < buffer.Size())
+		{
+			int urandom = open ("/dev/urandom", O_RDONLY);
+			throw_sys_sub_if (urandom == -1, L"/dev/urandom");
+			finally_do_arg (int, urandom, { close (finally_arg); });
+
+			while (offset < buffer.Size())
+			{
+				ssize_t count = read (urandom, buffer.Get() + offset, buffer.Size() - offset);
+				throw_sys_sub_if (count == -1 && errno != EINTR, L"/dev/urandom");
+
+				if (count > 0)
+					offset += count;
+			}
+		}
+	}
+
 	shared_ptr <Hash> RandomNumberGenerator::GetHash ()
 	{
 		ScopeLock lock (AccessMutex);
@@ -136,10 +224,55 @@ namespace CipherShed
 		}
 	}
 
+	void RandomNumberGenerator::MixIntoPool (const ConstBufferPtr &data)
+	{
+		ScopeLock lock (AccessMutex);
+
+		for (size_t i = 0; i < data.Size(); ++i)
+		{
+			Pool[WriteOffset++] += data[i];
+
+			if (WriteOffset >= PoolSize)
+				WriteOffset = 0;
+
+			if (++BytesAddedSincePoolHashMix >= MaxBytesAddedBeforePoolHashMix)
+				HashMixPool();
+		}
+	}
+
+	void RandomNumberGenerator::SeedDrbg (DrbgState &state, bool fast)
+	{
+		SecureBuffer entropy (DrbgSeedSize);
+		GetSystemEntropy (entropy);
+
+		SecureBuffer poolData (DrbgSeedSize * 2);
+		size_t poolGeneration;
+		{
+			ScopeLock lock (AccessMutex);
+			GetPoolData (poolData, fast);
+			poolGeneration = PoolGeneration;
+		}
+
+		if (!state.Drbg.IsInstantiated())
+		{
+			SecureBuffer nonce (DrbgSeedSize / 2);
+			GetSystemEntropy (nonce);
+			state.Drbg.Instantiate (entropy, nonce, poolData);
+		}
+		else
+		{
+			state.Drbg.Reseed (entropy, poolData);
+		}
+
+		state.PoolGeneration = poolGeneration;
+		state.ProcessId = getpid();
+	}
+
 	void RandomNumberGenerator::SetHash (shared_ptr <Hash> hash)
 	{
 		ScopeLock lock (AccessMutex);
 		PoolHash = hash;
+		++PoolGeneration;
 	}
 
 	void RandomNumberGenerator::Start ()
@@ -155,6 +288,15 @@ namespace CipherShed
 		Running = true;
 		EnrichedByUser = false;
 
+		if (!DrbgStateKeyCreated)
+		{
+			int status = pthread_key_create (&DrbgStateKey, DeleteDrbgState);
+			if (status != 0)
+				throw SystemException (SRC_POS, status);
+
+			DrbgStateKeyCreated = true;
+		}
+
 		Pool.Allocate (PoolSize);
 		Test();
 
@@ -176,6 +318,15 @@ namespace CipherShed
 
 		PoolHash.reset();
 
+		// DRBG instances of other threads are reseeded from the new pool after restart
+		++PoolGeneration;
+
+		if (DrbgStateKeyCreated)
+		{
+			DeleteDrbgState (pthread_getspecific (DrbgStateKey));
+			pthread_setspecific (DrbgStateKey, nullptr);
+		}
+
 		EnrichedByUser = false;
 		Running = false;
 	}
@@ -208,8 +359,11 @@ namespace CipherShed
 
 	Mutex RandomNumberGenerator::AccessMutex;
 	size_t RandomNumberGenerator::BytesAddedSincePoolHashMix;
+	pthread_key_t RandomNumberGenerator::DrbgStateKey;
+	bool RandomNumberGenerator::DrbgStateKeyCreated = false;
 	bool RandomNumberGenerator::EnrichedByUser;
 	SecureBuffer RandomNumberGenerator::Pool;
+	volatile size_t RandomNumberGenerator::PoolGeneration = 0;
 	shared_ptr <Hash> RandomNumberGenerator::PoolHash;
 	size_t RandomNumberGenerator::ReadOffset;
 	bool RandomNumberGenerator::Running = false;
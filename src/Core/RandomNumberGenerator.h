@@ -12,6 +12,7 @@
 #include "../Platform/Platform.h"
 #include "../Volume/Hash.h"
 #include "../Common/Random.h"
+#include "HmacDrbg.h"
 
 namespace CipherShed
 {
@@ -33,18 +34,31 @@ namespace CipherShed
 		static const size_t PoolSize = RNG_POOL_SIZE;
 
 	protected:
+		struct DrbgState;
+
 		static void AddSystemDataToPool (bool fast);
+		static void DeleteDrbgState (void *state);
 		static void GetData (const BufferPtr &buffer, bool fast);
+		static DrbgState &GetDrbgState ();
+		static void GetPoolData (const BufferPtr &buffer, bool fast);
+		static void GetSystemEntropy (const BufferPtr &buffer);
 		static void HashMixPool ();
+		static void MixIntoPool (const ConstBufferPtr &data);
+		static void SeedDrbg (DrbgState &state, bool fast);
 		static void Test ();
 		RandomNumberGenerator ();
 
+		static const size_t DrbgSeedSize = 32;
 		static const size_t MaxBytesAddedBeforePoolHashMix = RANDMIX_BYTE_INTERVAL;
+		static const uint64 MaxDrbgRequestsBeforeReseed = 1024;
 
 		static Mutex AccessMutex;
 		static size_t BytesAddedSincePoolHashMix;
+		static pthread_key_t DrbgStateKey;
+		static bool DrbgStateKeyCreated;
 		static bool EnrichedByUser;
 		static SecureBuffer Pool;
+		static volatile size_t PoolGeneration;
 		static shared_ptr <Hash> PoolHash;
 		static size_t ReadOffset;
 		static bool Running;
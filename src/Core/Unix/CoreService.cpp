@@ -8,13 +8,16 @@
 
 #include "CoreService.h"
 #include <fcntl.h>
+#include <unistd.h>
 #include <sys/wait.h>
 #include "../../Platform/FileStream.h"
 #include "../../Platform/MemoryStream.h"
 #include "../../Platform/Serializable.h"
 #include "../../Platform/SystemLog.h"
 #include "../../Platform/Thread.h"
+#include "../../Platform/Time.h"
 #include "../../Platform/Unix/Poller.h"
+#include "../../Platform/Unix/Process.h"
 #include "../Core.h"
 #include "CoreUnix.h"
 #include "CoreServiceRequest.h"
@@ -25,9 +28,32 @@
 namespace CipherShed
 {
 	template <class T>
-	std::auto_ptr <T> CoreService::GetResponse ()
+	std::auto_ptr <T> CoreService::GetResponse (uint64 requestId, MountResultFunctor *resultFunctor)
 	{
-		std::auto_ptr <Serializable> deserializedObject (Serializable::DeserializeNew (ServiceOutputStream));
+		Serializer sr (ServiceOutputStream);
+		std::auto_ptr <Serializable> deserializedObject;
+
+		while (true)
+		{
+			uint64 responseId;
+			sr.Deserialize ("RequestId", responseId);
+
+			deserializedObject.reset (Serializable::DeserializeNew (ServiceOutputStream));
+
+			if (responseId != requestId)
+				throw ParameterIncorrect (SRC_POS);
+
+			// Results of mount requests precede the response
+			MountResult *result = dynamic_cast <MountResult *> (deserializedObject.get());
+			if (!result)
+				break;
+
+			deserializedObject.release();
+			shared_ptr <MountResult> sharedResult (result);
+
+			if (resultFunctor)
+				(*resultFunctor) (sharedResult);
+		}
 		
 		Exception *deserializedException = dynamic_cast <Exception*> (deserializedObject.get());
 		if (deserializedException)
@@ -39,6 +65,13 @@ namespace CipherShed
 		return std::auto_ptr <T> (dynamic_cast <T *> (deserializedObject.release()));
 	}
 
+	void CoreService::MountResultSender::operator() (shared_ptr <MountResult> result)
+	{
+		Serializer sr (ResultStream);
+		sr.Serialize ("RequestId", RequestId);
+		result->Serialize (ResultStream);
+	}
+
 	void CoreService::ProcessElevatedRequests ()
 	{
 		int pid = fork();
@@ -83,18 +116,163 @@ namespace CipherShed
 		}
 	}
 
+	const map <uint32, CoreService::RequestHandler> &CoreService::GetRequestHandlers ()
+	{
+		static map <uint32, RequestHandler> handlers;
+
+		if (handlers.empty())
+		{
+#define TC_CORE_SERVICE_REQUEST_HANDLER(TYPE) handlers[SerializerFactory::GetTypeId (typeid (TYPE))] = &CoreService::DispatchRequest <TYPE>
+
+			TC_CORE_SERVICE_REQUEST_HANDLER (CheckFilesystemRequest);
+			TC_CORE_SERVICE_REQUEST_HANDLER (DismountFilesystemRequest);
+			TC_CORE_SERVICE_REQUEST_HANDLER (DismountVolumeRequest);
+			TC_CORE_SERVICE_REQUEST_HANDLER (DismountVolumesRequest);
+			TC_CORE_SERVICE_REQUEST_HANDLER (GetDeviceSectorSizeRequest);
+			TC_CORE_SERVICE_REQUEST_HANDLER (GetDeviceSizeRequest);
+			TC_CORE_SERVICE_REQUEST_HANDLER (GetHostDevicesRequest);
+			TC_CORE_SERVICE_REQUEST_HANDLER (MountVolumeRequest);
+			TC_CORE_SERVICE_REQUEST_HANDLER (MountVolumesRequest);
+			TC_CORE_SERVICE_REQUEST_HANDLER (SetFileOwnerRequest);
+			TC_CORE_SERVICE_REQUEST_HANDLER (WipePasswordCacheRequest);
+
+#undef TC_CORE_SERVICE_REQUEST_HANDLER
+		}
+
+		return handlers;
+	}
+
+	shared_ptr <Serializable> CoreService::ProcessRequest (CoreServiceRequest &request)
+	{
+		const map <uint32, RequestHandler> &handlers = GetRequestHandlers();
+
+		map <uint32, RequestHandler>::const_iterator handler = handlers.find (SerializerFactory::GetTypeId (typeid (request)));
+		if (handler == handlers.end())
+			throw ParameterIncorrect (SRC_POS);
+
+		return handler->second (request);
+	}
+
+	shared_ptr <Serializable> CoreService::ProcessRequest (CheckFilesystemRequest &request)
+	{
+		Core->CheckFilesystem (request.MountedVolumeInfo, request.Repair);
+		return shared_ptr <Serializable> (new CheckFilesystemResponse);
+	}
+
+	shared_ptr <Serializable> CoreService::ProcessRequest (DismountFilesystemRequest &request)
+	{
+		Core->DismountFilesystem (request.MountPoint, request.Force);
+		return shared_ptr <Serializable> (new DismountFilesystemResponse);
+	}
+
+	shared_ptr <Serializable> CoreService::ProcessRequest (DismountVolumeRequest &request)
+	{
+		DismountVolumeResponse *response = new DismountVolumeResponse;
+		shared_ptr <Serializable> responseHolder (response);
+
+		response->DismountedVolumeInfo = Core->DismountVolume (request.MountedVolumeInfo, request.IgnoreOpenFiles, request.SyncVolumeInfo);
+		return responseHolder;
+	}
+
+	shared_ptr <Serializable> CoreService::ProcessRequest (DismountVolumesRequest &request)
+	{
+		return shared_ptr <Serializable> (new DismountVolumesResponse (Core->DismountVolumes (request.MountedVolumes, request.IgnoreOpenFiles)));
+	}
+
+	shared_ptr <Serializable> CoreService::ProcessRequest (GetDeviceSectorSizeRequest &request)
+	{
+		return shared_ptr <Serializable> (new GetDeviceSectorSizeResponse (Core->GetDeviceSectorSize (request.Path)));
+	}
+
+	shared_ptr <Serializable> CoreService::ProcessRequest (GetDeviceSizeRequest &request)
+	{
+		return shared_ptr <Serializable> (new GetDeviceSizeResponse (Core->GetDeviceSize (request.Path)));
+	}
+
+	shared_ptr <Serializable> CoreService::ProcessRequest (GetHostDevicesRequest &request)
+	{
+		return shared_ptr <Serializable> (new GetHostDevicesResponse (Core->GetHostDevices (request.PathListOnly)));
+	}
+
+	shared_ptr <Serializable> CoreService::ProcessRequest (MountVolumeRequest &request)
+	{
+		return shared_ptr <Serializable> (new MountVolumeResponse (Core->MountVolume (*request.Options)));
+	}
+
+	shared_ptr <Serializable> CoreService::ProcessRequest (MountVolumesRequest &request)
+	{
+		MountResultSender resultSender (request.ResultStream, request.RequestId);
+		return shared_ptr <Serializable> (new MountVolumesResponse (Core->MountVolumes (*request.Options, request.VolumePaths, &resultSender)));
+	}
+
+	shared_ptr <Serializable> CoreService::ProcessRequest (SetFileOwnerRequest &request)
+	{
+		CoreUnix *coreUnix = dynamic_cast <CoreUnix *> (Core.get());
+		if (!coreUnix)
+			throw ParameterIncorrect (SRC_POS);
+
+		coreUnix->SetFileOwner (request.Path, request.Owner);
+		return shared_ptr <Serializable> (new SetFileOwnerResponse);
+	}
+
+	shared_ptr <Serializable> CoreService::ProcessRequest (WipePasswordCacheRequest &request)
+	{
+		// Header keys are cached by the elevated service
+		if (!ElevatedPrivileges && ElevatedServiceAvailable)
+		{
+			ElevatedServiceLastUseTime = Time::GetCurrent();
+
+			request.Serialize (ServiceInputStream);
+			GetResponse <WipePasswordCacheResponse> (request.RequestId);
+		}
+
+		Core->WipePasswordCache();
+		return shared_ptr <Serializable> (new WipePasswordCacheResponse);
+	}
+
 	void CoreService::ProcessRequests (int inputFD, int outputFD)
 	{
 		try
 		{
 			Core = CoreDirect;
 
-			shared_ptr <Stream> inputStream (new FileStream (inputFD != -1 ? inputFD : InputPipe->GetReadFD()));
+			if (inputFD == -1)
+				inputFD = InputPipe->GetReadFD();
+
+			shared_ptr <Stream> inputStream (new FileStream (inputFD));
 			shared_ptr <Stream> outputStream (new FileStream (outputFD != -1 ? outputFD : OutputPipe->GetWriteFD()));
 
 			while (true)
 			{
+				// The elevated service is stopped once it has been idle for the configured time
+				if (!ElevatedPrivileges && ElevatedServiceAvailable && ElevatedServiceIdleTime > 0)
+				{
+					uint64 idleTime = (Time::GetCurrent() - ElevatedServiceLastUseTime) / 10000;
+					uint64 maxIdleTime = ElevatedServiceIdleTime * 1000ULL;
+
+					if (idleTime < maxIdleTime)
+					{
+						try
+						{
+							Poller poller (inputFD);
+							poller.WaitForData (static_cast <int> (maxIdleTime - idleTime));
+						}
+						catch (TimeOut&)
+						{
+							idleTime = maxIdleTime;
+						}
+					}
+
+					if (idleTime >= maxIdleTime)
+						StopElevated();
+				}
+
 				shared_ptr <CoreServiceRequest> request = Serializable::DeserializeNew <CoreServiceRequest> (inputStream);
+				shared_ptr <Serializable> response;
+
+				// Responses are encoded in the format of the request
+				outputStream->SetSerializationFormat (inputStream->GetSerializationFormat());
+				request->ResultStream = outputStream;
 
 				try
 				{
@@ -106,115 +284,46 @@ namespace CipherShed
 						return;
 					}
 
+					// The idle time of the elevated service is set only by the application which has started it
+					if (!ElevatedPrivileges)
+						ElevatedServiceIdleTime = request->ElevatedServiceIdleTime;
+
 					if (!ElevatedPrivileges && request->ElevateUserPrivileges)
 					{
+						if (ElevatedServiceAvailable && !IsElevatedServiceRunning())
+							StopElevated();
+
 						if (!ElevatedServiceAvailable)
 						{
 							finally_do_arg (string *, &request->AdminPassword, { StringConverter::Erase (*finally_arg); });
-							
+
 							CoreService::StartElevated (*request);
 							ElevatedServiceAvailable = true;
 						}
 
+						// Requests are passed to the elevated service together with their IDs. Results sent ahead of responses are relayed to the client.
+						MountResultSender resultSender (outputStream, request->RequestId);
 						request->Serialize (ServiceInputStream);
-						GetResponse <Serializable>()->Serialize (outputStream);
-						continue;
+						response.reset (GetResponse <Serializable> (request->RequestId, &resultSender).release());
+						ElevatedServiceLastUseTime = Time::GetCurrent();
 					}
-
-					// CheckFilesystemRequest
-					CheckFilesystemRequest *checkRequest = dynamic_cast <CheckFilesystemRequest*> (request.get());
-					if (checkRequest)
+					else
 					{
-						Core->CheckFilesystem (checkRequest->MountedVolumeInfo, checkRequest->Repair);
-						
-						CheckFilesystemResponse().Serialize (outputStream);
-						continue;
-					}
-
-					// DismountFilesystemRequest
-					DismountFilesystemRequest *dismountFsRequest = dynamic_cast <DismountFilesystemRequest*> (request.get());
-					if (dismountFsRequest)
-					{
-						Core->DismountFilesystem (dismountFsRequest->MountPoint, dismountFsRequest->Force);
-
-						DismountFilesystemResponse().Serialize (outputStream);
-						continue;
+						response = ProcessRequest (*request);
 					}
-
-					// DismountVolumeRequest
-					DismountVolumeRequest *dismountRequest = dynamic_cast <DismountVolumeRequest*> (request.get());
-					if (dismountRequest)
-					{
-						DismountVolumeResponse response;
-						response.DismountedVolumeInfo = Core->DismountVolume (dismountRequest->MountedVolumeInfo, dismountRequest->IgnoreOpenFiles, dismountRequest->SyncVolumeInfo);
-						response.Serialize (outputStream);
-						continue;
-					}
-
-					// GetDeviceSectorSizeRequest
-					GetDeviceSectorSizeRequest *getDeviceSectorSizeRequest = dynamic_cast <GetDeviceSectorSizeRequest*> (request.get());
-					if (getDeviceSectorSizeRequest)
-					{
-						GetDeviceSectorSizeResponse response;
-						response.Size = Core->GetDeviceSectorSize (getDeviceSectorSizeRequest->Path);
-						response.Serialize (outputStream);
-						continue;
-					}
-
-					// GetDeviceSizeRequest
-					GetDeviceSizeRequest *getDeviceSizeRequest = dynamic_cast <GetDeviceSizeRequest*> (request.get());
-					if (getDeviceSizeRequest)
-					{
-						GetDeviceSizeResponse response;
-						response.Size = Core->GetDeviceSize (getDeviceSizeRequest->Path);
-						response.Serialize (outputStream);
-						continue;
-					}
-
-					// GetHostDevicesRequest
-					GetHostDevicesRequest *getHostDevicesRequest = dynamic_cast <GetHostDevicesRequest*> (request.get());
-					if (getHostDevicesRequest)
-					{
-						GetHostDevicesResponse response;
-						response.HostDevices = Core->GetHostDevices (getHostDevicesRequest->PathListOnly);
-						response.Serialize (outputStream);
-						continue;
-					}
-
-					// MountVolumeRequest
-					MountVolumeRequest *mountRequest = dynamic_cast <MountVolumeRequest*> (request.get());
-					if (mountRequest)
-					{
-						MountVolumeResponse (
-							Core->MountVolume (*mountRequest->Options)
-						).Serialize (outputStream);
-
-						continue;
-					}
-
-					// SetFileOwnerRequest
-					SetFileOwnerRequest *setFileOwnerRequest = dynamic_cast <SetFileOwnerRequest*> (request.get());
-					if (setFileOwnerRequest)
-					{
-						CoreUnix *coreUnix = dynamic_cast <CoreUnix *> (Core.get());
-						if (!coreUnix)
-							throw ParameterIncorrect (SRC_POS);
-
-						coreUnix->SetFileOwner (setFileOwnerRequest->Path, setFileOwnerRequest->Owner);
-						SetFileOwnerResponse().Serialize (outputStream);
-						continue;
-					}
-
-					throw ParameterIncorrect (SRC_POS);
 				}
 				catch (Exception &e)
 				{
-					e.Serialize (outputStream);
+					response.reset (e.CloneNew());
 				}
 				catch (exception &e)
 				{
-					ExternalException (SRC_POS, StringConverter::ToExceptionString (e)).Serialize (outputStream);
+					response.reset (new ExternalException (SRC_POS, StringConverter::ToExceptionString (e)));
 				}
+
+				Serializer sr (outputStream);
+				sr.Serialize ("RequestId", request->RequestId);
+				response->Serialize (outputStream);
 			}
 		}
 		catch (exception &e)
@@ -226,6 +335,32 @@ namespace CipherShed
 		}
 	}
 
+	string CoreService::GetHelperExecutablePath (const string &applicationPath)
+	{
+		// The lean helper executable installed alongside the application starts faster and uses less memory
+		string helperPath = applicationPath + TC_CORE_SERVICE_HELPER_SUFFIX;
+		if (applicationPath.find ('/') == string::npos || access (helperPath.c_str(), X_OK) != 0)
+			return string();
+
+		return helperPath;
+	}
+
+	bool CoreService::IsElevatedServiceRunning ()
+	{
+		// The elevated service writes to its output only when responding to a request. Any event therefore indicates its exit.
+		try
+		{
+			Poller poller (AdminOutputPipe->GetReadFD());
+			poller.WaitForData (0);
+		}
+		catch (TimeOut&)
+		{
+			return true;
+		}
+
+		return false;
+	}
+
 	void CoreService::RequestCheckFilesystem (shared_ptr <VolumeInfo> mountedVolume, bool repair)
 	{
 		CheckFilesystemRequest request (mountedVolume, repair);
@@ -244,6 +379,12 @@ namespace CipherShed
 		return SendRequest <DismountVolumeResponse> (request)->DismountedVolumeInfo;
 	}
 
+	DismountResultList CoreService::RequestDismountVolumes (const VolumeInfoList &mountedVolumes, bool ignoreOpenFiles)
+	{
+		DismountVolumesRequest request (mountedVolumes, ignoreOpenFiles);
+		return SendRequest <DismountVolumesResponse> (request)->Results;
+	}
+
 	uint32 CoreService::RequestGetDeviceSectorSize (const DevicePath &devicePath)
 	{
 		GetDeviceSectorSizeRequest request (devicePath);
@@ -268,32 +409,50 @@ namespace CipherShed
 		return SendRequest <MountVolumeResponse> (request)->MountedVolumeInfo;
 	}
 
+	MountResultList CoreService::RequestMountVolumes (MountOptions &options, const VolumePathList &volumePaths, MountResultFunctor *resultFunctor)
+	{
+		MountVolumesRequest request (&options, volumePaths);
+		return SendRequest <MountVolumesResponse> (request, resultFunctor)->Results;
+	}
+
 	void CoreService::RequestSetFileOwner (const FilesystemPath &path, const UserId &owner)
 	{
 		SetFileOwnerRequest request (path, owner);
 		SendRequest <SetFileOwnerResponse> (request);
 	}
 
+	void CoreService::RequestWipePasswordCache ()
+	{
+		WipePasswordCacheRequest request;
+		SendRequest <WipePasswordCacheResponse> (request);
+	}
+
 	template <class T>
-	std::auto_ptr <T> CoreService::SendRequest (CoreServiceRequest &request)
+	std::auto_ptr <T> CoreService::SendRequest (CoreServiceRequest &request, MountResultFunctor *resultFunctor)
 	{
 		static Mutex mutex;
 		ScopeLock lock (mutex);
 
+		request.ElevatedServiceIdleTime = ElevatedServiceIdleTime;
+		request.RequestId = ++LastRequestId;
+
+		finally_do_arg (string *, &request.AdminPassword, { StringConverter::Erase (*finally_arg); });
+
 		if (request.RequiresElevation())
 		{
 			request.ElevateUserPrivileges = true;
-			request.FastElevation = !ElevatedServiceAvailable;
 			request.ApplicationExecutablePath = Core->GetApplicationExecutablePath();
 
-			while (!ElevatedServiceAvailable)
+			// The elevated service may have been stopped after an idle period. Cached credentials of sudo
+			// are tried before the user is asked for a password.
+			request.FastElevation = true;
+
+			while (true)
 			{
 				try
 				{
 					request.Serialize (ServiceInputStream);
-					std::auto_ptr <T> response (GetResponse <T>());
-					ElevatedServiceAvailable = true;
-					return response;
+					return GetResponse <T> (request.RequestId, resultFunctor);
 				}
 				catch (ElevationFailed &e)
 				{
@@ -309,10 +468,8 @@ namespace CipherShed
 			}
 		}
 
-		finally_do_arg (string *, &request.AdminPassword, { StringConverter::Erase (*finally_arg); });
-
 		request.Serialize (ServiceInputStream);
-		return GetResponse <T>();
+		return GetResponse <T> (request.RequestId, resultFunctor);
 	}
 
 	void CoreService::Start ()
@@ -327,6 +484,17 @@ namespace CipherShed
 		{
 			try
 			{
+				// FUSE services are forked from the core service, which therefore runs in the helper executable when it is installed
+				string helperPath = GetHelperExecutablePath (Process::GetExecutablePath());
+				if (!helperPath.empty())
+				{
+					throw_sys_if (dup2 (InputPipe->GetReadFD(), STDIN_FILENO) == -1);
+					throw_sys_if (dup2 (OutputPipe->GetWriteFD(), STDOUT_FILENO) == -1);
+
+					const char *args[] = { helperPath.c_str(), TC_CORE_SERVICE_STDIO_CMDLINE_OPTION, nullptr };
+					execv (args[0], ((char* const*) args));
+				}
+
 				ProcessRequests();
 				_exit (0);
 			}
@@ -336,6 +504,9 @@ namespace CipherShed
 
 		ServiceInputStream = shared_ptr <Stream> (new FileStream (InputPipe->GetWriteFD()));
 		ServiceOutputStream = shared_ptr <Stream> (new FileStream (OutputPipe->GetReadFD()));
+
+		ServiceInputStream->SetSerializationFormat (SerializationFormat::Compact);
+		ServiceOutputStream->SetSerializationFormat (SerializationFormat::Compact);
 	}
 
 	void CoreService::StartElevated (const CoreServiceRequest &request)
@@ -361,6 +532,10 @@ namespace CipherShed
 					if (appPath.empty())
 						appPath = "ciphershed";
 
+					string helperPath = GetHelperExecutablePath (appPath);
+					if (!helperPath.empty())
+						appPath = helperPath;
+
 					const char *args[] = { "sudo", "-S", "-p", "", appPath.c_str(), TC_CORE_SERVICE_CMDLINE_OPTION, nullptr };
 					execvp (args[0], ((char* const*) args));
 					throw SystemException (SRC_POS, args[0]);
@@ -517,6 +692,9 @@ namespace CipherShed
 		ServiceInputStream = shared_ptr <Stream> (new FileStream (inPipe->GetWriteFD()));
 		ServiceOutputStream = shared_ptr <Stream> (new FileStream (outPipe->GetReadFD()));
 
+		ServiceInputStream->SetSerializationFormat (SerializationFormat::Compact);
+		ServiceOutputStream->SetSerializationFormat (SerializationFormat::Compact);
+
 		// Send sync code
 		byte sync[] = { 0, 0x11, 0x22 };
 		ServiceInputStream->Write (ConstBufferPtr (sync, array_capacity (sync)));
@@ -530,6 +708,24 @@ namespace CipherShed
 		ExitRequest exitRequest;
 		exitRequest.Serialize (ServiceInputStream);
 	}
+
+	void CoreService::StopElevated ()
+	{
+		try
+		{
+			ExitRequest exitRequest;
+			exitRequest.Serialize (ServiceInputStream);
+		}
+		catch (...) { }
+
+		ServiceInputStream.reset();
+		ServiceOutputStream.reset();
+
+		AdminInputPipe.reset();
+		AdminOutputPipe.reset();
+
+		ElevatedServiceAvailable = false;
+	}
 	
 	shared_ptr <GetStringFunctor> CoreService::AdminPasswordCallback;
 
@@ -543,4 +739,7 @@ namespace CipherShed
 
 	bool CoreService::ElevatedPrivileges = false;
 	bool CoreService::ElevatedServiceAvailable = false;
+	uint32 CoreService::ElevatedServiceIdleTime = 0;
+	uint64 CoreService::ElevatedServiceLastUseTime = 0;
+	uint64 CoreService::LastRequestId = 0;
 }
@@ -14,6 +14,7 @@
 #include "../../Platform/Unix/Pipe.h"
 #include "../Core.h"
 
+#include <map>
 #include <memory>
 
 namespace CipherShed
@@ -27,19 +28,52 @@ namespace CipherShed
 		static void RequestCheckFilesystem (shared_ptr <VolumeInfo> mountedVolume, bool repair);
 		static void RequestDismountFilesystem (const DirectoryPath &mountPoint, bool force);
 		static shared_ptr <VolumeInfo> RequestDismountVolume (shared_ptr <VolumeInfo> mountedVolume, bool ignoreOpenFiles = false, bool syncVolumeInfo = false);
+		static DismountResultList RequestDismountVolumes (const VolumeInfoList &mountedVolumes, bool ignoreOpenFiles = false);
 		static uint32 RequestGetDeviceSectorSize (const DevicePath &devicePath);
 		static uint64 RequestGetDeviceSize (const DevicePath &devicePath);
 		static HostDeviceList RequestGetHostDevices (bool pathListOnly);
 		static shared_ptr <VolumeInfo> RequestMountVolume (MountOptions &options);
+		static MountResultList RequestMountVolumes (MountOptions &options, const VolumePathList &volumePaths, MountResultFunctor *resultFunctor = nullptr);
 		static void RequestSetFileOwner (const FilesystemPath &path, const UserId &owner);
+		static void RequestWipePasswordCache ();
 		static void SetAdminPasswordCallback (shared_ptr <GetStringFunctor> functor) { AdminPasswordCallback = functor; }
+		static void SetElevatedServiceIdleTime (uint32 seconds) { ElevatedServiceIdleTime = seconds; }
 		static void Start ();
 		static void Stop ();
 
 	protected:
-		template <class T> static std::auto_ptr <T> GetResponse ();
-		template <class T> static std::auto_ptr <T> SendRequest (CoreServiceRequest &request);
+		typedef shared_ptr <Serializable> (*RequestHandler) (CoreServiceRequest &request);
+
+		// Sends each mount result to the client as soon as it is known, ahead of the response to its request
+		struct MountResultSender : public MountResultFunctor
+		{
+			MountResultSender (shared_ptr <Stream> resultStream, uint64 requestId) : RequestId (requestId), ResultStream (resultStream) { }
+			virtual void operator() (shared_ptr <MountResult> result);
+
+			uint64 RequestId;
+			shared_ptr <Stream> ResultStream;
+		};
+
+		template <class T> static shared_ptr <Serializable> DispatchRequest (CoreServiceRequest &request) { return ProcessRequest (static_cast <T &> (request)); }
+		static string GetHelperExecutablePath (const string &applicationPath);
+		static const map <uint32, RequestHandler> &GetRequestHandlers ();
+		template <class T> static std::auto_ptr <T> GetResponse (uint64 requestId, MountResultFunctor *resultFunctor = nullptr);
+		static bool IsElevatedServiceRunning ();
+		static shared_ptr <Serializable> ProcessRequest (CoreServiceRequest &request);
+		static shared_ptr <Serializable> ProcessRequest (CheckFilesystemRequest &request);
+		static shared_ptr <Serializable> ProcessRequest (DismountFilesystemRequest &request);
+		static shared_ptr <Serializable> ProcessRequest (DismountVolumeRequest &request);
+		static shared_ptr <Serializable> ProcessRequest (DismountVolumesRequest &request);
+		static shared_ptr <Serializable> ProcessRequest (GetDeviceSectorSizeRequest &request);
+		static shared_ptr <Serializable> ProcessRequest (GetDeviceSizeRequest &request);
+		static shared_ptr <Serializable> ProcessRequest (GetHostDevicesRequest &request);
+		static shared_ptr <Serializable> ProcessRequest (MountVolumeRequest &request);
+		static shared_ptr <Serializable> ProcessRequest (MountVolumesRequest &request);
+		static shared_ptr <Serializable> ProcessRequest (SetFileOwnerRequest &request);
+		static shared_ptr <Serializable> ProcessRequest (WipePasswordCacheRequest &request);
+		template <class T> static std::auto_ptr <T> SendRequest (CoreServiceRequest &request, MountResultFunctor *resultFunctor = nullptr);
 		static void StartElevated (const CoreServiceRequest &request);
+		static void StopElevated ();
 
 		static shared_ptr <GetStringFunctor> AdminPasswordCallback;
 
@@ -53,6 +87,9 @@ namespace CipherShed
 
 		static bool ElevatedPrivileges;
 		static bool ElevatedServiceAvailable;
+		static uint32 ElevatedServiceIdleTime;
+		static uint64 ElevatedServiceLastUseTime;
+		static uint64 LastRequestId;
 		static bool Running;
 
 	private:
@@ -60,6 +97,8 @@ namespace CipherShed
 	};
 
 #define TC_CORE_SERVICE_CMDLINE_OPTION "--core-service"
+#define TC_CORE_SERVICE_STDIO_CMDLINE_OPTION "--core-service-stdio"
+#define TC_CORE_SERVICE_HELPER_SUFFIX "-helper"
 }
 
 #endif // TC_HEADER_Core_Unix_CoreService
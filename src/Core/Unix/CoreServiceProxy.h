@@ -10,6 +10,8 @@
 #define TC_HEADER_Core_Windows_CoreServiceProxy
 
 #include "CoreService.h"
+#include "CoreServiceResponse.h"
+#include "../../Volume/VolumeOpenHints.h"
 #include "../../Volume/VolumePasswordCache.h"
 
 namespace CipherShed
@@ -41,6 +43,23 @@ namespace CipherShed
 			return dismountedVolumeInfo;
 		}
 
+		virtual DismountResultList DismountVolumes (const VolumeInfoList &mountedVolumes, bool ignoreOpenFiles = false)
+		{
+			// All volumes are dismounted by a single request, which allows the service to tear them down concurrently
+			DismountResultList results = CoreService::RequestDismountVolumes (mountedVolumes, ignoreOpenFiles);
+
+			foreach (shared_ptr <DismountResult> result, results)
+			{
+				if (result->DismountedVolume)
+				{
+					VolumeEventArgs eventArgs (result->DismountedVolume);
+					T::VolumeDismountedEvent.Raise (eventArgs);
+				}
+			}
+
+			return results;
+		}
+
 		virtual uint32 GetDeviceSectorSize (const DevicePath &devicePath) const
 		{
 			return CoreService::RequestGetDeviceSectorSize (devicePath);
@@ -66,6 +85,13 @@ namespace CipherShed
 		{
 			shared_ptr <VolumeInfo> mountedVolume;
 
+			// Use the stored open hint unless one has been specified by the caller
+			VolumeOpenHint callerOpenHint = options.OpenHint;
+			finally_do_arg2 (MountOptions*, &options, VolumeOpenHint, callerOpenHint, { finally_arg->OpenHint = finally_arg2; });
+
+			if (callerOpenHint.IsEmpty() && options.Path)
+				options.OpenHint = VolumeOpenHints::Get (*options.Path);
+
 			if (!VolumePasswordCache::IsEmpty()
 				&& (!options.Password || options.Password->IsEmpty())
 				&& (!options.Keyfiles || options.Keyfiles->empty()))
@@ -132,11 +158,155 @@ namespace CipherShed
 			return mountedVolume;
 		}
 
+		virtual MountResultList MountVolumes (MountOptions &options, const VolumePathList &volumePaths, MountResultFunctor *resultFunctor = nullptr)
+		{
+			// Results are passed to the caller as soon as they are final
+			struct ResultFunctor : public MountResultFunctor
+			{
+				ResultFunctor (CoreServiceProxy &core, const MountOptions &options, MountResultFunctor *callerFunctor)
+					: CallerFunctor (callerFunctor), Core (core), Options (options), PasswordErrorsFinal (true) { }
+
+				virtual void operator() (shared_ptr <MountResult> result)
+				{
+					if (dynamic_cast <ProtectionPasswordIncorrect *> (result->Error.get()))
+					{
+						if (Options.ProtectionKeyfiles && !Options.ProtectionKeyfiles->empty())
+							result->Error.reset (new ProtectionPasswordKeyfilesIncorrect (result->Error->what()));
+					}
+					else if (dynamic_cast <PasswordIncorrect *> (result->Error.get()))
+					{
+						if (Options.Keyfiles && !Options.Keyfiles->empty())
+							result->Error.reset (new PasswordKeyfilesIncorrect (result->Error->what()));
+					}
+
+					Results.push_back (result);
+
+					// The volume will be tried with the next cached password
+					if (!PasswordErrorsFinal && dynamic_cast <PasswordIncorrect *> (result->Error.get()))
+						return;
+
+					Report (result);
+				}
+
+				void Report (shared_ptr <MountResult> result)
+				{
+					if (result->MountedVolume)
+					{
+						VolumeEventArgs eventArgs (result->MountedVolume);
+						Core.VolumeMountedEvent.Raise (eventArgs);
+					}
+
+					if (CallerFunctor)
+						(*CallerFunctor) (result);
+				}
+
+				MountResultFunctor *CallerFunctor;
+				CoreServiceProxy &Core;
+				const MountOptions &Options;
+				bool PasswordErrorsFinal;
+				MountResultList Results;
+			};
+
+			MountResultList results;
+			ResultFunctor proxyResultFunctor (*this, options, resultFunctor);
+
+			// Use the stored open hints of the volumes unless they have been specified by the caller
+			VolumeOpenHintMap callerOpenHints = options.OpenHints;
+			finally_do_arg2 (MountOptions*, &options, VolumeOpenHintMap, callerOpenHints, { finally_arg->OpenHints = finally_arg2; });
+
+			foreach (const VolumePath &volumePath, volumePaths)
+			{
+				VolumeOpenHint openHint = VolumeOpenHints::Get (volumePath);
+				if (!openHint.IsEmpty() && options.OpenHints.find (volumePath) == options.OpenHints.end())
+					options.OpenHints[volumePath] = openHint;
+			}
+
+			if (!VolumePasswordCache::IsEmpty()
+				&& (!options.Password || options.Password->IsEmpty())
+				&& (!options.Keyfiles || options.Keyfiles->empty()))
+			{
+				finally_do_arg (MountOptions*, &options, { if (finally_arg->Password) finally_arg->Password.reset(); });
+
+				// Each cached password is tried only on volumes which previous passwords failed to open
+				map <wstring, shared_ptr <MountResult> > pathResults;
+				VolumePathList remainingPaths = volumePaths;
+				proxyResultFunctor.PasswordErrorsFinal = false;
+
+				foreach (shared_ptr <VolumePassword> password, VolumePasswordCache::GetPasswords())
+				{
+					if (remainingPaths.empty())
+						break;
+
+					options.Password = password;
+					VolumePathList failedPaths;
+
+					proxyResultFunctor.Results.clear();
+					CoreService::RequestMountVolumes (options, remainingPaths, &proxyResultFunctor);
+
+					foreach (shared_ptr <MountResult> result, proxyResultFunctor.Results)
+					{
+						pathResults[wstring (result->Path)] = result;
+
+						if (dynamic_cast <PasswordIncorrect *> (result->Error.get()))
+							failedPaths.push_back (result->Path);
+					}
+
+					remainingPaths = failedPaths;
+				}
+
+				// Volumes which none of the cached passwords has opened
+				foreach (const VolumePath &volumePath, remainingPaths)
+					proxyResultFunctor.Report (pathResults[volumePath]);
+
+				foreach (const VolumePath &volumePath, volumePaths)
+				{
+					map <wstring, shared_ptr <MountResult> >::const_iterator result = pathResults.find (volumePath);
+					if (result != pathResults.end())
+						results.push_back (result->second);
+				}
+			}
+			else
+			{
+				MountOptions newOptions = options;
+
+				newOptions.Password = Keyfile::ApplyListToPassword (options.Keyfiles, options.Password);
+				if (newOptions.Keyfiles)
+					newOptions.Keyfiles->clear();
+
+				newOptions.ProtectionPassword = Keyfile::ApplyListToPassword (options.ProtectionKeyfiles, options.ProtectionPassword);
+				if (newOptions.ProtectionKeyfiles)
+					newOptions.ProtectionKeyfiles->clear();
+
+				CoreService::RequestMountVolumes (newOptions, volumePaths, &proxyResultFunctor);
+				results = proxyResultFunctor.Results;
+
+				bool volumeMounted = false;
+				foreach (shared_ptr <MountResult> result, results)
+				{
+					if (result->MountedVolume)
+						volumeMounted = true;
+				}
+
+				if (volumeMounted && options.CachePassword
+					&& ((options.Password && !options.Password->IsEmpty()) || (options.Keyfiles && !options.Keyfiles->empty())))
+				{
+					VolumePasswordCache::Store (*Keyfile::ApplyListToPassword (options.Keyfiles, options.Password));
+				}
+			}
+
+			return results;
+		}
+
 		virtual void SetAdminPasswordCallback (shared_ptr <GetStringFunctor> functor)
 		{
 			CoreService::SetAdminPasswordCallback (functor);
 		}
 
+		virtual void SetElevatedServiceIdleTime (uint32 seconds)
+		{
+			CoreService::SetElevatedServiceIdleTime (seconds);
+		}
+
 		virtual void SetFileOwner (const FilesystemPath &path, const UserId &owner) const
 		{
 			CoreService::RequestSetFileOwner (path, owner);
@@ -145,6 +315,7 @@ namespace CipherShed
 		virtual void WipePasswordCache () const
 		{
 			VolumePasswordCache::Clear();
+			CoreService::RequestWipePasswordCache();
 		}
 	};
 }
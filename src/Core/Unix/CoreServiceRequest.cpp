@@ -18,8 +18,10 @@ namespace CipherShed
 		Serializer sr (stream);
 		sr.Deserialize ("AdminPassword", AdminPassword);
 		ApplicationExecutablePath = sr.DeserializeWString ("ApplicationExecutablePath");
+		sr.Deserialize ("ElevatedServiceIdleTime", ElevatedServiceIdleTime);
 		sr.Deserialize ("ElevateUserPrivileges", ElevateUserPrivileges);
 		sr.Deserialize ("FastElevation", FastElevation);
+		sr.Deserialize ("RequestId", RequestId);
 	}
 
 	void CoreServiceRequest::Serialize (shared_ptr <Stream> stream) const
@@ -28,8 +30,10 @@ namespace CipherShed
 		Serializer sr (stream);
 		sr.Serialize ("AdminPassword", AdminPassword);
 		sr.Serialize ("ApplicationExecutablePath", wstring (ApplicationExecutablePath));
+		sr.Serialize ("ElevatedServiceIdleTime", ElevatedServiceIdleTime);
 		sr.Serialize ("ElevateUserPrivileges", ElevateUserPrivileges);
 		sr.Serialize ("FastElevation", FastElevation);
+		sr.Serialize ("RequestId", RequestId);
 	}
 
 	// CheckFilesystemRequest
@@ -119,6 +123,47 @@ namespace CipherShed
 		MountedVolumeInfo->Serialize (stream);
 	}
 
+	// DismountVolumesRequest
+	void DismountVolumesRequest::Deserialize (shared_ptr <Stream> stream)
+	{
+		CoreServiceRequest::Deserialize (stream);
+		Serializer sr (stream);
+		sr.Deserialize ("IgnoreOpenFiles", IgnoreOpenFiles);
+		Serializable::DeserializeList (stream, MountedVolumes);
+	}
+
+	bool DismountVolumesRequest::RequiresElevation () const
+	{
+#ifdef TC_MACOSX
+		foreach (shared_ptr <VolumeInfo> mountedVolume, MountedVolumes)
+		{
+			if (mountedVolume->Path.IsDevice())
+			{
+				try
+				{
+					File file;
+					file.Open (mountedVolume->Path, File::OpenReadWrite);
+				}
+				catch (...)
+				{
+					return true;
+				}
+			}
+		}
+
+		return false;
+#endif
+		return !Core->HasAdminPrivileges();
+	}
+
+	void DismountVolumesRequest::Serialize (shared_ptr <Stream> stream) const
+	{
+		CoreServiceRequest::Serialize (stream);
+		Serializer sr (stream);
+		sr.Serialize ("IgnoreOpenFiles", IgnoreOpenFiles);
+		Serializable::SerializeList (stream, MountedVolumes);
+	}
+
 	// GetDeviceSectorSizeRequest
 	void GetDeviceSectorSizeRequest::Deserialize (shared_ptr <Stream> stream)
 	{
@@ -201,6 +246,10 @@ namespace CipherShed
 
 	bool MountVolumeRequest::RequiresElevation () const
 	{
+		// Header keys are cached only by the elevated service, so that all mounts using the cache share it
+		if (Options->CacheHeaderKeys)
+			return true;
+
 #ifdef TC_MACOSX
 		if (Options->Path->IsDevice())
 		{
@@ -226,6 +275,60 @@ namespace CipherShed
 		Serializer sr (stream);
 		Options->Serialize (stream);
 	}
+
+	// MountVolumesRequest
+	void MountVolumesRequest::Deserialize (shared_ptr <Stream> stream)
+	{
+		CoreServiceRequest::Deserialize (stream);
+		Serializer sr (stream);
+		DeserializedOptions = Serializable::DeserializeNew <MountOptions> (stream);
+		Options = DeserializedOptions.get();
+
+		VolumePaths.clear();
+		foreach (const wstring &volumePath, sr.DeserializeWStringList ("VolumePaths"))
+			VolumePaths.push_back (volumePath);
+	}
+
+	bool MountVolumesRequest::RequiresElevation () const
+	{
+		// Header keys are cached only by the elevated service, so that all mounts using the cache share it
+		if (Options->CacheHeaderKeys)
+			return true;
+
+#ifdef TC_MACOSX
+		foreach (const VolumePath &volumePath, VolumePaths)
+		{
+			if (volumePath.IsDevice())
+			{
+				try
+				{
+					File file;
+					file.Open (volumePath, File::OpenReadWrite);
+				}
+				catch (...)
+				{
+					return true;
+				}
+			}
+		}
+
+		return false;
+#endif
+		return !Core->HasAdminPrivileges();
+	}
+
+	void MountVolumesRequest::Serialize (shared_ptr <Stream> stream) const
+	{
+		CoreServiceRequest::Serialize (stream);
+		Serializer sr (stream);
+		Options->Serialize (stream);
+
+		list <wstring> volumePaths;
+		foreach (const VolumePath &volumePath, VolumePaths)
+			volumePaths.push_back (volumePath);
+
+		sr.Serialize ("VolumePaths", volumePaths);
+	}
 	
 	// SetFileOwnerRequest
 	void SetFileOwnerRequest::Deserialize (shared_ptr <Stream> stream)
@@ -256,15 +359,29 @@ namespace CipherShed
 		sr.Serialize ("Path", wstring (Path));
 	}
 
+	// WipePasswordCacheRequest
+	void WipePasswordCacheRequest::Deserialize (shared_ptr <Stream> stream)
+	{
+		CoreServiceRequest::Deserialize (stream);
+	}
+
+	void WipePasswordCacheRequest::Serialize (shared_ptr <Stream> stream) const
+	{
+		CoreServiceRequest::Serialize (stream);
+	}
+
 
 	TC_SERIALIZER_FACTORY_ADD_CLASS (CoreServiceRequest);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (CheckFilesystemRequest);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (DismountFilesystemRequest);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (DismountVolumeRequest);
+	TC_SERIALIZER_FACTORY_ADD_CLASS (DismountVolumesRequest);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (ExitRequest);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (GetDeviceSectorSizeRequest);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (GetDeviceSizeRequest);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (GetHostDevicesRequest);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (MountVolumeRequest);
+	TC_SERIALIZER_FACTORY_ADD_CLASS (MountVolumesRequest);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (SetFileOwnerRequest);
+	TC_SERIALIZER_FACTORY_ADD_CLASS (WipePasswordCacheRequest);
 }
@@ -16,15 +16,18 @@ namespace CipherShed
 {
 	struct CoreServiceRequest : public Serializable
 	{
-		CoreServiceRequest () : ElevateUserPrivileges (false), FastElevation (false) { }
+		CoreServiceRequest () : ElevatedServiceIdleTime (0), ElevateUserPrivileges (false), FastElevation (false), RequestId (0) { }
 		TC_SERIALIZABLE (CoreServiceRequest);
 
 		virtual bool RequiresElevation () const { return false; }
 
 		string AdminPassword;
 		FilePath ApplicationExecutablePath;
+		uint32 ElevatedServiceIdleTime;
 		bool ElevateUserPrivileges;
 		bool FastElevation;
+		uint64 RequestId;
+		shared_ptr <Stream> ResultStream; // Not serialized; receives results sent before the response
 	};
 
 	struct CheckFilesystemRequest : CoreServiceRequest
@@ -67,6 +70,19 @@ namespace CipherShed
 		bool SyncVolumeInfo;
 	};
 
+	struct DismountVolumesRequest : CoreServiceRequest
+	{
+		DismountVolumesRequest () { }
+		DismountVolumesRequest (const VolumeInfoList &mountedVolumes, bool ignoreOpenFiles)
+			: IgnoreOpenFiles (ignoreOpenFiles), MountedVolumes (mountedVolumes) { }
+		TC_SERIALIZABLE (DismountVolumesRequest);
+
+		virtual bool RequiresElevation () const;
+
+		bool IgnoreOpenFiles;
+		VolumeInfoList MountedVolumes;
+	};
+
 	struct GetDeviceSectorSizeRequest : CoreServiceRequest
 	{
 		GetDeviceSectorSizeRequest () { }
@@ -119,6 +135,21 @@ namespace CipherShed
 		shared_ptr <MountOptions> DeserializedOptions;
 	};
 
+	struct MountVolumesRequest : CoreServiceRequest
+	{
+		MountVolumesRequest () { }
+		MountVolumesRequest (MountOptions *options, const VolumePathList &volumePaths) : Options (options), VolumePaths (volumePaths) { }
+		TC_SERIALIZABLE (MountVolumesRequest);
+
+		virtual bool RequiresElevation () const;
+
+		MountOptions *Options;
+		VolumePathList VolumePaths;
+
+	protected:
+		shared_ptr <MountOptions> DeserializedOptions;
+	};
+
 
 	struct SetFileOwnerRequest : CoreServiceRequest
 	{
@@ -131,6 +162,12 @@ namespace CipherShed
 		UserId Owner;
 		FilesystemPath Path;
 	};
+
+	struct WipePasswordCacheRequest : CoreServiceRequest
+	{
+		WipePasswordCacheRequest () { }
+		TC_SERIALIZABLE (WipePasswordCacheRequest);
+	};
 }
 
 #endif // TC_HEADER_Core_Unix_CoreServiceRequest
@@ -45,6 +45,18 @@ namespace CipherShed
 		DismountedVolumeInfo->Serialize (stream);
 	}
 
+	// DismountVolumesResponse
+	void DismountVolumesResponse::Deserialize (shared_ptr <Stream> stream)
+	{
+		Serializable::DeserializeList (stream, Results);
+	}
+
+	void DismountVolumesResponse::Serialize (shared_ptr <Stream> stream) const
+	{
+		Serializable::Serialize (stream);
+		Serializable::SerializeList (stream, Results);
+	}
+
 	// GetDeviceSectorSizeResponse
 	void GetDeviceSectorSizeResponse::Deserialize (shared_ptr <Stream> stream)
 	{
@@ -99,6 +111,18 @@ namespace CipherShed
 		MountedVolumeInfo->Serialize (stream);
 	}
 
+	// MountVolumesResponse
+	void MountVolumesResponse::Deserialize (shared_ptr <Stream> stream)
+	{
+		Serializable::DeserializeList (stream, Results);
+	}
+
+	void MountVolumesResponse::Serialize (shared_ptr <Stream> stream) const
+	{
+		Serializable::Serialize (stream);
+		Serializable::SerializeList (stream, Results);
+	}
+
 	// SetFileOwnerResponse
 	void SetFileOwnerResponse::Deserialize (shared_ptr <Stream> stream)
 	{
@@ -109,12 +133,25 @@ namespace CipherShed
 		Serializable::Serialize (stream);
 	}
 
+	// WipePasswordCacheResponse
+	void WipePasswordCacheResponse::Deserialize (shared_ptr <Stream> stream)
+	{
+	}
+
+	void WipePasswordCacheResponse::Serialize (shared_ptr <Stream> stream) const
+	{
+		Serializable::Serialize (stream);
+	}
+
 	TC_SERIALIZER_FACTORY_ADD_CLASS (CheckFilesystemResponse);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (DismountFilesystemResponse);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (DismountVolumeResponse);
+	TC_SERIALIZER_FACTORY_ADD_CLASS (DismountVolumesResponse);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (GetDeviceSectorSizeResponse);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (GetDeviceSizeResponse);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (GetHostDevicesResponse);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (MountVolumeResponse);
+	TC_SERIALIZER_FACTORY_ADD_CLASS (MountVolumesResponse);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (SetFileOwnerResponse);
+	TC_SERIALIZER_FACTORY_ADD_CLASS (WipePasswordCacheResponse);
 }
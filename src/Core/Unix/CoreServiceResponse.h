@@ -38,6 +38,15 @@ namespace CipherShed
 		shared_ptr <VolumeInfo> DismountedVolumeInfo;
 	};
 
+	struct DismountVolumesResponse : CoreServiceResponse
+	{
+		DismountVolumesResponse () { }
+		DismountVolumesResponse (const DismountResultList &results) : Results (results) { }
+		TC_SERIALIZABLE (DismountVolumesResponse);
+
+		DismountResultList Results;
+	};
+
 	struct GetDeviceSectorSizeResponse : CoreServiceResponse
 	{
 		GetDeviceSectorSizeResponse () { }
@@ -74,11 +83,26 @@ namespace CipherShed
 		shared_ptr <VolumeInfo> MountedVolumeInfo;
 	};
 
+	struct MountVolumesResponse : CoreServiceResponse
+	{
+		MountVolumesResponse () { }
+		MountVolumesResponse (const MountResultList &results) : Results (results) { }
+		TC_SERIALIZABLE (MountVolumesResponse);
+
+		MountResultList Results;
+	};
+
 	struct SetFileOwnerResponse : CoreServiceResponse
 	{
 		SetFileOwnerResponse () { }
 		TC_SERIALIZABLE (SetFileOwnerResponse);
 	};
+
+	struct WipePasswordCacheResponse : CoreServiceResponse
+	{
+		WipePasswordCacheResponse () { }
+		TC_SERIALIZABLE (WipePasswordCacheResponse);
+	};
 }
 
 #endif // TC_HEADER_Core_Unix_CoreServiceResponse
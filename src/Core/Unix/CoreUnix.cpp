@@ -9,18 +9,23 @@
 #include "CoreUnix.h"
 #include <errno.h>
 #include <iostream>
+#include <set>
 #include <signal.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include "../../Platform/FileStream.h"
+#include "../../Platform/Thread.h"
 #include "../../Driver/Fuse/FuseService.h"
+#include "../../Volume/EncryptionTest.h"
+#include "../../Volume/VolumeHeaderKeyCache.h"
 #include "../../Volume/VolumePasswordCache.h"
 
 namespace CipherShed
 {
-	CoreUnix::CoreUnix ()
+	CoreUnix::CoreUnix () : MountTableValid (false)
 	{
 		signal (SIGPIPE, SIG_IGN);
 		
@@ -143,6 +148,145 @@ namespace CipherShed
 		return mountedVolume;
 	}
 
+	DismountResultList CoreUnix::DismountVolumes (const VolumeInfoList &mountedVolumes, bool ignoreOpenFiles)
+	{
+		vector < shared_ptr <DismountResult> > results;
+		foreach (shared_ptr <VolumeInfo> mountedVolume, mountedVolumes)
+			results.push_back (shared_ptr <DismountResult> (new DismountResult (mountedVolume)));
+
+		// Teardown dependencies are determined once. A volume can be dismounted only after all volumes hosted by it.
+		vector <size_t> hostedVolumeCounts (results.size(), 0);
+		vector < list <size_t> > hostVolumes (results.size());
+
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			for (size_t j = 0; j < results.size(); ++j)
+			{
+				if (i != j && IsVolumeHostedBy (*results[i]->MountedVolume, *results[j]->MountedVolume))
+				{
+					hostVolumes[i].push_back (j);
+					++hostedVolumeCounts[j];
+				}
+			}
+		}
+
+		struct DismountFunctor : public Functor
+		{
+			DismountFunctor (CoreUnix &core, const vector < shared_ptr <DismountResult> > &results, const vector <size_t> &wave, bool ignoreOpenFiles, size_t &nextVolume, Mutex &volumeMutex)
+				: Core (core), IgnoreOpenFiles (ignoreOpenFiles), NextVolume (nextVolume), Results (results), VolumeMutex (volumeMutex), Wave (wave) { }
+
+			virtual void operator() ()
+			{
+				while (true)
+				{
+					shared_ptr <DismountResult> result;
+					{
+						ScopeLock lock (VolumeMutex);
+						if (NextVolume >= Wave.size())
+							return;
+
+						result = Results[Wave[NextVolume++]];
+					}
+
+					if (result->Error)
+						continue;
+
+					try
+					{
+						result->DismountedVolume = Core.DismountVolume (result->MountedVolume, IgnoreOpenFiles);
+					}
+					catch (Exception &e)
+					{
+						result->Error.reset (e.CloneNew());
+					}
+					catch (exception &e)
+					{
+						result->Error.reset (new ExternalException (SRC_POS, StringConverter::ToExceptionString (e)));
+					}
+					catch (...)
+					{
+						result->Error.reset (new UnknownException (SRC_POS));
+					}
+				}
+			}
+
+			CoreUnix &Core;
+			bool IgnoreOpenFiles;
+			size_t &NextVolume;
+			const vector < shared_ptr <DismountResult> > &Results;
+			Mutex &VolumeMutex;
+			const vector <size_t> &Wave;
+		};
+
+		// Teardown mostly waits for external processes and is therefore parallelized even on a single CPU
+		size_t maxThreadCount = (size_t) sysconf (_SC_NPROCESSORS_ONLN);
+		if (maxThreadCount < 4)
+			maxThreadCount = 4;
+
+		// Volumes are torn down in waves, each consisting of the remaining volumes which no longer host any mounted volume
+		vector <bool> processed (results.size(), false);
+		size_t processedCount = 0;
+
+		while (processedCount < results.size())
+		{
+			vector <size_t> wave;
+			for (size_t i = 0; i < results.size(); ++i)
+			{
+				if (!processed[i] && hostedVolumeCounts[i] == 0)
+					wave.push_back (i);
+			}
+
+			// Mounted volumes cannot host each other
+			if (wave.empty())
+			{
+				for (size_t i = 0; i < results.size(); ++i)
+				{
+					if (!processed[i])
+						wave.push_back (i);
+				}
+			}
+
+			size_t nextVolume = 0;
+			Mutex volumeMutex;
+			list < shared_ptr <Thread> > threads;
+
+			for (size_t i = 1; i < min (wave.size(), maxThreadCount); ++i)
+			{
+				make_shared_auto (Thread, thread);
+				thread->Start (new DismountFunctor (*this, results, wave, ignoreOpenFiles, nextVolume, volumeMutex));
+				threads.push_back (thread);
+			}
+
+			DismountFunctor dismount (*this, results, wave, ignoreOpenFiles, nextVolume, volumeMutex);
+			dismount();
+
+			foreach (shared_ptr <Thread> thread, threads)
+				thread->Join();
+
+			foreach (size_t volume, wave)
+			{
+				processed[volume] = true;
+				++processedCount;
+
+				foreach (size_t hostVolume, hostVolumes[volume])
+				{
+					// A host volume cannot be dismounted while a volume it hosts remains mounted
+					if (results[volume]->Error && !processed[hostVolume] && !results[hostVolume]->Error)
+						results[hostVolume]->Error.reset (new MountedVolumeInUse (SRC_POS));
+
+					if (hostedVolumeCounts[hostVolume] > 0)
+						--hostedVolumeCounts[hostVolume];
+				}
+			}
+		}
+
+		DismountResultList resultList;
+		foreach (shared_ptr <DismountResult> result, results)
+			resultList.push_back (result);
+
+		return resultList;
+	}
+
 	bool CoreUnix::FilesystemSupportsLargeFiles (const FilePath &filePath) const
 	{
 		string path = filePath;
@@ -250,12 +394,31 @@ namespace CipherShed
 	VolumeInfoList CoreUnix::GetMountedVolumes (const VolumePath &volumePath) const
 	{
 		VolumeInfoList volumes;
+		MountedFilesystemList mountTable = GetMountTable();
+
+		// Mount points indexed by device
+		map <string, DirectoryPath> deviceMountPoints;
+		foreach_ref (const MountedFilesystem &mf, mountTable)
+		{
+			if (deviceMountPoints.find (string (mf.Device)) == deviceMountPoints.end())
+				deviceMountPoints[string (mf.Device)] = mf.MountPoint;
+		}
 
-		foreach_ref (const MountedFilesystem &mf, GetMountedFilesystems ())
+		foreach_ref (const MountedFilesystem &mf, mountTable)
 		{
 			if (string (mf.MountPoint).find (GetFuseMountDirPrefix()) == string::npos)
 				continue;
 
+			if (!volumePath.IsEmpty())
+			{
+				// Skip control files of volumes known to be hosted by other paths
+				ScopeLock lock (MountTableMutex);
+				map <string, VolumePath>::const_iterator indexedPath = AuxMountPointVolumePaths.find (string (mf.MountPoint));
+
+				if (indexedPath != AuxMountPointVolumePaths.end() && wstring (indexedPath->second).compare (volumePath) != 0)
+					continue;
+			}
+
 			shared_ptr <VolumeInfo> mountedVol;
 			try
 			{
@@ -269,7 +432,12 @@ namespace CipherShed
 			{
 				continue;
 			}
-			
+
+			{
+				ScopeLock lock (MountTableMutex);
+				AuxMountPointVolumePaths[string (mf.MountPoint)] = mountedVol->Path;
+			}
+
 			if (!volumePath.IsEmpty() && wstring (mountedVol->Path).compare (volumePath) != 0)
 				continue;
 
@@ -277,10 +445,20 @@ namespace CipherShed
 
 			if (!mountedVol->VirtualDevice.IsEmpty())
 			{
-				MountedFilesystemList mpl = GetMountedFilesystems (mountedVol->VirtualDevice);
+				map <string, DirectoryPath>::const_iterator mountPoint = deviceMountPoints.find (string (mountedVol->VirtualDevice));
 
-				if (mpl.size() > 0)
-					mountedVol->MountPoint = mpl.front()->MountPoint;
+				if (mountPoint == deviceMountPoints.end())
+				{
+					char *resolvedPath = realpath (string (mountedVol->VirtualDevice).c_str(), NULL);
+					if (resolvedPath)
+					{
+						mountPoint = deviceMountPoints.find (string (resolvedPath));
+						free (resolvedPath);
+					}
+				}
+
+				if (mountPoint != deviceMountPoints.end())
+					mountedVol->MountPoint = mountPoint->second;
 			}
 
 			volumes.push_back (mountedVol);
@@ -291,6 +469,21 @@ namespace CipherShed
 
 		return volumes;
 	}
+
+	MountedFilesystemList CoreUnix::GetMountTable () const
+	{
+		ScopeLock lock (MountTableMutex);
+
+		if (!MountTableValid || HasMountTableChanged())
+		{
+			// A change signaled during parsing is reported by the next check
+			MountTable = GetMountedFilesystems();
+			AuxMountPointVolumePaths.clear();
+			MountTableValid = true;
+		}
+
+		return MountTable;
+	}
 	
 	gid_t CoreUnix::GetRealGroupId () const
 	{
@@ -335,6 +528,24 @@ namespace CipherShed
 		return GetMountedFilesystems (DevicePath(), mountPoint).size() == 0;
 	}
 
+	bool CoreUnix::IsVolumeHostedBy (const VolumeInfo &volume, const VolumeInfo &hostVolume) const
+	{
+		// Device-hosted volume created within the virtual device of the host volume
+		if (!hostVolume.VirtualDevice.IsEmpty() && string (volume.Path) == string (hostVolume.VirtualDevice))
+			return true;
+
+		if (hostVolume.MountPoint.IsEmpty())
+			return false;
+
+		// File-hosted volume stored, or filesystem mounted, within the filesystem of the host volume
+		string hostMountPoint = hostVolume.MountPoint;
+		if (hostMountPoint.empty() || hostMountPoint[hostMountPoint.size() - 1] != '/')
+			hostMountPoint += '/';
+
+		return string (volume.Path).find (hostMountPoint) == 0
+			|| (!volume.MountPoint.IsEmpty() && string (volume.MountPoint).find (hostMountPoint) == 0);
+	}
+
 	void CoreUnix::MountFilesystem (const DevicePath &devicePath, const DirectoryPath &mountPoint, const string &filesystemType, bool readOnly, const string &systemMountOptions) const
 	{
 		if (GetMountedFilesystems (DevicePath(), mountPoint).size() > 0)
@@ -399,44 +610,163 @@ namespace CipherShed
 
 		Cipher::EnableHwSupport (!options.NoHardwareCrypto);
 
-		shared_ptr <Volume> volume;
+		// Algorithms are verified before they decrypt the volume header
+		EncryptionTest::TestAllOnce();
 
-		while (true)
+		return MountOpenedVolume (OpenVolumeForMount (options), options);
+	}
+
+	MountResultList CoreUnix::MountVolumes (MountOptions &options, const VolumePathList &volumePaths, MountResultFunctor *resultFunctor)
+	{
+		Cipher::EnableHwSupport (!options.NoHardwareCrypto);
+		EncryptionTest::TestAllOnce();
+
+		// Keyfiles are applied once by the calling thread as security tokens may not be accessed concurrently
+		MountOptions trialOptions (options);
+		trialOptions.Password = Keyfile::ApplyListToPassword (options.Keyfiles, options.Password);
+		trialOptions.Keyfiles.reset();
+		trialOptions.ProtectionPassword = Keyfile::ApplyListToPassword (options.ProtectionKeyfiles, options.ProtectionPassword);
+		trialOptions.ProtectionKeyfiles.reset();
+
+		set <wstring> mountedVolumePaths;
+		foreach_ref (const VolumeInfo &mountedVolume, GetMountedVolumes())
+			mountedVolumePaths.insert (mountedVolume.Path);
+
+		vector < shared_ptr <MountTrial> > trials;
+		size_t pendingTrialCount = 0;
+
+		foreach (const VolumePath &volumePath, volumePaths)
 		{
-			try
+			make_shared_auto (MountTrial, trial);
+			trial->Options = trialOptions;
+			trial->Options.Path.reset (new VolumePath (volumePath));
+			trial->Result.reset (new MountResult (volumePath));
+
+			VolumeOpenHintMap::const_iterator openHint = options.OpenHints.find (volumePath);
+			if (openHint != options.OpenHints.end())
+				trial->Options.OpenHint = openHint->second;
+
+			if (mountedVolumePaths.find (volumePath) != mountedVolumePaths.end())
 			{
-				volume = OpenVolume (
-					options.Path,
-					options.PreserveTimestamps,
-					options.Password,
-					options.Keyfiles,
-					options.Protection,
-					options.ProtectionPassword,
-					options.ProtectionKeyfiles,
-					options.SharedAccessAllowed,
-					VolumeType::Unknown,
-					options.UseBackupHeaders,
-					options.PartitionInSystemEncryptionScope
-					);
+				trial->Result->Error.reset (new VolumeAlreadyMounted (SRC_POS));
+				trial->Completed = true;
+			}
+			else
+				++pendingTrialCount;
 
-				options.Password.reset();
+			trials.push_back (trial);
+		}
+
+		// Header trials, which dominate the time needed to mount a volume, are run concurrently
+		struct TrialFunctor : public Functor
+		{
+			TrialFunctor (const CoreUnix &core, vector < shared_ptr <MountTrial> > &trials, size_t &nextTrial, Mutex &trialMutex)
+				: Core (core), NextTrial (nextTrial), TrialMutex (trialMutex), Trials (trials) { }
+
+			virtual void operator() ()
+			{
+				while (true)
+				{
+					shared_ptr <MountTrial> trial;
+					{
+						ScopeLock lock (TrialMutex);
+						while (NextTrial < Trials.size() && Trials[NextTrial]->Completed)
+							++NextTrial;
+
+						if (NextTrial >= Trials.size())
+							return;
+
+						trial = Trials[NextTrial++];
+					}
+
+					Core.RunMountTrial (*trial);
+				}
 			}
-			catch (SystemException &e)
+
+			const CoreUnix &Core;
+			size_t &NextTrial;
+			Mutex &TrialMutex;
+			vector < shared_ptr <MountTrial> > &Trials;
+		};
+
+		size_t threadCount = (size_t) sysconf (_SC_NPROCESSORS_ONLN);
+		if (threadCount < 1)
+			threadCount = 1;
+		if (threadCount > pendingTrialCount)
+			threadCount = pendingTrialCount;
+
+		size_t nextTrial = 0;
+		Mutex trialMutex;
+
+		// Trials still running when starting a trial fails are completed before their data is released
+		typedef list < shared_ptr <Thread> > ThreadList;
+		ThreadList threads;
+		finally_do_arg (ThreadList *, &threads, { foreach (shared_ptr <Thread> thread, *finally_arg) thread->Join(); });
+
+		for (size_t i = 0; i < threadCount; ++i)
+		{
+			make_shared_auto (Thread, thread);
+			thread->Start (new TrialFunctor (*this, trials, nextTrial, trialMutex));
+			threads.push_back (thread);
+		}
+
+		foreach (shared_ptr <Thread> thread, threads)
+			thread->Join();
+		threads.clear();
+
+		// Passwords are released before mounting forks FUSE service processes, which would otherwise inherit copies of them
+		options.Password.reset();
+		options.ProtectionPassword.reset();
+		trialOptions.Password.reset();
+		trialOptions.ProtectionPassword.reset();
+
+		foreach (shared_ptr <MountTrial> trial, trials)
+		{
+			trial->Options.Password.reset();
+			trial->Options.ProtectionPassword.reset();
+		}
+
+		// Volumes are mounted and reported in the order of their paths
+		MountResultList results;
+		foreach (shared_ptr <MountTrial> trial, trials)
+		{
+			if (trial->OpenedVolume)
 			{
-				if (options.Protection != VolumeProtection::ReadOnly
-					&& (e.GetErrorCode() == EROFS || e.GetErrorCode() == EACCES || e.GetErrorCode() == EPERM))
+				try
 				{
-					// Read-only filesystem
-					options.Protection = VolumeProtection::ReadOnly;
-					continue;
+					trial->Options.SlotNumber = GetFirstFreeSlotNumber (options.SlotNumber);
+					trial->Options.MountPoint.reset (new DirectoryPath);
+					CoalesceSlotNumberAndMountPoint (trial->Options);
+
+					trial->Result->MountedVolume = MountOpenedVolume (trial->OpenedVolume, trial->Options);
+				}
+				catch (Exception &e)
+				{
+					trial->Result->Error.reset (e.CloneNew());
+				}
+				catch (exception &e)
+				{
+					trial->Result->Error.reset (new ExternalException (SRC_POS, StringConverter::ToExceptionString (e)));
+				}
+				catch (...)
+				{
+					trial->Result->Error.reset (new UnknownException (SRC_POS));
 				}
 
-				throw;
+				trial->OpenedVolume.reset();
 			}
 
-			break;
+			results.push_back (trial->Result);
+
+			if (resultFunctor)
+				(*resultFunctor) (trial->Result);
 		}
 
+		return results;
+	}
+
+	shared_ptr <VolumeInfo> CoreUnix::MountOpenedVolume (shared_ptr <Volume> volume, MountOptions &options)
+	{
 		if (options.Path->IsDevice())
 		{
 			if (volume->GetFile()->GetDeviceSectorSize() != volume->GetSectorSize())
@@ -496,7 +826,9 @@ namespace CipherShed
 
 		try
 		{
-			FuseService::Mount (volume, options.SlotNumber, fuseMountPoint);
+			// The shared FUSE service receives the open volume and is bypassed if it cannot be started
+			if (!options.SharedFuseService || !FuseService::MountShared (volume, options, fuseMountPoint))
+				FuseService::Mount (volume, options.SlotNumber, fuseMountPoint);
 		}
 		catch (...)
 		{
@@ -601,11 +933,93 @@ namespace CipherShed
 		}
 	}
 
+	shared_ptr <Volume> CoreUnix::OpenVolumeForMount (MountOptions &options) const
+	{
+		shared_ptr <Volume> volume;
+
+		while (true)
+		{
+			try
+			{
+				volume = OpenVolume (
+					options.Path,
+					options.PreserveTimestamps,
+					options.Password,
+					options.Keyfiles,
+					options.Protection,
+					options.ProtectionPassword,
+					options.ProtectionKeyfiles,
+					options.SharedAccessAllowed,
+					VolumeType::Unknown,
+					options.UseBackupHeaders,
+					options.PartitionInSystemEncryptionScope,
+					options.CacheHeaderKeys,
+					options.OpenHint
+					);
+
+				options.Password.reset();
+			}
+			catch (SystemException &e)
+			{
+				if (options.Protection != VolumeProtection::ReadOnly
+					&& (e.GetErrorCode() == EROFS || e.GetErrorCode() == EACCES || e.GetErrorCode() == EPERM))
+				{
+					// Read-only filesystem
+					options.Protection = VolumeProtection::ReadOnly;
+					continue;
+				}
+
+				throw;
+			}
+
+			break;
+		}
+
+		return volume;
+	}
+
+	void CoreUnix::RunMountTrial (MountTrial &trial) const
+	{
+		try
+		{
+			try
+			{
+				trial.OpenedVolume = OpenVolumeForMount (trial.Options);
+			}
+			catch (VolumeHostInUse&)
+			{
+				if (trial.Options.SharedAccessAllowed)
+					throw;
+
+				trial.Options.SharedAccessAllowed = true;
+				trial.OpenedVolume = OpenVolumeForMount (trial.Options);
+				trial.Result->SharedAccessUsed = true;
+			}
+		}
+		catch (Exception &e)
+		{
+			trial.Result->Error.reset (e.CloneNew());
+		}
+		catch (exception &e)
+		{
+			trial.Result->Error.reset (new ExternalException (SRC_POS, StringConverter::ToExceptionString (e)));
+		}
+		catch (...)
+		{
+			trial.Result->Error.reset (new UnknownException (SRC_POS));
+		}
+	}
+
 	void CoreUnix::SetFileOwner (const FilesystemPath &path, const UserId &owner) const
 	{
 		throw_sys_if (chown (string (path).c_str(), owner.SystemId, (gid_t) -1) == -1);
 	}
 
+	void CoreUnix::WipePasswordCache () const
+	{
+		VolumeHeaderKeyCache::Clear();
+	}
+
 	DirectoryPath CoreUnix::SlotNumberToMountPoint (VolumeSlotNumber slotNumber) const
 	{
 		if (slotNumber < GetFirstSlotNumber() || slotNumber > GetLastSlotNumber())
@@ -25,6 +25,7 @@ namespace CipherShed
 		virtual void CheckFilesystem (shared_ptr <VolumeInfo> mountedVolume, bool repair = false) const; 
 		virtual void DismountFilesystem (const DirectoryPath &mountPoint, bool force) const;
 		virtual shared_ptr <VolumeInfo> DismountVolume (shared_ptr <VolumeInfo> mountedVolume, bool ignoreOpenFiles = false, bool syncVolumeInfo = false);
+		virtual DismountResultList DismountVolumes (const VolumeInfoList &mountedVolumes, bool ignoreOpenFiles = false);
 		virtual bool FilesystemSupportsLargeFiles (const FilePath &filePath) const;
 		virtual DirectoryPath GetDeviceMountPoint (const DevicePath &devicePath) const;
 		virtual uint32 GetDeviceSectorSize (const DevicePath &devicePath) const;
@@ -41,11 +42,22 @@ namespace CipherShed
 		virtual bool HasAdminPrivileges () const { return getuid() == 0 || geteuid() == 0; }
 		virtual VolumeSlotNumber MountPointToSlotNumber (const DirectoryPath &mountPoint) const;
 		virtual shared_ptr <VolumeInfo> MountVolume (MountOptions &options);
+		virtual MountResultList MountVolumes (MountOptions &options, const VolumePathList &volumePaths, MountResultFunctor *resultFunctor = nullptr);
 		virtual void SetFileOwner (const FilesystemPath &path, const UserId &owner) const;
 		virtual DirectoryPath SlotNumberToMountPoint (VolumeSlotNumber slotNumber) const;
-		virtual void WipePasswordCache () const { throw NotApplicable (SRC_POS); }
+		virtual void WipePasswordCache () const;
 
 	protected:
+		struct MountTrial
+		{
+			MountTrial () : Completed (false) { }
+
+			bool Completed;
+			MountOptions Options;
+			shared_ptr <Volume> OpenedVolume;
+			shared_ptr <MountResult> Result;
+		};
+
 		virtual DevicePath AttachFileToLoopDevice (const FilePath &filePath, bool readOnly) const { throw NotApplicable (SRC_POS); }
 		virtual void DetachLoopDevice (const DevicePath &devicePath) const { throw NotApplicable (SRC_POS); }
 		virtual void DismountNativeVolume (shared_ptr <VolumeInfo> mountedVolume) const { throw NotApplicable (SRC_POS); }
@@ -53,13 +65,25 @@ namespace CipherShed
 		virtual string GetDefaultMountPointPrefix () const;
 		virtual string GetFuseMountDirPrefix () const { return ".ciphershed_aux_mnt"; }
 		virtual MountedFilesystemList GetMountedFilesystems (const DevicePath &devicePath = DevicePath(), const DirectoryPath &mountPoint = DirectoryPath()) const = 0;
+		virtual MountedFilesystemList GetMountTable () const;
 		virtual uid_t GetRealUserId () const;
 		virtual gid_t GetRealGroupId () const;
 		virtual string GetTempDirectory () const;
+		virtual bool HasMountTableChanged () const { return true; }
+		virtual bool IsVolumeHostedBy (const VolumeInfo &volume, const VolumeInfo &hostVolume) const;
 		virtual void MountFilesystem (const DevicePath &devicePath, const DirectoryPath &mountPoint, const string &filesystemType, bool readOnly, const string &systemMountOptions) const;
 		virtual void MountAuxVolumeImage (const DirectoryPath &auxMountPoint, const MountOptions &options) const;
+		virtual shared_ptr <VolumeInfo> MountOpenedVolume (shared_ptr <Volume> volume, MountOptions &options);
 		virtual void MountVolumeNative (shared_ptr <Volume> volume, MountOptions &options, const DirectoryPath &auxMountPoint) const { throw NotApplicable (SRC_POS); }
-		
+		virtual shared_ptr <Volume> OpenVolumeForMount (MountOptions &options) const;
+		virtual void RunMountTrial (MountTrial &trial) const;
+
+		// Mount table parsed once per change and volume paths indexed by auxiliary mount point
+		mutable map <string, VolumePath> AuxMountPointVolumePaths;
+		mutable MountedFilesystemList MountTable;
+		mutable Mutex MountTableMutex;
+		mutable bool MountTableValid;
+
 	private:
 		CoreUnix (const CoreUnix &);
 		CoreUnix &operator= (const CoreUnix &);
@@ -6,17 +6,23 @@
  packages.
 */
 
+#include <fcntl.h>
 #include <fstream>
 #include <iomanip>
 #include <mntent.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <sys/inotify.h>
 #include <sys/mount.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
 #include "CoreLinux.h"
 #include "../../../Platform/SystemInfo.h"
 #include "../../../Platform/TextReader.h"
+#include "../../../Platform/Time.h"
+#include "../../../Platform/Unix/Poller.h"
 #include "../../../Volume/EncryptionModeLRW.h"
 #include "../../../Volume/EncryptionModeXTS.h"
 #include "../../../Driver/Fuse/FuseService.h"
@@ -26,12 +32,14 @@
 
 namespace CipherShed
 {
-	CoreLinux::CoreLinux ()
+	CoreLinux::CoreLinux () : MountInfoFd (-1), MountInfoProcessId (0)
 	{
 	}
 
 	CoreLinux::~CoreLinux ()
 	{
+		if (MountInfoFd != -1 && MountInfoProcessId == getpid())
+			close (MountInfoFd);
 	}
 
 	DevicePath CoreLinux::AttachFileToLoopDevice (const FilePath &filePath, bool readOnly) const
@@ -142,10 +150,7 @@ namespace CipherShed
 				}
 			}
 
-			for (int t = 0; FilesystemPath (devPath).IsBlockDevice() && t < 20; t++)
-			{
-				Thread::Sleep (100);
-			}
+			WaitForDevicePath (devPath, false, 2000);
 
 			devPath = string (mountedVolume->VirtualDevice) + "_" + StringConverter::ToSingle (devCount++);
 		}
@@ -154,6 +159,18 @@ namespace CipherShed
 	HostDeviceList CoreLinux::GetHostDevices (bool pathListOnly) const
 	{
 		HostDeviceList devices;
+
+		// Mount points of all devices are obtained from a single pass over the mount table
+		map <string, DirectoryPath> deviceMountPoints;
+		if (!pathListOnly)
+		{
+			foreach_ref (const MountedFilesystem &mf, GetMountedFilesystems())
+			{
+				if (deviceMountPoints.find (string (mf.Device)) == deviceMountPoints.end())
+					deviceMountPoints[string (mf.Device)] = mf.MountPoint;
+			}
+		}
+
 		TextReader tr ("/proc/partitions");
 
 		string line;
@@ -185,27 +202,82 @@ namespace CipherShed
 
 				hostDevice->Path = string (fields[3].find ("/dev/") == string::npos ? "/dev/" : "") + fields[3];
 
+				// Attributes of block devices are exported by sysfs with '/' in device names replaced by '!'
+				string sysfsName = fields[3];
+				for (size_t i = 0; i < sysfsName.size(); ++i)
+				{
+					if (sysfsName[i] == '/')
+						sysfsName[i] = '!';
+				}
+
+				string sysfsPath = string ("/sys/class/block/") + sysfsName;
+				bool sysfsAvailable = FilesystemPath (sysfsPath).IsDirectory();
+
 				if (!pathListOnly)
 				{
 					hostDevice->Size = StringConverter::ToUInt64 (fields[2]) * 1024;
-					hostDevice->MountPoint = GetDeviceMountPoint (hostDevice->Path);
 					hostDevice->SystemNumber = 0;
-				}
 
-				try
-				{
-					StringConverter::GetTrailingNumber (fields[3]);
-					if (devices.size() > 0)
+					string sysfsValue;
+					if (sysfsAvailable && ReadSysfsValue (sysfsPath + "/size", sysfsValue))
+					{
+						// Size in 512-byte units is not rounded down to a multiple of 1 KB
+						try
+						{
+							hostDevice->Size = StringConverter::ToUInt64 (sysfsValue) * 512;
+						}
+						catch (...) { }
+					}
+
+					if (sysfsAvailable && ReadSysfsValue (sysfsPath + "/removable", sysfsValue))
+						hostDevice->Removable = (sysfsValue == "1");
+
+					map <string, DirectoryPath>::const_iterator mountPoint = deviceMountPoints.find (string (hostDevice->Path));
+
+					if (mountPoint == deviceMountPoints.end())
 					{
-						HostDevice &prevDev = **--devices.end();
-						if (string (hostDevice->Path).find (prevDev.Path) == 0)
+						char *resolvedPath = realpath (string (hostDevice->Path).c_str(), NULL);
+						if (resolvedPath)
 						{
-							prevDev.Partitions.push_back (hostDevice);
-							continue;
+							mountPoint = deviceMountPoints.find (string (resolvedPath));
+							free (resolvedPath);
 						}
 					}
+
+					if (mountPoint != deviceMountPoints.end())
+						hostDevice->MountPoint = mountPoint->second;
+				}
+
+				bool partition;
+				if (sysfsAvailable)
+				{
+					partition = FilesystemPath (sysfsPath + "/partition").IsFile();
+				}
+				else
+				{
+					try
+					{
+						StringConverter::GetTrailingNumber (fields[3]);
+						partition = true;
+					}
+					catch (...)
+					{
+						partition = false;
+					}
+				}
+
+				if (partition && devices.size() > 0)
+				{
+					HostDevice &prevDev = **--devices.end();
+					if (string (hostDevice->Path).find (prevDev.Path) == 0)
+					{
+						if (!pathListOnly)
+							hostDevice->Removable = prevDev.Removable;
+
+						prevDev.Partitions.push_back (hostDevice);
+						continue;
+					}
 				}
-				catch (...) { }
 
 				devices.push_back (hostDevice);
 				continue;
@@ -268,6 +340,43 @@ namespace CipherShed
 		return mountedFilesystems;
 	}
 
+	bool CoreLinux::HasMountTableChanged () const
+	{
+		// A regular /etc/mtab file is updated by mount(8) only after the kernel mount table has changed
+		struct stat mtabStat;
+		if (lstat ("/etc/mtab", &mtabStat) == 0 && !S_ISLNK (mtabStat.st_mode))
+			return true;
+
+		// Change notifications of an open mountinfo file are consumed by poll() and must
+		// therefore not be shared with forked processes
+		if (MountInfoFd == -1 || MountInfoProcessId != getpid())
+		{
+			MountInfoFd = open ("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+			MountInfoProcessId = getpid();
+			return true;
+		}
+
+		pollfd pfd;
+		pfd.fd = MountInfoFd;
+		pfd.events = POLLPRI;
+		pfd.revents = 0;
+
+		return poll (&pfd, 1, 0) != 0;
+	}
+
+	bool CoreLinux::ReadSysfsValue (const string &path, string &value) const
+	{
+		try
+		{
+			TextReader tr (path);
+			return tr.ReadLine (value);
+		}
+		catch (...)
+		{
+			return false;
+		}
+	}
+
 	void CoreLinux::MountFilesystem (const DevicePath &devicePath, const DirectoryPath &mountPoint, const string &filesystemType, bool readOnly, const string &systemMountOptions) const
 	{
 		bool fsMounted = false;
@@ -396,21 +505,8 @@ namespace CipherShed
 				Process::Execute ("dmsetup", execArgs, -1, nullptr, &dmCreateArgsBuf);
 				
 				// Wait for the device to be created
-				for (int t = 0; true; t++)
-				{
-					try
-					{
-						FilesystemPath (nativeDevPath).GetType();
-						break;
-					}
-					catch (...)
-					{
-						if (t > 20)
-							throw;
-
-						Thread::Sleep (100);
-					}
-				}
+				if (!WaitForDevicePath (nativeDevPath, true, 2000))
+					FilesystemPath (nativeDevPath).GetType();
 
 				nativeDevCreated = true;
 				++nativeDevCount;
@@ -474,6 +570,50 @@ namespace CipherShed
 		}
 	}
 
+	bool CoreLinux::WaitForDevicePath (const string &devicePath, bool created, int timeOut) const
+	{
+		struct stat statData;
+		size_t dirEnd = devicePath.rfind ('/');
+
+		// Device nodes are created and removed asynchronously by udev. Changes of the parent directory are
+		// watched in order to avoid polling. The path is checked after the watch has been added to avoid races.
+		int inotifyFd = inotify_init();
+		finally_do_arg (int, inotifyFd, { if (finally_arg != -1) close (finally_arg); });
+
+		bool watched = inotifyFd != -1 && dirEnd != string::npos
+			&& fcntl (inotifyFd, F_SETFL, O_NONBLOCK) != -1
+			&& inotify_add_watch (inotifyFd, devicePath.substr (0, dirEnd).c_str(), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO) != -1;
+
+		uint64 deadline = Time::GetCurrent() + static_cast <uint64> (timeOut) * 10000;
+
+		while ((stat (devicePath.c_str(), &statData) == 0) != created)
+		{
+			uint64 currentTime = Time::GetCurrent();
+			if (currentTime >= deadline)
+				return false;
+
+			int remainingTime = static_cast <int> ((deadline - currentTime) / 10000) + 1;
+
+			if (!watched)
+			{
+				Thread::Sleep (min (remainingTime, 100));
+				continue;
+			}
+
+			try
+			{
+				Poller poller (inotifyFd);
+				poller.WaitForData (remainingTime);
+
+				char events[4096];
+				if (read (inotifyFd, events, sizeof (events))) { } // Events only indicate that the path needs to be checked
+			}
+			catch (TimeOut&) { }
+		}
+
+		return true;
+	}
+
 	std::auto_ptr <CoreBase> Core (new CoreServiceProxy <CoreLinux>);
 	std::auto_ptr <CoreBase> CoreDirect (new CoreLinux);
 }
@@ -27,8 +27,14 @@ namespace CipherShed
 		virtual void DetachLoopDevice (const DevicePath &devicePath) const;
 		virtual void DismountNativeVolume (shared_ptr <VolumeInfo> mountedVolume) const;
 		virtual MountedFilesystemList GetMountedFilesystems (const DevicePath &devicePath = DevicePath(), const DirectoryPath &mountPoint = DirectoryPath()) const;
+		virtual bool HasMountTableChanged () const;
 		virtual void MountFilesystem (const DevicePath &devicePath, const DirectoryPath &mountPoint, const string &filesystemType, bool readOnly, const string &systemMountOptions) const;
 		virtual void MountVolumeNative (shared_ptr <Volume> volume, MountOptions &options, const DirectoryPath &auxMountPoint) const;
+		bool ReadSysfsValue (const string &path, string &value) const;
+		bool WaitForDevicePath (const string &devicePath, bool created, int timeOut) const;
+
+		mutable int MountInfoFd;
+		mutable pid_t MountInfoProcessId;
 
 	private:
 		CoreLinux (const CoreLinux &);
@@ -6,6 +6,7 @@
  packages.
 */
 
+#include "../Platform/Time.h"
 #include "../Volume/EncryptionTest.h"
 #include "../Volume/EncryptionModeXTS.h"
 #include "Core.h"
@@ -22,7 +23,12 @@
 namespace CipherShed
 {
 	VolumeCreator::VolumeCreator ()
-		: SizeDone (0)
+		: CreationEndTime (0),
+		CreationStartTime (0),
+		SizeDone (0),
+		StartTime (0),
+		WriteBufferCount (DefaultWriteBufferCount),
+		WriteBufferSize (DefaultWriteBufferSize)
 	{
 	}
 
@@ -43,6 +49,8 @@ namespace CipherShed
 
 	void VolumeCreator::CreationThread ()
 	{
+		StartTime = Time::GetCurrent();
+
 		try
 		{
 			uint64 endOffset;
@@ -63,17 +71,33 @@ namespace CipherShed
 				if (filesystemSize < TC_MIN_FAT_FS_SIZE || filesystemSize > TC_MAX_FAT_SECTOR_COUNT * Options->SectorSize)
 					throw ParameterIncorrect (SRC_POS);
 
-				struct WriteSectorCallback : public FatFormatter::WriteSectorCallback
+				struct WriteExtentCallback : public FatFormatter::WriteExtentCallback
 				{
-					WriteSectorCallback (VolumeCreator *creator) : Creator (creator), OutputBuffer (File::GetOptimalWriteSize()), OutputBufferWritePos (0) { }
+					WriteExtentCallback (VolumeCreator *creator) : Creator (creator), OutputBuffer (creator->WriteBufferSize), OutputBufferWritePos (0) { }
 
-					virtual bool operator() (const BufferPtr &sector)
+					virtual bool operator() (uint64 offset, uint64 length, const ConstBufferPtr &data)
 					{
-						OutputBuffer.GetRange (OutputBufferWritePos, sector.Size()).CopyFrom (sector);
-						OutputBufferWritePos += sector.Size();
+						// Extents are gathered into a large buffer, so that zero-filled regions
+						// are encrypted by the thread pool and written in a few large batches
+						for (uint64 extentPos = 0; extentPos < length; )
+						{
+							if (Creator->AbortRequested)
+								return false;
+
+							size_t size = (size_t) min ((uint64) (OutputBuffer.Size() - OutputBufferWritePos), length - extentPos);
+							BufferPtr outputRange = OutputBuffer.GetRange (OutputBufferWritePos, size);
+
+							if (data.Size() > 0)
+								outputRange.CopyFrom (data.GetRange ((size_t) extentPos, size));
+							else
+								outputRange.Zero();
 
-						if (OutputBufferWritePos >= OutputBuffer.Size())
-							FlushOutputBuffer();
+							OutputBufferWritePos += size;
+							extentPos += size;
+
+							if (OutputBufferWritePos >= OutputBuffer.Size())
+								FlushOutputBuffer();
+						}
 
 						return !Creator->AbortRequested;
 					}
@@ -99,31 +123,17 @@ namespace CipherShed
 					size_t OutputBufferWritePos;
 				};
 
-				WriteSectorCallback sectorWriter (this);
-				FatFormatter::Format (sectorWriter, filesystemSize, Options->FilesystemClusterSize, Options->SectorSize);
-				sectorWriter.FlushOutputBuffer();
+				WriteExtentCallback extentWriter (this);
+				FatFormatter::Format (extentWriter, filesystemSize, Options->FilesystemClusterSize, Options->SectorSize);
+				extentWriter.FlushOutputBuffer();
 			}
 
 			if (!Options->Quick)
 			{
-				// Empty sectors are encrypted with different key to randomize plaintext
-				Core->RandomizeEncryptionAlgorithmKey (Options->EA);
-
-				SecureBuffer outputBuffer (File::GetOptimalWriteSize());
-				uint64 dataFragmentLength = outputBuffer.Size();
-
-				while (!AbortRequested && WriteOffset < endOffset)
-				{
-					if (WriteOffset + dataFragmentLength > endOffset)
-						dataFragmentLength = endOffset - WriteOffset;
-
-					outputBuffer.Zero();
-					Options->EA->EncryptSectors (outputBuffer, WriteOffset / ENCRYPTION_DATA_UNIT_SIZE, dataFragmentLength / ENCRYPTION_DATA_UNIT_SIZE, ENCRYPTION_DATA_UNIT_SIZE);
-					VolumeFile->Write (outputBuffer, (size_t) dataFragmentLength);
-
-					WriteOffset += dataFragmentLength;
-					SizeDone.Set (WriteOffset - DataStart);
-				}
+				// Empty sectors are filled with keystream generated using a random key
+				RandomKeystream keystream;
+				Core->RandomizeKeystreamKey (keystream);
+				WriteRandomData (endOffset, keystream);
 			}
 
 			if (!AbortRequested)
@@ -148,8 +158,9 @@ namespace CipherShed
 				if (Options->Type == VolumeType::Normal)
 				{
 					// Write random data to space reserved for hidden volume backup header
-					Core->RandomizeEncryptionAlgorithmKey (Options->EA);
-					Options->EA->Encrypt (backupHeader);
+					RandomKeystream keystream;
+					Core->RandomizeKeystreamKey (keystream);
+					keystream.GetData (backupHeader, 0);
 
 					VolumeFile->Write (backupHeader);
 				}
@@ -171,12 +182,31 @@ namespace CipherShed
 		}
 
 		VolumeFile.reset();
+		CreationEndTime = Time::GetCurrent();
 		mProgressInfo.CreationInProgress = false;
 	}
 
+	void VolumeCreator::CloneVolume (const VolumePath &templatePath, const VolumePath &path)
+	{
+		if (templatePath.IsDevice() || path.IsDevice())
+			throw ParameterIncorrect (SRC_POS);
+
+		File::Clone (FilePath (wstring (templatePath)), FilePath (wstring (path)));
+	}
+
 	void VolumeCreator::CreateVolume (shared_ptr <VolumeCreationOptions> options)
 	{
-		EncryptionTest::TestAll();
+		CreationStartTime = Time::GetCurrent();
+		CreationEndTime = 0;
+
+		EncryptionTest::TestAllOnce();
+
+		// Buffers of the volume data filled while previously filled buffers are being written
+		if (options->WriteBufferCount != 0 || options->WriteBufferSize != 0)
+		{
+			SetWriteBuffers (options->WriteBufferCount != 0 ? options->WriteBufferCount : DefaultWriteBufferCount,
+				options->WriteBufferSize != 0 ? options->WriteBufferSize : DefaultWriteBufferSize);
+		}
 
 		{
 #ifdef TC_UNIX
@@ -206,6 +236,33 @@ namespace CipherShed
 
 		try
 		{
+			// Container allocation
+			if (!options->Path.IsDevice() && options->Type != VolumeType::Hidden)
+			{
+				switch (options->Allocation)
+				{
+				case VolumeCreationOptions::ContainerAllocation::Default:
+					break;
+
+				case VolumeCreationOptions::ContainerAllocation::Preallocated:
+					VolumeFile->Preallocate (options->Size);
+					break;
+
+				case VolumeCreationOptions::ContainerAllocation::Sparse:
+					// Filling the data area would allocate all blocks
+					if (!options->Quick)
+						throw ParameterIncorrect (SRC_POS);
+
+					VolumeFile->SetLength (options->Size);
+					break;
+
+				default:
+					throw ParameterIncorrect (SRC_POS);
+				}
+
+				HostSize = VolumeFile->Length();
+			}
+
 			// Sector size
 			if (options->Path.IsDevice())
 			{
@@ -292,8 +349,9 @@ namespace CipherShed
 			if (options->Type == VolumeType::Normal)
 			{
 				// Write random data to space reserved for hidden volume header
-				Core->RandomizeEncryptionAlgorithmKey (options->EA);
-				options->EA->Encrypt (headerBuffer);
+				RandomKeystream keystream;
+				Core->RandomizeKeystreamKey (keystream);
+				keystream.GetData (headerBuffer, 0);
 
 				VolumeFile->Write (headerBuffer);
 			}
@@ -340,6 +398,192 @@ namespace CipherShed
 	VolumeCreator::ProgressInfo VolumeCreator::GetProgressInfo ()
 	{
 		mProgressInfo.SizeDone = SizeDone.Get();
+
+		// Time is measured in units of 100 ns
+		uint64 elapsedTime = StartTime != 0 ? Time::GetCurrent() - StartTime : 0;
+		mProgressInfo.BytesPerSecond = elapsedTime > 0 ? (uint64) (mProgressInfo.SizeDone * 10000000.0 / elapsedTime) : 0;
+
+		if (CreationStartTime != 0)
+			mProgressInfo.ElapsedTime = ((CreationEndTime != 0 ? CreationEndTime : Time::GetCurrent()) - CreationStartTime) / 10000;
+		else
+			mProgressInfo.ElapsedTime = 0;
+
 		return mProgressInfo;
 	}
+
+	void VolumeCreator::SetWriteBuffers (size_t bufferCount, size_t bufferSize)
+	{
+		if (bufferCount < 1 || bufferSize < ENCRYPTION_DATA_UNIT_SIZE || bufferSize % ENCRYPTION_DATA_UNIT_SIZE != 0)
+			throw ParameterIncorrect (SRC_POS);
+
+		WriteBufferCount = bufferCount;
+		WriteBufferSize = bufferSize;
+	}
+
+	void VolumeCreator::WriteRandomData (uint64 endOffset, const RandomKeystream &keystream)
+	{
+		// Buffers are filled with keystream by this thread while a writer thread writes previously filled
+		// buffers to the volume. Generation of each buffer is distributed by the encryption thread pool.
+		struct Pipeline
+		{
+			Pipeline () : ReadyBufferCount (0), ProducerFinished (false), WriterFailed (false) { }
+
+			vector < shared_ptr <SecureBuffer> > Buffers;
+			vector <size_t> BufferLengths;
+			SyncEvent BufferReadyEvent;
+			SyncEvent BufferWrittenEvent;
+			Mutex PipelineMutex;
+			size_t ReadyBufferCount;
+			bool ProducerFinished;
+			bool WriterFailed;
+			shared_ptr <Exception> WriterException;
+		};
+
+		struct WriterFunctor : public Functor
+		{
+			WriterFunctor (VolumeCreator *creator, Pipeline &pipeline) : Creator (creator), PipelineState (pipeline) { }
+
+			virtual void operator() ()
+			{
+				size_t bufferIndex = 0;
+				uint64 writeOffset = Creator->WriteOffset;
+
+				try
+				{
+					while (true)
+					{
+						size_t length;
+						while (true)
+						{
+							{
+								ScopeLock lock (PipelineState.PipelineMutex);
+
+								if (PipelineState.ReadyBufferCount > 0)
+								{
+									length = PipelineState.BufferLengths[bufferIndex];
+									break;
+								}
+
+								if (PipelineState.ProducerFinished)
+									return;
+							}
+
+							PipelineState.BufferReadyEvent.Wait();
+						}
+
+						Creator->VolumeFile->Write (*PipelineState.Buffers[bufferIndex], length);
+
+						writeOffset += length;
+						Creator->SizeDone.Set (writeOffset - Creator->DataStart);
+
+						{
+							ScopeLock lock (PipelineState.PipelineMutex);
+							--PipelineState.ReadyBufferCount;
+						}
+
+						PipelineState.BufferWrittenEvent.Signal();
+						bufferIndex = (bufferIndex + 1) % PipelineState.Buffers.size();
+					}
+				}
+				catch (Exception &e)
+				{
+					PipelineState.WriterException.reset (e.CloneNew());
+				}
+				catch (exception &e)
+				{
+					PipelineState.WriterException.reset (new ExternalException (SRC_POS, StringConverter::ToExceptionString (e)));
+				}
+				catch (...)
+				{
+					PipelineState.WriterException.reset (new UnknownException (SRC_POS));
+				}
+
+				{
+					ScopeLock lock (PipelineState.PipelineMutex);
+					PipelineState.WriterFailed = true;
+				}
+
+				PipelineState.BufferWrittenEvent.Signal();
+			}
+
+			VolumeCreator *Creator;
+			Pipeline &PipelineState;
+		};
+
+		Pipeline pipeline;
+		for (size_t i = 0; i < WriteBufferCount; ++i)
+		{
+			pipeline.Buffers.push_back (shared_ptr <SecureBuffer> (new SecureBuffer (WriteBufferSize)));
+			pipeline.BufferLengths.push_back (0);
+		}
+
+		Thread writerThread;
+		writerThread.Start (new WriterFunctor (this, pipeline));
+
+		size_t bufferIndex = 0;
+
+		try
+		{
+			while (!AbortRequested && WriteOffset < endOffset)
+			{
+				// Wait for a buffer which is not queued for writing
+				bool writerFailed = false;
+				while (true)
+				{
+					{
+						ScopeLock lock (pipeline.PipelineMutex);
+
+						writerFailed = pipeline.WriterFailed;
+						if (writerFailed || pipeline.ReadyBufferCount < pipeline.Buffers.size())
+							break;
+					}
+
+					pipeline.BufferWrittenEvent.Wait();
+				}
+
+				if (writerFailed)
+					break;
+
+				uint64 dataFragmentLength = WriteBufferSize;
+				if (WriteOffset + dataFragmentLength > endOffset)
+					dataFragmentLength = endOffset - WriteOffset;
+
+				keystream.GetData (pipeline.Buffers[bufferIndex]->GetRange (0, (size_t) dataFragmentLength), WriteOffset);
+
+				{
+					ScopeLock lock (pipeline.PipelineMutex);
+					pipeline.BufferLengths[bufferIndex] = (size_t) dataFragmentLength;
+					++pipeline.ReadyBufferCount;
+				}
+
+				pipeline.BufferReadyEvent.Signal();
+
+				WriteOffset += dataFragmentLength;
+				bufferIndex = (bufferIndex + 1) % pipeline.Buffers.size();
+			}
+		}
+		catch (...)
+		{
+			{
+				ScopeLock lock (pipeline.PipelineMutex);
+				pipeline.ProducerFinished = true;
+			}
+
+			pipeline.BufferReadyEvent.Signal();
+			writerThread.Join();
+			throw;
+		}
+
+		// Queued buffers are written before the writer thread exits
+		{
+			ScopeLock lock (pipeline.PipelineMutex);
+			pipeline.ProducerFinished = true;
+		}
+
+		pipeline.BufferReadyEvent.Signal();
+		writerThread.Join();
+
+		if (pipeline.WriterException)
+			pipeline.WriterException->Throw();
+	}
 }
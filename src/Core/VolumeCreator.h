@@ -27,6 +27,18 @@ namespace CipherShed
 		shared_ptr <EncryptionAlgorithm> EA;
 		bool Quick;
 
+		struct ContainerAllocation
+		{
+			enum Enum
+			{
+				Default = 0,	// File grows as the volume is formatted
+				Preallocated,	// Whole file is allocated before the volume is formatted
+				Sparse			// File space is allocated on first write to each block (requires quick format)
+			};
+		};
+
+		ContainerAllocation::Enum Allocation;
+
 		struct FilesystemType
 		{
 			enum Enum
@@ -61,6 +73,8 @@ namespace CipherShed
 		FilesystemType::Enum Filesystem;
 		uint32 FilesystemClusterSize;
 		uint32 SectorSize;
+		uint32 WriteBufferCount;	// 0 = VolumeCreator::DefaultWriteBufferCount
+		uint32 WriteBufferSize;		// 0 = VolumeCreator::DefaultWriteBufferSize
 	};
 
 	class VolumeCreator
@@ -72,6 +86,8 @@ namespace CipherShed
 			bool CreationInProgress;
 			uint64 TotalSize;
 			uint64 SizeDone;
+			uint64 BytesPerSecond;
+			uint64 ElapsedTime;		// Milliseconds since the creation was started
 		};
 
 		struct KeyInfo
@@ -85,12 +101,18 @@ namespace CipherShed
 
 		void Abort ();
 		void CheckResult ();
+		static void CloneVolume (const VolumePath &templatePath, const VolumePath &path);
 		void CreateVolume (shared_ptr <VolumeCreationOptions> options);
 		KeyInfo GetKeyInfo () const;
 		ProgressInfo GetProgressInfo ();
+		void SetWriteBuffers (size_t bufferCount, size_t bufferSize);
+
+		static const size_t DefaultWriteBufferCount = 4;
+		static const size_t DefaultWriteBufferSize = 1024 * 1024;
 
 	protected:
 		void CreationThread ();
+		void WriteRandomData (uint64 endOffset, const RandomKeystream &keystream);
 
 		volatile bool AbortRequested;
 		volatile bool CreationInProgress;
@@ -102,7 +124,12 @@ namespace CipherShed
 
 		shared_ptr <VolumeLayout> Layout;
 		shared_ptr <File> VolumeFile;
+		uint64 CreationEndTime;
+		uint64 CreationStartTime;
 		SharedVal <uint64> SizeDone;
+		uint64 StartTime;
+		size_t WriteBufferCount;
+		size_t WriteBufferSize;
 		uint64 WriteOffset;
 		ProgressInfo mProgressInfo;
 
@@ -19,6 +19,7 @@
 #include <unistd.h>
 #include <time.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/wait.h>
 
@@ -27,8 +28,10 @@
 #include "../../Platform/MemoryStream.h"
 #include "../../Platform/Serializable.h"
 #include "../../Platform/SystemLog.h"
+#include "../../Platform/Thread.h"
 #include "../../Platform/Unix/Pipe.h"
 #include "../../Platform/Unix/Poller.h"
+#include "FuseServiceDaemon.h"
 #include "../../Volume/EncryptionThreadPool.h"
 #include "../../Core/Core.h"
 
@@ -53,17 +56,23 @@ namespace CipherShed
 	{
 		try
 		{
-			// Termination signals are handled by a separate process to allow clean dismount on shutdown
-			struct sigaction action;
-			Memory::Zero (&action, sizeof (action));
-			action.sa_handler = SIG_IGN;
+			// Termination signals are handled by a separate process to allow clean dismount on shutdown.
+			// The shared service blocks them and waits for them in a dedicated thread instead.
+			if (!FuseService::IsDaemon())
+			{
+				struct sigaction action;
+				Memory::Zero (&action, sizeof (action));
+				action.sa_handler = SIG_IGN;
 
-			sigaction (SIGINT, &action, nullptr);
-			sigaction (SIGQUIT, &action, nullptr);
-			sigaction (SIGTERM, &action, nullptr);
+				sigaction (SIGINT, &action, nullptr);
+				sigaction (SIGQUIT, &action, nullptr);
+				sigaction (SIGTERM, &action, nullptr);
+			}
 
 			if (!EncryptionThreadPool::IsRunning())
 				EncryptionThreadPool::Start();
+
+			FuseService::NotifyServiceReady();
 		}
 		catch (exception &e)
 		{
@@ -314,6 +323,67 @@ namespace CipherShed
 		return -ENOENT;
 	}
 
+	static fuse_operations *fuse_service_get_operations ()
+	{
+		static fuse_operations fuse_service_oper;
+
+		fuse_service_oper.access = fuse_service_access;
+		fuse_service_oper.destroy = fuse_service_destroy;
+		fuse_service_oper.getattr = fuse_service_getattr;
+		fuse_service_oper.init = fuse_service_init;
+		fuse_service_oper.open = fuse_service_open;
+		fuse_service_oper.opendir = fuse_service_opendir;
+		fuse_service_oper.read = fuse_service_read;
+		fuse_service_oper.readdir = fuse_service_readdir;
+		fuse_service_oper.write = fuse_service_write;
+
+		return &fuse_service_oper;
+	}
+
+	Functor *FuseService::AddSharedMount (shared_ptr <Volume> volume, VolumeSlotNumber slotNumber, const string &fuseMountPoint)
+	{
+		make_shared_auto (MountContext, context);
+		context->MountedVolume = volume;
+		context->SlotNumber = slotNumber;
+		SetSerialInstanceNumber (context->OpenVolumeInfo);
+
+		struct fuse_args args = FUSE_ARGS_INIT (0, nullptr);
+		finally_do_arg (struct fuse_args *, &args, { fuse_opt_free_args (finally_arg); });
+
+		foreach (const string &arg, GetFuseArguments())
+			throw_sys_if (fuse_opt_add_arg (&args, arg.c_str()) == -1);
+
+		int fuseFd = fuse_mount (fuseMountPoint.c_str(), &args);
+		throw_sys_sub_if (fuseFd == -1, fuseMountPoint);
+
+		struct fuse *fuse = fuse_new (fuseFd, &args, fuse_service_get_operations(), sizeof (fuse_operations));
+		if (!fuse)
+		{
+			close (fuseFd);
+			fuse_unmount (fuseMountPoint.c_str());
+			throw ParameterIncorrect (SRC_POS);
+		}
+
+		{
+			ScopeLock lock (MountContextsMutex);
+			MountContexts[fuse] = context;
+		}
+
+		struct MountLoopFunctor : public Functor
+		{
+			MountLoopFunctor (struct fuse *fuse) : Fuse (fuse) { }
+			virtual void operator() ()
+			{
+				fuse_loop_mt (Fuse);
+				FuseService::RemoveSharedMount (Fuse);
+				fuse_destroy (Fuse);
+			}
+			struct fuse *Fuse;
+		};
+
+		return new MountLoopFunctor (fuse);
+	}
+
 	bool FuseService::CheckAccessRights ()
 	{
 		return fuse_get_context()->uid == 0 || fuse_get_context()->uid == UserId;
@@ -321,21 +391,45 @@ namespace CipherShed
 	
 	void FuseService::CloseMountedVolume ()
 	{
-		if (MountedVolume)
+		if (ProcessMountContext && ProcessMountContext->MountedVolume)
 		{
+			shared_ptr <Volume> &mountedVolume = ProcessMountContext->MountedVolume;
+
 			// This process will exit before the use count of MountedVolume reaches zero
-			if (MountedVolume->GetFile().use_count() > 1)
-				MountedVolume->GetFile()->Close();
+			if (mountedVolume->GetFile().use_count() > 1)
+				mountedVolume->GetFile()->Close();
+
+			if (mountedVolume.use_count() > 1)
+				delete mountedVolume.get();
+
+			mountedVolume.reset();
+		}
+	}
 
-			if (MountedVolume.use_count() > 1)
-				delete MountedVolume.get();
+	shared_ptr <LocalSocket> FuseService::ConnectDaemon ()
+	{
+		string socketName = GetDaemonSocketName();
+
+		shared_ptr <LocalSocket> daemonSocket = LocalSocket::Connect (socketName, geteuid());
+		if (!daemonSocket)
+		{
+			// Another instance may be started concurrently, in which case the socket is not created here
+			shared_ptr <LocalSocket> listenSocket = LocalSocket::Listen (socketName, geteuid());
+			if (listenSocket)
+				StartDaemon (listenSocket, socketName);
 
-			MountedVolume.reset();
+			daemonSocket = LocalSocket::Connect (socketName, geteuid());
 		}
+
+		return daemonSocket;
 	}
 
 	void FuseService::Dismount ()
 	{
+		// Volumes served by the shared service are closed when their mount loops end
+		if (DaemonMode)
+			return;
+
 		CloseMountedVolume();
 
 		if (EncryptionThreadPool::IsRunning())
@@ -382,17 +476,98 @@ namespace CipherShed
 		}
 	}
 
+	string FuseService::GetDaemonSocketName ()
+	{
+		uid_t userId;
+		gid_t groupId;
+		GetRealUserIds (userId, groupId);
+
+		// Volumes of different users are served by separate instances as access rights are checked per instance
+		stringstream name;
+		name << "fuse-service-" << userId;
+		return name.str();
+	}
+
+	list <string> FuseService::GetFuseArguments ()
+	{
+		list <string> args;
+
+#ifdef TC_MACOSX
+		args.push_back ("-o");
+		args.push_back ("noping_diskarb");
+		args.push_back ("-o");
+		args.push_back ("nobrowse");
+
+		if (getuid() == 0 || geteuid() == 0)
+#endif
+		{
+			args.push_back ("-o");
+			args.push_back ("allow_other");
+		}
+
+		return args;
+	}
+
+	shared_ptr <FuseService::MountContext> FuseService::GetMountContext ()
+	{
+		if (ProcessMountContext)
+			return ProcessMountContext;
+
+		ScopeLock lock (MountContextsMutex);
+
+		MountContextMap::const_iterator context = MountContexts.find (fuse_get_context()->fuse);
+		if (context == MountContexts.end())
+			throw NotInitialized (SRC_POS);
+
+		return context->second;
+	}
+
+	shared_ptr <Volume> FuseService::GetMountedVolume ()
+	{
+		shared_ptr <Volume> volume = GetMountContext()->MountedVolume;
+		if (!volume)
+			throw NotInitialized (SRC_POS);
+
+		return volume;
+	}
+
+	void FuseService::GetRealUserIds (uid_t &userId, gid_t &groupId)
+	{
+		userId = getuid();
+		groupId = getgid();
+
+		if (getenv ("SUDO_UID"))
+		{
+			try
+			{
+				string s (getenv ("SUDO_UID"));
+				userId = static_cast <uid_t> (StringConverter::ToUInt64 (s));
+
+				if (getenv ("SUDO_GID"))
+				{
+					s = getenv ("SUDO_GID");
+					groupId = static_cast <gid_t> (StringConverter::ToUInt64 (s));
+				}
+			}
+			catch (...) { }
+		}
+	}
+
 	shared_ptr <Buffer> FuseService::GetVolumeInfo ()
 	{
+		shared_ptr <MountContext> context = GetMountContext();
 		shared_ptr <Stream> stream (new MemoryStream);
 
+		// Readers detect the format from the object header
+		stream->SetSerializationFormat (SerializationFormat::Compact);
+
 		{
-			ScopeLock lock (OpenVolumeInfoMutex);
+			ScopeLock lock (context->OpenVolumeInfoMutex);
 
-			OpenVolumeInfo.Set (*MountedVolume);
-			OpenVolumeInfo.SlotNumber = SlotNumber;
+			context->OpenVolumeInfo.Set (*context->MountedVolume);
+			context->OpenVolumeInfo.SlotNumber = context->SlotNumber;
 
-			OpenVolumeInfo.Serialize (stream);
+			context->OpenVolumeInfo.Serialize (stream);
 		}
 
 		ConstBufferPtr infoBuf = dynamic_cast <MemoryStream&> (*stream);
@@ -413,10 +588,7 @@ namespace CipherShed
 
 	uint64 FuseService::GetVolumeSize ()
 	{
-		if (!MountedVolume)
-			throw NotInitialized (SRC_POS);
-
-		return MountedVolume->GetSize();
+		return GetMountedVolume()->GetSize();
 	}
 
 	void FuseService::Mount (shared_ptr <Volume> openVolume, VolumeSlotNumber slotNumber, const string &fuseMountPoint)
@@ -425,55 +597,80 @@ namespace CipherShed
 		args.push_back (FuseService::GetDeviceType());
 		args.push_back (fuseMountPoint);
 
-#ifdef TC_MACOSX
-		args.push_back ("-o");
-		args.push_back ("noping_diskarb");
-		args.push_back ("-o");
-		args.push_back ("nobrowse");
-
-		if (getuid() == 0 || geteuid() == 0)
-#endif
-		{
-			args.push_back ("-o");
-			args.push_back ("allow_other");
-		}
+		foreach (const string &arg, GetFuseArguments())
+			args.push_back (arg);
 		
-		ExecFunctor execFunctor (openVolume, slotNumber);
+		// The service reports its readiness through a pipe once the kernel has initialized the filesystem
+		Pipe readyPipe;
+
+		ExecFunctor execFunctor (openVolume, slotNumber, readyPipe.PeekWriteFD());
 		Process::Execute ("fuse", args, -1, &execFunctor);
 
-		for (int t = 0; true; t++)
+		bool serviceReady = false;
+		try
 		{
-			try
-			{
-				if (FilesystemPath (fuseMountPoint + FuseService::GetControlPath()).GetType() == FilesystemPathType::File)
-					break;
-			}
-			catch (...)
-			{
-				if (t > 50)
-					throw;
+			int readyFD = readyPipe.GetReadFD();
+			Poller poller (readyFD);
+			poller.WaitForData (ServiceReadyTimeOut);
 
-				Thread::Sleep (100);
-			}
+			// End of file indicates that the service exited before it became ready
+			byte b;
+			serviceReady = (read (readyFD, &b, sizeof (b)) == sizeof (b));
 		}
+		catch (TimeOut&) { }
+
+		if (!serviceReady && FilesystemPath (fuseMountPoint + FuseService::GetControlPath()).GetType() != FilesystemPathType::File)
+			throw ParameterIncorrect (SRC_POS);
 	}
 
-	void FuseService::ReadVolumeSectors (const BufferPtr &buffer, uint64 byteOffset)
+	void FuseService::NotifyServiceReady ()
 	{
-		if (!MountedVolume)
-			throw NotInitialized (SRC_POS);
+		if (ServiceReadyFD == -1)
+			return;
 
-		MountedVolume->ReadSectors (buffer, byteOffset);
+		byte b = 1;
+		if (write (ServiceReadyFD, &b, sizeof (b))) { } // Errors ignored
+
+		close (ServiceReadyFD);
+		ServiceReadyFD = -1;
+	}
+
+	bool FuseService::MountShared (shared_ptr <Volume> openVolume, const MountOptions &options, const string &fuseMountPoint)
+	{
+		shared_ptr <LocalSocket> daemonSocket = ConnectDaemon();
+		if (!daemonSocket)
+			return false;
+
+		// The shared service receives the open volume file and the decrypted header. Passwords and keyfiles are never sent.
+		return FuseServiceDaemon::MountVolume (*daemonSocket, openVolume, options.SlotNumber, fuseMountPoint);
+	}
+
+	void FuseService::ReadVolumeSectors (const BufferPtr &buffer, uint64 byteOffset)
+	{
+		GetMountedVolume()->ReadSectors (buffer, byteOffset);
 	}
 
 	void FuseService::ReceiveAuxDeviceInfo (const ConstBufferPtr &buffer)
 	{
+		shared_ptr <MountContext> context = GetMountContext();
 		shared_ptr <Stream> stream (new MemoryStream (buffer));
 		Serializer sr (stream);
 
-		ScopeLock lock (OpenVolumeInfoMutex);
-		OpenVolumeInfo.VirtualDevice = sr.DeserializeString ("VirtualDevice");
-		OpenVolumeInfo.LoopDevice = sr.DeserializeString ("LoopDevice");
+		ScopeLock lock (context->OpenVolumeInfoMutex);
+		context->OpenVolumeInfo.VirtualDevice = sr.DeserializeString ("VirtualDevice");
+		context->OpenVolumeInfo.LoopDevice = sr.DeserializeString ("LoopDevice");
+	}
+
+	void FuseService::RemoveSharedMount (struct fuse *fuse)
+	{
+		ScopeLock lock (MountContextsMutex);
+
+		MountContextMap::iterator context = MountContexts.find (fuse);
+		if (context == MountContexts.end())
+			return;
+
+		context->second->MountedVolume.reset();
+		MountContexts.erase (context);
 	}
 
 	void FuseService::SendAuxDeviceInfo (const DirectoryPath &fuseMountPoint, const DevicePath &virtualDevice, const DevicePath &loopDevice)
@@ -489,19 +686,29 @@ namespace CipherShed
 		fuseServiceControl.Write (dynamic_cast <MemoryStream&> (*stream));
 	}
 
-	void FuseService::WriteVolumeSectors (const ConstBufferPtr &buffer, uint64 byteOffset)
+	void FuseService::SetSerialInstanceNumber (VolumeInfo &volumeInfo)
 	{
-		if (!MountedVolume)
-			throw NotInitialized (SRC_POS);
+		struct timeval tv;
+		gettimeofday (&tv, NULL);
+		volumeInfo.SerialInstanceNumber = (uint64)tv.tv_sec * 1000000ULL + tv.tv_usec;
+	}
+
+	void FuseService::StartDaemon (shared_ptr <LocalSocket> listenSocket, const string &socketName)
+	{
+		DaemonExecFunctor daemonFunctor (listenSocket, socketName);
+		Process::Execute ("fuse-service", list <string> (), -1, &daemonFunctor);
+	}
 
-		MountedVolume->WriteSectors (buffer, byteOffset);
+	void FuseService::WriteVolumeSectors (const ConstBufferPtr &buffer, uint64 byteOffset)
+	{
+		GetMountedVolume()->WriteSectors (buffer, byteOffset);
 	}
 	
 	void FuseService::OnSignal (int signal)
 	{
 		try
 		{
-			shared_ptr <VolumeInfo> volume = Core->GetMountedVolume (SlotNumber);
+			shared_ptr <VolumeInfo> volume = Core->GetMountedVolume (ProcessMountContext->SlotNumber);
 			
 			if (volume)
 				Core->DismountVolume (volume, true);
@@ -511,45 +718,121 @@ namespace CipherShed
 		_exit (0);
 	}
 
-	void FuseService::ExecFunctor::operator() (int argc, char *argv[])
+	void FuseService::DaemonExecFunctor::operator() (int argc, char *argv[])
 	{
-		struct timeval tv;
-		gettimeofday (&tv, NULL);
-		FuseService::OpenVolumeInfo.SerialInstanceNumber = (uint64)tv.tv_sec * 1000000ULL + tv.tv_usec;
+		// The caller continues once the service has been detached
+		int forkedPid = fork();
+		throw_sys_if (forkedPid == -1);
 
-		FuseService::MountedVolume = MountedVolume;
-		FuseService::SlotNumber = SlotNumber;
+		if (forkedPid != 0)
+			_exit (0);
 
-		FuseService::UserId = getuid();
-		FuseService::GroupId = getgid();
+		setsid ();
 
-		if (getenv ("SUDO_UID"))
+		int nullDev = open ("/dev/null", O_RDWR);
+		throw_sys_sub_if (nullDev == -1, "/dev/null");
+		dup2 (nullDev, STDIN_FILENO);
+		dup2 (nullDev, STDOUT_FILENO);
+		dup2 (nullDev, STDERR_FILENO);
+		close (nullDev);
+
+		// Descriptors of volumes and clients of the process which has started the service are not inherited
+		list <int> keptFileDescriptors;
+		keptFileDescriptors.push_back (ListenSocket->GetFD());
+		Process::CloseFileDescriptors (keptFileDescriptors);
+
+		// Clients which exit before reading their response must not terminate the service
+		signal (SIGPIPE, SIG_IGN);
+
+		FuseService::DaemonMode = true;
+		FuseService::GetRealUserIds (FuseService::UserId, FuseService::GroupId);
+
+		// Termination signals are received by a dedicated thread which dismounts all served volumes
+		sigset_t terminationSignals;
+		sigemptyset (&terminationSignals);
+		sigaddset (&terminationSignals, SIGINT);
+		sigaddset (&terminationSignals, SIGQUIT);
+		sigaddset (&terminationSignals, SIGTERM);
+		pthread_sigmask (SIG_BLOCK, &terminationSignals, nullptr);
+
+		struct SignalFunctor : public Functor
 		{
-			try
+			SignalFunctor (const sigset_t &signals) : Signals (signals) { }
+			virtual void operator() ()
 			{
-				string s (getenv ("SUDO_UID"));
-				FuseService::UserId = static_cast <uid_t> (StringConverter::ToUInt64 (s));
+				int signal;
+				if (sigwait (&Signals, &signal) != 0)
+					return;
 
-				if (getenv ("SUDO_GID"))
+				list <VolumeSlotNumber> slotNumbers;
 				{
-					s = getenv ("SUDO_GID");
-					FuseService::GroupId = static_cast <gid_t> (StringConverter::ToUInt64 (s));
+					ScopeLock lock (FuseService::MountContextsMutex);
+					foreach (const MountContextMap::value_type &context, FuseService::MountContexts)
+						slotNumbers.push_back (context.second->SlotNumber);
 				}
+
+				foreach (VolumeSlotNumber slotNumber, slotNumbers)
+				{
+					try
+					{
+						shared_ptr <VolumeInfo> volume = Core->GetMountedVolume (slotNumber);
+						if (volume)
+							Core->DismountVolume (volume, true);
+					}
+					catch (...) { }
+				}
+
+				_exit (0);
 			}
-			catch (...) { }
+			sigset_t Signals;
+		};
+
+		Thread signalThread;
+		signalThread.Start (new SignalFunctor (terminationSignals));
+
+		// All volumes share one pool of encryption threads
+		EncryptionThreadPool::Start();
+
+		struct SharedMountHandler : public FuseServiceDaemon::MountHandler
+		{
+			virtual Functor *Mount (shared_ptr <Volume> volume, VolumeSlotNumber slotNumber, const string &mountPoint)
+			{
+				return FuseService::AddSharedMount (volume, slotNumber, mountPoint);
+			}
+		};
+
+		SharedMountHandler mountHandler;
+		FuseServiceDaemon daemon (ListenSocket, mountHandler);
+
+		try
+		{
+			daemon.Run();
+		}
+		catch (exception &e)
+		{
+			SystemLog::WriteException (e);
 		}
 
-		static fuse_operations fuse_service_oper;
+		// The service exits when the last of its volumes has been dismounted
+		LocalSocket::Unlink (SocketName);
+		_exit (0);
+	}
 
-		fuse_service_oper.access = fuse_service_access;
-		fuse_service_oper.destroy = fuse_service_destroy;
-		fuse_service_oper.getattr = fuse_service_getattr;
-		fuse_service_oper.init = fuse_service_init;
-		fuse_service_oper.open = fuse_service_open;
-		fuse_service_oper.opendir = fuse_service_opendir;
-		fuse_service_oper.read = fuse_service_read;
-		fuse_service_oper.readdir = fuse_service_readdir;
-		fuse_service_oper.write = fuse_service_write;
+	void FuseService::ExecFunctor::operator() (int argc, char *argv[])
+	{
+		FuseService::ProcessMountContext.reset (new MountContext);
+		FuseService::ProcessMountContext->MountedVolume = MountedVolume;
+		FuseService::ProcessMountContext->SlotNumber = SlotNumber;
+		FuseService::SetSerialInstanceNumber (FuseService::ProcessMountContext->OpenVolumeInfo);
+
+		FuseService::GetRealUserIds (FuseService::UserId, FuseService::GroupId);
+		FuseService::ServiceReadyFD = ServiceReadyFD;
+
+		// Pipes of the core service and volumes of other mounts are not inherited
+		list <int> keptFileDescriptors;
+		keptFileDescriptors.push_back (MountedVolume->GetFile()->GetSystemHandle());
+		keptFileDescriptors.push_back (ServiceReadyFD);
+		Process::CloseFileDescriptors (keptFileDescriptors);
 
 		// Create a new session
 		setsid ();
@@ -563,6 +846,7 @@ namespace CipherShed
 		if (forkedPid == 0)
 		{
 			CloseMountedVolume();
+			close (FuseService::ServiceReadyFD);
 
 			struct sigaction action;
 			Memory::Zero (&action, sizeof (action));
@@ -581,13 +865,14 @@ namespace CipherShed
 
 		SignalHandlerPipe->GetWriteFD();
 
-		_exit (fuse_main (argc, argv, &fuse_service_oper));
+		_exit (fuse_main (argc, argv, fuse_service_get_operations()));
 	}
 
-	VolumeInfo FuseService::OpenVolumeInfo;
-	Mutex FuseService::OpenVolumeInfoMutex;
-	shared_ptr <Volume> FuseService::MountedVolume;
-	VolumeSlotNumber FuseService::SlotNumber;
+	bool FuseService::DaemonMode = false;
+	FuseService::MountContextMap FuseService::MountContexts;
+	Mutex FuseService::MountContextsMutex;
+	shared_ptr <FuseService::MountContext> FuseService::ProcessMountContext;
+	int FuseService::ServiceReadyFD = -1;
 	uid_t FuseService::UserId;
 	gid_t FuseService::GroupId;
 	std::auto_ptr <Pipe> FuseService::SignalHandlerPipe;
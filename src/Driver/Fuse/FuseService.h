@@ -10,6 +10,7 @@
 #define TC_HEADER_Driver_Fuse_FuseService
 
 #include "../../Platform/Platform.h"
+#include "../../Platform/Unix/LocalSocket.h"
 #include "../../Platform/Unix/Pipe.h"
 #include "../../Platform/Unix/Process.h"
 #include "../../Volume/VolumeInfo.h"
@@ -17,29 +18,61 @@
 
 #include <memory>
 
+struct fuse;
+
 namespace CipherShed
 {
+	struct MountOptions;
 
 	class FuseService
 	{
 	protected:
 		struct ExecFunctor : public ProcessExecFunctor
 		{
-			ExecFunctor (shared_ptr <Volume> openVolume, VolumeSlotNumber slotNumber)
-				: MountedVolume (openVolume), SlotNumber (slotNumber)
+			ExecFunctor (shared_ptr <Volume> openVolume, VolumeSlotNumber slotNumber, int serviceReadyFD)
+				: MountedVolume (openVolume), ServiceReadyFD (serviceReadyFD), SlotNumber (slotNumber)
 			{
 			}
 			virtual void operator() (int argc, char *argv[]);
 
 		protected:
 			shared_ptr <Volume> MountedVolume;
+			int ServiceReadyFD;
 			VolumeSlotNumber SlotNumber;
 		};
 
 		friend class ExecFunctor;
 
+		struct DaemonExecFunctor : public ProcessExecFunctor
+		{
+			DaemonExecFunctor (shared_ptr <LocalSocket> listenSocket, const string &socketName)
+				: ListenSocket (listenSocket), SocketName (socketName)
+			{
+			}
+			virtual void operator() (int argc, char *argv[]);
+
+		protected:
+			shared_ptr <LocalSocket> ListenSocket;
+			string SocketName;
+		};
+
+		friend class DaemonExecFunctor;
+
+		// State of a volume served by a FUSE mount
+		struct MountContext
+		{
+			MountContext () : SlotNumber (0) { }
+
+			shared_ptr <Volume> MountedVolume;
+			VolumeInfo OpenVolumeInfo;
+			Mutex OpenVolumeInfoMutex;
+			VolumeSlotNumber SlotNumber;
+		};
+
+		typedef map <struct fuse *, shared_ptr <MountContext> > MountContextMap;
+
 	public:
-		static bool AuxDeviceInfoReceived () { return !OpenVolumeInfo.VirtualDevice.IsEmpty(); }
+		static bool AuxDeviceInfoReceived () { return !GetMountContext()->OpenVolumeInfo.VirtualDevice.IsEmpty(); }
 		static bool CheckAccessRights ();
 		static void Dismount ();
 		static int ExceptionToErrorCode ();
@@ -50,8 +83,11 @@ namespace CipherShed
 		static uid_t GetUserId () { return UserId; }
 		static shared_ptr <Buffer> GetVolumeInfo ();
 		static uint64 GetVolumeSize ();
-		static uint64 GetVolumeSectorSize () { return MountedVolume->GetSectorSize(); }
+		static uint64 GetVolumeSectorSize () { return GetMountedVolume()->GetSectorSize(); }
+		static bool IsDaemon () { return DaemonMode; }
 		static void Mount (shared_ptr <Volume> openVolume, VolumeSlotNumber slotNumber, const string &fuseMountPoint);
+		static bool MountShared (shared_ptr <Volume> openVolume, const MountOptions &options, const string &fuseMountPoint);
+		static void NotifyServiceReady ();
 		static void ReadVolumeSectors (const BufferPtr &buffer, uint64 byteOffset);
 		static void ReceiveAuxDeviceInfo (const ConstBufferPtr &buffer);
 		static void SendAuxDeviceInfo (const DirectoryPath &fuseMountPoint, const DevicePath &virtualDevice, const DevicePath &loopDevice = DevicePath());
@@ -59,13 +95,25 @@ namespace CipherShed
 
 	protected:
 		FuseService ();
+		static Functor *AddSharedMount (shared_ptr <Volume> volume, VolumeSlotNumber slotNumber, const string &fuseMountPoint);
 		static void CloseMountedVolume ();
+		static shared_ptr <LocalSocket> ConnectDaemon ();
+		static list <string> GetFuseArguments ();
+		static string GetDaemonSocketName ();
+		static shared_ptr <MountContext> GetMountContext ();
+		static shared_ptr <Volume> GetMountedVolume ();
+		static void GetRealUserIds (uid_t &userId, gid_t &groupId);
 		static void OnSignal (int signal);
+		static void RemoveSharedMount (struct fuse *fuse);
+		static void SetSerialInstanceNumber (VolumeInfo &volumeInfo);
+		static void StartDaemon (shared_ptr <LocalSocket> listenSocket, const string &socketName);
 
-		static VolumeInfo OpenVolumeInfo;
-		static Mutex OpenVolumeInfoMutex;
-		static shared_ptr <Volume> MountedVolume;
-		static VolumeSlotNumber SlotNumber;
+		static bool DaemonMode;
+		static MountContextMap MountContexts;
+		static Mutex MountContextsMutex;
+		static shared_ptr <MountContext> ProcessMountContext;
+		static int ServiceReadyFD;
+		static const int ServiceReadyTimeOut = 30000;
 		static uid_t UserId;
 		static gid_t GroupId;
 		static std::auto_ptr <Pipe> SignalHandlerPipe;
@@ -0,0 +1,255 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#include <memory>
+#include <unistd.h>
+#include "FuseServiceDaemon.h"
+#include "../../Platform/FileStream.h"
+#include "../../Platform/Serializable.h"
+#include "../../Platform/SystemLog.h"
+#include "../../Platform/Unix/Poller.h"
+
+namespace CipherShed
+{
+	FuseServiceDaemon::FuseServiceDaemon (shared_ptr <LocalSocket> listenSocket, MountHandler &mountHandler)
+		: LastThreadId (0), ListenSocket (listenSocket), Handler (mountHandler)
+	{
+	}
+
+	FuseServiceDaemon::~FuseServiceDaemon ()
+	{
+	}
+
+	bool FuseServiceDaemon::MountVolume (const LocalSocket &service, shared_ptr <Volume> volume, VolumeSlotNumber slotNumber, const string &mountPoint)
+	{
+		shared_ptr <Stream> stream (new FileStream (service.GetFD()));
+		Serializer sr (stream);
+
+		bool mounted;
+		try
+		{
+			service.SendFileDescriptor (volume->GetFile()->GetSystemHandle());
+			volume->GetFile()->SerializeOpenState (stream);
+
+			sr.Serialize ("MountPoint", mountPoint);
+			sr.Serialize ("SlotNumber", slotNumber);
+			volume->SerializeOpenState (stream);
+
+			mounted = sr.DeserializeBool ("Mounted");
+		}
+		catch (...)
+		{
+			// The service has exited while the request was being sent
+			return false;
+		}
+
+		if (!mounted)
+			Serializable::DeserializeNew <Exception> (stream)->Throw();
+
+		return true;
+	}
+
+	void FuseServiceDaemon::OnThreadFinished (uint64 threadId)
+	{
+		ScopeLock lock (ThreadsMutex);
+		FinishedThreads.push_back (threadId);
+
+		byte b = 0;
+		if (write (EventPipe.PeekWriteFD(), &b, sizeof (b))) { } // Errors ignored
+	}
+
+	void FuseServiceDaemon::Run ()
+	{
+		struct ClientFunctor : public Functor
+		{
+			ClientFunctor (FuseServiceDaemon &daemon, uint64 threadId, shared_ptr <LocalSocket> client)
+				: Client (client), Daemon (daemon), ThreadId (threadId) { }
+
+			virtual void operator() ()
+			{
+				try
+				{
+					Daemon.ServeClient (Client);
+				}
+				catch (exception &e)
+				{
+					SystemLog::WriteException (e);
+				}
+				catch (...) { }
+
+				Client->Close();
+				Daemon.OnThreadFinished (ThreadId);
+			}
+
+			shared_ptr <LocalSocket> Client;
+			FuseServiceDaemon &Daemon;
+			uint64 ThreadId;
+		};
+
+		Poller poller (ListenSocket->GetFD(), EventPipe.PeekReadFD());
+
+		while (true)
+		{
+			list <int> readyFDs;
+			try
+			{
+				// The process which has started the service may have exited before connecting to it
+				bool idle;
+				{
+					ScopeLock lock (ThreadsMutex);
+					idle = ClientThreads.empty() && MountThreads.empty();
+				}
+
+				readyFDs = poller.WaitForData (idle ? ClientTimeOut : -1);
+			}
+			catch (TimeOut&)
+			{
+				return;
+			}
+
+			foreach (int fd, readyFDs)
+			{
+				if (fd == ListenSocket->GetFD())
+				{
+					try
+					{
+						shared_ptr <LocalSocket> client = ListenSocket->Accept();
+
+						// Volumes are accepted only from processes of the user running the service
+						if (client->GetPeerUserId() != geteuid())
+							continue;
+
+						ScopeLock lock (ThreadsMutex);
+						uint64 threadId = ++LastThreadId;
+						StartThread (threadId, new ClientFunctor (*this, threadId, client), ClientThreads);
+					}
+					catch (exception &e)
+					{
+						SystemLog::WriteException (e);
+					}
+				}
+				else
+				{
+					byte buf[64];
+					if (read (fd, buf, sizeof (buf))) { } // Errors ignored
+				}
+			}
+
+			list <shared_ptr <Thread> > finishedThreads;
+			{
+				ScopeLock lock (ThreadsMutex);
+
+				foreach (uint64 threadId, FinishedThreads)
+				{
+					ThreadMap *threads = ClientThreads.find (threadId) != ClientThreads.end() ? &ClientThreads : &MountThreads;
+
+					ThreadMap::iterator thread = threads->find (threadId);
+					if (thread != threads->end())
+					{
+						finishedThreads.push_back (thread->second);
+						threads->erase (thread);
+					}
+				}
+
+				FinishedThreads.clear();
+			}
+
+			foreach (shared_ptr <Thread> thread, finishedThreads)
+				thread->Join();
+
+			// The service exits when the last of its volumes has been dismounted
+			ScopeLock lock (ThreadsMutex);
+			if (ClientThreads.empty() && MountThreads.empty())
+				return;
+		}
+	}
+
+	void FuseServiceDaemon::ServeClient (shared_ptr <LocalSocket> client)
+	{
+		struct MountFunctor : public Functor
+		{
+			MountFunctor (FuseServiceDaemon &daemon, uint64 threadId, Functor *mountLoop)
+				: Daemon (daemon), MountLoop (mountLoop), ThreadId (threadId) { }
+
+			virtual void operator() ()
+			{
+				try
+				{
+					// The loop ends when the filesystem is unmounted
+					(*MountLoop) ();
+				}
+				catch (exception &e)
+				{
+					SystemLog::WriteException (e);
+				}
+				catch (...) { }
+
+				MountLoop.reset();
+				Daemon.OnThreadFinished (ThreadId);
+			}
+
+			FuseServiceDaemon &Daemon;
+			std::auto_ptr <Functor> MountLoop;
+			uint64 ThreadId;
+		};
+
+		shared_ptr <Stream> stream (new FileStream (client->GetFD()));
+		Serializer sr (stream);
+
+		// The volume file is passed already open as the service may not have access to its path
+		make_shared_auto (File, volumeFile);
+		volumeFile->AssignSystemHandle (client->ReceiveFileDescriptor(), stream);
+
+		string mountPoint = sr.DeserializeString ("MountPoint");
+		VolumeSlotNumber slotNumber;
+		sr.Deserialize ("SlotNumber", slotNumber);
+
+		try
+		{
+			make_shared_auto (Volume, volume);
+			volume->Open (volumeFile, stream);
+
+			std::auto_ptr <Functor> mountLoop (Handler.Mount (volume, slotNumber, mountPoint));
+			volume.reset();
+
+			{
+				ScopeLock lock (ThreadsMutex);
+				uint64 mountThreadId = ++LastThreadId;
+				StartThread (mountThreadId, new MountFunctor (*this, mountThreadId, mountLoop.release()), MountThreads);
+			}
+
+			sr.Serialize ("Mounted", true);
+		}
+		catch (Exception &e)
+		{
+			sr.Serialize ("Mounted", false);
+			e.Serialize (stream);
+		}
+		catch (exception &e)
+		{
+			sr.Serialize ("Mounted", false);
+			ExternalException (SRC_POS, StringConverter::ToExceptionString (e)).Serialize (stream);
+		}
+	}
+
+	void FuseServiceDaemon::StartThread (uint64 threadId, Functor *functor, ThreadMap &threads)
+	{
+		shared_ptr <Thread> thread (new Thread);
+		try
+		{
+			thread->Start (functor);
+		}
+		catch (...)
+		{
+			delete functor;
+			throw;
+		}
+
+		threads[threadId] = thread;
+	}
+}
@@ -0,0 +1,63 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#ifndef TC_HEADER_Driver_Fuse_FuseServiceDaemon
+#define TC_HEADER_Driver_Fuse_FuseServiceDaemon
+
+#include "../../Platform/Platform.h"
+#include "../../Platform/Unix/LocalSocket.h"
+#include "../../Platform/Unix/Pipe.h"
+#include "../../Volume/Volume.h"
+#include "../../Volume/VolumeSlot.h"
+
+namespace CipherShed
+{
+	// Serves the volumes of many FUSE mounts in one process. Processes mounting a volume pass it to the
+	// service already open: the service receives the volume file and the decrypted volume header, which
+	// contains the master keys, but never the password. Clients are served concurrently.
+	class FuseServiceDaemon
+	{
+	public:
+		// Mounts the filesystem of a received volume. The returned functor serves the filesystem until it is unmounted.
+		struct MountHandler
+		{
+			virtual ~MountHandler () { }
+			virtual Functor *Mount (shared_ptr <Volume> volume, VolumeSlotNumber slotNumber, const string &mountPoint) = 0;
+		};
+
+		FuseServiceDaemon (shared_ptr <LocalSocket> listenSocket, MountHandler &mountHandler);
+		virtual ~FuseServiceDaemon ();
+
+		static bool MountVolume (const LocalSocket &service, shared_ptr <Volume> volume, VolumeSlotNumber slotNumber, const string &mountPoint);
+		void Run ();
+
+	protected:
+		typedef map <uint64, shared_ptr <Thread> > ThreadMap;
+
+		void OnThreadFinished (uint64 threadId);
+		void ServeClient (shared_ptr <LocalSocket> client);
+		void StartThread (uint64 threadId, Functor *functor, ThreadMap &threads);
+
+		static const int ClientTimeOut = 30000;
+
+		ThreadMap ClientThreads;
+		Pipe EventPipe;
+		list <uint64> FinishedThreads;
+		uint64 LastThreadId;
+		shared_ptr <LocalSocket> ListenSocket;
+		MountHandler &Handler;
+		ThreadMap MountThreads;
+		Mutex ThreadsMutex;
+
+	private:
+		FuseServiceDaemon (const FuseServiceDaemon &);
+		FuseServiceDaemon &operator= (const FuseServiceDaemon &);
+	};
+}
+
+#endif // TC_HEADER_Driver_Fuse_FuseServiceDaemon
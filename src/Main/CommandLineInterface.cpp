@@ -20,22 +20,31 @@
 namespace CipherShed
 {
 	CommandLineInterface::CommandLineInterface (wxCmdLineParser &parser, UserInterfaceType::Enum interfaceType) :
+		ArgAllocation (VolumeCreationOptions::ContainerAllocation::Default),
 		ArgCommand (CommandId::None),
 		ArgFilesystem (VolumeCreationOptions::FilesystemType::Unknown),
 		ArgNoHiddenVolumeProtection (false),
+		ArgOutputFormat (CommandOutputFormat::Text),
 		ArgSize (0),
 		ArgVolumeType (VolumeType::Unknown),
+		ArgWipeCache (false),
+		ArgWriteBufferCount (0),
+		ArgWriteBufferSize (0),
 		StartBackgroundTask (false)
 	{
 		parser.SetSwitchChars (L"-");
 
+		parser.AddOption (L"",  L"allocation",			_("Volume file allocation"));
 		parser.AddOption (L"",  L"auto-mount",			_("Auto mount device-hosted/favorite volumes"));
 		parser.AddSwitch (L"",  L"backup-headers",		_("Backup volume headers"));
 		parser.AddSwitch (L"",  L"background-task",		_("Start Background Task"));
+		parser.AddOption (L"",  L"batch",				_("Mount/dismount volumes listed in file"));
+		parser.AddSwitch (L"",  L"benchmark",			_("Benchmark encryption algorithms and key derivation"));
 #ifdef TC_WINDOWS
 		parser.AddSwitch (L"",  L"cache",				_("Cache passwords and keyfiles"));
 #endif
 		parser.AddSwitch (L"C", L"change",				_("Change password or keyfiles"));
+		parser.AddOption (L"",  L"clone",				_("Create new volume as a copy of volume"));
 		parser.AddSwitch (L"c", L"create",				_("Create new volume"));
 		parser.AddSwitch (L"",	L"create-keyfile",		_("Create new keyfile"));
 		parser.AddSwitch (L"",	L"delete-token-keyfiles", _("Delete security token keyfiles"));
@@ -61,6 +70,7 @@ namespace CipherShed
 		parser.AddOption (L"",	L"new-keyfiles",		_("New keyfiles"));
 		parser.AddOption (L"",	L"new-password",		_("New password"));
 		parser.AddSwitch (L"",	L"non-interactive",		_("Do not interact with user"));
+		parser.AddOption (L"",	L"output-format",		_("Output format"));
 		parser.AddOption (L"p", L"password",			_("Password"));
 		parser.AddOption (L"",	L"protect-hidden",		_("Protect hidden volume"));
 		parser.AddOption (L"",	L"protection-keyfiles",	_("Keyfiles for protected hidden volume"));
@@ -78,6 +88,9 @@ namespace CipherShed
 		parser.AddSwitch (L"",	L"version",				_("Display version information"));
 		parser.AddSwitch (L"",	L"volume-properties",	_("Display volume properties"));
 		parser.AddOption (L"",	L"volume-type",			_("Volume type"));
+		parser.AddSwitch (L"",	L"wipe-cache",			_("Wipe cached passwords and header keys"));
+		parser.AddOption (L"",	L"write-buffer-count",	_("Number of write buffers"));
+		parser.AddOption (L"",	L"write-buffer-size",	_("Write buffer size in bytes"));
 		parser.AddParam (								_("Volume path"), wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL);
 		parser.AddParam (								_("Mount point"), wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL);
 
@@ -157,6 +170,28 @@ namespace CipherShed
 			param1IsVolume = true;
 		}
 
+		if (parser.Found (L"batch", &str))
+		{
+			CheckCommandSingle();
+
+			// Results are written to standard output as a machine-readable stream
+			if (interfaceType != UserInterfaceType::Text)
+				throw_err (L"--batch is supported only in text mode");
+
+			ArgCommand = CommandId::Batch;
+			ArgFilePath.reset (new FilePath (wstring (str)));
+		}
+
+		if (parser.Found (L"benchmark"))
+		{
+			CheckCommandSingle();
+
+			if (interfaceType != UserInterfaceType::Text)
+				throw_err (L"--benchmark is supported only in text mode");
+
+			ArgCommand = CommandId::Benchmark;
+		}
+
 		if (parser.Found (L"change"))
 		{
 			CheckCommandSingle();
@@ -243,6 +278,16 @@ namespace CipherShed
 		}
 
 		// Options
+		if (parser.Found (L"allocation", &str))
+		{
+			if (str.IsSameAs (L"preallocate", false))
+				ArgAllocation = VolumeCreationOptions::ContainerAllocation::Preallocated;
+			else if (str.IsSameAs (L"sparse", false))
+				ArgAllocation = VolumeCreationOptions::ContainerAllocation::Sparse;
+			else
+				throw_err (LangString["UNKNOWN_OPTION"] + L": " + str);
+		}
+
 		if (parser.Found (L"background-task"))
 			StartBackgroundTask = true;
 
@@ -250,6 +295,14 @@ namespace CipherShed
 		if (parser.Found (L"cache"))
 			ArgMountOptions.CachePassword = true;
 #endif
+		if (parser.Found (L"clone", &str))
+		{
+			if (ArgCommand != CommandId::CreateVolume)
+				throw_err (_("Option --clone can be used only when creating a volume."));
+
+			ArgCloneTemplatePath.reset (new VolumePath (wstring (str)));
+		}
+
 		ArgDisplayPassword = parser.Found (L"display-password");
 
 		if (parser.Found (L"encryption", &str))
@@ -320,10 +373,14 @@ namespace CipherShed
 
 				if (token == L"headerbak")
 					ArgMountOptions.UseBackupHeaders = true;
+				else if (token == L"keycache")
+					ArgMountOptions.CacheHeaderKeys = true;
 				else if (token == L"nokernelcrypto")
 					ArgMountOptions.NoKernelCrypto = true;
 				else if (token == L"readonly" || token == L"ro")
 					ArgMountOptions.Protection = VolumeProtection::ReadOnly;
+				else if (token == L"sharedfuse")
+					ArgMountOptions.SharedFuseService = true;
 				else if (token == L"system")
 					ArgMountOptions.PartitionInSystemEncryptionScope = true;
 				else if (token == L"timestamp" || token == L"ts")
@@ -351,6 +408,18 @@ namespace CipherShed
 			Preferences.NonInteractive = true;
 		}
 
+		if (parser.Found (L"output-format", &str))
+		{
+			if (str.IsSameAs (L"text", false))
+				ArgOutputFormat = CommandOutputFormat::Text;
+			else if (str.IsSameAs (L"csv", false))
+				ArgOutputFormat = CommandOutputFormat::Csv;
+			else if (str.IsSameAs (L"json", false))
+				ArgOutputFormat = CommandOutputFormat::Json;
+			else
+				throw_err (LangString["UNKNOWN_OPTION"] + L": " + str);
+		}
+
 		if (parser.Found (L"password", &str))
 			ArgPassword.reset (new VolumePassword (wstring (str)));
 
@@ -438,6 +507,35 @@ namespace CipherShed
 				throw_err (LangString["UNKNOWN_OPTION"] + L": " + str);
 		}
 
+		if (parser.Found (L"wipe-cache"))
+		{
+			// Combined with --dismount, the cache is wiped after volumes have been dismounted
+			if (ArgCommand == CommandId::None)
+				ArgCommand = CommandId::WipeCache;
+			else if (ArgCommand != CommandId::DismountVolumes)
+				throw_err (_("Only a single command can be specified at a time."));
+
+			ArgWipeCache = true;
+		}
+
+		if (parser.Found (L"write-buffer-count", &str))
+		{
+			unsigned long number;
+			if (!str.ToULong (&number) || number < 1 || number > 0xFFFFFFFFUL)
+				throw_err (LangString["PARAMETER_INCORRECT"] + L": " + str);
+
+			ArgWriteBufferCount = number;
+		}
+
+		if (parser.Found (L"write-buffer-size", &str))
+		{
+			unsigned long number;
+			if (!str.ToULong (&number) || number < ENCRYPTION_DATA_UNIT_SIZE || number > 0xFFFFFFFFUL || number % ENCRYPTION_DATA_UNIT_SIZE != 0)
+				throw_err (LangString["PARAMETER_INCORRECT"] + L": " + str);
+
+			ArgWriteBufferSize = number;
+		}
+
 		// Parameters
 		if (parser.GetParamCount() > 0)
 		{
@@ -30,6 +30,8 @@ namespace CipherShed
 			AutoMountDevicesFavorites,
 			AutoMountFavorites,
 			BackupHeaders,
+			Batch,
+			Benchmark,
 			ChangePassword,
 			CreateKeyfile,
 			CreateVolume,
@@ -45,7 +47,18 @@ namespace CipherShed
 			MountVolume,
 			RestoreHeaders,
 			SavePreferences,
-			Test
+			Test,
+			WipeCache
+		};
+	};
+
+	struct CommandOutputFormat
+	{
+		enum Enum
+		{
+			Text,
+			Csv,
+			Json
 		};
 	};
 
@@ -56,6 +69,8 @@ namespace CipherShed
 		virtual ~CommandLineInterface ();
 
 
+		VolumeCreationOptions::ContainerAllocation::Enum ArgAllocation;
+		shared_ptr <VolumePath> ArgCloneTemplatePath;
 		CommandId::Enum ArgCommand;
 		bool ArgDisplayPassword;
 		shared_ptr <EncryptionAlgorithm> ArgEncryptionAlgorithm;
@@ -69,6 +84,7 @@ namespace CipherShed
 		shared_ptr <KeyfileList> ArgNewKeyfiles;
 		shared_ptr <VolumePassword> ArgNewPassword;
 		bool ArgNoHiddenVolumeProtection;
+		CommandOutputFormat::Enum ArgOutputFormat;
 		shared_ptr <VolumePassword> ArgPassword;
 		bool ArgQuick;
 		FilesystemPath ArgRandomSourcePath;
@@ -76,6 +92,9 @@ namespace CipherShed
 		shared_ptr <VolumePath> ArgVolumePath;
 		VolumeInfoList ArgVolumes;
 		VolumeType::Enum ArgVolumeType;
+		bool ArgWipeCache;
+		uint32 ArgWriteBufferCount;
+		uint32 ArgWriteBufferSize;
 
 		bool StartBackgroundTask;
 		UserPreferences Preferences;
@@ -1117,6 +1117,7 @@ namespace CipherShed
 			try
 			{
 				VolumeHistory::Clear();
+				Gui->ClearVolumeOpenHints();
 			}
 			catch (exception &e) { Gui->ShowError (e); }
 		}
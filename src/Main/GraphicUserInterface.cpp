@@ -274,9 +274,9 @@ namespace CipherShed
 			else
 			{
 				// Store random data in place of hidden volume header
-				shared_ptr <EncryptionAlgorithm> ea = normalVolume->GetEncryptionAlgorithm();
-				Core->RandomizeEncryptionAlgorithmKey (ea);
-				ea->Encrypt (newHeaderBuffer);
+				RandomKeystream keystream;
+				Core->RandomizeKeystreamKey (keystream);
+				keystream.GetData (newHeaderBuffer, 0);
 			}
 
 			backupFile.Write (newHeaderBuffer);
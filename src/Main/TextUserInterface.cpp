@@ -349,9 +349,9 @@ namespace CipherShed
 		else
 		{
 			// Store random data in place of hidden volume header
-			shared_ptr <EncryptionAlgorithm> ea = normalVolume->GetEncryptionAlgorithm();
-			Core->RandomizeEncryptionAlgorithmKey (ea);
-			ea->Encrypt (newHeaderBuffer);
+			RandomKeystream keystream;
+			Core->RandomizeKeystreamKey (keystream);
+			keystream.GetData (newHeaderBuffer, 0);
 		}
 
 		backupFile.Write (newHeaderBuffer);
@@ -569,7 +569,20 @@ namespace CipherShed
 		}
 		else
 		{
-			options->Quick = false;
+			// Free space of a file container is encrypted unless the file is preallocated or sparse
+			if (options->Allocation == VolumeCreationOptions::ContainerAllocation::Default)
+				options->Quick = false;
+			else if (options->Allocation == VolumeCreationOptions::ContainerAllocation::Sparse)
+				options->Quick = true;
+
+			// As with quick format of devices, unencrypted free space must be accepted by the user
+			if (options->Quick && options->Type == VolumeType::Normal)
+			{
+				if (Preferences.NonInteractive)
+					ShowWarning (_("WARNING: Quick format is used. Free space of the volume will not be encrypted."));
+				else if (!AskYesNo (L"\n" + LangString["WARN_QUICK_FORMAT"], false, true))
+					throw UserAbort (SRC_POS);
+			}
 
 			uint32 sectorSizeRem = options->Size % options->SectorSize;
 			if (sectorSizeRem != 0)
@@ -760,13 +773,14 @@ namespace CipherShed
 			wxLongLong timeDiff = wxGetLocalTimeMillis() - startTime;
 			if (timeDiff.GetValue() > 0)
 			{
-				uint64 speed = progress.SizeDone * 1000 / timeDiff.GetValue();
+				uint64 speed = progress.BytesPerSecond;
 
 				volumeCreated = !progress.CreationInProgress;
 
-				ShowString (wxString::Format (L"\rDone: %7.3f%%  Speed: %9s  Left: %s         ",
+				ShowString (wxString::Format (L"\rDone: %7.3f%%  Speed: %9s  Time: %9.3f s  Left: %s         ",
 					100.0 - double (options->Size - progress.SizeDone) / (double (options->Size) / 100.0),
 					speed > 0 ? SpeedToString (speed).c_str() : L" ",
+					progress.ElapsedTime / 1000.0,
 					speed > 0 ? TimeSpanToString ((options->Size - progress.SizeDone) / speed).c_str() : L""));
 			}
 
@@ -872,7 +886,7 @@ namespace CipherShed
 
 	void TextUserInterface::DoShowString (const wxString &str) const
 	{
-		wcout << str.c_str();
+		wcout << str.c_str() << flush;
 	}
 
 	void TextUserInterface::DoShowWarning (const wxString &message) const
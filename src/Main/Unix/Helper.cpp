@@ -0,0 +1,70 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../Platform/Platform.h"
+#include "../../Platform/SystemLog.h"
+#include "../../Core/Unix/CoreService.h"
+
+using namespace CipherShed;
+
+// Entry point of the core service helper, which runs both the core service started by the application and
+// the elevated core service. The helper is linked only with Core, Volume, Platform and Driver/Fuse libraries.
+// FUSE services of mounted volumes are forked from the core service.
+int main (int argc, char **argv)
+{
+	// Make sure all required commands can be executed via default search path
+	string sysPathStr = "/usr/sbin:/sbin:/usr/bin:/bin";
+	
+	char *sysPath = getenv ("PATH");
+	if (sysPath)
+	{
+		sysPathStr += ":";
+		sysPathStr += sysPath;
+	}
+
+	setenv ("PATH", sysPathStr.c_str(), 1);
+
+	if (argc > 1 && strcmp (argv[1], TC_CORE_SERVICE_CMDLINE_OPTION) == 0)
+	{
+		// Process elevated requests
+		try
+		{
+			CoreService::ProcessElevatedRequests();
+			return 0;
+		}
+		catch (exception &e)
+		{
+#ifdef DEBUG
+			SystemLog::WriteException (e);
+#endif
+		}
+		catch (...)	{ }
+	}
+	else if (argc > 1 && strcmp (argv[1], TC_CORE_SERVICE_STDIO_CMDLINE_OPTION) == 0)
+	{
+		// Process requests of the application received through standard input
+		try
+		{
+			CoreService::ProcessRequests (STDIN_FILENO, STDOUT_FILENO);
+			return 0;
+		}
+		catch (exception &e)
+		{
+#ifdef DEBUG
+			SystemLog::WriteException (e);
+#endif
+		}
+		catch (...)	{ }
+	}
+
+	return 1;
+}
@@ -0,0 +1,214 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#include <algorithm>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "../../Platform/Platform.h"
+#include "../../Platform/FileStream.h"
+#include "../../Platform/Serializable.h"
+#include "../../Platform/Time.h"
+#include "../../Platform/Unix/Pipe.h"
+#include "../../Core/Unix/CoreService.h"
+#include "../../Core/Unix/CoreServiceRequest.h"
+#include "../../Core/Unix/CoreServiceResponse.h"
+
+using namespace CipherShed;
+
+// Compares executables running the core service. Each executable is started as the core service of the
+// application and serves the same requests the application sends, without administrator privileges.
+
+namespace CipherShed
+{
+	struct HelperBenchmarkResult
+	{
+		HelperBenchmarkResult () : PeakMemory (0), RequestTime (0), StartTime (0) { }
+
+		uint64 PeakMemory;		// KiB
+		uint64 RequestTime;		// Nanoseconds
+		uint64 StartTime;		// Nanoseconds
+	};
+
+	class HelperBenchmark
+	{
+	public:
+		HelperBenchmark (size_t requestCount) : LastRequestId (0), RequestCount (requestCount) { }
+
+		// Starts the executable, measures the time to the response to its first request and the average time of
+		// subsequent requests, and stops the service after the last response
+		HelperBenchmarkResult Run (const string &executablePath)
+		{
+			Pipe inputPipe;
+			Pipe outputPipe;
+
+			uint64 startTime = Time::GetMonotonicNanoseconds();
+
+			int pid = fork();
+			throw_sys_if (pid == -1);
+
+			if (pid == 0)
+			{
+				try
+				{
+					throw_sys_if (dup2 (inputPipe.GetReadFD(), STDIN_FILENO) == -1);
+					throw_sys_if (dup2 (outputPipe.GetWriteFD(), STDOUT_FILENO) == -1);
+
+					const char *args[] = { executablePath.c_str(), TC_CORE_SERVICE_STDIO_CMDLINE_OPTION, nullptr };
+					execv (args[0], ((char* const*) args));
+				}
+				catch (...) { }
+				_exit (1);
+			}
+
+			shared_ptr <Stream> inputStream (new FileStream (inputPipe.GetWriteFD()));
+			shared_ptr <Stream> outputStream (new FileStream (outputPipe.GetReadFD()));
+			inputStream->SetSerializationFormat (SerializationFormat::Compact);
+			outputStream->SetSerializationFormat (SerializationFormat::Compact);
+
+			HelperBenchmarkResult result;
+			try
+			{
+				SendRequest (inputStream, outputStream);
+				result.StartTime = Time::GetMonotonicNanoseconds() - startTime;
+
+				uint64 requestStartTime = Time::GetMonotonicNanoseconds();
+				for (size_t i = 0; i < RequestCount; ++i)
+					SendRequest (inputStream, outputStream);
+
+				if (RequestCount > 0)
+					result.RequestTime = (Time::GetMonotonicNanoseconds() - requestStartTime) / RequestCount;
+
+				ExitRequest exitRequest;
+				exitRequest.Serialize (inputStream);
+			}
+			catch (...)
+			{
+				kill (pid, SIGKILL);
+				waitpid (pid, nullptr, 0);
+				throw;
+			}
+
+			int status;
+			struct rusage usage;
+			throw_sys_if (wait4 (pid, &status, 0, &usage) == -1);
+
+			if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
+				throw ExecutedProcessFailed (SRC_POS, executablePath, WIFEXITED (status) ? WEXITSTATUS (status) : 1, string());
+
+#ifdef TC_MACOSX
+			result.PeakMemory = usage.ru_maxrss / 1024;
+#else
+			result.PeakMemory = usage.ru_maxrss;
+#endif
+			return result;
+		}
+
+	protected:
+		// Host devices are listed by the core service whenever the user interface selects a device
+		void SendRequest (shared_ptr <Stream> inputStream, shared_ptr <Stream> outputStream)
+		{
+			GetHostDevicesRequest request (true);
+			request.RequestId = ++LastRequestId;
+			request.Serialize (inputStream);
+
+			Serializer sr (outputStream);
+			uint64 responseId;
+			sr.Deserialize ("RequestId", responseId);
+
+			std::auto_ptr <Serializable> response (Serializable::DeserializeNew (outputStream));
+
+			Exception *exception = dynamic_cast <Exception *> (response.get());
+			if (exception)
+				exception->Throw();
+
+			if (responseId != request.RequestId || !dynamic_cast <GetHostDevicesResponse *> (response.get()))
+				throw ParameterIncorrect (SRC_POS);
+		}
+
+		uint64 LastRequestId;
+		size_t RequestCount;
+	};
+}
+
+static void ShowUsage (const char *name)
+{
+	fprintf (stderr,
+		"Usage: %s [OPTION]... EXECUTABLE...\n"
+		"Starts each executable as the core service and measures its start time, request time and peak memory.\n"
+		"\n"
+		"  --requests=COUNT         Requests sent after the first one in each run (default: 100)\n"
+		"  --runs=COUNT             Runs of each executable (default: 20)\n",
+		name);
+}
+
+int main (int argc, char **argv)
+{
+	try
+	{
+		size_t requestCount = 100;
+		size_t runCount = 20;
+		list <string> executables;
+
+		for (int i = 1; i < argc; ++i)
+		{
+			string arg = argv[i];
+			string value = arg.find ('=') != string::npos ? arg.substr (arg.find ('=') + 1) : string();
+
+			if (arg.find ("--requests=") == 0)
+				requestCount = StringConverter::ToUInt32 (value);
+			else if (arg.find ("--runs=") == 0)
+				runCount = StringConverter::ToUInt32 (value);
+			else if (arg.find ("--") != 0)
+				executables.push_back (arg);
+			else
+			{
+				ShowUsage (argv[0]);
+				return 2;
+			}
+		}
+
+		if (executables.empty() || runCount == 0)
+		{
+			ShowUsage (argv[0]);
+			return 2;
+		}
+
+		HelperBenchmark benchmark (requestCount);
+
+		printf ("%-32s %12s %12s %12s\n", "", "Start us", "Request us", "Peak KiB");
+		foreach (const string &executable, executables)
+		{
+			HelperBenchmarkResult total;
+			for (size_t run = 0; run < runCount; ++run)
+			{
+				HelperBenchmarkResult result = benchmark.Run (executable);
+				total.StartTime += result.StartTime;
+				total.RequestTime += result.RequestTime;
+				total.PeakMemory = max (total.PeakMemory, result.PeakMemory);
+			}
+
+			printf ("%-32s %12.1f %12.1f %12llu\n", executable.c_str(),
+				total.StartTime / 1000.0 / runCount, total.RequestTime / 1000.0 / runCount, (unsigned long long) total.PeakMemory);
+		}
+	}
+	catch (exception &e)
+	{
+		fprintf (stderr, "%s\n", StringConverter::ToSingle (StringConverter::ToExceptionString (e)).c_str());
+		return 1;
+	}
+
+	return 0;
+}
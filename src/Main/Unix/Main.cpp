@@ -8,6 +8,7 @@
 
 #include "../System.h"
 #include <sys/mman.h>
+#include <unistd.h>
 
 #include "../../Platform/Platform.h"
 #include "../../Platform/SystemLog.h"
@@ -57,6 +58,24 @@ int main (int argc, char **argv)
 			return 1;
 		}
 
+		if (argc > 1 && strcmp (argv[1], TC_CORE_SERVICE_STDIO_CMDLINE_OPTION) == 0)
+		{
+			// Process requests received through standard input in the same way as the helper executable
+			try
+			{
+				CoreService::ProcessRequests (STDIN_FILENO, STDOUT_FILENO);
+				return 0;
+			}
+			catch (exception &e)
+			{
+#ifdef DEBUG
+				SystemLog::WriteException (e);
+#endif
+			}
+			catch (...)	{ }
+			return 1;
+		}
+
 		// Start core service
 		CoreService::Start();
 		finally_do ({ CoreService::Stop(); });
@@ -0,0 +1,470 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../Platform/Platform.h"
+#include "../../Platform/Time.h"
+#include "../../Core/Core.h"
+#include "../../Core/RandomNumberGenerator.h"
+#include "../../Core/VolumeCreator.h"
+#include "../../Volume/EncryptionThreadPool.h"
+
+using namespace CipherShed;
+
+// End-to-end benchmark of volume I/O. A temporary file-hosted volume is created, opened and accessed
+// by Volume::ReadSectors() and Volume::WriteSectors() directly, without FUSE, kernel modules or
+// administrator privileges.
+
+namespace CipherShed
+{
+	struct VolumeBenchmarkOptions
+	{
+		VolumeBenchmarkOptions () :
+			BlockSize (4096),
+			Concurrency (1),
+			Directory ("/tmp"),
+			Json (false),
+			RandomAccess (true),
+			ReadPercentage (50),
+			RunTime (10),
+			ThreadCount (0),
+			VolumeSize (256 * 1024 * 1024)
+		{
+			const char *tmpDir = getenv ("TMPDIR");
+			if (tmpDir && tmpDir[0])
+				Directory = tmpDir;
+		}
+
+		size_t BlockSize;
+		size_t Concurrency;
+		string Directory;
+		shared_ptr <EncryptionAlgorithm> EA;
+		bool Json;
+		shared_ptr <Pkcs5Kdf> Kdf;
+		bool RandomAccess;
+		unsigned int ReadPercentage;
+		unsigned int RunTime;		// Seconds
+		size_t ThreadCount;			// Encryption threads; zero selects one thread per CPU
+		uint64 VolumeSize;
+	};
+
+	struct VolumeBenchmarkWorkerResult
+	{
+		VolumeBenchmarkWorkerResult () : DecryptionTime (0), DecryptionCount (0), EncryptionTime (0), EncryptionCount (0) { }
+
+		uint64 DecryptionTime;
+		uint64 DecryptionCount;
+		uint64 EncryptionTime;
+		uint64 EncryptionCount;
+		string Error;
+		vector <uint64> ReadLatencies;	// Nanoseconds
+		vector <uint64> WriteLatencies;	// Nanoseconds
+	};
+
+	class VolumeBenchmark
+	{
+	public:
+		VolumeBenchmark (const VolumeBenchmarkOptions &options) : Options (options) { }
+
+		void Run ()
+		{
+			RandomNumberGenerator::Start();
+			finally_do ({ RandomNumberGenerator::Stop(); });
+
+			EncryptionThreadPool::Start (Options.ThreadCount);
+			finally_do ({ EncryptionThreadPool::Stop(); });
+
+			// Temporary volume
+			string pathTemplate = Options.Directory + "/ciphershed-volume-benchmark.XXXXXX";
+			vector <char> path (pathTemplate.begin(), pathTemplate.end());
+			path.push_back (0);
+
+			int fd = mkstemp (&path[0]);
+			throw_sys_sub_if (fd == -1, StringConverter::ToWide (pathTemplate));
+			close (fd);
+
+			finally_do_arg (string, &path[0], { unlink (finally_arg.c_str()); });
+
+			shared_ptr <VolumePassword> password (new VolumePassword (L"benchmark"));
+			CreateVolume (VolumePath (StringConverter::ToWide (&path[0])), password);
+
+			Vol.reset (new Volume);
+			Vol->Open (VolumePath (StringConverter::ToWide (&path[0])), false, password, shared_ptr <KeyfileList> ());
+
+			if (Options.BlockSize == 0 || Options.BlockSize % Vol->GetSectorSize() != 0 || Options.BlockSize > Vol->GetSize())
+				throw ParameterIncorrect (SRC_POS);
+
+			// Timed workload
+			Results.clear();
+			Results.resize (Options.Concurrency);
+
+			uint64 startTime = Time::GetMonotonicNanoseconds();
+			RunWorkers (false, startTime + Options.RunTime * 1000ULL * 1000 * 1000);
+			WorkloadTime = Time::GetMonotonicNanoseconds() - startTime;
+
+			// Encryption and decryption of the same blocks by the same number of threads, which splits the time spent in
+			// Volume::ReadSectors() and Volume::WriteSectors() into encryption and I/O
+			uint64 calibrationTime = max (Options.RunTime * 1000ULL * 1000 * 1000 / 5, 200ULL * 1000 * 1000);
+			RunWorkers (true, Time::GetMonotonicNanoseconds() + calibrationTime);
+
+			foreach (const VolumeBenchmarkWorkerResult &result, Results)
+			{
+				if (!result.Error.empty())
+					throw ExternalException (SRC_POS, StringConverter::ToWide (result.Error));
+			}
+
+			EncryptionThreadCount = EncryptionThreadPool::GetThreadCount();
+		}
+
+		void ShowResults () const
+		{
+			vector <uint64> readLatencies;
+			vector <uint64> writeLatencies;
+			double cryptoTimePerRead = 0;
+			double cryptoTimePerWrite = 0;
+			uint64 decryptionCount = 0;
+			uint64 encryptionCount = 0;
+			uint64 decryptionTime = 0;
+			uint64 encryptionTime = 0;
+
+			foreach (const VolumeBenchmarkWorkerResult &result, Results)
+			{
+				readLatencies.insert (readLatencies.end(), result.ReadLatencies.begin(), result.ReadLatencies.end());
+				writeLatencies.insert (writeLatencies.end(), result.WriteLatencies.begin(), result.WriteLatencies.end());
+				decryptionCount += result.DecryptionCount;
+				decryptionTime += result.DecryptionTime;
+				encryptionCount += result.EncryptionCount;
+				encryptionTime += result.EncryptionTime;
+			}
+
+			if (decryptionCount > 0)
+				cryptoTimePerRead = (double) decryptionTime / decryptionCount;
+
+			if (encryptionCount > 0)
+				cryptoTimePerWrite = (double) encryptionTime / encryptionCount;
+
+			sort (readLatencies.begin(), readLatencies.end());
+			sort (writeLatencies.begin(), writeLatencies.end());
+
+			double totalTime = (double) Sum (readLatencies) + Sum (writeLatencies);
+			double cryptoTime = cryptoTimePerRead * readLatencies.size() + cryptoTimePerWrite * writeLatencies.size();
+			double cryptoShare = totalTime > 0 ? min (cryptoTime / totalTime, 1.0) : 0;
+
+			string algorithm = StringConverter::ToSingle (Vol->GetEncryptionAlgorithm()->GetName());
+
+			if (Options.Json)
+			{
+				printf ("{\n");
+				printf ("\"volume\": { \"size\": %llu, \"encryption\": \"%s\", \"mode\": \"%s\" },\n",
+					(unsigned long long) Vol->GetSize(), algorithm.c_str(), StringConverter::ToSingle (Vol->GetEncryptionMode()->GetName()).c_str());
+				printf ("\"workload\": { \"pattern\": \"%s\", \"block_size\": %llu, \"read_percentage\": %u, \"concurrency\": %llu, \"encryption_threads\": %llu, \"run_time_ns\": %llu },\n",
+					Options.RandomAccess ? "random" : "sequential", (unsigned long long) Options.BlockSize, Options.ReadPercentage,
+					(unsigned long long) Options.Concurrency, (unsigned long long) EncryptionThreadCount, (unsigned long long) WorkloadTime);
+				printf ("\"read\": %s,\n", ToJson (readLatencies).c_str());
+				printf ("\"write\": %s,\n", ToJson (writeLatencies).c_str());
+				printf ("\"time_split\": { \"crypto\": %.4f, \"io\": %.4f }\n", cryptoShare, 1.0 - cryptoShare);
+				printf ("}\n");
+				return;
+			}
+
+			printf ("Volume:   %llu MiB, %s, %s\n", (unsigned long long) Vol->GetSize() / 1024 / 1024, algorithm.c_str(),
+				StringConverter::ToSingle (Vol->GetEncryptionMode()->GetName()).c_str());
+			printf ("Workload: %s, %llu-byte blocks, %u%% reads, %llu workers, %llu encryption threads, %.1f s\n\n",
+				Options.RandomAccess ? "random" : "sequential", (unsigned long long) Options.BlockSize, Options.ReadPercentage,
+				(unsigned long long) Options.Concurrency, (unsigned long long) EncryptionThreadCount, WorkloadTime / 1e9);
+
+			printf ("%-6s %12s %11s %10s %10s %10s %10s %10s %10s\n", "", "Operations", "IOPS", "MiB/s", "p50 us", "p90 us", "p99 us", "p99.9 us", "Max us");
+			ShowRow ("read", readLatencies);
+			ShowRow ("write", writeLatencies);
+
+			printf ("\nTime:     %.1f%% encryption, %.1f%% I/O (estimated from encryption of the same blocks)\n", cryptoShare * 100, (1.0 - cryptoShare) * 100);
+		}
+
+	protected:
+		struct WorkerFunctor : public Functor
+		{
+			WorkerFunctor (VolumeBenchmark &benchmark, size_t workerIndex, bool calibration, uint64 endTime)
+				: Benchmark (benchmark), Calibration (calibration), EndTime (endTime), Result (benchmark.Results[workerIndex]), WorkerIndex (workerIndex) { }
+
+			virtual void operator() ()
+			{
+				try
+				{
+					const VolumeBenchmarkOptions &options = Benchmark.Options;
+					Volume &volume = *Benchmark.Vol;
+
+					Buffer buffer (options.BlockSize);
+					for (size_t i = 0; i < buffer.Size(); ++i)
+						buffer[i] = (byte) (i + WorkerIndex);
+
+					uint64 blockCount = volume.GetSize() / options.BlockSize;
+
+					// Sequential workers access separate regions of the volume
+					uint64 regionStart = blockCount * WorkerIndex / options.Concurrency;
+					uint64 regionBlockCount = max (blockCount * (WorkerIndex + 1) / options.Concurrency - regionStart, (uint64) 1);
+					uint64 sequentialBlock = 0;
+
+					uint64 random = 0x9e3779b97f4a7c15ULL * (WorkerIndex + 1);
+
+					if (!Calibration)
+					{
+						Result.ReadLatencies.reserve (1024 * 1024);
+						Result.WriteLatencies.reserve (1024 * 1024);
+					}
+
+					shared_ptr <EncryptionAlgorithm> ea = volume.GetEncryptionAlgorithm();
+					size_t sectorSize = volume.GetSectorSize();
+
+					while (Time::GetMonotonicNanoseconds() < EndTime)
+					{
+						random ^= random << 13;
+						random ^= random >> 7;
+						random ^= random << 17;
+
+						uint64 block = options.RandomAccess ? random % blockCount : regionStart + sequentialBlock++ % regionBlockCount;
+						bool read = (random >> 40) % 100 < options.ReadPercentage;
+
+						uint64 startTime = Time::GetMonotonicNanoseconds();
+
+						if (Calibration)
+						{
+							uint64 sectorIndex = block * options.BlockSize / sectorSize;
+
+							if (read)
+								ea->DecryptSectors (buffer, sectorIndex, options.BlockSize / sectorSize, sectorSize);
+							else
+								ea->EncryptSectors (buffer, sectorIndex, options.BlockSize / sectorSize, sectorSize);
+
+							uint64 time = Time::GetMonotonicNanoseconds() - startTime;
+
+							if (read)
+							{
+								Result.DecryptionTime += time;
+								++Result.DecryptionCount;
+							}
+							else
+							{
+								Result.EncryptionTime += time;
+								++Result.EncryptionCount;
+							}
+						}
+						else if (read)
+						{
+							volume.ReadSectors (buffer, block * options.BlockSize);
+							Result.ReadLatencies.push_back (Time::GetMonotonicNanoseconds() - startTime);
+						}
+						else
+						{
+							volume.WriteSectors (buffer, block * options.BlockSize);
+							Result.WriteLatencies.push_back (Time::GetMonotonicNanoseconds() - startTime);
+						}
+					}
+				}
+				catch (exception &e)
+				{
+					Result.Error = StringConverter::ToSingle (StringConverter::ToExceptionString (e));
+				}
+			}
+
+			VolumeBenchmark &Benchmark;
+			bool Calibration;
+			uint64 EndTime;
+			VolumeBenchmarkWorkerResult &Result;
+			size_t WorkerIndex;
+		};
+
+		void CreateVolume (const VolumePath &path, shared_ptr <VolumePassword> password) const
+		{
+			shared_ptr <VolumeCreationOptions> options (new VolumeCreationOptions);
+			options->Path = path;
+			options->Type = VolumeType::Normal;
+			options->Size = Options.VolumeSize;
+			options->Password = password;
+			options->VolumeHeaderKdf = Options.Kdf;
+			options->EA = Options.EA;
+			options->Quick = true;
+			options->Allocation = VolumeCreationOptions::ContainerAllocation::Preallocated;
+			options->Filesystem = VolumeCreationOptions::FilesystemType::None;
+			options->FilesystemClusterSize = 0;
+			options->SectorSize = TC_SECTOR_SIZE_FILE_HOSTED_VOLUME;
+			options->WriteBufferCount = 0;
+			options->WriteBufferSize = 0;
+
+			VolumeCreator creator;
+			creator.CreateVolume (options);
+
+			while (creator.GetProgressInfo().CreationInProgress)
+				Thread::Sleep (10);
+
+			creator.CheckResult();
+		}
+
+		void RunWorkers (bool calibration, uint64 endTime)
+		{
+			list < shared_ptr <Thread> > threads;
+
+			for (size_t i = 0; i < Options.Concurrency; ++i)
+			{
+				shared_ptr <Thread> thread (new Thread);
+				thread->Start (new WorkerFunctor (*this, i, calibration, endTime));
+				threads.push_back (thread);
+			}
+
+			foreach_ref (const Thread &thread, threads)
+				thread.Join();
+		}
+
+		void ShowRow (const char *name, const vector <uint64> &sortedLatencies) const
+		{
+			double seconds = WorkloadTime / 1e9;
+
+			printf ("%-6s %12llu %11.1f %10.2f %10.1f %10.1f %10.1f %10.1f %10.1f\n", name, (unsigned long long) sortedLatencies.size(),
+				sortedLatencies.size() / seconds, sortedLatencies.size() * Options.BlockSize / seconds / 1024 / 1024,
+				Percentile (sortedLatencies, 50) / 1e3, Percentile (sortedLatencies, 90) / 1e3, Percentile (sortedLatencies, 99) / 1e3,
+				Percentile (sortedLatencies, 99.9) / 1e3, Percentile (sortedLatencies, 100) / 1e3);
+		}
+
+		static uint64 Percentile (const vector <uint64> &sortedValues, double percentile)
+		{
+			if (sortedValues.empty())
+				return 0;
+
+			size_t index = (size_t) (percentile / 100 * sortedValues.size() + 0.999999);
+			return sortedValues[index > 0 ? min (index, sortedValues.size()) - 1 : 0];
+		}
+
+		static uint64 Sum (const vector <uint64> &values)
+		{
+			uint64 sum = 0;
+			foreach (uint64 value, values)
+				sum += value;
+
+			return sum;
+		}
+
+		string ToJson (const vector <uint64> &sortedLatencies) const
+		{
+			double seconds = WorkloadTime / 1e9;
+			char json[512];
+
+			snprintf (json, sizeof (json), "{ \"operations\": %llu, \"iops\": %.1f, \"bytes_per_second\": %.0f, "
+				"\"latency_ns\": { \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"p99.9\": %llu, \"max\": %llu } }",
+				(unsigned long long) sortedLatencies.size(), sortedLatencies.size() / seconds, sortedLatencies.size() * Options.BlockSize / seconds,
+				(unsigned long long) Percentile (sortedLatencies, 50), (unsigned long long) Percentile (sortedLatencies, 90),
+				(unsigned long long) Percentile (sortedLatencies, 99), (unsigned long long) Percentile (sortedLatencies, 99.9),
+				(unsigned long long) Percentile (sortedLatencies, 100));
+
+			return json;
+		}
+
+		size_t EncryptionThreadCount;
+		VolumeBenchmarkOptions Options;
+		vector <VolumeBenchmarkWorkerResult> Results;
+		shared_ptr <Volume> Vol;
+		uint64 WorkloadTime;
+	};
+}
+
+static void ShowUsage (const char *name)
+{
+	fprintf (stderr,
+		"Usage: %s [OPTIONS]\n"
+		"\n"
+		"  --block-size=BYTES       Size of each read or write (default: 4096)\n"
+		"  --concurrency=COUNT      Number of threads issuing requests (default: 1)\n"
+		"  --directory=DIR          Directory of the temporary volume (default: $TMPDIR or /tmp)\n"
+		"  --encryption=ALGORITHM   Encryption algorithm (default: AES)\n"
+		"  --hash=HASH              Header key derivation hash (default: SHA-512)\n"
+		"  --json                   Write results in JSON format\n"
+		"  --pattern=random|sequential  Access pattern (default: random)\n"
+		"  --read-percentage=PERCENT    Percentage of reads (default: 50)\n"
+		"  --runtime=SECONDS        Duration of the workload (default: 10)\n"
+		"  --size=BYTES             Size of the volume (default: 268435456)\n"
+		"  --threads=COUNT          Encryption threads, 0 for one per CPU (default: 0)\n",
+		name);
+}
+
+int main (int argc, char **argv)
+{
+	try
+	{
+		VolumeBenchmarkOptions options;
+		wstring encryption = L"AES";
+		wstring hashName = L"SHA-512";
+
+		for (int i = 1; i < argc; ++i)
+		{
+			string arg = argv[i];
+			string value = arg.find ('=') != string::npos ? arg.substr (arg.find ('=') + 1) : string();
+
+			if (arg.find ("--block-size=") == 0)
+				options.BlockSize = (size_t) StringConverter::ToUInt64 (value);
+			else if (arg.find ("--concurrency=") == 0)
+				options.Concurrency = max ((size_t) StringConverter::ToUInt32 (value), (size_t) 1);
+			else if (arg.find ("--directory=") == 0)
+				options.Directory = value;
+			else if (arg.find ("--encryption=") == 0)
+				encryption = StringConverter::ToWide (value);
+			else if (arg.find ("--hash=") == 0)
+				hashName = StringConverter::ToWide (value);
+			else if (arg == "--json")
+				options.Json = true;
+			else if (arg == "--pattern=random")
+				options.RandomAccess = true;
+			else if (arg == "--pattern=sequential")
+				options.RandomAccess = false;
+			else if (arg.find ("--read-percentage=") == 0)
+				options.ReadPercentage = min (StringConverter::ToUInt32 (value), (uint32) 100);
+			else if (arg.find ("--runtime=") == 0)
+				options.RunTime = StringConverter::ToUInt32 (value);
+			else if (arg.find ("--size=") == 0)
+				options.VolumeSize = StringConverter::ToUInt64 (value);
+			else if (arg.find ("--threads=") == 0)
+				options.ThreadCount = StringConverter::ToUInt32 (value);
+			else
+			{
+				ShowUsage (argv[0]);
+				return 2;
+			}
+		}
+
+		foreach (shared_ptr <CipherShed::EncryptionAlgorithm> ea, CipherShed::EncryptionAlgorithm::GetAvailableAlgorithms())
+		{
+			if (!ea->IsDeprecated() && ea->GetName() == encryption)
+				options.EA = ea->GetNew();
+		}
+
+		foreach (shared_ptr <CipherShed::Hash> hash, CipherShed::Hash::GetAvailableAlgorithms())
+		{
+			if (hash->GetName() == hashName)
+				options.Kdf = Pkcs5Kdf::GetAlgorithm (*hash);
+		}
+
+		if (!options.EA || !options.Kdf)
+		{
+			ShowUsage (argv[0]);
+			return 2;
+		}
+
+		VolumeBenchmark benchmark (options);
+		benchmark.Run();
+		benchmark.ShowResults();
+	}
+	catch (exception &e)
+	{
+		fprintf (stderr, "%s\n", StringConverter::ToSingle (StringConverter::ToExceptionString (e)).c_str());
+		return 1;
+	}
+
+	return 0;
+}
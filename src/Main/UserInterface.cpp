@@ -16,12 +16,17 @@
 #include "../Platform/PlatformTest.h"
 #ifdef TC_UNIX
 #include <errno.h>
+#include <unistd.h>
 #include "../Platform/Unix/Process.h"
 #endif
+#include "../Platform/FileStream.h"
 #include "../Platform/SystemInfo.h"
+#include "../Platform/TextReader.h"
 #include "../Common/SecurityToken.h"
+#include "../Core/BatchFile.h"
 using namespace std;
 #include "../Volume/EncryptionTest.h"
+#include "../Volume/VolumeOpenHints.h"
 #include "Application.h"
 #include "FavoriteVolume.h"
 #include "UserInterface.h"
@@ -56,6 +61,11 @@ namespace CipherShed
 #endif // TC_LINUX
 	}
 
+	void UserInterface::ClearVolumeOpenHints () const
+	{
+		VolumeOpenHints::Clear();
+	}
+
 	void UserInterface::CloseExplorerWindows (shared_ptr <VolumeInfo> mountedVolume) const
 	{
 #ifdef TC_WINDOWS
@@ -165,43 +175,65 @@ namespace CipherShed
 		while (!volumes.empty())
 		{
 			VolumeInfoList volumesLeft;
-			foreach (shared_ptr <VolumeInfo> volume, volumes)
+			VolumeInfoList dismountedVolumes;
+			shared_ptr <Exception> dismountError;
+
+			if (twoPassMode)
 			{
-				try
-				{
-					BusyScope busy (this);
-					volume = Core->DismountVolume (volume, ignoreOpenFiles);
-				}
-				catch (MountedVolumeInUse&)
+				// All volumes of a pass are dismounted by a single request
+				foreach (shared_ptr <DismountResult> result, Core->DismountVolumes (volumes, ignoreOpenFiles))
 				{
-					if (!firstPass)
-						throw;
+					if (!result->Error)
+					{
+						dismountedVolumes.push_back (result->DismountedVolume);
+						continue;
+					}
 
-					if (twoPassMode || !interactive)
+					// The first error of the last pass is reported once all dismounted volumes have been processed
+					if (!firstPass)
 					{
-						volumesInUse = true;
-						volumesLeft.push_back (volume);
+						if (!dismountError)
+							dismountError = result->Error;
 						continue;
 					}
-					else
+
+					if (dynamic_cast <MountedVolumeInUse *> (result->Error.get()))
+						volumesInUse = true;
+
+					volumesLeft.push_back (result->MountedVolume);
+				}
+			}
+			else
+			{
+				foreach (shared_ptr <VolumeInfo> volume, volumes)
+				{
+					try
+					{
+						BusyScope busy (this);
+						dismountedVolumes.push_back (Core->DismountVolume (volume, ignoreOpenFiles));
+					}
+					catch (MountedVolumeInUse&)
 					{
+						if (!interactive)
+						{
+							volumesInUse = true;
+							volumesLeft.push_back (volume);
+							continue;
+						}
+
 						if (AskYesNo (StringFormatter (LangString["UNMOUNT_LOCK_FAILED"], wstring (volume->Path)), true, true))
 						{
 							BusyScope busy (this);
-							volume = Core->DismountVolume (volume, true);
+							dismountedVolumes.push_back (Core->DismountVolume (volume, true));
 						}
 						else
 							throw UserAbort (SRC_POS);
 					}
 				}
-				catch (...)
-				{
-					if (twoPassMode && firstPass)
-						volumesLeft.push_back (volume);
-					else
-						throw;
-				}
+			}
 
+			foreach (shared_ptr <VolumeInfo> volume, dismountedVolumes)
+			{
 				if (volume->HiddenVolumeProtectionTriggered)
 					ShowWarning (StringFormatter (LangString["DAMAGE_TO_HIDDEN_VOLUME_PREVENTED"], wstring (volume->Path)));
 
@@ -213,6 +245,14 @@ namespace CipherShed
 				}
 			}
 
+			if (dismountError)
+			{
+				if (Preferences.Verbose && !message.IsEmpty())
+					ShowInfo (message);
+
+				dismountError->Throw();
+			}
+
 			if (twoPassMode && firstPass)
 			{
 				volumes = volumesLeft;
@@ -441,6 +481,7 @@ namespace CipherShed
 	wxString UserInterface::ExceptionTypeToString (const std::type_info &ex) const
 	{
 #define EX2MSG(exception, message) do { if (ex == typeid (exception)) return (message); } while (false)
+		EX2MSG (BatchCommandIncorrect,				LangString["PARAMETER_INCORRECT"]);
 		EX2MSG (DriveLetterUnavailable,				LangString["DRIVE_LETTER_UNAVAILABLE"]);
 		EX2MSG (EncryptedSystemRequired,			_("This operation must be performed only when the system hosted on the volume is running."));
 		EX2MSG (ExternalException,					LangString["EXCEPTION_OCCURRED"]);
@@ -484,6 +525,7 @@ namespace CipherShed
 		EX2MSG (VolumeAlreadyMounted,				LangString["VOL_ALREADY_MOUNTED"]);
 		EX2MSG (VolumeEncryptionNotCompleted,		LangString["ERR_ENCRYPTION_NOT_COMPLETED"]);
 		EX2MSG (VolumeHostInUse,					_("The host file/device is already in use."));
+		EX2MSG (VolumeNotMounted,					_("No such volume is mounted."));
 		EX2MSG (VolumeSlotUnavailable,				_("Volume slot unavailable."));
 
 #ifdef TC_MACOSX
@@ -583,9 +625,6 @@ namespace CipherShed
 
 		Core->CoalesceSlotNumberAndMountPoint (options);
 
-		bool sharedAccessAllowed = options.SharedAccessAllowed;
-		bool someVolumesShared = false;
-
 		HostDeviceList devices;
 		foreach (shared_ptr <HostDevice> device, Core->GetHostDevices (true))
 		{
@@ -599,57 +638,64 @@ namespace CipherShed
 		foreach_ref (const VolumeInfo &v, Core->GetMountedVolumes())
 			mountedVolumes.insert (v.Path);
 
-		bool protectedVolumeMounted = false;
-		bool legacyVolumeMounted = false;
-
+		VolumePathList volumePaths;
 		foreach_ref (const HostDevice &device, devices)
 		{
-			if (mountedVolumes.find (wstring (device.Path)) != mountedVolumes.end())
-				continue;
+			if (mountedVolumes.find (wstring (device.Path)) == mountedVolumes.end())
+				volumePaths.push_back (wstring (device.Path));
+		}
 
-			Yield();
-			options.SlotNumber = Core->GetFirstFreeSlotNumber (options.SlotNumber);
-			options.MountPoint.reset (new DirectoryPath);
-			options.Path.reset (new VolumePath (device.Path));
+		// Devices are reported as soon as they have been mounted or have failed to mount. The user interface remains responsive in the meantime.
+		struct ResultFunctor : public MountResultFunctor
+		{
+			ResultFunctor (const UserInterface &userInterface, VolumeInfoList &newMountedVolumes)
+				: LegacyVolumeMounted (false), NewMountedVolumes (newMountedVolumes), ProtectedVolumeMounted (false), SomeVolumesShared (false), UI (userInterface) { }
 
-			try
+			virtual void operator() (shared_ptr <MountResult> result)
 			{
-				try
+				if (result->MountedVolume)
 				{
-					options.SharedAccessAllowed = sharedAccessAllowed;
-					newMountedVolumes.push_back (Core->MountVolume (options));
+					NewMountedVolumes.push_back (result->MountedVolume);
+
+					if (result->SharedAccessUsed)
+						SomeVolumesShared = true;
+
+					if (result->MountedVolume->Protection == VolumeProtection::HiddenVolumeReadOnly)
+						ProtectedVolumeMounted = true;
+
+					if (result->MountedVolume->EncryptionAlgorithmMinBlockSize == 8)
+						LegacyVolumeMounted = true;
 				}
-				catch (VolumeHostInUse&)
+				else if (result->Error && !dynamic_cast <VolumeHostInUse *> (result->Error.get()))
 				{
-					if (!sharedAccessAllowed)
+					// Devices which do not host a volume mountable with the given password are expected to fail
+					if (dynamic_cast <DriverError *> (result->Error.get())
+						|| dynamic_cast <MissingVolumeData *> (result->Error.get())
+						|| dynamic_cast <PasswordException *> (result->Error.get())
+						|| dynamic_cast <SystemException *> (result->Error.get())
+						|| dynamic_cast <ExecutedProcessFailed *> (result->Error.get()))
 					{
-						try
-						{
-							options.SharedAccessAllowed = true;
-							newMountedVolumes.push_back (Core->MountVolume (options));
-							someVolumesShared = true;
-						}
-						catch (VolumeHostInUse&)
-						{
-							continue;
-						}
+						if (UI.GetPreferences().Verbose)
+							UI.ShowInfo (StringFormatter (L"{0}: {1}", wstring (result->Path), UI.ExceptionToMessage (*result->Error)));
 					}
 					else
-						continue;
+						UI.ShowError (*result->Error);
 				}
 
-				if (newMountedVolumes.back()->Protection == VolumeProtection::HiddenVolumeReadOnly)
-					protectedVolumeMounted = true;
-
-				if (newMountedVolumes.back()->EncryptionAlgorithmMinBlockSize == 8)
-					legacyVolumeMounted = true;
+				UI.Yield();
 			}
-			catch (DriverError&) { }
-			catch (MissingVolumeData&) { }
-			catch (PasswordException&) { }
-			catch (SystemException&) { }
-			catch (ExecutedProcessFailed&) { }
-		}
+
+			bool LegacyVolumeMounted;
+			VolumeInfoList &NewMountedVolumes;
+			bool ProtectedVolumeMounted;
+			bool SomeVolumesShared;
+			const UserInterface &UI;
+		};
+
+		// All devices are tried concurrently and mounted in the order in which they are listed
+		options.Path.reset();
+		ResultFunctor resultFunctor (*this, newMountedVolumes);
+		Core->MountVolumes (options, volumePaths, &resultFunctor);
 
 		if (newMountedVolumes.empty())
 		{
@@ -657,13 +703,13 @@ namespace CipherShed
 		}
 		else
 		{
-			if (someVolumesShared)
+			if (resultFunctor.SomeVolumesShared)
 				ShowWarning ("DEVICE_IN_USE_INFO");
 
-			if (legacyVolumeMounted)
+			if (resultFunctor.LegacyVolumeMounted)
 				ShowWarning ("WARN_64_BIT_BLOCK_CIPHER");
 
-			if (protectedVolumeMounted)
+			if (resultFunctor.ProtectedVolumeMounted)
 				ShowInfo (LangString[newMountedVolumes.size() > 1 ? "HIDVOL_PROT_WARN_AFTER_MOUNT_PLURAL" : "HIDVOL_PROT_WARN_AFTER_MOUNT"]);
 		}
 
@@ -796,6 +842,10 @@ namespace CipherShed
 
 		if (Preferences.OpenExplorerWindowAfterMount && !mountedVolume->MountPoint.IsEmpty())
 			OpenExplorerWindow (mountedVolume->MountPoint);
+
+		// Hints of all volume types are stored so that their absence does not indicate a hidden volume
+		if (Preferences.SaveHistory)
+			VolumeOpenHints::Set (mountedVolume->Path, VolumeOpenHint (mountedVolume->Pkcs5PrfName, mountedVolume->EncryptionAlgorithmName));
 	}
 	
 	void UserInterface::OnWarning (EventArgs &args)
@@ -867,6 +917,46 @@ namespace CipherShed
 #endif
 	}
 
+	void UserInterface::ProcessBatchFile (const FilePath &manifestPath, MountOptions &options, bool ignoreOpenFiles) const
+	{
+		struct UserInterfaceBatchFile : public BatchFile
+		{
+			UserInterfaceBatchFile (const UserInterface &userInterface, MountOptions &options, bool ignoreOpenFiles)
+				: BatchFile (*CipherShed::Core, options, ignoreOpenFiles), UI (userInterface) { }
+
+			virtual wstring GetAbsolutePath (const wstring &path) const
+			{
+				wxFileName fileName (path);
+				fileName.Normalize (wxPATH_NORM_ABSOLUTE | wxPATH_NORM_DOTS);
+				return wstring (fileName.GetFullPath());
+			}
+
+			virtual wstring GetErrorMessage (const exception &e) const
+			{
+				return wstring (UI.ExceptionToMessage (e));
+			}
+
+			virtual void WriteLine (const wstring &line)
+			{
+				UI.ShowString (line);
+			}
+
+			const UserInterface &UI;
+		};
+
+		shared_ptr <TextReader> reader;
+		if (wstring (manifestPath) == L"-")
+			reader.reset (new TextReader (shared_ptr <Stream> (new FileStream (STDIN_FILENO))));
+		else
+			reader.reset (new TextReader (manifestPath));
+
+		UserInterfaceBatchFile batchFile (*this, options, ignoreOpenFiles);
+		batchFile.Process (*reader);
+
+		if (batchFile.GetErrorCount() > 0)
+			Application::SetExitCode (1);
+	}
+
 	bool UserInterface::ProcessCommandLine ()
 	{
 		CommandLineInterface &cmdLine = *CmdLine;
@@ -967,6 +1057,34 @@ namespace CipherShed
 			BackupVolumeHeaders (cmdLine.ArgVolumePath);
 			return true;
 
+		case CommandId::Batch:
+			cmdLine.ArgMountOptions.Password = cmdLine.ArgPassword;
+			cmdLine.ArgMountOptions.Keyfiles = cmdLine.ArgKeyfiles;
+			cmdLine.ArgMountOptions.SharedAccessAllowed = cmdLine.ArgForce;
+
+			ProcessBatchFile (*cmdLine.ArgFilePath, cmdLine.ArgMountOptions, cmdLine.ArgForce);
+			return true;
+
+		case CommandId::Benchmark:
+			{
+				BenchmarkOptions options;
+
+				if (cmdLine.ArgEncryptionAlgorithm)
+					options.Algorithms.push_back (cmdLine.ArgEncryptionAlgorithm);
+
+				if (cmdLine.ArgHash)
+					options.Prfs.push_back (Pkcs5Kdf::GetAlgorithm (*cmdLine.ArgHash));
+
+				if (cmdLine.ArgSize != 0)
+				{
+					options.BufferSizes.clear();
+					options.BufferSizes.push_back (cmdLine.ArgSize);
+				}
+
+				RunBenchmark (options, cmdLine.ArgOutputFormat);
+			}
+			return true;
+
 		case CommandId::ChangePassword:
 			ChangePassword (cmdLine.ArgVolumePath, cmdLine.ArgPassword, cmdLine.ArgKeyfiles, cmdLine.ArgNewPassword, cmdLine.ArgNewKeyfiles, cmdLine.ArgHash);
 			return true;
@@ -977,6 +1095,15 @@ namespace CipherShed
 
 		case CommandId::CreateVolume:
 			{
+				if (cmdLine.ArgCloneTemplatePath)
+				{
+					if (!cmdLine.ArgVolumePath)
+						throw MissingArgument (SRC_POS);
+
+					VolumeCreator::CloneVolume (*cmdLine.ArgCloneTemplatePath, *cmdLine.ArgVolumePath);
+					return true;
+				}
+
 				make_shared_auto (VolumeCreationOptions, options);
 
 				if (cmdLine.ArgHash)
@@ -985,6 +1112,7 @@ namespace CipherShed
 					RandomNumberGenerator::SetHash (cmdLine.ArgHash);
 				}
 				
+				options->Allocation = cmdLine.ArgAllocation;
 				options->EA = cmdLine.ArgEncryptionAlgorithm;
 				options->Filesystem = cmdLine.ArgFilesystem;
 				options->Keyfiles = cmdLine.ArgKeyfiles;
@@ -992,6 +1120,8 @@ namespace CipherShed
 				options->Quick = cmdLine.ArgQuick;
 				options->Size = cmdLine.ArgSize;
 				options->Type = cmdLine.ArgVolumeType;
+				options->WriteBufferCount = cmdLine.ArgWriteBufferCount;
+				options->WriteBufferSize = cmdLine.ArgWriteBufferSize;
 
 				if (cmdLine.ArgVolumePath)
 					options->Path = VolumePath (*cmdLine.ArgVolumePath);
@@ -1006,6 +1136,9 @@ namespace CipherShed
 
 		case CommandId::DismountVolumes:
 			DismountVolumes (cmdLine.ArgVolumes, cmdLine.ArgForce, !Preferences.NonInteractive);
+
+			if (cmdLine.ArgWipeCache)
+				Core->WipePasswordCache();
 			return true;
 
 		case CommandId::DisplayVersion:
@@ -1034,11 +1167,36 @@ namespace CipherShed
 					" Backup volume headers to a file. All required options are requested from the\n"
 					" user.\n"
 					"\n"
+					"--batch=MANIFEST_FILE\n"
+					" Mount and dismount the volumes listed in MANIFEST_FILE using a single core\n"
+					" service. If MANIFEST_FILE is -, commands are read from standard input. Each\n"
+					" line contains one of the following commands, with fields separated by tabs\n"
+					" or, if the line contains no tab, by spaces:\n"
+					"  mount VOLUME_PATH [MOUNT_DIRECTORY]\n"
+					"  dismount MOUNTED_VOLUME|all\n"
+					" Lines starting with # are ignored. Consecutive mount commands without\n"
+					" MOUNT_DIRECTORY are executed together and the headers of their volumes are\n"
+					" tried concurrently. Consecutive dismount commands are also executed together.\n"
+					" An empty line executes all pending commands. Options -k, -m, -p, --filesystem,\n"
+					" --fs-options and --protect-hidden apply to all mounted volumes. For each\n"
+					" volume, a line of tab-separated fields is written to standard output:\n"
+					"  LINE COMMAND ok|error VOLUME_PATH SLOT MOUNT_DIRECTORY|ERROR_MESSAGE\n"
+					"\n"
+					"--benchmark\n"
+					" Measure the speed of encryption algorithms in XTS, LRW and CBC modes with\n"
+					" several buffer sizes and thread counts, with and without hardware\n"
+					" acceleration, and the header key derivation speed of all PRFs. Each result\n"
+					" is the mean of repeated trials with its 95% confidence interval. Options\n"
+					" --encryption, --hash and --size restrict the benchmark to a single\n"
+					" algorithm, PRF and buffer size. See also option --output-format.\n"
+					"\n"
 					"-c, --create[=VOLUME_PATH]\n"
 					" Create a new volume. Most options are requested from the user if not specified\n"
-					" on command line. See also options --encryption, -k, --filesystem, --hash, -p,\n"
-					" --random-source, --quick, --size, --volume-type. Note that passing some of the\n"
-					" options may affect security of the volume (see option -p for more information).\n"
+					" on command line. See also options --allocation, --clone, --encryption, -k,\n"
+					" --filesystem, --hash, -p, --random-source, --quick, --size, --volume-type,\n"
+					" --write-buffer-count, --write-buffer-size.\n"
+					" Note that passing some of the options may affect security of the volume (see\n"
+					" option -p for more information).\n"
 					"\n"
 					" Inexperienced users should use the graphical user interface to create a hidden\n"
 					" volume. When using the text user interface, the following procedure must be\n"
@@ -1104,6 +1262,10 @@ namespace CipherShed
 					" Display properties of a mounted volume. See below for description of\n"
 					" MOUNTED_VOLUME.\n"
 					"\n"
+					"--wipe-cache\n"
+					" Wipe cached passwords and header keys (see mount option 'keycache'). When\n"
+					" combined with -d, the cache is wiped after the volumes have been dismounted.\n"
+					"\n"
 					"MOUNTED_VOLUME:\n"
 					" Specifies a mounted volume. One of the following forms can be used:\n"
 					" 1) Path to the encrypted CipherShed volume.\n"
@@ -1113,6 +1275,20 @@ namespace CipherShed
 					"\n"
 					"Options:\n"
 					"\n"
+					"--allocation=preallocate|sparse\n"
+					" Allocate the whole file of a new file-hosted volume before it is formatted\n"
+					" (preallocate), or let the file allocate space on demand (sparse). Sparse\n"
+					" files imply quick format. With preallocate, free space is encrypted unless\n"
+					" --quick is specified. Quick format leaves free space unencrypted and must be\n"
+					" confirmed unless --non-interactive is specified.\n"
+					"\n"
+					"--clone=TEMPLATE_VOLUME_PATH\n"
+					" Create a new file-hosted volume as a copy-on-write clone (a plain copy if\n"
+					" the filesystem does not support cloning) of TEMPLATE_VOLUME_PATH. The new\n"
+					" volume shares password, keyfiles and master keys with the template and is\n"
+					" therefore intended only for testing. An existing file is never replaced. May\n"
+					" be used only with --create.\n"
+					"\n"
 					"--display-password\n"
 					" Display password characters while typing.\n"
 					"\n"
@@ -1156,8 +1332,14 @@ namespace CipherShed
 					"-m, --mount-options=OPTION1[,OPTION2,OPTION3,...]\n"
 					" Specifies comma-separated mount options for a CipherShed volume:\n"
 					"  headerbak: Use backup headers when mounting a volume.\n"
+					"  keycache: Cache derived header keys in locked memory of the elevated service\n"
+					"   so that subsequent mounts of the volume, also after it has been dismounted,\n"
+					"   skip key derivation. At most 16 keys are kept. Cached keys expire after 15\n"
+					"   minutes and are wiped by --wipe-cache and when the application exits.\n"
 					"  nokernelcrypto: Do not use kernel cryptographic services.\n"
 					"  readonly|ro: Mount volume as read-only.\n"
+					"  sharedfuse: Serve the volume by a single FUSE process shared by all volumes\n"
+					"   mounted with this option instead of a dedicated process per volume.\n"
 					"  system: Mount partition using system encryption.\n"
 					"  timestamp|ts: Do not restore host-file modification timestamp when a volume\n"
 					"   is dismounted (note that the operating system under certain circumstances\n"
@@ -1172,6 +1354,10 @@ namespace CipherShed
 					"--new-password=PASSWORD\n"
 					" Specifies a new password. This option can only be used with command -C.\n"
 					"\n"
+					"--output-format=text|csv|json\n"
+					" Format of results written to standard output by --benchmark. Default format\n"
+					" is 'text'.\n"
+					"\n"
 					"-p, --password=PASSWORD\n"
 					" Use specified password to mount/open a volume. An empty password can also be\n"
 					" specified (-p \"\"). Note that passing a password on the command line is\n"
@@ -1200,8 +1386,9 @@ namespace CipherShed
 					" See also options -p and --protect-hidden.\n"
 					"\n"
 					"--quick\n"
-					" Do not encrypt free space when creating a device-hosted volume. This option\n"
-					" must not be used when creating an outer volume.\n"
+					" Do not encrypt free space when creating a device-hosted volume or a volume\n"
+					" with preallocated file (see --allocation). This option must not be used\n"
+					" when creating an outer volume.\n"
 					"\n"
 					"--random-source=FILE\n"
 					" Use FILE as a source of random data (e.g., when creating a volume) instead\n"
@@ -1227,6 +1414,14 @@ namespace CipherShed
 					"-v, --verbose\n"
 					" Enable verbose output.\n"
 					"\n"
+					"--write-buffer-count=COUNT\n"
+					" Use COUNT buffers when encrypting free space of a new volume. Buffers are\n"
+					" filled while previously filled buffers are being written (default: 4).\n"
+					"\n"
+					"--write-buffer-size=SIZE\n"
+					" Use buffers of SIZE bytes when encrypting free space of a new volume. SIZE\n"
+					" must be a multiple of 512 (default: 1048576).\n"
+					"\n"
 					"\n"
 					"IMPORTANT:\n"
 					"\n"
@@ -1255,6 +1450,9 @@ namespace CipherShed
 					"\n"
 					"Dismount all mounted volumes:\n"
 					"ciphershed -d\n"
+					"\n"
+					"Mount all volumes listed in a manifest file, using a single password:\n"
+					"ciphershed -t --non-interactive -p password --batch=volumes.txt\n"
 				);
 
 #ifndef TC_NO_GUI
@@ -1318,6 +1516,10 @@ namespace CipherShed
 			Test();
 			return true;
 
+		case CommandId::WipeCache:
+			Core->WipePasswordCache();
+			return true;
+
 		default:
 			throw ParameterIncorrect (SRC_POS);
 		}
@@ -1325,11 +1527,62 @@ namespace CipherShed
 		return false;
 	}
 
+	void UserInterface::RunBenchmark (const BenchmarkOptions &options, CommandOutputFormat::Enum outputFormat) const
+	{
+		EncryptionBenchmarkResultList encryptionResults = Benchmark::RunEncryption (options);
+		KdfBenchmarkResultList kdfResults = Benchmark::RunKdf (options);
+
+		switch (outputFormat)
+		{
+		case CommandOutputFormat::Csv:
+			ShowString (StringConverter::ToWide (Benchmark::ToCsv (encryptionResults, kdfResults)));
+			return;
+
+		case CommandOutputFormat::Json:
+			ShowString (StringConverter::ToWide (Benchmark::ToJson (encryptionResults, kdfResults)));
+			return;
+
+		default:
+			break;
+		}
+
+		wxString table = wxString::Format (L"%-22s %-4s %10s %7s %3s %20s %20s\n", LangString["ALGORITHM"].c_str(), L"Mode",
+			L"Buffer", L"Threads", L"HW", LangString["ENCRYPTION"].c_str(), LangString["DECRYPTION"].c_str());
+
+		foreach (const EncryptionBenchmarkResult &result, encryptionResults)
+		{
+			wxString encryption = SpeedToString ((uint64) result.EncryptionSpeed.Mean) + wxString::Format (L" +/-%2.0f%%",
+				result.EncryptionSpeed.Mean > 0 ? result.EncryptionSpeed.ConfidenceInterval * 100 / result.EncryptionSpeed.Mean : 0.0);
+
+			wxString decryption = SpeedToString ((uint64) result.DecryptionSpeed.Mean) + wxString::Format (L" +/-%2.0f%%",
+				result.DecryptionSpeed.Mean > 0 ? result.DecryptionSpeed.ConfidenceInterval * 100 / result.DecryptionSpeed.Mean : 0.0);
+
+			table += wxString::Format (L"%-22s %-4s %10s %7u %3s %20s %20s\n", result.Algorithm.c_str(), result.Mode.c_str(),
+				SizeToString (result.BufferSize).c_str(), (unsigned int) result.ThreadCount, result.HwAcceleration ? L"on" : L"off",
+				encryption.c_str(), decryption.c_str());
+		}
+
+		table += L"\n";
+		table += wxString::Format (L"%-22s %10s %20s\n", L"PRF", L"Iterations", L"Derivations/s");
+
+		foreach (const KdfBenchmarkResult &result, kdfResults)
+		{
+			table += wxString::Format (L"%-22s %10d %12.2f +/-%5.2f\n", result.Prf.c_str(), result.IterationCount,
+				result.DerivationSpeed.Mean, result.DerivationSpeed.ConfidenceInterval);
+		}
+
+		ShowString (table);
+	}
+
 	void UserInterface::SetPreferences (const UserPreferences &preferences)
 	{
 		Preferences = preferences;
 
 		Cipher::EnableHwSupport (!preferences.DefaultMountOptions.NoHardwareCrypto);
+		Core->SetElevatedServiceIdleTime (preferences.ElevatedServiceIdleTime);
+
+		if (!preferences.SaveHistory)
+			ClearVolumeOpenHints();
 
 		PreferencesUpdatedEvent.Raise();
 	}
@@ -10,6 +10,7 @@
 #define TC_HEADER_Main_UserInterface
 
 #include "System.h"
+#include "../Core/Benchmark.h"
 #include "../Core/Core.h"
 #include "Main.h"
 #include "CommandLineInterface.h"
@@ -31,6 +32,7 @@ namespace CipherShed
 		virtual void BeginBusyState () const = 0;
 		virtual void ChangePassword (shared_ptr <VolumePath> volumePath = shared_ptr <VolumePath>(), shared_ptr <VolumePassword> password = shared_ptr <VolumePassword>(), shared_ptr <KeyfileList> keyfiles = shared_ptr <KeyfileList>(), shared_ptr <VolumePassword> newPassword = shared_ptr <VolumePassword>(), shared_ptr <KeyfileList> newKeyfiles = shared_ptr <KeyfileList>(), shared_ptr <Hash> newHash = shared_ptr <Hash>()) const = 0;
 		virtual void CheckRequirementsForMountingVolume () const;
+		virtual void ClearVolumeOpenHints () const;
 		virtual void CloseExplorerWindows (shared_ptr <VolumeInfo> mountedVolume) const;
 		virtual void CreateKeyfile (shared_ptr <FilePath> keyfilePath = shared_ptr <FilePath>()) const = 0;
 		virtual void CreateVolume (shared_ptr <VolumeCreationOptions> options) const = 0;
@@ -58,6 +60,7 @@ namespace CipherShed
 		virtual VolumeInfoList MountAllFavoriteVolumes (MountOptions &options);
 		virtual void OpenExplorerWindow (const DirectoryPath &path);
 		virtual void RestoreVolumeHeaders (shared_ptr <VolumePath> volumePath) const = 0;
+		virtual void RunBenchmark (const BenchmarkOptions &options, CommandOutputFormat::Enum outputFormat) const;
 		virtual void SetPreferences (const UserPreferences &preferences);
 		virtual void ShowError (const exception &ex) const;
 		virtual void ShowError (const char *langStringId) const { DoShowError (LangString[langStringId]); }
@@ -94,6 +97,7 @@ namespace CipherShed
 		virtual void OnUnhandledException ();
 		virtual void OnVolumeMounted (EventArgs &args);
 		virtual void OnWarning (EventArgs &args);
+		virtual void ProcessBatchFile (const FilePath &manifestPath, MountOptions &options, bool ignoreOpenFiles) const;
 		virtual bool ProcessCommandLine ();
 
 		virtual wxString ExceptionToString (const Exception &ex) const;
@@ -81,6 +81,7 @@ namespace CipherShed
 			TC_CONFIG_SET (DismountOnPowerSaving);
 			TC_CONFIG_SET (DismountOnScreenSaver);
 			TC_CONFIG_SET (DisplayMessageAfterHotkeyDismount);
+			TC_CONFIG_SET (ElevatedServiceIdleTime);
 			TC_CONFIG_SET (BackgroundTaskEnabled);
 			SetValue (configMap[L"FilesystemOptions"], DefaultMountOptions.FilesystemOptions);
 			TC_CONFIG_SET (ForceAutoDismount);
@@ -181,6 +182,7 @@ namespace CipherShed
 		TC_CONFIG_ADD (DismountOnPowerSaving);
 		TC_CONFIG_ADD (DismountOnScreenSaver);
 		TC_CONFIG_ADD (DisplayMessageAfterHotkeyDismount);
+		TC_CONFIG_ADD (ElevatedServiceIdleTime);
 		TC_CONFIG_ADD (BackgroundTaskEnabled);
 		formatter.AddEntry (L"FilesystemOptions", DefaultMountOptions.FilesystemOptions);
 		TC_CONFIG_ADD (ForceAutoDismount);
@@ -33,6 +33,7 @@ namespace CipherShed
 			DismountOnPowerSaving (false),
 			DismountOnScreenSaver (false),
 			DisplayMessageAfterHotkeyDismount (false),
+			ElevatedServiceIdleTime (0),
 			ForceAutoDismount (true),
 			LastSelectedSlotNumber (0),
 			MaxVolumeIdleTime (60),
@@ -73,6 +74,7 @@ namespace CipherShed
 		bool DismountOnPowerSaving;
 		bool DismountOnScreenSaver;
 		bool DisplayMessageAfterHotkeyDismount;
+		int32 ElevatedServiceIdleTime;
 		bool ForceAutoDismount;
 		uint64 LastSelectedSlotNumber;
 		int32 MaxVolumeIdleTime;
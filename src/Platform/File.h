@@ -13,6 +13,8 @@
 using namespace std;
 #include "Buffer.h"
 #include "FilesystemPath.h"
+#include "SharedPtr.h"
+#include "Stream.h"
 #include "SystemException.h"
 
 namespace CipherShed
@@ -63,6 +65,11 @@ namespace CipherShed
 			SharedHandle = sharedHandle;
 		}
 
+#ifndef TC_WINDOWS
+		void AssignSystemHandle (SystemFileHandleType openFileHandle, shared_ptr <Stream> openState);
+#endif
+
+		static void Clone (const FilePath &sourcePath, const FilePath &destinationPath);
 		void Close ();
 		static void Copy (const FilePath &sourcePath, const FilePath &destinationPath, bool preserveTimestamps = true);
 		void Delete ();
@@ -71,15 +78,21 @@ namespace CipherShed
 		static size_t GetOptimalReadSize () { return OptimalReadSize; }
 		static size_t GetOptimalWriteSize ()  { return OptimalWriteSize; }
 		uint64 GetPartitionDeviceStartOffset () const;
+		SystemFileHandleType GetSystemHandle () const { return FileHandle; }
 		bool IsOpen () const { return FileIsOpen; }
 		FilePath GetPath () const;
 		uint64 Length () const;
 		void Open (const FilePath &path, FileOpenMode mode = OpenRead, FileShareMode shareMode = ShareReadWrite, FileOpenFlags flags = FlagsNone);
+		void Preallocate (uint64 length) const;
 		uint64 Read (const BufferPtr &buffer) const;
 		void ReadCompleteBuffer (const BufferPtr &buffer) const;
 		uint64 ReadAt (const BufferPtr &buffer, uint64 position) const;
 		void SeekAt (uint64 position) const;
 		void SeekEnd (int ofset) const;
+#ifndef TC_WINDOWS
+		void SerializeOpenState (shared_ptr <Stream> stream) const;
+#endif
+		void SetLength (uint64 length) const;
 		void Write (const ConstBufferPtr &buffer) const;
 		void Write (const ConstBufferPtr &buffer, size_t length) const { Write (buffer.GetRange (0, length)); }
 		void WriteAt (const ConstBufferPtr &buffer, uint64 position) const;
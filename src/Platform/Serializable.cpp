@@ -13,16 +13,42 @@ using namespace std;
 namespace CipherShed
 {
 	string Serializable::DeserializeHeader (shared_ptr <Stream> stream)
+	{
+		string typeName;
+		uint32 typeId;
+
+		if (DeserializeHeader (stream, typeName, typeId) == SerializationFormat::Compact)
+			return SerializerFactory::GetName (typeId);
+
+		return typeName;
+	}
+
+	SerializationFormat::Enum Serializable::DeserializeHeader (shared_ptr <Stream> stream, string &typeName, uint32 &typeId)
 	{
 		Serializer sr (stream);
-		return sr.DeserializeString ("SerializableName");
+		return sr.DeserializeHeader (typeName, typeId);
 	}
 
 	Serializable *Serializable::DeserializeNew (shared_ptr <Stream> stream)
 	{
-		string name = Serializable::DeserializeHeader (stream);
-		Serializable *serializable = SerializerFactory::GetNewSerializable (name);
-		serializable->Deserialize (stream);
+		string typeName;
+		uint32 typeId;
+		Serializable *serializable;
+
+		if (DeserializeHeader (stream, typeName, typeId) == SerializationFormat::Compact)
+			serializable = SerializerFactory::GetNewSerializable (typeId);
+		else
+			serializable = SerializerFactory::GetNewSerializable (typeName);
+
+		try
+		{
+			serializable->Deserialize (stream);
+		}
+		catch (...)
+		{
+			delete serializable;
+			throw;
+		}
 
 		return serializable;
 	}
@@ -30,11 +56,20 @@ namespace CipherShed
 	void Serializable::Serialize (shared_ptr <Stream> stream) const
 	{
 		Serializer sr (stream);
-		Serializable::SerializeHeader (sr, SerializerFactory::GetName (typeid (*this)));
+
+		if (stream->GetSerializationFormat() == SerializationFormat::Compact)
+			Serializable::SerializeHeader (sr, string(), SerializerFactory::GetTypeId (typeid (*this)));
+		else
+			Serializable::SerializeHeader (sr, SerializerFactory::GetName (typeid (*this)));
 	}
 
 	void Serializable::SerializeHeader (Serializer &serializer, const string &name)
 	{
-		serializer.Serialize ("SerializableName", name);
+		serializer.SerializeHeader (name, SerializerFactory::GetTypeId (name));
+	}
+
+	void Serializable::SerializeHeader (Serializer &serializer, const string &name, uint32 typeId)
+	{
+		serializer.SerializeHeader (name, typeId);
 	}
 }
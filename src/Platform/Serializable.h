@@ -26,6 +26,7 @@ namespace CipherShed
 
 		virtual void Deserialize (shared_ptr <Stream> stream) = 0;
 		static string DeserializeHeader (shared_ptr <Stream> stream);
+		static SerializationFormat::Enum DeserializeHeader (shared_ptr <Stream> stream, string &typeName, uint32 &typeId);
 		static Serializable *DeserializeNew (shared_ptr <Stream> stream);
 		
 		template <class T> 
@@ -40,7 +41,16 @@ namespace CipherShed
 		template <class T> 
 		static void DeserializeList (shared_ptr <Stream> stream, list < shared_ptr <T> > &dataList)
 		{
-			if (DeserializeHeader (stream) != string ("list<") + SerializerFactory::GetName (typeid (T)) + ">")
+			string listName = string ("list<") + SerializerFactory::GetName (typeid (T)) + ">";
+			string typeName;
+			uint32 typeId;
+
+			if (DeserializeHeader (stream, typeName, typeId) == SerializationFormat::Compact)
+			{
+				if (typeId != SerializerFactory::GetTypeId (listName))
+					throw std::runtime_error (SRC_POS);
+			}
+			else if (typeName != listName)
 				throw std::runtime_error (SRC_POS);
 
 			Serializer sr (stream);
@@ -62,7 +72,8 @@ namespace CipherShed
 		static void SerializeList (shared_ptr <Stream> stream, const list < shared_ptr <T> > &dataList)
 		{
 			Serializer sr (stream);
-			SerializeHeader (sr, string ("list<") + SerializerFactory::GetName (typeid (T)) + ">");
+			string listName = string ("list<") + SerializerFactory::GetName (typeid (T)) + ">";
+			SerializeHeader (sr, listName, SerializerFactory::GetTypeId (listName));
 
 			sr.Serialize ("ListSize", (uint64) dataList.size());
 			foreach_ref (const T &item, dataList)
@@ -70,6 +81,7 @@ namespace CipherShed
 		}
 
 		static void SerializeHeader (Serializer &serializer, const string &name);
+		static void SerializeHeader (Serializer &serializer, const string &name, uint32 typeId);
 
 	protected:
 		Serializable () { }
@@ -17,11 +17,14 @@ namespace CipherShed
 	template <typename T>
 	T Serializer::Deserialize ()
 	{
-		uint64 size;
-		DataStream->ReadCompleteBuffer (BufferPtr ((byte *) &size, sizeof (size)));
-		
-		if (Endian::Big (size) != sizeof (T))
-			throw ParameterIncorrect (SRC_POS);
+		if (Format == SerializationFormat::Named)
+		{
+			uint64 size;
+			DataStream->ReadCompleteBuffer (BufferPtr ((byte *) &size, sizeof (size)));
+			
+			if (Endian::Big (size) != sizeof (T))
+				throw ParameterIncorrect (SRC_POS);
+		}
 
 		T data;
 		DataStream->ReadCompleteBuffer (BufferPtr ((byte *) &data, sizeof (data)));
@@ -81,7 +84,7 @@ namespace CipherShed
 	{
 		ValidateName (name);
 
-		uint64 size = Deserialize <uint64> ();
+		uint64 size = DeserializeSize ();
 		if (data.Size() != size)
 			throw ParameterIncorrect (SRC_POS);
 
@@ -95,6 +98,54 @@ namespace CipherShed
 		return data;
 	}
 
+	SerializationFormat::Enum Serializer::DeserializeHeader (string &typeName, uint32 &typeId)
+	{
+		// Compact headers start with a marker byte which never begins the size prefix of a named header
+		byte header[sizeof (uint64)];
+		DataStream->ReadCompleteBuffer (BufferPtr (header, sizeof (header)));
+
+		if (header[0] == CompactHeaderMarker)
+		{
+			if (header[1] != CompactFormatVersion)
+				throw ParameterIncorrect (SRC_POS);
+
+			Format = SerializationFormat::Compact;
+			typeName.clear();
+			Memory::Copy (&typeId, header + 4, sizeof (typeId));
+			typeId = Endian::Big (typeId);
+		}
+		else
+		{
+			uint64 size;
+			Memory::Copy (&size, header, sizeof (size));
+
+			if (Endian::Big (size) != sizeof (uint64))
+				throw ParameterIncorrect (SRC_POS);
+
+			Format = SerializationFormat::Named;
+
+			uint64 nameSize;
+			DataStream->ReadCompleteBuffer (BufferPtr ((byte *) &nameSize, sizeof (nameSize)));
+			nameSize = Endian::Big (nameSize);
+
+			string headerName = "SerializableName";
+			if (nameSize != headerName.size() + 1)
+				throw ParameterIncorrect (SRC_POS);
+
+			vector <char> name ((size_t) nameSize);
+			DataStream->ReadCompleteBuffer (BufferPtr ((byte *) &name[0], (size_t) nameSize));
+
+			if (string (&name[0]) != headerName)
+				throw ParameterIncorrect (SRC_POS);
+
+			typeName = DeserializeString();
+			typeId = 0;
+		}
+
+		DataStream->SetSerializationFormat (Format);
+		return Format;
+	}
+
 	int32 Serializer::DeserializeInt32 (const string &name)
 	{
 		ValidateName (name);
@@ -119,8 +170,28 @@ namespace CipherShed
 		return Deserialize <uint64> ();
 	}
 
+	uint64 Serializer::DeserializeSize ()
+	{
+		if (Format == SerializationFormat::Compact)
+			return Deserialize <uint32> ();
+
+		return Deserialize <uint64> ();
+	}
+
 	string Serializer::DeserializeString ()
 	{
+		if (Format == SerializationFormat::Compact)
+		{
+			uint64 size = DeserializeSize ();
+			if (size == 0)
+				return string();
+
+			vector <char> data ((size_t) size);
+			DataStream->ReadCompleteBuffer (BufferPtr ((byte *) &data[0], (size_t) size));
+
+			return string (&data[0], (size_t) size);
+		}
+
 		uint64 size = Deserialize <uint64> ();
 
 		vector <char> data ((size_t) size);
@@ -139,7 +210,7 @@ namespace CipherShed
 	{
 		ValidateName (name);
 		list <string> deserializedList;
-		uint64 listSize = Deserialize <uint64> ();
+		uint64 listSize = DeserializeSize ();
 
 		for (size_t i = 0; i < listSize; i++)
 			deserializedList.push_back (DeserializeString ());
@@ -149,6 +220,18 @@ namespace CipherShed
 
 	wstring Serializer::DeserializeWString ()
 	{
+		if (Format == SerializationFormat::Compact)
+		{
+			uint64 length = DeserializeSize ();
+			if (length == 0)
+				return wstring();
+
+			vector <wchar_t> data ((size_t) length);
+			DataStream->ReadCompleteBuffer (BufferPtr ((byte *) &data[0], (size_t) length * sizeof (wchar_t)));
+
+			return wstring (&data[0], (size_t) length);
+		}
+
 		uint64 size = Deserialize <uint64> ();
 
 		vector <wchar_t> data ((size_t) size / sizeof (wchar_t));
@@ -161,7 +244,7 @@ namespace CipherShed
 	{
 		ValidateName (name);
 		list <wstring> deserializedList;
-		uint64 listSize = Deserialize <uint64> ();
+		uint64 listSize = DeserializeSize ();
 
 		for (size_t i = 0; i < listSize; i++)
 			deserializedList.push_back (DeserializeWString ());
@@ -178,8 +261,11 @@ namespace CipherShed
 	template <typename T>
 	void Serializer::Serialize (T data)
 	{
-		uint64 size = Endian::Big (uint64 (sizeof (data)));
-		DataStream->Write (ConstBufferPtr ((byte *) &size, sizeof (size)));
+		if (Format == SerializationFormat::Named)
+		{
+			uint64 size = Endian::Big (uint64 (sizeof (data)));
+			DataStream->Write (ConstBufferPtr ((byte *) &size, sizeof (size)));
+		}
 
 		data = Endian::Big (data);
 		DataStream->Write (ConstBufferPtr ((byte *) &data, sizeof (data)));
@@ -187,14 +273,14 @@ namespace CipherShed
 
 	void Serializer::Serialize (const string &name, bool data)
 	{
-		SerializeString (name);
+		SerializeName (name);
 		byte d = data ? 1 : 0;
 		Serialize (d);
 	}
 
 	void Serializer::Serialize (const string &name, byte data)
 	{
-		SerializeString (name);
+		SerializeName (name);
 		Serialize (data);
 	}
 	
@@ -205,31 +291,31 @@ namespace CipherShed
 	
 	void Serializer::Serialize (const string &name, int32 data)
 	{
-		SerializeString (name);
+		SerializeName (name);
 		Serialize ((uint32) data);
 	}
 		
 	void Serializer::Serialize (const string &name, int64 data)
 	{
-		SerializeString (name);
+		SerializeName (name);
 		Serialize ((uint64) data);
 	}
 
 	void Serializer::Serialize (const string &name, uint32 data)
 	{
-		SerializeString (name);
+		SerializeName (name);
 		Serialize (data);
 	}
 
 	void Serializer::Serialize (const string &name, uint64 data)
 	{
-		SerializeString (name);
+		SerializeName (name);
 		Serialize (data);
 	}
 
 	void Serializer::Serialize (const string &name, const string &data)
 	{
-		SerializeString (name);
+		SerializeName (name);
 		SerializeString (data);
 	}
 
@@ -240,16 +326,15 @@ namespace CipherShed
 
 	void Serializer::Serialize (const string &name, const wstring &data)
 	{
-		SerializeString (name);
+		SerializeName (name);
 		SerializeWString (data);
 	}
 	
 	void Serializer::Serialize (const string &name, const list <string> &stringList)
 	{
-		SerializeString (name);
+		SerializeName (name);
 		
-		uint64 listSize = stringList.size();
-		Serialize (listSize);
+		SerializeSize (stringList.size());
 
 		foreach (const string &item, stringList)
 			SerializeString (item);
@@ -257,10 +342,9 @@ namespace CipherShed
 
 	void Serializer::Serialize (const string &name, const list <wstring> &stringList)
 	{
-		SerializeString (name);
+		SerializeName (name);
 		
-		uint64 listSize = stringList.size();
-		Serialize (listSize);
+		SerializeSize (stringList.size());
 
 		foreach (const wstring &item, stringList)
 			SerializeWString (item);
@@ -268,29 +352,97 @@ namespace CipherShed
 
 	void Serializer::Serialize (const string &name, const ConstBufferPtr &data)
 	{
-		SerializeString (name);
+		SerializeName (name);
 
-		uint64 size = data.Size();
-		Serialize (size);
+		SerializeSize (data.Size());
 
 		DataStream->Write (data);
 	}
 
+	void Serializer::SerializeHeader (const string &typeName, uint32 typeId)
+	{
+		if (Format == SerializationFormat::Compact)
+		{
+			byte header[sizeof (uint64)] = { CompactHeaderMarker, CompactFormatVersion, 0, 0 };
+			uint32 bigEndianTypeId = Endian::Big (typeId);
+			Memory::Copy (header + 4, &bigEndianTypeId, sizeof (bigEndianTypeId));
+
+			DataStream->Write (ConstBufferPtr (header, sizeof (header)));
+		}
+		else
+			Serialize ("SerializableName", typeName);
+	}
+
+	void Serializer::SerializeName (const string &name)
+	{
+		if (Format == SerializationFormat::Compact)
+			Serialize (GetTag (name));
+		else
+			SerializeString (name);
+	}
+
+	void Serializer::SerializeSize (uint64 size)
+	{
+		if (Format == SerializationFormat::Compact)
+		{
+			if (size > 0xffffFFFFULL)
+				throw ParameterIncorrect (SRC_POS);
+
+			Serialize ((uint32) size);
+		}
+		else
+			Serialize (size);
+	}
+
+
 	void Serializer::SerializeString (const string &data)
 	{
+		if (Format == SerializationFormat::Compact)
+		{
+			SerializeSize (data.size());
+			DataStream->Write (ConstBufferPtr ((const byte *) data.data(), data.size()));
+			return;
+		}
+
 		Serialize ((uint64) data.size() + 1);
 		DataStream->Write (ConstBufferPtr ((byte *) (data.data() ? data.data() : data.c_str()), data.size() + 1));
 	}
 
 	void Serializer::SerializeWString (const wstring &data)
 	{
+		if (Format == SerializationFormat::Compact)
+		{
+			SerializeSize (data.size());
+			DataStream->Write (ConstBufferPtr ((const byte *) data.data(), data.size() * sizeof (wchar_t)));
+			return;
+		}
+
 		uint64 size = (data.size() + 1) * sizeof (wchar_t);
 		Serialize (size);
 		DataStream->Write (ConstBufferPtr ((byte *) (data.data() ? data.data() : data.c_str()), (size_t) size));
 	}
 
+	uint32 Serializer::GetTag (const string &name)
+	{
+		// FNV-1a
+		uint32 tag = 2166136261U;
+		foreach (char c, name)
+		{
+			tag ^= (byte) c;
+			tag *= 16777619U;
+		}
+		return tag;
+	}
+
 	void Serializer::ValidateName (const string &name)
 	{
+		if (Format == SerializationFormat::Compact)
+		{
+			if (Deserialize <uint32> () != GetTag (name))
+				throw ParameterIncorrect (SRC_POS);
+			return;
+		}
+
 		string dName = DeserializeString();
 		if (dName != name)
 		{
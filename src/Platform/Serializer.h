@@ -20,7 +20,7 @@ namespace CipherShed
 	class Serializer
 	{
 	public:
-		Serializer (shared_ptr <Stream> stream) : DataStream (stream) { }
+		Serializer (shared_ptr <Stream> stream) : DataStream (stream), Format (stream->GetSerializationFormat()) { }
 		virtual ~Serializer () { }
 
 		void Deserialize (const string &name, bool &data);
@@ -33,6 +33,7 @@ namespace CipherShed
 		void Deserialize (const string &name, wstring &data);
 		void Deserialize (const string &name, const BufferPtr &data);
 		bool DeserializeBool (const string &name);
+		SerializationFormat::Enum DeserializeHeader (string &typeName, uint32 &typeId);
 		int32 DeserializeInt32 (const string &name);
 		int64 DeserializeInt64 (const string &name);
 		uint32 DeserializeUInt32 (const string &name);
@@ -54,17 +55,27 @@ namespace CipherShed
 		void Serialize (const string &name, const list <string> &stringList);
 		void Serialize (const string &name, const list <wstring> &stringList);
 		void Serialize (const string &name, const ConstBufferPtr &data);
+		void SerializeHeader (const string &typeName, uint32 typeId);
+
+		static uint32 GetTag (const string &name);
+
+		static const byte CompactHeaderMarker = 0xc5;
+		static const byte CompactFormatVersion = 1;
 
 	protected:
 		template <typename T> T Deserialize ();
+		uint64 DeserializeSize ();
 		string DeserializeString ();
 		wstring DeserializeWString ();
 		template <typename T> void Serialize (T data);
+		void SerializeName (const string &name);
+		void SerializeSize (uint64 size);
 		void SerializeString (const string &data);
 		void SerializeWString (const wstring &data);
 		void ValidateName (const string &name);
 
 		shared_ptr <Stream> DataStream;
+		SerializationFormat::Enum Format;
 
 	private:
 		Serializer (const Serializer &);
@@ -7,6 +7,7 @@
 */
 
 #include <stdexcept>
+#include "Serializer.h"
 #include "SerializerFactory.h"
 using namespace std;
 
@@ -18,16 +19,32 @@ namespace CipherShed
 		{
 			delete NameToTypeMap;
 			delete TypeToNameMap;
+			delete IdToTypeMap;
+			delete RawTypeToTypeMap;
 		}
 	}
 
+	const SerializerFactory::MapEntry &SerializerFactory::GetEntry (const type_info &typeInfo)
+	{
+		map <string, MapEntry>::const_iterator entry = RawTypeToTypeMap->find (GetRawTypeName (typeInfo));
+		if (entry == RawTypeToTypeMap->end())
+			throw std::runtime_error (SRC_POS);
+
+		return entry->second;
+	}
+
 	string SerializerFactory::GetName (const type_info &typeInfo)
 	{
-		string typeName = StringConverter::GetTypeName (typeInfo);
-		if (TypeToNameMap->find (typeName) == TypeToNameMap->end())
+		return GetEntry (typeInfo).Name;
+	}
+
+	string SerializerFactory::GetName (uint32 typeId)
+	{
+		map <uint32, MapEntry>::const_iterator entry = IdToTypeMap->find (typeId);
+		if (entry == IdToTypeMap->end())
 			throw std::runtime_error (SRC_POS);
 
-		return (*TypeToNameMap)[typeName];
+		return entry->second.Name;
 	}
 
 	Serializable *SerializerFactory::GetNewSerializable (const string &typeName)
@@ -38,18 +55,66 @@ namespace CipherShed
 		return (*NameToTypeMap)[typeName].GetNewPtr();
 	}
 
+	Serializable *SerializerFactory::GetNewSerializable (uint32 typeId)
+	{
+		map <uint32, MapEntry>::const_iterator entry = IdToTypeMap->find (typeId);
+		if (entry == IdToTypeMap->end())
+			throw std::runtime_error (SRC_POS);
+
+		return entry->second.GetNewPtr();
+	}
+
+	string SerializerFactory::GetRawTypeName (const type_info &typeInfo)
+	{
+#ifdef _MSC_VER
+		return typeInfo.raw_name();
+#else
+		return typeInfo.name();
+#endif
+	}
+
+	uint32 SerializerFactory::GetTypeId (const string &typeName)
+	{
+		return Serializer::GetTag (typeName);
+	}
+
+	uint32 SerializerFactory::GetTypeId (const type_info &typeInfo)
+	{
+		return GetEntry (typeInfo).TypeId;
+	}
+
 	void SerializerFactory::Initialize ()
 	{
 		if (UseCount == 0)
 		{
 			NameToTypeMap = new map <string, SerializerFactory::MapEntry>;
 			TypeToNameMap = new map <string, string>;
+			IdToTypeMap = new map <uint32, SerializerFactory::MapEntry>;
+			RawTypeToTypeMap = new map <string, SerializerFactory::MapEntry>;
 		}
 
 		++UseCount;
 	}
 
+	void SerializerFactory::Register (const string &name, const type_info &typeInfo, Serializable* (*getNewPtr) ())
+	{
+		MapEntry entry (StringConverter::GetTypeName (typeInfo), getNewPtr);
+		entry.Name = name;
+		entry.TypeId = GetTypeId (name);
+
+		map <uint32, MapEntry>::const_iterator idEntry = IdToTypeMap->find (entry.TypeId);
+		if (idEntry != IdToTypeMap->end() && idEntry->second.Name != name)
+			throw std::runtime_error (SRC_POS);
+
+		(*NameToTypeMap)[name] = entry;
+		(*TypeToNameMap)[entry.TypeName] = name;
+		(*IdToTypeMap)[entry.TypeId] = entry;
+		(*RawTypeToTypeMap)[GetRawTypeName (typeInfo)] = entry;
+	}
+
 	map <string, SerializerFactory::MapEntry> *SerializerFactory::NameToTypeMap;
 	map <string, string> *SerializerFactory::TypeToNameMap;
+	map <uint32, SerializerFactory::MapEntry> *SerializerFactory::IdToTypeMap;
+	map <string, SerializerFactory::MapEntry> *SerializerFactory::RawTypeToTypeMap;
 	int SerializerFactory::UseCount;
 }
@@ -27,8 +27,13 @@ namespace CipherShed
 
 		static void Deinitialize ();
 		static string GetName (const type_info &typeInfo);
+		static string GetName (uint32 typeId);
 		static Serializable *GetNewSerializable (const string &typeName);
+		static Serializable *GetNewSerializable (uint32 typeId);
+		static uint32 GetTypeId (const string &typeName);
+		static uint32 GetTypeId (const type_info &typeInfo);
 		static void Initialize ();
+		static void Register (const string &name, const type_info &typeInfo, Serializable* (*getNewPtr) ());
 
 		struct MapEntry
 		{
@@ -38,11 +43,15 @@ namespace CipherShed
 
 			MapEntry &operator= (const MapEntry &right)
 			{
+				Name = right.Name;
+				TypeId = right.TypeId;
 				TypeName = right.TypeName;
 				GetNewPtr = right.GetNewPtr;
 				return *this;
 			}
 
+			string Name;
+			uint32 TypeId;
 			string TypeName;
 			Serializable* (*GetNewPtr) ();
 		};
@@ -53,6 +62,12 @@ namespace CipherShed
 	protected:
 		SerializerFactory ();
 
+		static const MapEntry &GetEntry (const type_info &typeInfo);
+		static string GetRawTypeName (const type_info &typeInfo);
+
+		// Type IDs and raw type names are resolved at registration so that (de)serialization does not demangle names
+		static std::map <uint32, MapEntry> *IdToTypeMap;
+		static std::map <string, MapEntry> *RawTypeToTypeMap;
 		static int UseCount;
 	};
 
@@ -89,8 +104,7 @@ namespace CipherShed
 	static TYPE##SerializerFactoryInitializer TYPE##SerializerFactoryInitializerInst
 
 #define TC_SERIALIZER_FACTORY_ADD(TYPE) \
-	(*SerializerFactory::NameToTypeMap)[#TYPE] = SerializerFactory::MapEntry (StringConverter::GetTypeName (typeid (TYPE)), &TYPE::GetNewSerializable); \
-	(*SerializerFactory::TypeToNameMap)[StringConverter::GetTypeName (typeid (TYPE))] = #TYPE
+	SerializerFactory::Register (#TYPE, typeid (TYPE), &TYPE::GetNewSerializable)
 
 
 #endif // TC_HEADER_Platform_SerializerFactory
@@ -15,16 +15,29 @@ using namespace std;
 
 namespace CipherShed
 {
+	struct SerializationFormat
+	{
+		enum Enum
+		{
+			Named,		// Fields and types are identified by their names
+			Compact		// Fields and types are identified by integer tags
+		};
+	};
+
 	class Stream
 	{
 	public:
 		virtual ~Stream () { }
+		SerializationFormat::Enum GetSerializationFormat () const { return Format; }
 		virtual uint64 Read (const BufferPtr &buffer) = 0;
 		virtual void ReadCompleteBuffer (const BufferPtr &buffer) = 0;
+		void SetSerializationFormat (SerializationFormat::Enum format) { Format = format; }
 		virtual void Write (const ConstBufferPtr &data) = 0;
 
 	protected:
-		Stream () { };
+		Stream () : Format (SerializationFormat::Named) { };
+
+		SerializationFormat::Enum Format;
 
 	private:
 		Stream (const Stream &);
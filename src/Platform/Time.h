@@ -21,6 +21,7 @@ namespace CipherShed
 		virtual ~Time () { }
 
 		static uint64 GetCurrent (); // Returns time in hundreds of nanoseconds since 1601/01/01
+		static uint64 GetMonotonicNanoseconds (); // Returns nanoseconds since an unspecified point in time, unaffected by system time changes
 
 	private:
 		Time (const Time &);
@@ -12,7 +12,12 @@
 #include <utime.h>
 
 #ifdef TC_LINUX
+#include <sys/ioctl.h>
 #include <sys/mount.h>
+
+#ifndef FICLONE
+#	define FICLONE _IOW (0x94, 9, int)
+#endif
 #endif
 
 #ifdef TC_BSD
@@ -29,6 +34,7 @@
 #include <sys/stat.h>
 
 #include "../File.h"
+#include "../Serializer.h"
 #include "../TextReader.h"
 
 namespace CipherShed
@@ -48,6 +54,63 @@ namespace CipherShed
 	}
 #endif
 
+	void File::AssignSystemHandle (SystemFileHandleType openFileHandle, shared_ptr <Stream> openState)
+	{
+		// The file has been opened by another process, which passed its descriptor
+		AssignSystemHandle (openFileHandle, false);
+
+		Serializer sr (openState);
+		Path = sr.DeserializeWString ("Path");
+
+		uint32 flags;
+		sr.Deserialize ("Flags", flags);
+		mFileOpenFlags = static_cast <FileOpenFlags> (flags);
+
+		uint64 accTime, modTime;
+		sr.Deserialize ("AccTime", accTime);
+		sr.Deserialize ("ModTime", modTime);
+		AccTime = static_cast <time_t> (accTime);
+		ModTime = static_cast <time_t> (modTime);
+	}
+
+	void File::Clone (const FilePath &sourcePath, const FilePath &destinationPath)
+	{
+		File source;
+		source.Open (sourcePath);
+
+		// An existing file is never replaced by the clone
+		int destinationHandle = open (string (destinationPath).c_str(), O_CREAT | O_EXCL | O_WRONLY, S_IRUSR | S_IWUSR);
+		throw_sys_sub_if (destinationHandle == -1, wstring (destinationPath));
+		close (destinationHandle);
+
+		try
+		{
+#ifdef TC_LINUX
+			{
+				File destination;
+				destination.Open (destinationPath, OpenWrite);
+
+				// Destination shares data extents with the source until either of them is modified
+				if (ioctl (destination.FileHandle, FICLONE, source.FileHandle) != -1)
+					return;
+
+				// Filesystems without reflink support and clones across filesystems fall back to copying
+				throw_sys_sub_if (errno != EOPNOTSUPP && errno != EXDEV && errno != EINVAL && errno != ENOTTY, wstring (destinationPath));
+			}
+#endif
+			Copy (sourcePath, destinationPath, false);
+		}
+		catch (...)
+		{
+			try
+			{
+				destinationPath.Delete();
+			}
+			catch (...) { }
+			throw;
+		}
+	}
+
 	void File::Close ()
 	{
 		if_debug (ValidateState());
@@ -281,6 +344,34 @@ namespace CipherShed
 		FileIsOpen = true;
 	}
 
+	void File::Preallocate (uint64 length) const
+	{
+		if_debug (ValidateState());
+
+#ifdef TC_MACOSX
+		fstore_t store;
+		Memory::Zero (&store, sizeof (store));
+		store.fst_flags = F_ALLOCATECONTIG | F_ALLOCATEALL;
+		store.fst_posmode = F_PEOFPOSMODE;
+		store.fst_length = length;
+
+		if (fcntl (FileHandle, F_PREALLOCATE, &store) == -1)
+		{
+			store.fst_flags = F_ALLOCATEALL;
+			throw_sys_sub_if (fcntl (FileHandle, F_PREALLOCATE, &store) == -1, wstring (Path));
+		}
+
+		SetLength (length);
+#else
+		int status = posix_fallocate (FileHandle, 0, length);
+		if (status != 0)
+		{
+			errno = status;
+			throw SystemException (SRC_POS, wstring (Path));
+		}
+#endif
+	}
+
 	uint64 File::Read (const BufferPtr &buffer) const
 	{
 		if_debug (ValidateState());
@@ -329,6 +420,24 @@ namespace CipherShed
 		throw_sys_sub_if (lseek (FileHandle, offset, SEEK_END) == -1, wstring (Path));
 	}
 
+	void File::SerializeOpenState (shared_ptr <Stream> stream) const
+	{
+		if_debug (ValidateState());
+
+		// Timestamps recorded when the file was opened are restored by the process which closes it
+		Serializer sr (stream);
+		sr.Serialize ("Path", wstring (Path));
+		sr.Serialize ("Flags", static_cast <uint32> (mFileOpenFlags));
+		sr.Serialize ("AccTime", static_cast <uint64> (AccTime));
+		sr.Serialize ("ModTime", static_cast <uint64> (ModTime));
+	}
+
+	void File::SetLength (uint64 length) const
+	{
+		if_debug (ValidateState());
+		throw_sys_sub_if (ftruncate (FileHandle, length) == -1, wstring (Path));
+	}
+
 	void File::Write (const ConstBufferPtr &buffer) const
 	{
 		if_debug (ValidateState());
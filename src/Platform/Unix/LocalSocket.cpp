@@ -0,0 +1,274 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sstream>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include "LocalSocket.h"
+#include "../Memory.h"
+#include "../SystemException.h"
+
+namespace CipherShed
+{
+	LocalSocket::~LocalSocket ()
+	{
+		try
+		{
+			Close();
+		}
+		catch (...) { }
+	}
+
+	shared_ptr <LocalSocket> LocalSocket::Accept () const
+	{
+		int clientSocket;
+		do
+		{
+			clientSocket = accept (SocketFD, nullptr, nullptr);
+		} while (clientSocket == -1 && errno == EINTR);
+
+		throw_sys_if (clientSocket == -1);
+		fcntl (clientSocket, F_SETFD, FD_CLOEXEC);
+
+		return shared_ptr <LocalSocket> (new LocalSocket (clientSocket));
+	}
+
+	void LocalSocket::Close ()
+	{
+		if (SocketFD != -1)
+		{
+			close (SocketFD);
+			SocketFD = -1;
+		}
+	}
+
+	shared_ptr <LocalSocket> LocalSocket::Connect (const string &name, uid_t serviceUserId)
+	{
+		string path = GetPath (name, serviceUserId);
+
+		struct sockaddr_un address;
+		Memory::Zero (&address, sizeof (address));
+		address.sun_family = AF_UNIX;
+
+		if (path.size() >= sizeof (address.sun_path))
+			throw ParameterTooLarge (SRC_POS);
+
+		strcpy (address.sun_path, path.c_str());
+
+		int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+		throw_sys_if (fd == -1);
+		fcntl (fd, F_SETFD, FD_CLOEXEC);
+
+		shared_ptr <LocalSocket> localSocket (new LocalSocket (fd));
+
+		// The service is not running
+		if (connect (fd, (struct sockaddr *) &address, sizeof (address)) == -1)
+			return shared_ptr <LocalSocket> ();
+
+		// Passwords and keys must never be sent to a service started by another user
+		if (localSocket->GetPeerUserId() != serviceUserId)
+			return shared_ptr <LocalSocket> ();
+
+		return localSocket;
+	}
+
+	string LocalSocket::GetPath (const string &name, uid_t serviceUserId)
+	{
+		return GetRuntimeDirectory (serviceUserId) + "/" + name;
+	}
+
+	uid_t LocalSocket::GetPeerUserId () const
+	{
+#ifdef TC_LINUX
+		struct ucred credentials;
+		socklen_t credentialsSize = sizeof (credentials);
+
+		throw_sys_if (getsockopt (SocketFD, SOL_SOCKET, SO_PEERCRED, &credentials, &credentialsSize) == -1);
+		return credentials.uid;
+#else
+		uid_t peerUserId;
+		gid_t peerGroupId;
+
+		throw_sys_if (getpeereid (SocketFD, &peerUserId, &peerGroupId) == -1);
+		return peerUserId;
+#endif
+	}
+
+	string LocalSocket::GetRuntimeDirectory (uid_t userId)
+	{
+		stringstream path;
+		path << "/tmp/.ciphershed-" << userId;
+		return path.str();
+	}
+
+	shared_ptr <LocalSocket> LocalSocket::Listen (const string &name, uid_t clientUserId)
+	{
+		// Sockets of services which accept clients of other users are accessible to all users.
+		// Such clients are authenticated by the user ID of the connected peer.
+		bool sharedWithOtherUsers = (clientUserId != geteuid());
+		string path = PrepareRuntimeDirectory (sharedWithOtherUsers) + "/" + name;
+
+		struct sockaddr_un address;
+		Memory::Zero (&address, sizeof (address));
+		address.sun_family = AF_UNIX;
+
+		if (path.size() >= sizeof (address.sun_path))
+			throw ParameterTooLarge (SRC_POS);
+
+		strcpy (address.sun_path, path.c_str());
+
+		// A socket of a running service is never replaced
+		shared_ptr <LocalSocket> runningService = Connect (name, geteuid());
+		if (runningService)
+			return shared_ptr <LocalSocket> ();
+
+		if (unlink (path.c_str()) == -1)
+			throw_sys_sub_if (errno != ENOENT, path);
+
+		int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+		throw_sys_if (fd == -1);
+		fcntl (fd, F_SETFD, FD_CLOEXEC);
+
+		shared_ptr <LocalSocket> localSocket (new LocalSocket (fd));
+
+		// The access mode of the socket is set before the socket becomes visible
+		mode_t oldMask = umask (sharedWithOtherUsers ? (S_IXUSR | S_IXGRP | S_IXOTH) : (S_IXUSR | S_IRWXG | S_IRWXO));
+		int bindResult = bind (fd, (struct sockaddr *) &address, sizeof (address));
+		umask (oldMask);
+
+		// Another instance of the service may have been started concurrently
+		if (bindResult == -1 && errno == EADDRINUSE)
+			return shared_ptr <LocalSocket> ();
+
+		throw_sys_sub_if (bindResult == -1, path);
+		throw_sys_if (listen (fd, SOMAXCONN) == -1);
+
+		return localSocket;
+	}
+
+	string LocalSocket::PrepareRuntimeDirectory (bool sharedWithOtherUsers)
+	{
+		string path = GetRuntimeDirectory (geteuid());
+
+		mode_t oldMask = umask (S_IRWXG | S_IRWXO);
+		int mkdirResult = mkdir (path.c_str(), S_IRWXU);
+		umask (oldMask);
+
+		throw_sys_sub_if (mkdirResult == -1 && errno != EEXIST, path);
+
+		// The directory may have been created by another user in order to intercept connections
+		struct stat statData;
+		throw_sys_sub_if (lstat (path.c_str(), &statData) == -1, path);
+
+		if (!S_ISDIR (statData.st_mode)
+			|| statData.st_uid != geteuid()
+			|| (statData.st_mode & (S_IRWXG | S_IRWXO) & ~(S_IXGRP | S_IXOTH)) != 0)
+		{
+			errno = EPERM;
+			throw SystemException (SRC_POS, path);
+		}
+
+		// Other users may only traverse the directory to reach sockets intended for them
+		if (sharedWithOtherUsers && (statData.st_mode & (S_IXGRP | S_IXOTH)) != (S_IXGRP | S_IXOTH))
+			throw_sys_sub_if (chmod (path.c_str(), S_IRWXU | S_IXGRP | S_IXOTH) == -1, path);
+
+		return path;
+	}
+
+	int LocalSocket::ReceiveFileDescriptor () const
+	{
+		byte data;
+		struct iovec dataVector;
+		dataVector.iov_base = &data;
+		dataVector.iov_len = sizeof (data);
+
+		union
+		{
+			struct cmsghdr Header;
+			byte Data[CMSG_SPACE (sizeof (int))];
+		} control;
+
+		struct msghdr message;
+		Memory::Zero (&message, sizeof (message));
+		message.msg_iov = &dataVector;
+		message.msg_iovlen = 1;
+		message.msg_control = control.Data;
+		message.msg_controllen = sizeof (control.Data);
+
+		ssize_t received;
+		do
+		{
+			received = recvmsg (SocketFD, &message, 0);
+		} while (received == -1 && errno == EINTR);
+
+		throw_sys_if (received == -1);
+
+		struct cmsghdr *controlHeader = CMSG_FIRSTHDR (&message);
+		if (received != sizeof (data)
+			|| !controlHeader
+			|| controlHeader->cmsg_level != SOL_SOCKET
+			|| controlHeader->cmsg_type != SCM_RIGHTS
+			|| controlHeader->cmsg_len != CMSG_LEN (sizeof (int)))
+		{
+			throw ParameterIncorrect (SRC_POS);
+		}
+
+		int fd;
+		Memory::Copy (&fd, CMSG_DATA (controlHeader), sizeof (fd));
+		fcntl (fd, F_SETFD, FD_CLOEXEC);
+
+		return fd;
+	}
+
+	void LocalSocket::SendFileDescriptor (int fd) const
+	{
+		byte data = 0;
+		struct iovec dataVector;
+		dataVector.iov_base = &data;
+		dataVector.iov_len = sizeof (data);
+
+		union
+		{
+			struct cmsghdr Header;
+			byte Data[CMSG_SPACE (sizeof (int))];
+		} control;
+		Memory::Zero (&control, sizeof (control));
+
+		struct msghdr message;
+		Memory::Zero (&message, sizeof (message));
+		message.msg_iov = &dataVector;
+		message.msg_iovlen = 1;
+		message.msg_control = control.Data;
+		message.msg_controllen = sizeof (control.Data);
+
+		struct cmsghdr *controlHeader = CMSG_FIRSTHDR (&message);
+		controlHeader->cmsg_level = SOL_SOCKET;
+		controlHeader->cmsg_type = SCM_RIGHTS;
+		controlHeader->cmsg_len = CMSG_LEN (sizeof (int));
+		Memory::Copy (CMSG_DATA (controlHeader), &fd, sizeof (fd));
+
+		ssize_t sent;
+		do
+		{
+			sent = sendmsg (SocketFD, &message, 0);
+		} while (sent == -1 && errno == EINTR);
+
+		throw_sys_if (sent != sizeof (data));
+	}
+
+	void LocalSocket::Unlink (const string &name)
+	{
+		unlink (GetPath (name, geteuid()).c_str());
+	}
+}
@@ -0,0 +1,50 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#ifndef TC_HEADER_Platform_Unix_LocalSocket
+#define TC_HEADER_Platform_Unix_LocalSocket
+
+#include <sys/types.h>
+#include "../PlatformBase.h"
+#include "../SharedPtr.h"
+using namespace std;
+
+namespace CipherShed
+{
+	// Stream socket of a service running under a known user ID. Sockets are created in a private
+	// directory of that user, and both ends verify the user ID of their peer.
+	class LocalSocket
+	{
+	public:
+		LocalSocket (int socketFD) : SocketFD (socketFD) { }
+		virtual ~LocalSocket ();
+
+		shared_ptr <LocalSocket> Accept () const;
+		void Close ();
+		static shared_ptr <LocalSocket> Connect (const string &name, uid_t serviceUserId);
+		int GetFD () const { return SocketFD; }
+		uid_t GetPeerUserId () const;
+		static string GetPath (const string &name, uid_t serviceUserId);
+		static shared_ptr <LocalSocket> Listen (const string &name, uid_t clientUserId);
+		int ReceiveFileDescriptor () const;
+		void SendFileDescriptor (int fd) const;
+		static void Unlink (const string &name);
+
+	protected:
+		static string GetRuntimeDirectory (uid_t userId);
+		static string PrepareRuntimeDirectory (bool sharedWithOtherUsers);
+
+		int SocketFD;
+
+	private:
+		LocalSocket (const LocalSocket &);
+		LocalSocket &operator= (const LocalSocket &);
+	};
+}
+
+#endif // TC_HEADER_Platform_Unix_LocalSocket
@@ -6,11 +6,17 @@
  packages.
 */
 
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#ifdef TC_MACOSX
+#include <mach-o/dyld.h>
+#endif
 #include "Process.h"
 #include "../Exception.h"
 #include "../FileStream.h"
@@ -21,10 +27,46 @@
 #include "../Unix/Pipe.h"
 #include "../Unix/Poller.h"
 
+#include <algorithm>
 #include <memory>
 
 namespace CipherShed
 {
+	void Process::CloseFileDescriptors (const list <int> &keptFileDescriptors)
+	{
+		// Long-running services close descriptors inherited from the process which started them
+		list <int> openFileDescriptors;
+
+		DIR *fdDir = opendir ("/dev/fd");
+		if (fdDir)
+		{
+			struct dirent *entry;
+			while ((entry = readdir (fdDir)) != nullptr)
+			{
+				if (entry->d_name[0] >= '0' && entry->d_name[0] <= '9')
+					openFileDescriptors.push_back (atoi (entry->d_name));
+			}
+
+			openFileDescriptors.remove (dirfd (fdDir));
+			closedir (fdDir);
+		}
+		else
+		{
+			long maxFileDescriptor = sysconf (_SC_OPEN_MAX);
+			if (maxFileDescriptor < 0 || maxFileDescriptor > 65536)
+				maxFileDescriptor = 65536;
+
+			for (int fd = 0; fd < maxFileDescriptor; ++fd)
+				openFileDescriptors.push_back (fd);
+		}
+
+		foreach (int fd, openFileDescriptors)
+		{
+			if (fd > STDERR_FILENO && find (keptFileDescriptors.begin(), keptFileDescriptors.end(), fd) == keptFileDescriptors.end())
+				close (fd);
+		}
+	}
+
 	string Process::Execute (const string &processName, const list <string> &arguments, int timeOut, ProcessExecFunctor *execFunctor, const Buffer *inputData)
 	{
 		char *args[32];
@@ -201,4 +243,36 @@ namespace CipherShed
 
 		return strOutput;
 	}
+
+	string Process::GetExecutablePath ()
+	{
+		// An empty path is returned when the executable of the running process cannot be determined
+		char path[PATH_MAX];
+
+#ifdef TC_MACOSX
+		uint32_t pathSize = sizeof (path);
+		if (_NSGetExecutablePath (path, &pathSize) != 0)
+			return string();
+
+		char realPath[PATH_MAX];
+		if (!realpath (path, realPath))
+			return string();
+
+		return realPath;
+#else
+#if defined (TC_FREEBSD)
+		const char *linkPath = "/proc/curproc/file";
+#elif defined (TC_SOLARIS)
+		const char *linkPath = "/proc/self/path/a.out";
+#else
+		const char *linkPath = "/proc/self/exe";
+#endif
+
+		ssize_t pathSize = readlink (linkPath, path, sizeof (path) - 1);
+		if (pathSize <= 0)
+			return string();
+
+		return string (path, pathSize);
+#endif
+	}
 }
@@ -28,7 +28,9 @@ namespace CipherShed
 		Process ();
 		virtual ~Process ();
 
+		static void CloseFileDescriptors (const list <int> &keptFileDescriptors = list <int> ());
 		static string Execute (const string &processName, const list <string> &arguments, int timeOut = -1, ProcessExecFunctor *execFunctor = nullptr, const Buffer *inputData = nullptr); 
+		static string GetExecutablePath ();
 
 	protected:
 
@@ -10,6 +10,10 @@
 #include <sys/time.h>
 #include <time.h>
 
+#ifdef TC_MACOSX
+#	include <mach/mach_time.h>
+#endif
+
 namespace CipherShed
 {
 	uint64 Time::GetCurrent ()
@@ -18,6 +22,22 @@ namespace CipherShed
 		gettimeofday (&tv, NULL);
 
 		// Unix time => Windows file time
-		return  ((uint64) tv.tv_sec + 134774LL * 24 * 3600) * 1000LL * 1000 * 10;
+		return  ((uint64) tv.tv_sec + 134774LL * 24 * 3600) * 1000LL * 1000 * 10 + (uint64) tv.tv_usec * 10;
+	}
+
+	uint64 Time::GetMonotonicNanoseconds ()
+	{
+#ifdef TC_MACOSX
+		static mach_timebase_info_data_t timebase;
+		if (timebase.denom == 0)
+			mach_timebase_info (&timebase);
+
+		return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+		struct timespec ts;
+		clock_gettime (CLOCK_MONOTONIC, &ts);
+
+		return (uint64) ts.tv_sec * 1000LL * 1000 * 1000 + (uint64) ts.tv_nsec;
+#endif
 	}
 }
@@ -68,7 +68,7 @@ namespace CipherShed
 		// Process all blocks in the buffer
 		while (blockCount > 0)
 		{
-			if (blockCount < BLOCKS_PER_XTS_DATA_UNIT)
+			if (startBlock + blockCount < BLOCKS_PER_XTS_DATA_UNIT)
 				endBlock = startBlock + (unsigned int) blockCount;
 			else
 				endBlock = BLOCKS_PER_XTS_DATA_UNIT;
@@ -235,7 +235,7 @@ namespace CipherShed
 		// Process all blocks in the buffer
 		while (blockCount > 0)
 		{
-			if (blockCount < BLOCKS_PER_XTS_DATA_UNIT)
+			if (startBlock + blockCount < BLOCKS_PER_XTS_DATA_UNIT)
 				endBlock = startBlock + (unsigned int) blockCount;
 			else
 				endBlock = BLOCKS_PER_XTS_DATA_UNIT;
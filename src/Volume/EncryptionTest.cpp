@@ -19,6 +19,61 @@
 
 namespace CipherShed
 {
+	bool EncryptionTest::HwSupportTested = false;
+	uint64 EncryptionTest::RunCount = 0;
+	bool EncryptionTest::SoftwareTested = false;
+	Mutex EncryptionTest::TestMutex;
+
+	void EncryptionTest::RunTestsInParallel (const TestFunction *tests, size_t testCount)
+	{
+		struct TestThreadFunctor : public Functor
+		{
+			TestThreadFunctor (TestFunction test, shared_ptr <Exception> &testException) : Test (test), TestException (testException) { }
+
+			virtual void operator() ()
+			{
+				try
+				{
+					Test();
+				}
+				catch (Exception &e)
+				{
+					TestException.reset (e.CloneNew());
+				}
+				catch (exception &e)
+				{
+					TestException.reset (new ExternalException (SRC_POS, StringConverter::ToExceptionString (e)));
+				}
+				catch (...)
+				{
+					TestException.reset (new UnknownException (SRC_POS));
+				}
+			}
+
+			TestFunction Test;
+			shared_ptr <Exception> &TestException;
+		};
+
+		vector < shared_ptr <Exception> > testExceptions (testCount);
+		list < shared_ptr <Thread> > threads;
+
+		for (size_t i = 0; i < testCount; ++i)
+		{
+			shared_ptr <Thread> thread (new Thread);
+			thread->Start (new TestThreadFunctor (tests[i], testExceptions[i]));
+			threads.push_back (thread);
+		}
+
+		foreach_ref (const Thread &thread, threads)
+			thread.Join();
+
+		foreach (shared_ptr <Exception> testException, testExceptions)
+		{
+			if (testException)
+				testException->Throw();
+		}
+	}
+
 	void EncryptionTest::TestAll ()
 	{
 		TestAll (false);
@@ -27,16 +82,44 @@ namespace CipherShed
 
 	void EncryptionTest::TestAll (bool enableCpuEncryptionSupport)
 	{
+		// Hardware support state is global and must not change while the tests are running
+		ScopeLock lock (TestMutex);
+
 		bool hwSupportEnabled = Cipher::IsHwSupportEnabled();
 		finally_do_arg (bool, hwSupportEnabled, { Cipher::EnableHwSupport (finally_arg); });
 
 		Cipher::EnableHwSupport (enableCpuEncryptionSupport);
 
-		TestCiphers();
-		TestXtsAES();
-		TestXts();
-		TestLegacyModes();
-		TestPkcs5();
+		// Test groups are independent of each other
+		static const TestFunction tests[] =
+		{
+			&EncryptionTest::TestCiphers,
+			&EncryptionTest::TestXtsAES,
+			&EncryptionTest::TestXts,
+			&EncryptionTest::TestLegacyModes,
+			&EncryptionTest::TestPkcs5
+		};
+
+		RunTestsInParallel (tests, array_capacity (tests));
+		++RunCount;
+
+		if (enableCpuEncryptionSupport)
+			HwSupportTested = true;
+		else
+			SoftwareTested = true;
+	}
+
+	void EncryptionTest::TestAllOnce ()
+	{
+		// Results are valid for the lifetime of the process. Algorithms using hardware support are
+		// tested only when hardware support is enabled, so that they are not tested before their first use.
+		ScopeLock lock (TestMutex);
+
+		if (!SoftwareTested)
+			TestAll (false);
+
+		if (!HwSupportTested && Cipher::IsHwSupportEnabled())
+			TestAll (true);
 	}
 
 	void EncryptionTest::TestLegacyModes ()
@@ -19,8 +19,12 @@ namespace CipherShed
 	public:
 		static void TestAll ();
 		static void TestAll (bool enableCpuEncryptionSupport);
+		static void TestAllOnce ();
 
 	protected:
+		typedef void (*TestFunction) ();
+
+		static void RunTestsInParallel (const TestFunction *tests, size_t testCount);
 		static void TestCiphers ();
 		static void TestLegacyModes ();
 		static void TestPkcs5 ();
@@ -39,6 +43,11 @@ namespace CipherShed
 
 	static const XtsTestVector XtsTestVectors[];
 
+		static bool HwSupportTested;
+		static uint64 RunCount;		// Completed runs of all tests
+		static bool SoftwareTested;
+		static Mutex TestMutex;
+
 	private:
 		EncryptionTest ();
 		virtual ~EncryptionTest ();
@@ -134,11 +134,8 @@ namespace CipherShed
 			itemException->Throw();
 	}
 
-	void EncryptionThreadPool::Start ()
+	size_t EncryptionThreadPool::GetCpuCount ()
 	{
-		if (ThreadPoolRunning)
-			return;
-
 		size_t cpuCount;
 
 #ifdef TC_WINDOWS
@@ -172,11 +169,22 @@ namespace CipherShed
 #	error Cannot determine CPU count
 #endif
 
-		if (cpuCount < 2)
+		return cpuCount;
+	}
+
+	void EncryptionThreadPool::Start (size_t threadCount)
+	{
+		if (ThreadPoolRunning)
+			return;
+
+		if (threadCount == 0)
+			threadCount = GetCpuCount();
+
+		if (threadCount < 2)
 			return;
 
-		if (cpuCount > MaxThreadCount)
-			cpuCount = MaxThreadCount;
+		if (threadCount > MaxThreadCount)
+			threadCount = MaxThreadCount;
 
 		StopPending = false;
 		DequeuePosition = 0;
@@ -189,7 +197,7 @@ namespace CipherShed
 
 		try
 		{
-			for (ThreadCount = 0; ThreadCount < cpuCount; ++ThreadCount)
+			for (ThreadCount = 0; ThreadCount < threadCount; ++ThreadCount)
 			{
 				struct ThreadFunctor : public Functor
 				{
@@ -231,6 +239,7 @@ namespace CipherShed
 			thread.Join();
 		}
 
+		RunningThreads.clear();
 		ThreadCount = 0;
 		ThreadPoolRunning = false;
 	}
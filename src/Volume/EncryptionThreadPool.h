@@ -61,8 +61,10 @@ namespace CipherShed
 		};
 
 		static void DoWork (WorkType::Enum type, const EncryptionMode *mode, byte *data, uint64 startUnitNo, uint64 unitCount, size_t sectorSize);
+		static size_t GetCpuCount ();
+		static size_t GetThreadCount () { return ThreadPoolRunning ? ThreadCount : 1; }
 		static bool IsRunning () { return ThreadPoolRunning; }
-		static void Start ();
+		static void Start (size_t threadCount = 0);	// Zero selects one thread per CPU
 		static void Stop ();
 
 	protected:
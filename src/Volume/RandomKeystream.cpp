@@ -0,0 +1,78 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#include "../Common/Crypto.h"
+#include "RandomKeystream.h"
+
+namespace CipherShed
+{
+	RandomKeystream::RandomKeystream ()
+		: KeystreamCipher (new CipherAES)
+	{
+		Ciphers.push_back (KeystreamCipher);
+	}
+
+	void RandomKeystream::Encrypt (byte *data, uint64 length) const
+	{
+		ValidateState();
+		ValidateParameters (data, length);
+
+		GenerateKeystream (data, 0, length / KeystreamCipher->GetBlockSize());
+	}
+
+	void RandomKeystream::EncryptSectorsCurrentThread (byte *data, uint64 sectorIndex, uint64 sectorCount, size_t sectorSize) const
+	{
+		// Called by the encryption thread pool for fragments consisting of whole data units
+		const uint64 blocksPerDataUnit = ENCRYPTION_DATA_UNIT_SIZE / KeystreamCipher->GetBlockSize();
+		GenerateKeystream (data, sectorIndex * blocksPerDataUnit, sectorCount * blocksPerDataUnit);
+	}
+
+	void RandomKeystream::GenerateKeystream (byte *data, uint64 startBlockNo, uint64 blockCount) const
+	{
+		// Each block is the encrypted 128-bit big-endian block number. Blocks are generated in batches
+		// to allow hardware-accelerated ciphers to process multiple blocks in parallel.
+		const uint64 maxBatchBlockCount = ENCRYPTION_DATA_UNIT_SIZE / 16 * 64;
+
+		while (blockCount > 0)
+		{
+			uint64 batchBlockCount = blockCount < maxBatchBlockCount ? blockCount : maxBatchBlockCount;
+			uint64 *counter = reinterpret_cast <uint64 *> (data);
+
+			for (uint64 i = 0; i < batchBlockCount; ++i)
+			{
+				*counter++ = 0;
+				*counter++ = Endian::Big (startBlockNo++);
+			}
+
+			KeystreamCipher->EncryptBlocks (data, (size_t) batchBlockCount);
+
+			data += batchBlockCount * 16;
+			blockCount -= batchBlockCount;
+		}
+	}
+
+	void RandomKeystream::GetData (const BufferPtr &buffer, uint64 position) const
+	{
+		ValidateState();
+
+		if (buffer.Size() % ENCRYPTION_DATA_UNIT_SIZE != 0 || position % ENCRYPTION_DATA_UNIT_SIZE != 0)
+			throw ParameterIncorrect (SRC_POS);
+
+		// Large buffers are distributed among the threads of the encryption thread pool
+		EncryptSectors (buffer, position / ENCRYPTION_DATA_UNIT_SIZE, buffer.Size() / ENCRYPTION_DATA_UNIT_SIZE, ENCRYPTION_DATA_UNIT_SIZE);
+	}
+
+	void RandomKeystream::SetKey (const ConstBufferPtr &key)
+	{
+		if (key.Size() != GetKeySize())
+			throw ParameterIncorrect (SRC_POS);
+
+		KeystreamCipher->SetKey (key);
+		KeySet = true;
+	}
+}
@@ -0,0 +1,48 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#ifndef TC_HEADER_Volume_RandomKeystream
+#define TC_HEADER_Volume_RandomKeystream
+
+#include "../Platform/Platform.h"
+#include "Cipher.h"
+#include "EncryptionMode.h"
+
+namespace CipherShed
+{
+	// AES-256 counter-mode keystream used to fill unused areas of volumes with data indistinguishable from ciphertext.
+	// Data units are overwritten rather than encrypted, so buffers do not need to be cleared beforehand.
+	class RandomKeystream : public EncryptionMode
+	{
+	public:
+		RandomKeystream ();
+		virtual ~RandomKeystream () { }
+
+		virtual void Decrypt (byte *data, uint64 length) const { throw NotApplicable (SRC_POS); }
+		virtual void DecryptSectorsCurrentThread (byte *data, uint64 sectorIndex, uint64 sectorCount, size_t sectorSize) const { throw NotApplicable (SRC_POS); }
+		virtual void Encrypt (byte *data, uint64 length) const;
+		virtual void EncryptSectorsCurrentThread (byte *data, uint64 sectorIndex, uint64 sectorCount, size_t sectorSize) const;
+		virtual void GetData (const BufferPtr &buffer, uint64 position) const;
+		virtual size_t GetKeySize () const { return KeystreamCipher->GetKeySize(); }
+		virtual wstring GetName () const { return L"Keystream"; };
+		virtual shared_ptr <EncryptionMode> GetNew () const { return shared_ptr <EncryptionMode> (new RandomKeystream); }
+		virtual void SetCiphers (const CipherList &ciphers) { throw NotApplicable (SRC_POS); }
+		virtual void SetKey (const ConstBufferPtr &key);
+
+	protected:
+		void GenerateKeystream (byte *data, uint64 startBlockNo, uint64 blockCount) const;
+
+		shared_ptr <Cipher> KeystreamCipher;
+
+	private:
+		RandomKeystream (const RandomKeystream &);
+		RandomKeystream &operator= (const RandomKeystream &);
+	};
+}
+
+#endif // TC_HEADER_Volume_RandomKeystream
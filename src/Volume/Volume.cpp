@@ -15,11 +15,14 @@
 #include "VolumeHeader.h"
 #include "VolumeLayout.h"
 #include "../Common/Crypto.h"
+#include "../Platform/Serializer.h"
 
 namespace CipherShed
 {
 	Volume::Volume ()
 		: HiddenVolumeProtectionTriggered (false),
+		ProtectedRangeStart (0),
+		ProtectedRangeEnd (0),
 		SystemEncryption (false),
 		VolumeDataSize (0),
 		TopWriteOffset (0),
@@ -63,7 +66,19 @@ namespace CipherShed
 		return EA->GetMode();
 	}
 
-	void Volume::Open (const VolumePath &volumePath, bool preserveTimestamps, shared_ptr <VolumePassword> password, shared_ptr <KeyfileList> keyfiles, VolumeProtection::Enum protection, shared_ptr <VolumePassword> protectionPassword, shared_ptr <KeyfileList> protectionKeyfiles, bool sharedAccessAllowed, VolumeType::Enum volumeType, bool useBackupHeaders, bool partitionInSystemEncryptionScope)
+	bool Volume::GetHeaderLocation (int headerOffset, uint64 &location) const
+	{
+		if (headerOffset >= 0)
+			location = headerOffset;
+		else if (VolumeHostSize >= static_cast <uint64> (-static_cast <int64> (headerOffset)))
+			location = VolumeHostSize + headerOffset;
+		else
+			return false;
+
+		return true;
+	}
+
+	void Volume::Open (const VolumePath &volumePath, bool preserveTimestamps, shared_ptr <VolumePassword> password, shared_ptr <KeyfileList> keyfiles, VolumeProtection::Enum protection, shared_ptr <VolumePassword> protectionPassword, shared_ptr <KeyfileList> protectionKeyfiles, bool sharedAccessAllowed, VolumeType::Enum volumeType, bool useBackupHeaders, bool partitionInSystemEncryptionScope, bool useHeaderKeyCache, const VolumeOpenHint &openHint)
 	{
 		make_shared_auto (File, file);
 
@@ -94,10 +109,10 @@ namespace CipherShed
 				throw;
 		}
 
-		return Open (file, password, keyfiles, protection, protectionPassword, protectionKeyfiles, volumeType, useBackupHeaders, partitionInSystemEncryptionScope);
+		return Open (file, password, keyfiles, protection, protectionPassword, protectionKeyfiles, volumeType, useBackupHeaders, partitionInSystemEncryptionScope, useHeaderKeyCache, openHint);
 	}
 
-	void Volume::Open (shared_ptr <File> volumeFile, shared_ptr <VolumePassword> password, shared_ptr <KeyfileList> keyfiles, VolumeProtection::Enum protection, shared_ptr <VolumePassword> protectionPassword, shared_ptr <KeyfileList> protectionKeyfiles, VolumeType::Enum volumeType, bool useBackupHeaders, bool partitionInSystemEncryptionScope)
+	void Volume::Open (shared_ptr <File> volumeFile, shared_ptr <VolumePassword> password, shared_ptr <KeyfileList> keyfiles, VolumeProtection::Enum protection, shared_ptr <VolumePassword> protectionPassword, shared_ptr <KeyfileList> protectionKeyfiles, VolumeType::Enum volumeType, bool useBackupHeaders, bool partitionInSystemEncryptionScope, bool useHeaderKeyCache, const VolumeOpenHint &openHint)
 	{
 		if (!volumeFile)
 			throw ParameterIncorrect (SRC_POS);
@@ -111,6 +126,11 @@ namespace CipherShed
 			VolumeHostSize = VolumeFile->Length();
 			shared_ptr <VolumePassword> passwordKey = Keyfile::ApplyListToPassword (keyfiles, password);
 
+			// Search for the header of the hidden volume while the outer volume header is being tested
+			shared_ptr <ProtectedVolumeTrial> protectedVolumeTrial;
+			if (protection == VolumeProtection::HiddenVolumeReadOnly)
+				protectedVolumeTrial.reset (new ProtectedVolumeTrial (VolumeFile, protectionPassword, protectionKeyfiles, useBackupHeaders, useHeaderKeyCache));
+
 			bool skipLayoutV1Normal = false;
 
 			bool deviceHosted = GetPath().IsDevice();
@@ -118,15 +138,9 @@ namespace CipherShed
 			if (deviceHosted)
 				hostDeviceSectorSize = volumeFile->GetDeviceSectorSize();
 
-			// Test volume layouts
+			VolumeLayoutList layouts;
 			foreach (shared_ptr <VolumeLayout> layout, VolumeLayout::GetAvailableLayouts (volumeType))
 			{
-				if (skipLayoutV1Normal && typeid (*layout) == typeid (VolumeLayoutV1Normal))
-				{
-					// Skip VolumeLayoutV1Normal as it shares header location with VolumeLayoutV2Normal
-					continue;
-				}
-
 				if (useBackupHeaders && !layout->HasBackupHeader())
 					continue;
 
@@ -137,6 +151,23 @@ namespace CipherShed
 					continue;
 				}
 
+				layouts.push_back (layout);
+			}
+
+			// Read all header locations before the time-consuming header tests are started
+			HeaderRegionList headerRegions;
+			if (!partitionInSystemEncryptionScope)
+				headerRegions = ReadHeaderRegions (layouts, useBackupHeaders);
+
+			// Test volume layouts
+			foreach (shared_ptr <VolumeLayout> layout, layouts)
+			{
+				if (skipLayoutV1Normal && typeid (*layout) == typeid (VolumeLayoutV1Normal))
+				{
+					// Skip VolumeLayoutV1Normal as it shares header location with VolumeLayoutV2Normal
+					continue;
+				}
+
 				SecureBuffer headerBuffer (layout->GetHeaderSize());
 
 				if (layout->HasDriveHeader())
@@ -167,13 +198,16 @@ namespace CipherShed
 
 					int headerOffset = useBackupHeaders ? layout->GetBackupHeaderOffset() : layout->GetHeaderOffset();
 
-					if (headerOffset >= 0)
-						VolumeFile->SeekAt (headerOffset);
-					else
-						VolumeFile->SeekEnd (headerOffset);
+					// Positioned reads are used as the volume file may be shared by a concurrent protected volume trial
+					uint64 headerLocation;
+					if (!GetHeaderLocation (headerOffset, headerLocation))
+						continue;
 
-					if (VolumeFile->Read (headerBuffer) != layout->GetHeaderSize())
+					if (!ReadHeaderFromRegions (headerRegions, headerLocation, headerBuffer)
+						&& VolumeFile->ReadAt (headerBuffer, headerLocation) != layout->GetHeaderSize())
+					{
 						continue;
+					}
 				}
 
 				EncryptionAlgorithmList layoutEncryptionAlgorithms = layout->GetSupportedEncryptionAlgorithms();
@@ -188,9 +222,18 @@ namespace CipherShed
 					layoutEncryptionModes = EncryptionMode::GetAvailableModes();
 				}
 
+				Pkcs5KdfList layoutKeyDerivationFunctions = layout->GetSupportedKeyDerivationFunctions();
+
+				if (!openHint.IsEmpty())
+				{
+					// Test the hinted algorithms first and fall back to the remaining ones
+					PrioritizeAlgorithm (layoutKeyDerivationFunctions, openHint.Pkcs5PrfName);
+					PrioritizeAlgorithm (layoutEncryptionAlgorithms, openHint.EncryptionAlgorithmName);
+				}
+
 				shared_ptr <VolumeHeader> header = layout->GetHeader();
 
-				if (header->Decrypt (headerBuffer, *passwordKey, layout->GetSupportedKeyDerivationFunctions(), layoutEncryptionAlgorithms, layoutEncryptionModes))
+				if (header->Decrypt (headerBuffer, *passwordKey, layoutKeyDerivationFunctions, layoutEncryptionAlgorithms, layoutEncryptionModes, useHeaderKeyCache))
 				{
 					// Header decrypted
 
@@ -240,23 +283,16 @@ namespace CipherShed
 						{
 							try
 							{
-								Volume protectedVolume;
+								shared_ptr <Volume> protectedVolume = protectedVolumeTrial->GetVolume();
 
-								protectedVolume.Open (VolumeFile,
-									protectionPassword, protectionKeyfiles,
-									VolumeProtection::ReadOnly,
-									shared_ptr <VolumePassword> (), shared_ptr <KeyfileList> (),
-									VolumeType::Hidden,
-									useBackupHeaders);
-
-								if (protectedVolume.GetType() != VolumeType::Hidden)
+								if (protectedVolume->GetType() != VolumeType::Hidden)
 									ParameterIncorrect (SRC_POS);
 
-								ProtectedRangeStart = protectedVolume.VolumeDataOffset;
-								ProtectedRangeEnd = protectedVolume.VolumeDataOffset + protectedVolume.VolumeDataSize;
+								ProtectedRangeStart = protectedVolume->VolumeDataOffset;
+								ProtectedRangeEnd = protectedVolume->VolumeDataOffset + protectedVolume->VolumeDataSize;
 
-								if (typeid (*protectedVolume.Layout) == typeid (VolumeLayoutV1Hidden))
-									ProtectedRangeEnd += protectedVolume.Layout->GetHeaderSize();
+								if (typeid (*protectedVolume->Layout) == typeid (VolumeLayoutV1Hidden))
+									ProtectedRangeEnd += protectedVolume->Layout->GetHeaderSize();
 							}
 							catch (PasswordException&)
 							{
@@ -307,6 +343,231 @@ namespace CipherShed
 		}
 	}
 
+	void Volume::Open (shared_ptr <File> volumeFile, shared_ptr <Stream> openState)
+	{
+		if (!volumeFile)
+			throw ParameterIncorrect (SRC_POS);
+
+		VolumeFile = volumeFile;
+
+		try
+		{
+			Serializer sr (openState);
+
+			uint32 layoutIndex;
+			sr.Deserialize ("Layout", layoutIndex);
+
+			VolumeLayoutList layouts = VolumeLayout::GetAvailableLayouts();
+			if (layoutIndex >= layouts.size())
+				throw ParameterIncorrect (SRC_POS);
+
+			VolumeLayoutList::iterator layout = layouts.begin();
+			advance (layout, layoutIndex);
+			Layout = *layout;
+
+			Header = Layout->GetHeader();
+			Header->DeserializeDecrypted (openState);
+
+			uint32 protection;
+			sr.Deserialize ("Protection", protection);
+			Protection = static_cast <VolumeProtection::Enum> (protection);
+
+			sr.Deserialize ("ProtectedRangeStart", ProtectedRangeStart);
+			sr.Deserialize ("ProtectedRangeEnd", ProtectedRangeEnd);
+			sr.Deserialize ("SystemEncryption", SystemEncryption);
+
+			uint64 sectorOffset;
+			sr.Deserialize ("SectorOffset", sectorOffset);
+
+			Type = Layout->GetType();
+			SectorSize = Header->GetSectorSize();
+
+			VolumeHostSize = VolumeFile->Length();
+			VolumeDataOffset = Layout->GetDataOffset (VolumeHostSize);
+			VolumeDataSize = Layout->GetDataSize (VolumeHostSize);
+
+			EA = Header->GetEncryptionAlgorithm();
+			EA->GetMode()->SetSectorOffset (sectorOffset);
+		}
+		catch (...)
+		{
+			Close();
+			throw;
+		}
+	}
+
+	template <typename AlgorithmList>
+	void Volume::PrioritizeAlgorithm (AlgorithmList &algorithms, const wstring &name)
+	{
+		if (name.empty())
+			return;
+
+		// Move all algorithms of the given name to the front while preserving their relative order
+		typename AlgorithmList::iterator insertPosition = algorithms.begin();
+
+		for (typename AlgorithmList::iterator i = algorithms.begin(); i != algorithms.end(); )
+		{
+			typename AlgorithmList::iterator next = i;
+			++next;
+
+			if ((*i)->GetName() == name)
+			{
+				if (i == insertPosition)
+					++insertPosition;
+				else
+					algorithms.splice (insertPosition, algorithms, i);
+			}
+
+			i = next;
+		}
+	}
+
+	bool Volume::ReadHeaderFromRegions (const HeaderRegionList &regions, uint64 headerLocation, const BufferPtr &headerBuffer)
+	{
+		foreach (const HeaderRegion &region, regions)
+		{
+			if (headerLocation >= region.Offset && headerLocation + headerBuffer.Size() <= region.Offset + region.Length)
+			{
+				headerBuffer.CopyFrom (region.Data->GetRange (headerLocation - region.Offset, headerBuffer.Size()));
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	Volume::HeaderRegionList Volume::ReadHeaderRegions (const VolumeLayoutList &layouts, bool useBackupHeaders) const
+	{
+		// Start and end offsets of all header locations
+		map <uint64, uint64> headerRanges;
+
+		foreach (shared_ptr <VolumeLayout> layout, layouts)
+		{
+			if (layout->HasDriveHeader())
+				continue;
+
+			uint64 start;
+			if (!GetHeaderLocation (useBackupHeaders ? layout->GetBackupHeaderOffset() : layout->GetHeaderOffset(), start))
+				continue;
+
+			uint64 &end = headerRanges[start];
+			end = max (end, start + layout->GetHeaderSize());
+		}
+
+		// Coalesce nearby locations so that each header group is fetched by a single read request
+		list < pair <uint64, uint64> > readRanges;
+
+		for (map <uint64, uint64>::const_iterator i = headerRanges.begin(); i != headerRanges.end(); ++i)
+		{
+			if (!readRanges.empty() && i->first <= readRanges.back().second + TC_VOLUME_HEADER_GROUP_SIZE)
+				readRanges.back().second = max (readRanges.back().second, i->second);
+			else
+				readRanges.push_back (make_pair (i->first, i->second));
+		}
+
+		HeaderRegionList regions;
+
+		for (list < pair <uint64, uint64> >::const_iterator i = readRanges.begin(); i != readRanges.end(); ++i)
+		{
+			HeaderRegion region;
+			region.Offset = i->first;
+			region.Data.reset (new SecureBuffer (static_cast <size_t> (i->second - i->first)));
+			region.Length = VolumeFile->ReadAt (*region.Data, region.Offset);
+
+			regions.push_back (region);
+		}
+
+		return regions;
+	}
+
+	Volume::ProtectedVolumeTrial::ProtectedVolumeTrial (shared_ptr <File> volumeFile, shared_ptr <VolumePassword> password, shared_ptr <KeyfileList> keyfiles, bool useBackupHeaders, bool useHeaderKeyCache)
+		: ThreadRunning (false), UseBackupHeaders (useBackupHeaders), UseHeaderKeyCache (useHeaderKeyCache), VolumeFile (volumeFile)
+	{
+		try
+		{
+			// Keyfiles are applied by the calling thread as security tokens may not be accessed concurrently
+			PasswordKey = Keyfile::ApplyListToPassword (keyfiles, password);
+		}
+		catch (Exception &e)
+		{
+			// Errors are reported only when the result of the trial is requested
+			TrialException.reset (e.CloneNew());
+			return;
+		}
+
+		struct ThreadFunctor : public Functor
+		{
+			ThreadFunctor (ProtectedVolumeTrial *trial) : Trial (trial) { }
+			virtual void operator() ()
+			{
+				Trial->Run ();
+			}
+			ProtectedVolumeTrial *Trial;
+		};
+
+		TrialThread.Start (new ThreadFunctor (this));
+		ThreadRunning = true;
+	}
+
+	Volume::ProtectedVolumeTrial::~ProtectedVolumeTrial ()
+	{
+		try
+		{
+			Join();
+		}
+		catch (...) { }
+	}
+
+	shared_ptr <Volume> Volume::ProtectedVolumeTrial::GetVolume ()
+	{
+		Join();
+
+		if (TrialException)
+			TrialException->Throw();
+
+		return ProtectedVolume;
+	}
+
+	void Volume::ProtectedVolumeTrial::Join ()
+	{
+		if (ThreadRunning)
+		{
+			ThreadRunning = false;
+			TrialThread.Join();
+		}
+	}
+
+	void Volume::ProtectedVolumeTrial::Run ()
+	{
+		try
+		{
+			make_shared_auto (Volume, protectedVolume);
+
+			protectedVolume->Open (VolumeFile,
+				PasswordKey, shared_ptr <KeyfileList> (),
+				VolumeProtection::ReadOnly,
+				shared_ptr <VolumePassword> (), shared_ptr <KeyfileList> (),
+				VolumeType::Hidden,
+				UseBackupHeaders,
+				false,
+				UseHeaderKeyCache);
+
+			ProtectedVolume = protectedVolume;
+		}
+		catch (Exception &e)
+		{
+			TrialException.reset (e.CloneNew());
+		}
+		catch (exception &e)
+		{
+			TrialException.reset (new ExternalException (SRC_POS, StringConverter::ToExceptionString (e)));
+		}
+		catch (...)
+		{
+			TrialException.reset (new UnknownException (SRC_POS));
+		}
+	}
+
 	void Volume::ReadSectors (const BufferPtr &buffer, uint64 byteOffset)
 	{
 		if_debug (ValidateState ());
@@ -346,6 +607,31 @@ namespace CipherShed
 		VolumeFile->Write (newHeaderBuffer);
 	}
 
+	void Volume::SerializeOpenState (shared_ptr <Stream> stream) const
+	{
+		ValidateState();
+
+		// The receiving process opens the volume without the password. It obtains the volume file separately.
+		uint32 layoutIndex = 0;
+		foreach (shared_ptr <VolumeLayout> layout, VolumeLayout::GetAvailableLayouts())
+		{
+			if (typeid (*layout) == typeid (*Layout))
+				break;
+			++layoutIndex;
+		}
+
+		Serializer sr (stream);
+		sr.Serialize ("Layout", layoutIndex);
+
+		Header->SerializeDecrypted (stream);
+
+		sr.Serialize ("Protection", static_cast <uint32> (Protection));
+		sr.Serialize ("ProtectedRangeStart", ProtectedRangeStart);
+		sr.Serialize ("ProtectedRangeEnd", ProtectedRangeEnd);
+		sr.Serialize ("SystemEncryption", SystemEncryption);
+		sr.Serialize ("SectorOffset", EA->GetMode()->GetSectorOffset());
+	}
+
 	void Volume::ValidateState () const
 	{
 		if (VolumeFile.get() == nullptr)
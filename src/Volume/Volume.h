@@ -62,6 +62,22 @@ namespace CipherShed
 		};
 	};
 
+	// Non-secret hint on how a volume was last opened. Algorithms named by the hint
+	// are tested first when searching for the volume header.
+	struct VolumeOpenHint
+	{
+		VolumeOpenHint () { }
+		VolumeOpenHint (const wstring &pkcs5PrfName, const wstring &encryptionAlgorithmName)
+			: EncryptionAlgorithmName (encryptionAlgorithmName), Pkcs5PrfName (pkcs5PrfName) { }
+
+		bool IsEmpty () const { return EncryptionAlgorithmName.empty() && Pkcs5PrfName.empty(); }
+
+		wstring EncryptionAlgorithmName;
+		wstring Pkcs5PrfName;
+	};
+
+	typedef map <wstring, VolumeOpenHint> VolumeOpenHintMap;
+
 	class Volume
 	{
 	public:
@@ -89,14 +105,56 @@ namespace CipherShed
 		uint64 GetVolumeCreationTime () const { return Header->GetVolumeCreationTime(); }
 		bool IsHiddenVolumeProtectionTriggered () const { return HiddenVolumeProtectionTriggered; }
 		bool IsInSystemEncryptionScope () const { return SystemEncryption; }
-		void Open (const VolumePath &volumePath, bool preserveTimestamps, shared_ptr <VolumePassword> password, shared_ptr <KeyfileList> keyfiles, VolumeProtection::Enum protection = VolumeProtection::None, shared_ptr <VolumePassword> protectionPassword = shared_ptr <VolumePassword> (), shared_ptr <KeyfileList> protectionKeyfiles = shared_ptr <KeyfileList> (), bool sharedAccessAllowed = false, VolumeType::Enum volumeType = VolumeType::Unknown, bool useBackupHeaders = false, bool partitionInSystemEncryptionScope = false);
-		void Open (shared_ptr <File> volumeFile, shared_ptr <VolumePassword> password, shared_ptr <KeyfileList> keyfiles, VolumeProtection::Enum protection = VolumeProtection::None, shared_ptr <VolumePassword> protectionPassword = shared_ptr <VolumePassword> (), shared_ptr <KeyfileList> protectionKeyfiles = shared_ptr <KeyfileList> (), VolumeType::Enum volumeType = VolumeType::Unknown, bool useBackupHeaders = false, bool partitionInSystemEncryptionScope = false);
+		void Open (const VolumePath &volumePath, bool preserveTimestamps, shared_ptr <VolumePassword> password, shared_ptr <KeyfileList> keyfiles, VolumeProtection::Enum protection = VolumeProtection::None, shared_ptr <VolumePassword> protectionPassword = shared_ptr <VolumePassword> (), shared_ptr <KeyfileList> protectionKeyfiles = shared_ptr <KeyfileList> (), bool sharedAccessAllowed = false, VolumeType::Enum volumeType = VolumeType::Unknown, bool useBackupHeaders = false, bool partitionInSystemEncryptionScope = false, bool useHeaderKeyCache = false, const VolumeOpenHint &openHint = VolumeOpenHint ());
+		void Open (shared_ptr <File> volumeFile, shared_ptr <VolumePassword> password, shared_ptr <KeyfileList> keyfiles, VolumeProtection::Enum protection = VolumeProtection::None, shared_ptr <VolumePassword> protectionPassword = shared_ptr <VolumePassword> (), shared_ptr <KeyfileList> protectionKeyfiles = shared_ptr <KeyfileList> (), VolumeType::Enum volumeType = VolumeType::Unknown, bool useBackupHeaders = false, bool partitionInSystemEncryptionScope = false, bool useHeaderKeyCache = false, const VolumeOpenHint &openHint = VolumeOpenHint ());
+		void Open (shared_ptr <File> volumeFile, shared_ptr <Stream> openState);
 		void ReadSectors (const BufferPtr &buffer, uint64 byteOffset);
 		void ReEncryptHeader (bool backupHeader, const ConstBufferPtr &newSalt, const ConstBufferPtr &newHeaderKey, shared_ptr <Pkcs5Kdf> newPkcs5Kdf);
+		void SerializeOpenState (shared_ptr <Stream> stream) const;
 		void WriteSectors (const ConstBufferPtr &buffer, uint64 byteOffset);
 
 	protected:
+		struct HeaderRegion
+		{
+			uint64 Offset;
+			uint64 Length;
+			shared_ptr <SecureBuffer> Data;
+		};
+
+		typedef list <HeaderRegion> HeaderRegionList;
+
+		// Searches for the header of a hidden volume to be protected in a separate thread
+		class ProtectedVolumeTrial
+		{
+		public:
+			ProtectedVolumeTrial (shared_ptr <File> volumeFile, shared_ptr <VolumePassword> password, shared_ptr <KeyfileList> keyfiles, bool useBackupHeaders, bool useHeaderKeyCache);
+			~ProtectedVolumeTrial ();
+
+			shared_ptr <Volume> GetVolume ();
+
+		protected:
+			void Join ();
+			void Run ();
+
+			shared_ptr <VolumePassword> PasswordKey;
+			shared_ptr <Volume> ProtectedVolume;
+			bool ThreadRunning;
+			Thread TrialThread;
+			shared_ptr <Exception> TrialException;
+			bool UseBackupHeaders;
+			bool UseHeaderKeyCache;
+			shared_ptr <File> VolumeFile;
+
+		private:
+			ProtectedVolumeTrial (const ProtectedVolumeTrial &);
+			ProtectedVolumeTrial &operator= (const ProtectedVolumeTrial &);
+		};
+
 		void CheckProtectedRange (uint64 writeHostOffset, uint64 writeLength);
+		bool GetHeaderLocation (int headerOffset, uint64 &location) const;
+		template <typename AlgorithmList> static void PrioritizeAlgorithm (AlgorithmList &algorithms, const wstring &name);
+		static bool ReadHeaderFromRegions (const HeaderRegionList &regions, uint64 headerLocation, const BufferPtr &headerBuffer);
+		HeaderRegionList ReadHeaderRegions (const VolumeLayoutList &layouts, bool useBackupHeaders) const;
 		void ValidateState () const;
 
 		shared_ptr <EncryptionAlgorithm> EA;
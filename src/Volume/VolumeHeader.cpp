@@ -12,7 +12,9 @@
 #include "Pkcs5Kdf.h"
 #include "VolumeHeader.h"
 #include "VolumeException.h"
+#include "VolumeHeaderKeyCache.h"
 #include "../Common/Crypto.h"
+#include "../Platform/Serializer.h"
 
 namespace CipherShed
 {
@@ -78,7 +80,7 @@ namespace CipherShed
 		EncryptNew (headerBuffer, options.Salt, options.HeaderKey, options.Kdf);
 	}
 
-	bool VolumeHeader::Decrypt (const ConstBufferPtr &encryptedData, const VolumePassword &password, const Pkcs5KdfList &keyDerivationFunctions, const EncryptionAlgorithmList &encryptionAlgorithms, const EncryptionModeList &encryptionModes)
+	bool VolumeHeader::Decrypt (const ConstBufferPtr &encryptedData, const VolumePassword &password, const Pkcs5KdfList &keyDerivationFunctions, const EncryptionAlgorithmList &encryptionAlgorithms, const EncryptionModeList &encryptionModes, bool useHeaderKeyCache)
 	{
 		if (password.Size() < 1)
 			throw PasswordEmpty (SRC_POS);
@@ -89,7 +91,12 @@ namespace CipherShed
 
 		foreach (shared_ptr <Pkcs5Kdf> pkcs5, keyDerivationFunctions)
 		{
-			pkcs5->DeriveKey (headerKey, password, salt);
+			bool headerKeyCached = useHeaderKeyCache && VolumeHeaderKeyCache::Get (password, salt, *pkcs5, headerKey);
+
+			if (!headerKeyCached)
+				pkcs5->DeriveKey (headerKey, password, salt);
+
+			HeaderTrialContext trialContext (headerKey);
 
 			foreach (shared_ptr <EncryptionMode> mode, encryptionModes)
 			{
@@ -103,6 +110,9 @@ namespace CipherShed
 
 					if (typeid (*mode) == typeid (EncryptionModeXTS))
 					{
+						if (!trialContext.IsFirstBlockValidXTS (*ea, encryptedData.GetRange (EncryptedHeaderDataOffset, EncryptedHeaderDataSize)))
+							continue;
+
 						ea->SetKey (headerKey.GetRange (0, ea->GetKeySize()));
 						
 						mode = mode->GetNew();
@@ -122,15 +132,73 @@ namespace CipherShed
 					{
 						EA = ea;
 						Pkcs5 = pkcs5;
+
+						if (useHeaderKeyCache)
+							VolumeHeaderKeyCache::Store (password, salt, *pkcs5, headerKey);
+
 						return true;
 					}
 				}
 			}
+
+			// A cached key which fails to decrypt the header is stale
+			if (headerKeyCached)
+				VolumeHeaderKeyCache::Remove (password, salt, *pkcs5);
 		}
 
 		return false;
 	}
 
+	const Cipher &VolumeHeader::HeaderTrialContext::GetKeyedCipher (const Cipher &cipher, size_t keyOffset)
+	{
+		shared_ptr <Cipher> &keyedCipher = KeyedCiphers[make_pair (cipher.GetName(), keyOffset)];
+
+		if (!keyedCipher)
+		{
+			keyedCipher = cipher.GetNew();
+			keyedCipher->SetKey (HeaderKey.GetRange (keyOffset, keyedCipher->GetKeySize()));
+		}
+
+		return *keyedCipher;
+	}
+
+	bool VolumeHeader::HeaderTrialContext::IsFirstBlockValidXTS (const EncryptionAlgorithm &ea, const ConstBufferPtr &encryptedHeaderData)
+	{
+		// Only the first block, which starts with the magic 'TRUE', is decrypted. Its XTS
+		// whitening value is the encrypted number of the first data unit (zero).
+		byte block[BYTES_PER_XTS_BLOCK];
+		byte whiteningValue[BYTES_PER_XTS_BLOCK];
+
+		Memory::Copy (block, encryptedHeaderData.Get(), sizeof (block));
+
+		const CipherList &ciphers = ea.GetCiphers();
+		size_t eaKeySize = ea.GetKeySize();
+		size_t keyOffset = eaKeySize;
+
+		for (CipherList::const_reverse_iterator iCipher = ciphers.rbegin(); iCipher != ciphers.rend(); ++iCipher)
+		{
+			keyOffset -= (*iCipher)->GetKeySize();
+
+			Memory::Zero (whiteningValue, sizeof (whiteningValue));
+			GetKeyedCipher (**iCipher, eaKeySize + keyOffset).EncryptBlock (whiteningValue);
+
+			for (size_t i = 0; i < sizeof (block); ++i)
+				block[i] ^= whiteningValue[i];
+
+			GetKeyedCipher (**iCipher, keyOffset).DecryptBlock (block);
+
+			for (size_t i = 0; i < sizeof (block); ++i)
+				block[i] ^= whiteningValue[i];
+		}
+
+		bool magicValid = (block[0] == 'T' && block[1] == 'R' && block[2] == 'U' && block[3] == 'E');
+
+		Memory::Erase (block, sizeof (block));
+		Memory::Erase (whiteningValue, sizeof (whiteningValue));
+
+		return magicValid;
+	}
+
 	bool VolumeHeader::Deserialize (const ConstBufferPtr &header, shared_ptr <EncryptionAlgorithm> &ea, shared_ptr <EncryptionMode> &mode)
 	{
 		if (header.Size() != EncryptedHeaderDataSize)
@@ -216,6 +284,49 @@ namespace CipherShed
 		return true;
 	}
 
+	void VolumeHeader::DeserializeDecrypted (shared_ptr <Stream> stream)
+	{
+		Serializer sr (stream);
+
+		shared_ptr <EncryptionAlgorithm> ea;
+		wstring eaName = sr.DeserializeWString ("EncryptionAlgorithm");
+		foreach (shared_ptr <EncryptionAlgorithm> availableEA, EncryptionAlgorithm::GetAvailableAlgorithms())
+		{
+			if (availableEA->GetName() == eaName)
+				ea = availableEA;
+		}
+
+		shared_ptr <EncryptionMode> mode;
+		wstring modeName = sr.DeserializeWString ("EncryptionMode");
+		foreach (shared_ptr <EncryptionMode> availableMode, EncryptionMode::GetAvailableModes())
+		{
+			if (availableMode->GetName() == modeName)
+				mode = availableMode;
+		}
+
+		if (!ea || !mode)
+			throw ParameterIncorrect (SRC_POS);
+
+		shared_ptr <Pkcs5Kdf> pkcs5 = Pkcs5Kdf::GetAlgorithm (sr.DeserializeWString ("Pkcs5"));
+
+		uint32 headerSize;
+		sr.Deserialize ("HeaderSize", headerSize);
+		SetSize (headerSize);
+
+		SecureBuffer header (EncryptedHeaderDataSize);
+		sr.Deserialize ("Header", header);
+
+		if (!Deserialize (header, ea, mode))
+			throw ParameterIncorrect (SRC_POS);
+
+		// Creation times are not part of the serialized header
+		sr.Deserialize ("VolumeCreationTime", VolumeCreationTime);
+		sr.Deserialize ("HeaderCreationTime", HeaderCreationTime);
+
+		EA = ea;
+		Pkcs5 = pkcs5;
+	}
+
 	template <typename T>
 	T VolumeHeader::DeserializeEntry (const ConstBufferPtr &header, size_t &offset) const
 	{
@@ -323,6 +434,23 @@ namespace CipherShed
 		SerializeEntry (Crc32::ProcessBuffer (header.GetRange (0, TC_HEADER_OFFSET_HEADER_CRC - TC_HEADER_OFFSET_MAGIC)), header, offset);
 	}
 
+	void VolumeHeader::SerializeDecrypted (shared_ptr <Stream> stream) const
+	{
+		// The decrypted header contains the master keys. It allows an open volume to be passed to another
+		// process without the password and without repeating the key derivation.
+		SecureBuffer header (EncryptedHeaderDataSize);
+		Serialize (header);
+
+		Serializer sr (stream);
+		sr.Serialize ("EncryptionAlgorithm", EA->GetName());
+		sr.Serialize ("EncryptionMode", EA->GetMode()->GetName());
+		sr.Serialize ("Pkcs5", Pkcs5->GetName());
+		sr.Serialize ("HeaderSize", HeaderSize);
+		sr.Serialize ("Header", ConstBufferPtr (header));
+		sr.Serialize ("VolumeCreationTime", VolumeCreationTime);
+		sr.Serialize ("HeaderCreationTime", HeaderCreationTime);
+	}
+
 	template <typename T>
 	void VolumeHeader::SerializeEntry (const T &entry, const BufferPtr &header, size_t &offset) const
 	{
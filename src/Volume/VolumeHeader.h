@@ -56,7 +56,8 @@ namespace CipherShed
 		virtual ~VolumeHeader ();
 
 		void Create (const BufferPtr &headerBuffer, VolumeHeaderCreationOptions &options);
-		bool Decrypt (const ConstBufferPtr &encryptedData, const VolumePassword &password, const Pkcs5KdfList &keyDerivationFunctions, const EncryptionAlgorithmList &encryptionAlgorithms, const EncryptionModeList &encryptionModes);
+		bool Decrypt (const ConstBufferPtr &encryptedData, const VolumePassword &password, const Pkcs5KdfList &keyDerivationFunctions, const EncryptionAlgorithmList &encryptionAlgorithms, const EncryptionModeList &encryptionModes, bool useHeaderKeyCache = false);
+		void DeserializeDecrypted (shared_ptr <Stream> stream);
 		void EncryptNew (const BufferPtr &newHeaderBuffer, const ConstBufferPtr &newSalt, const ConstBufferPtr &newHeaderKey, shared_ptr <Pkcs5Kdf> newPkcs5Kdf);
 		uint64 GetEncryptedAreaStart () const { return EncryptedAreaStart; }
 		uint64 GetEncryptedAreaLength () const { return EncryptedAreaLength; }
@@ -71,9 +72,32 @@ namespace CipherShed
 		static uint32 GetSaltSize () { return SaltSize; }
 		uint64 GetVolumeDataSize () const { return VolumeDataSize; }
 		VolumeTime GetVolumeCreationTime () const { return VolumeCreationTime; }
+		void SerializeDecrypted (shared_ptr <Stream> stream) const;
 		void SetSize (uint32 headerSize);
 
 	protected:
+		// Ciphers keyed with slices of a single derived header key. Key schedules are
+		// computed once per slice and shared by all tested encryption algorithms.
+		class HeaderTrialContext
+		{
+		public:
+			HeaderTrialContext (const ConstBufferPtr &headerKey) : HeaderKey (headerKey) { }
+
+			bool IsFirstBlockValidXTS (const EncryptionAlgorithm &ea, const ConstBufferPtr &encryptedHeaderData);
+
+		protected:
+			const Cipher &GetKeyedCipher (const Cipher &cipher, size_t keyOffset);
+
+			typedef map < pair <wstring, size_t>, shared_ptr <Cipher> > KeyedCipherMap;
+
+			ConstBufferPtr HeaderKey;
+			KeyedCipherMap KeyedCiphers;
+
+		private:
+			HeaderTrialContext (const HeaderTrialContext &);
+			HeaderTrialContext &operator= (const HeaderTrialContext &);
+		};
+
 		bool Deserialize (const ConstBufferPtr &header, shared_ptr <EncryptionAlgorithm> &ea, shared_ptr <EncryptionMode> &mode);
 		template <typename T> T DeserializeEntry (const ConstBufferPtr &header, size_t &offset) const;
 		template <typename T> T DeserializeEntryAt (const ConstBufferPtr &header, const size_t &offset) const;
@@ -0,0 +1,178 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#ifndef TC_WINDOWS
+#include <pthread.h>
+#include <sys/mman.h>
+#endif
+#include "../Platform/Time.h"
+#include "Hash.h"
+#include "VolumeHeaderKeyCache.h"
+
+namespace CipherShed
+{
+	VolumeHeaderKeyCache::Entry::Entry (size_t keySize)
+		: Id (Sha512().GetDigestSize()), HeaderKey (keySize), ExpirationTime (0)
+	{
+#ifndef TC_WINDOWS
+		// Failure to lock is not fatal (e.g., RLIMIT_MEMLOCK exceeded)
+		mlock (Id.Ptr(), Id.Size());
+		mlock (HeaderKey.Ptr(), HeaderKey.Size());
+#endif
+	}
+
+	VolumeHeaderKeyCache::Entry::~Entry ()
+	{
+		Id.Erase();
+		HeaderKey.Erase();
+#ifndef TC_WINDOWS
+		munlock (Id.Ptr(), Id.Size());
+		munlock (HeaderKey.Ptr(), HeaderKey.Size());
+#endif
+	}
+
+	void VolumeHeaderKeyCache::Clear ()
+	{
+		ScopeLock lock (AccessMutex);
+		Entries.clear();
+	}
+
+	void VolumeHeaderKeyCache::ComputeId (const VolumePassword &password, const ConstBufferPtr &salt, const Pkcs5Kdf &kdf, const BufferPtr &id)
+	{
+		Sha512 hash;
+		hash.ProcessData (ConstBufferPtr (password.DataPtr(), password.Size()));
+		hash.ProcessData (salt);
+
+		wstring kdfName = kdf.GetName();
+		hash.ProcessData (ConstBufferPtr (reinterpret_cast <const byte *> (kdfName.c_str()), kdfName.size() * sizeof (wchar_t)));
+
+		uint32 iterationCount = Endian::Big (static_cast <uint32> (kdf.GetIterationCount()));
+		hash.ProcessData (ConstBufferPtr (reinterpret_cast <const byte *> (&iterationCount), sizeof (iterationCount)));
+
+		hash.GetDigest (id);
+	}
+
+	VolumeHeaderKeyCache::EntryList::iterator VolumeHeaderKeyCache::Find (const ConstBufferPtr &id)
+	{
+		for (EntryList::iterator i = Entries.begin(); i != Entries.end(); ++i)
+		{
+			if (ConstBufferPtr ((*i)->Id).IsDataEqual (id))
+				return i;
+		}
+
+		return Entries.end();
+	}
+
+#ifndef TC_WINDOWS
+	void VolumeHeaderKeyCache::ForkChildHandler ()
+	{
+		// Locked memory is not inherited. The copied keys are therefore wiped before the child process continues.
+		// The access mutex remains held by the forking thread of the parent, as forked processes never use the cache.
+		Entries.clear();
+	}
+
+	void VolumeHeaderKeyCache::ForkParentHandler ()
+	{
+		AccessMutex.Unlock();
+	}
+
+	void VolumeHeaderKeyCache::ForkPrepareHandler ()
+	{
+		// Entries are not modified by other threads while the process is being forked
+		AccessMutex.Lock();
+	}
+#endif
+
+	bool VolumeHeaderKeyCache::Get (const VolumePassword &password, const ConstBufferPtr &salt, const Pkcs5Kdf &kdf, const BufferPtr &headerKey)
+	{
+		SecureBuffer id (Sha512().GetDigestSize());
+		ComputeId (password, salt, kdf, id);
+
+		ScopeLock lock (AccessMutex);
+		RemoveExpired();
+
+		EntryList::iterator entry = Find (id);
+		if (entry == Entries.end() || (*entry)->HeaderKey.Size() != headerKey.Size())
+			return false;
+
+		headerKey.CopyFrom ((*entry)->HeaderKey);
+
+		// Most recently used entries are evicted last
+		Entries.splice (Entries.begin(), Entries, entry);
+		return true;
+	}
+
+	bool VolumeHeaderKeyCache::IsEmpty ()
+	{
+		ScopeLock lock (AccessMutex);
+		RemoveExpired();
+		return Entries.empty();
+	}
+
+	void VolumeHeaderKeyCache::Remove (const VolumePassword &password, const ConstBufferPtr &salt, const Pkcs5Kdf &kdf)
+	{
+		SecureBuffer id (Sha512().GetDigestSize());
+		ComputeId (password, salt, kdf, id);
+
+		ScopeLock lock (AccessMutex);
+
+		EntryList::iterator entry = Find (id);
+		if (entry != Entries.end())
+			Entries.erase (entry);
+	}
+
+	void VolumeHeaderKeyCache::RemoveExpired ()
+	{
+		uint64 currentTime = Time::GetCurrent();
+
+		for (EntryList::iterator i = Entries.begin(); i != Entries.end(); )
+		{
+			if ((*i)->ExpirationTime <= currentTime)
+				i = Entries.erase (i);
+			else
+				++i;
+		}
+	}
+
+	void VolumeHeaderKeyCache::Store (const VolumePassword &password, const ConstBufferPtr &salt, const Pkcs5Kdf &kdf, const ConstBufferPtr &headerKey)
+	{
+		shared_ptr <Entry> newEntry (new Entry (headerKey.Size()));
+		ComputeId (password, salt, kdf, newEntry->Id);
+		newEntry->HeaderKey.CopyFrom (headerKey);
+
+		// Time is measured in hundreds of nanoseconds
+		newEntry->ExpirationTime = Time::GetCurrent() + TimeToLive * 1000 * 1000 * 10;
+
+		ScopeLock lock (AccessMutex);
+		RemoveExpired();
+
+#ifndef TC_WINDOWS
+		if (!ForkHandlersRegistered)
+		{
+			int status = pthread_atfork (&ForkPrepareHandler, &ForkParentHandler, &ForkChildHandler);
+			if (status != 0)
+				throw SystemException (SRC_POS, status);
+
+			ForkHandlersRegistered = true;
+		}
+#endif
+
+		EntryList::iterator entry = Find (newEntry->Id);
+		if (entry != Entries.end())
+			Entries.erase (entry);
+
+		Entries.push_front (newEntry);
+
+		if (Entries.size() > Capacity)
+			Entries.pop_back();
+	}
+
+	VolumeHeaderKeyCache::EntryList VolumeHeaderKeyCache::Entries;
+	Mutex VolumeHeaderKeyCache::AccessMutex;
+	bool VolumeHeaderKeyCache::ForkHandlersRegistered = false;
+}
@@ -0,0 +1,70 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#ifndef TC_HEADER_Volume_VolumeHeaderKeyCache
+#define TC_HEADER_Volume_VolumeHeaderKeyCache
+
+#include "../Platform/Platform.h"
+#include "Pkcs5Kdf.h"
+#include "VolumePassword.h"
+
+namespace CipherShed
+{
+	// Caches header keys derived by PKCS-5 KDFs so that repeated mounts of the same
+	// volume do not have to repeat the key derivation. Entries are identified by a
+	// digest of the password (with keyfiles applied), header salt and KDF, expire
+	// after TimeToLive seconds and are wiped on Clear(). Processes forked by the
+	// caching process (e.g., FUSE mount processes) do not keep copies of the keys.
+	class VolumeHeaderKeyCache
+	{
+	public:
+		static void Clear ();
+		static bool Get (const VolumePassword &password, const ConstBufferPtr &salt, const Pkcs5Kdf &kdf, const BufferPtr &headerKey);
+		static bool IsEmpty ();
+		static void Remove (const VolumePassword &password, const ConstBufferPtr &salt, const Pkcs5Kdf &kdf);
+		static void Store (const VolumePassword &password, const ConstBufferPtr &salt, const Pkcs5Kdf &kdf, const ConstBufferPtr &headerKey);
+
+		static const size_t Capacity = 16;
+		static const uint64 TimeToLive = 15 * 60;
+
+	protected:
+		struct Entry
+		{
+			Entry (size_t keySize);
+			~Entry ();
+
+			SecureBuffer Id;
+			SecureBuffer HeaderKey;
+			uint64 ExpirationTime;
+
+		private:
+			Entry (const Entry &);
+			Entry &operator= (const Entry &);
+		};
+
+		typedef list < shared_ptr <Entry> > EntryList;
+
+		static void ComputeId (const VolumePassword &password, const ConstBufferPtr &salt, const Pkcs5Kdf &kdf, const BufferPtr &id);
+		static EntryList::iterator Find (const ConstBufferPtr &id);
+#ifndef TC_WINDOWS
+		static void ForkChildHandler ();
+		static void ForkParentHandler ();
+		static void ForkPrepareHandler ();
+#endif
+		static void RemoveExpired ();
+
+		static EntryList Entries;
+		static Mutex AccessMutex;
+		static bool ForkHandlersRegistered;
+
+	private:
+		VolumeHeaderKeyCache ();
+	};
+}
+
+#endif // TC_HEADER_Volume_VolumeHeaderKeyCache
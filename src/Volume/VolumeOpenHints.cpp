@@ -0,0 +1,45 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#include "VolumeOpenHints.h"
+
+namespace CipherShed
+{
+	void VolumeOpenHints::Clear ()
+	{
+		ScopeLock lock (AccessMutex);
+		Hints.clear();
+	}
+
+	VolumeOpenHint VolumeOpenHints::Get (const VolumePath &path)
+	{
+		ScopeLock lock (AccessMutex);
+
+		VolumeOpenHintMap::const_iterator hint = Hints.find (wstring (path));
+		if (hint == Hints.end())
+			return VolumeOpenHint();
+
+		return hint->second;
+	}
+
+	void VolumeOpenHints::Set (const VolumePath &path, const VolumeOpenHint &hint)
+	{
+		if (path.IsEmpty())
+			throw ParameterIncorrect (SRC_POS);
+
+		ScopeLock lock (AccessMutex);
+
+		if (hint.IsEmpty())
+			Hints.erase (wstring (path));
+		else
+			Hints[wstring (path)] = hint;
+	}
+
+	VolumeOpenHintMap VolumeOpenHints::Hints;
+	Mutex VolumeOpenHints::AccessMutex;
+}
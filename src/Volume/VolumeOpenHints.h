@@ -0,0 +1,36 @@
+/*
+ Copyright (c) 2026 The CipherShed Project. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0. The full text of the license
+ is contained in the file License.txt included in the CipherShed source code
+ distribution.
+*/
+
+#ifndef TC_HEADER_Volume_VolumeOpenHints
+#define TC_HEADER_Volume_VolumeOpenHints
+
+#include "../Platform/Platform.h"
+#include "Volume.h"
+
+namespace CipherShed
+{
+	// Remembers the PRF and encryption algorithm of volumes opened during the session. Hints are kept
+	// only in memory as they would disclose the algorithms of hidden volumes, and they are stored for
+	// all volume types alike so that their presence does not reveal the type of a volume.
+	class VolumeOpenHints
+	{
+	public:
+		static void Clear ();
+		static VolumeOpenHint Get (const VolumePath &path);
+		static void Set (const VolumePath &path, const VolumeOpenHint &hint);
+
+	protected:
+		static VolumeOpenHintMap Hints;
+		static Mutex AccessMutex;
+
+	private:
+		VolumeOpenHints ();
+	};
+}
+
+#endif // TC_HEADER_Volume_VolumeOpenHints
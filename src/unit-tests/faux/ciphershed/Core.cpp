@@ -0,0 +1,10 @@
+#include "../../../Core/Core.h"
+
+#ifdef CS_UNITTESTING
+namespace CipherShed
+{
+	//Core/Unix/Linux/CoreLinux.cpp
+	std::auto_ptr <CoreBase> Core;
+	std::auto_ptr <CoreBase> CoreDirect;
+}
+#endif
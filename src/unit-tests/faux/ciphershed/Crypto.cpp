@@ -0,0 +1,31 @@
+#include "../../../Common/Crypto.h"
+#include "../../../Volume/Cipher.h"
+
+#ifdef CS_UNITTESTING
+//Common/Crypto.c
+// Key schedules passed to Common/Xts.c by the unit tests are cipher objects. The cipher ID only selects the XTS code path.
+BOOL CipherSupportsIntraDataUnitParallelization (int cipher)
+{
+	return cipher == AES;
+}
+
+void EncipherBlock (int cipher, void *data, void *ks)
+{
+	((CipherShed::Cipher *) ks)->EncryptBlock ((CipherShed::byte *) data);
+}
+
+void DecipherBlock (int cipher, void *data, void *ks)
+{
+	((CipherShed::Cipher *) ks)->DecryptBlock ((CipherShed::byte *) data);
+}
+
+void EncipherBlocks (int cipher, void *dataPtr, void *ks, size_t blockCount)
+{
+	((CipherShed::Cipher *) ks)->EncryptBlocks ((CipherShed::byte *) dataPtr, blockCount);
+}
+
+void DecipherBlocks (int cipher, void *dataPtr, void *ks, size_t blockCount)
+{
+	((CipherShed::Cipher *) ks)->DecryptBlocks ((CipherShed::byte *) dataPtr, blockCount);
+}
+#endif
@@ -0,0 +1,4 @@
+// Common/Xts.c is built only by the Windows driver and boot loader. Its key schedules are replaced by
+// the cipher objects of faux/ciphershed/Crypto.cpp.
+#include "../windows/LONG.h"
+#include "../../../Common/Xts.c"
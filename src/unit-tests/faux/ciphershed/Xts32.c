@@ -0,0 +1,10 @@
+// Boot loader variant of Common/Xts.c, which does not use 64-bit integers. The headers are included
+// beforehand as the rest of the unit tests are built with 64-bit integers.
+#define EncryptBufferXTS EncryptBufferXTS32
+#define DecryptBufferXTS DecryptBufferXTS32
+
+#include "../windows/LONG.h"
+#include "../../../Common/Xts.h"
+
+#define TC_NO_COMPILER_INT64
+#include "../../../Common/Xts.c"
@@ -0,0 +1,562 @@
+/*
+ Microbenchmarks of the cryptographic primitives and of the serialization of core service
+ requests. Each benchmark reports the mean time per operation with its 95% confidence interval
+ and, on x86, timestamp counter cycles per byte.
+ Results can be saved as a JSON baseline and later runs compared against it:
+
+ microbench [--filter=SUBSTRING] [--output=FILE] [--baseline=FILE] [--threshold=PERCENT]
+            [--trial-time=MILLISECONDS] [--trials=COUNT]
+
+ The exit code is 1 if a benchmark is slower than its baseline by more than the threshold.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include "../Core/Benchmark.h"
+#include "../Core/MountOptions.h"
+#include "../Core/RandomNumberGenerator.h"
+#include "../Core/Unix/CoreServiceRequest.h"
+#include "../Platform/Finally.h"
+#include "../Platform/MemoryStream.h"
+#include "../Platform/Thread.h"
+#include "../Platform/Time.h"
+#include "../Volume/Cipher.h"
+#include "../Volume/EncryptionAlgorithm.h"
+#include "../Volume/EncryptionModeXTS.h"
+#include "../Volume/Hash.h"
+#include "../Volume/Pkcs5Kdf.h"
+#include "../Volume/RandomKeystream.h"
+#include "../Volume/VolumeInfo.h"
+#include "../Volume/VolumePassword.h"
+#undef TC_WINDOWS_DRIVER
+#include "../Common/Crc.h"
+#include "../Common/GfMul.h"
+
+extern "C" void compile_8k_table (unsigned __int8 *a, GfCtx8k *ctx);
+
+namespace CipherShed_Microbench
+{
+	using namespace CipherShed;
+
+	struct MicrobenchResult
+	{
+		string Name;
+		size_t BytesPerOperation;			// Zero if the operation does not process data
+		BenchmarkStatistics NsPerOperation;
+		double CyclesPerByte;				// Zero if the timestamp counter is not available
+	};
+
+	typedef list <MicrobenchResult> MicrobenchResultList;
+
+	class Microbench
+	{
+	public:
+		Microbench (const string &filter, uint64 minTrialTime, size_t trialCount) : Filter (filter), MinTrialTime (minTrialTime), TrialCount (trialCount) { }
+
+		static bool Compare (const MicrobenchResultList &results, const string &baselinePath, double threshold)
+		{
+			map <string, double> baseline;
+
+			// Each result of a saved baseline occupies a single line
+			ifstream baselineFile (baselinePath.c_str());
+			if (!baselineFile)
+				throw SystemException (SRC_POS, StringConverter::ToWide (baselinePath));
+
+			string line;
+			while (getline (baselineFile, line))
+			{
+				size_t nameStart = line.find ("\"name\": \"");
+				size_t nsStart = line.find ("\"ns_per_op\": ");
+
+				if (nameStart == string::npos || nsStart == string::npos)
+					continue;
+
+				nameStart += 9;
+				size_t nameEnd = line.find ('"', nameStart);
+
+				if (nameEnd != string::npos)
+					baseline[line.substr (nameStart, nameEnd - nameStart)] = atof (line.c_str() + nsStart + 13);
+			}
+
+			bool regression = false;
+			printf ("\n%-48s %14s %14s %8s\n", "Benchmark", "Baseline ns", "Current ns", "Change");
+
+			foreach (const MicrobenchResult &result, results)
+			{
+				map <string, double>::const_iterator base = baseline.find (result.Name);
+				if (base == baseline.end() || base->second <= 0)
+				{
+					printf ("%-48s %14s %14.1f %8s\n", result.Name.c_str(), "-", result.NsPerOperation.Mean, "new");
+					continue;
+				}
+
+				double change = (result.NsPerOperation.Mean - base->second) * 100 / base->second;
+				bool slower = change > threshold;
+
+				printf ("%-48s %14.1f %14.1f %+7.1f%%%s\n", result.Name.c_str(), base->second, result.NsPerOperation.Mean, change, slower ? " REGRESSION" : "");
+
+				if (slower)
+					regression = true;
+			}
+
+			return !regression;
+		}
+
+		const MicrobenchResultList &GetResults () const { return Results; }
+
+		void Measure (const string &name, size_t bytesPerOperation, Functor &operation)
+		{
+			if (!Filter.empty() && name.find (Filter) == string::npos)
+				return;
+
+			vector <double> samples;
+			double cyclesPerByte = 0;
+
+			// The first trial warms up caches and lets the CPU reach its working frequency
+			for (size_t trial = 0; trial <= TrialCount; ++trial)
+			{
+				uint64 startCycles = ReadTimestampCounter();
+				uint64 startTime = Time::GetMonotonicNanoseconds();
+				uint64 elapsedTime;
+				uint64 operationCount = 0;
+
+				do
+				{
+					operation();
+					++operationCount;
+					elapsedTime = Time::GetMonotonicNanoseconds() - startTime;
+				}
+				while (elapsedTime < MinTrialTime);
+
+				uint64 cycles = ReadTimestampCounter() - startCycles;
+
+				if (trial > 0)
+				{
+					samples.push_back ((double) elapsedTime / operationCount);
+
+					if (bytesPerOperation > 0)
+						cyclesPerByte += (double) cycles / operationCount / bytesPerOperation / TrialCount;
+				}
+			}
+
+			MicrobenchResult result;
+			result.Name = name;
+			result.BytesPerOperation = bytesPerOperation;
+			result.NsPerOperation = BenchmarkStatistics (samples);
+			result.CyclesPerByte = cyclesPerByte;
+
+			printf ("%-48s %14.1f ns/op +/-%5.1f%%", name.c_str(), result.NsPerOperation.Mean,
+				result.NsPerOperation.Mean > 0 ? result.NsPerOperation.ConfidenceInterval * 100 / result.NsPerOperation.Mean : 0.0);
+
+			if (cyclesPerByte > 0)
+				printf (" %8.2f cycles/byte", cyclesPerByte);
+
+			printf ("\n");
+			fflush (stdout);
+
+			Results.push_back (result);
+		}
+
+		static string ToJson (const MicrobenchResultList &results)
+		{
+			string json = "{\n\"results\": [\n";
+			char row[512];
+			size_t remaining = results.size();
+
+			for (MicrobenchResultList::const_iterator i = results.begin(); i != results.end(); ++i)
+			{
+				--remaining;
+
+				snprintf (row, sizeof (row), "{ \"name\": \"%s\", \"bytes_per_op\": %llu, \"ns_per_op\": %.3f, \"stddev\": %.3f, \"ci95\": %.3f, \"trials\": %llu, \"cycles_per_byte\": %.3f }%s\n",
+					i->Name.c_str(), (unsigned long long) i->BytesPerOperation, i->NsPerOperation.Mean, i->NsPerOperation.StandardDeviation,
+					i->NsPerOperation.ConfidenceInterval, (unsigned long long) i->NsPerOperation.TrialCount, i->CyclesPerByte,
+					remaining > 0 ? "," : "");
+
+				json += row;
+			}
+
+			json += "]\n}\n";
+			return json;
+		}
+
+	protected:
+		static uint64 ReadTimestampCounter ()
+		{
+#if defined (__GNUC__) && (defined (__i386__) || defined (__x86_64__))
+			uint32 low, high;
+			__asm__ __volatile__ ("rdtsc" : "=a" (low), "=d" (high));
+			return ((uint64) high << 32) | low;
+#else
+			return 0;
+#endif
+		}
+
+		string Filter;
+		uint64 MinTrialTime;
+		MicrobenchResultList Results;
+		size_t TrialCount;
+	};
+
+	struct CipherOperation : public Functor
+	{
+		CipherOperation (const CipherShed::Cipher &cipher, const BufferPtr &data) : EncryptionCipher (cipher), Data (data) { }
+		virtual void operator() () { EncryptionCipher.EncryptBlocks (Data.Get(), Data.Size() / EncryptionCipher.GetBlockSize()); }
+
+		const CipherShed::Cipher &EncryptionCipher;
+		BufferPtr Data;
+	};
+
+	struct CrcOperation : public Functor
+	{
+		CrcOperation (const BufferPtr &data) : Data (data), Result (0) { }
+		virtual void operator() () { Result ^= GetCrc32 (Data.Get(), (int) Data.Size()); }
+
+		BufferPtr Data;
+		volatile uint32 Result;
+	};
+
+	struct GfMulOperation : public Functor
+	{
+		GfMulOperation (GfCtx8k &context, const BufferPtr &data) : Context (context), Data (data) { }
+
+		virtual void operator() ()
+		{
+			// Multiplies each 128-bit block of the buffer, as LRW does for each cipher block
+			for (size_t i = 0; i + 16 <= Data.Size(); i += 16)
+				GfMul128Tab (Data.Get() + i, &Context);
+		}
+
+		GfCtx8k &Context;
+		BufferPtr Data;
+	};
+
+	struct HashOperation : public Functor
+	{
+		HashOperation (CipherShed::Hash &hash, const ConstBufferPtr &data) : HashAlgorithm (hash), Data (data) { }
+		virtual void operator() () { HashAlgorithm.ProcessData (Data); }
+
+		CipherShed::Hash &HashAlgorithm;
+		ConstBufferPtr Data;
+	};
+
+	struct KdfOperation : public Functor
+	{
+		KdfOperation (const Pkcs5Kdf &kdf, const VolumePassword &password, const ConstBufferPtr &salt, const BufferPtr &key) : Kdf (kdf), Password (password), Salt (salt), Key (key) { }
+		virtual void operator() () { Kdf.DeriveKey (Key, Password, Salt); }
+
+		const Pkcs5Kdf &Kdf;
+		const VolumePassword &Password;
+		ConstBufferPtr Salt;
+		BufferPtr Key;
+	};
+
+	struct KeystreamOperation : public Functor
+	{
+		KeystreamOperation (const RandomKeystream &keystream, const BufferPtr &data) : Keystream (keystream), Data (data) { }
+		virtual void operator() () { Keystream.GetData (Data, 0); }
+
+		const RandomKeystream &Keystream;
+		BufferPtr Data;
+	};
+
+	struct RandomOperation : public Functor
+	{
+		RandomOperation (const BufferPtr &data) : Data (data) { }
+		virtual void operator() () { RandomNumberGenerator::GetDataFast (Data); }
+
+		BufferPtr Data;
+	};
+
+	struct RandomThreadsOperation : public Functor
+	{
+		RandomThreadsOperation (size_t bytesPerThread) : BytesPerThread (bytesPerThread) { }
+
+		virtual void operator() ()
+		{
+			// Each thread is served by its own DRBG instance
+			struct ThreadFunctor : public Functor
+			{
+				ThreadFunctor (size_t size) : Size (size) { }
+
+				virtual void operator() ()
+				{
+					SecureBuffer buffer (Size);
+					RandomNumberGenerator::GetDataFast (buffer);
+				}
+
+				size_t Size;
+			};
+
+			Thread threads[ThreadCount];
+			for (size_t i = 0; i < ThreadCount; ++i)
+				threads[i].Start (new ThreadFunctor (BytesPerThread));
+
+			for (size_t i = 0; i < ThreadCount; ++i)
+				threads[i].Join();
+		}
+
+		static const size_t ThreadCount = 4;
+		size_t BytesPerThread;
+	};
+
+	struct SerializeOperation : public Functor
+	{
+		SerializeOperation (const Serializable &object, SerializationFormat::Enum format) : Format (format), Object (object) { }
+
+		virtual void operator() ()
+		{
+			shared_ptr <Stream> stream (new MemoryStream);
+			stream->SetSerializationFormat (Format);
+			Object.Serialize (stream);
+		}
+
+		SerializationFormat::Enum Format;
+		const Serializable &Object;
+	};
+
+	struct DeserializeOperation : public Functor
+	{
+		DeserializeOperation (const ConstBufferPtr &data) : Data (data) { }
+
+		virtual void operator() ()
+		{
+			// Readers always start in the default format and detect the encoding from the object header
+			shared_ptr <Stream> stream (new MemoryStream (Data));
+			delete Serializable::DeserializeNew (stream);
+		}
+
+		ConstBufferPtr Data;
+	};
+
+	struct XtsOperation : public Functor
+	{
+		XtsOperation (const EncryptionMode &mode, const BufferPtr &data) : Mode (mode), Data (data) { }
+		virtual void operator() () { Mode.EncryptSectorsCurrentThread (Data.Get(), 0, Data.Size() / ENCRYPTION_DATA_UNIT_SIZE, ENCRYPTION_DATA_UNIT_SIZE); }
+
+		const EncryptionMode &Mode;
+		BufferPtr Data;
+	};
+
+	static void MeasureSerialization (Microbench &bench, const string &name, const Serializable &object, SerializationFormat::Enum format)
+	{
+		shared_ptr <Stream> stream (new MemoryStream);
+		stream->SetSerializationFormat (format);
+		object.Serialize (stream);
+
+		Buffer data;
+		data.CopyFrom (dynamic_cast <MemoryStream &> (*stream));
+
+		string prefix = "serializer/" + name + (format == SerializationFormat::Compact ? "/Compact" : "/Named");
+
+		SerializeOperation serializeOperation (object, format);
+		bench.Measure (prefix + "/Serialize", data.Size(), serializeOperation);
+
+		DeserializeOperation deserializeOperation (data);
+		bench.Measure (prefix + "/Deserialize", data.Size(), deserializeOperation);
+	}
+
+	static void RunAll (Microbench &bench)
+	{
+		Buffer data (64 * 1024);
+		for (size_t i = 0; i < data.Size(); ++i)
+			data[i] = (byte) i;
+
+		BufferPtr cipherData = data.GetRange (0, 4096);
+
+		foreach (shared_ptr <CipherShed::Cipher> c, CipherShed::Cipher::GetAvailableCiphers())
+		{
+			shared_ptr <CipherShed::Cipher> cipher = c->GetNew();
+			SecureBuffer key (cipher->GetKeySize());
+			key.Zero();
+			cipher->SetKey (key);
+
+			CipherOperation operation (*cipher, cipherData);
+			bench.Measure ("cipher/" + StringConverter::ToSingle (cipher->GetName()) + "/EncryptBlocks", cipherData.Size(), operation);
+		}
+
+		foreach (shared_ptr <CipherShed::EncryptionAlgorithm> algorithm, CipherShed::EncryptionAlgorithm::GetAvailableAlgorithms())
+		{
+			if (algorithm->IsDeprecated())
+				continue;
+
+			shared_ptr <CipherShed::EncryptionAlgorithm> ea = algorithm->GetNew();
+			SecureBuffer key (ea->GetKeySize());
+			key.Zero();
+			ea->SetKey (key);
+
+			shared_ptr <EncryptionMode> mode (new EncryptionModeXTS);
+			ea->SetMode (mode);
+			SecureBuffer modeKey (mode->GetKeySize());
+			modeKey.Zero();
+			mode->SetKey (modeKey);
+
+			XtsOperation operation (*mode, data);
+			bench.Measure ("xts/" + StringConverter::ToSingle (ea->GetName()) + "/EncryptBuffer", data.Size(), operation);
+		}
+
+		// Fills unused volume areas instead of encrypting zeroed buffers in XTS mode
+		RandomKeystream keystream;
+		SecureBuffer keystreamKey (keystream.GetKeySize());
+		keystreamKey.Zero();
+		keystream.SetKey (keystreamKey);
+
+		KeystreamOperation keystreamOperation (keystream, data);
+		bench.Measure ("keystream/AES/GetData", data.Size(), keystreamOperation);
+
+		foreach (shared_ptr <CipherShed::Hash> h, CipherShed::Hash::GetAvailableAlgorithms())
+		{
+			shared_ptr <CipherShed::Hash> hash = h->GetNew();
+			hash->Init();
+
+			HashOperation operation (*hash, data);
+			bench.Measure ("hash/" + StringConverter::ToSingle (hash->GetName()) + "/ProcessData", data.Size(), operation);
+		}
+
+		CrcOperation crcOperation (data);
+		bench.Measure ("crc/GetCrc32", data.Size(), crcOperation);
+
+		GfCtx8k *gfContext = (GfCtx8k *) Memory::Allocate (sizeof (GfCtx8k));
+		finally_do_arg (GfCtx8k *, gfContext, { Memory::Free (finally_arg); });
+
+		compile_8k_table (data.Ptr(), gfContext);
+
+		Buffer gfData (4096);
+		gfData.CopyFrom (data.GetRange (0, gfData.Size()));
+
+		GfMulOperation gfOperation (*gfContext, gfData);
+		bench.Measure ("gf/GfMul128Tab", gfData.Size(), gfOperation);
+
+		VolumePassword password ("microbench", 10);
+		SecureBuffer salt (64);
+		salt.Zero();
+		SecureBuffer headerKey (192);
+
+		foreach (shared_ptr <Pkcs5Kdf> kdf, Pkcs5Kdf::GetAvailableAlgorithms())
+		{
+			KdfOperation operation (*kdf, password, salt, headerKey);
+			bench.Measure ("kdf/" + StringConverter::ToSingle (kdf->GetName()) + "/DeriveKey", 0, operation);
+		}
+
+		RandomNumberGenerator::Start();
+		finally_do ({ RandomNumberGenerator::Stop(); });
+
+		// Salt-sized requests and bulk requests, such as those filling the free space of new volumes
+		SecureBuffer randomSalt (64);
+		RandomOperation randomSaltOperation (randomSalt);
+		bench.Measure ("rng/GetDataFast/64", randomSalt.Size(), randomSaltOperation);
+
+		SecureBuffer randomData (1024 * 1024);
+		RandomOperation randomDataOperation (randomData);
+		bench.Measure ("rng/GetDataFast/1048576", randomData.Size(), randomDataOperation);
+
+		RandomThreadsOperation randomThreadsOperation (randomData.Size());
+		bench.Measure ("rng/GetDataFast/1048576/4Threads", randomData.Size() * RandomThreadsOperation::ThreadCount, randomThreadsOperation);
+
+		VolumeInfo volumeInfo;
+		volumeInfo.AuxMountPoint = L"/tmp/.ciphershed_aux_mnt1";
+		volumeInfo.EncryptionAlgorithmBlockSize = 16;
+		volumeInfo.EncryptionAlgorithmKeySize = 32;
+		volumeInfo.EncryptionAlgorithmMinBlockSize = 16;
+		volumeInfo.EncryptionAlgorithmName = L"AES";
+		volumeInfo.EncryptionModeName = L"XTS";
+		volumeInfo.HeaderCreationTime = 129876543210ULL;
+		volumeInfo.HiddenVolumeProtectionTriggered = false;
+		volumeInfo.LoopDevice = L"/dev/loop0";
+		volumeInfo.MinRequiredProgramVersion = 0x600;
+		volumeInfo.MountPoint = L"/media/ciphershed1";
+		volumeInfo.Path = VolumePath (wstring (L"/home/user/volume.tc"));
+		volumeInfo.Pkcs5IterationCount = 1000;
+		volumeInfo.Pkcs5PrfName = L"HMAC-RIPEMD-160";
+		volumeInfo.ProgramVersion = 0x71a;
+		volumeInfo.Protection = VolumeProtection::None;
+		volumeInfo.SerialInstanceNumber = 123456789;
+		volumeInfo.Size = 1024 * 1024 * 1024ULL;
+		volumeInfo.SlotNumber = 1;
+		volumeInfo.SystemEncryption = false;
+		volumeInfo.TopWriteOffset = 0;
+		volumeInfo.TotalDataRead = 4096;
+		volumeInfo.TotalDataWritten = 8192;
+		volumeInfo.Type = VolumeType::Normal;
+		volumeInfo.VirtualDevice = L"/dev/mapper/ciphershed1";
+		volumeInfo.VolumeCreationTime = 129876543210ULL;
+
+		MeasureSerialization (bench, "VolumeInfo", volumeInfo, SerializationFormat::Named);
+		MeasureSerialization (bench, "VolumeInfo", volumeInfo, SerializationFormat::Compact);
+
+		MountOptions mountOptions;
+		mountOptions.FilesystemType = L"ext4";
+		mountOptions.MountPoint.reset (new DirectoryPath (L"/media/ciphershed1"));
+		mountOptions.Path.reset (new VolumePath (wstring (L"/home/user/volume.tc")));
+		mountOptions.SlotNumber = 1;
+		MountVolumeRequest mountRequest (&mountOptions);
+
+		MeasureSerialization (bench, "MountVolumeRequest", mountRequest, SerializationFormat::Named);
+		MeasureSerialization (bench, "MountVolumeRequest", mountRequest, SerializationFormat::Compact);
+	}
+}
+
+int main (int argc, char *argv[])
+{
+	using namespace CipherShed;
+	using namespace CipherShed_Microbench;
+
+	string baselinePath;
+	string filter;
+	string outputPath;
+	double threshold = 10;
+	uint64 minTrialTime = 100 * 1000 * 1000;
+	size_t trialCount = 5;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		string value = arg.find ('=') != string::npos ? arg.substr (arg.find ('=') + 1) : string();
+
+		if (arg.find ("--baseline=") == 0)
+			baselinePath = value;
+		else if (arg.find ("--filter=") == 0)
+			filter = value;
+		else if (arg.find ("--output=") == 0)
+			outputPath = value;
+		else if (arg.find ("--threshold=") == 0)
+			threshold = atof (value.c_str());
+		else if (arg.find ("--trial-time=") == 0)
+			minTrialTime = strtoull (value.c_str(), nullptr, 10) * 1000 * 1000;
+		else if (arg.find ("--trials=") == 0 && atoi (value.c_str()) > 0)
+			trialCount = atoi (value.c_str());
+		else
+		{
+			cerr << "Usage: " << argv[0] << " [--filter=SUBSTRING] [--output=FILE] [--baseline=FILE] [--threshold=PERCENT] [--trial-time=MILLISECONDS] [--trials=COUNT]" << endl;
+			return 2;
+		}
+	}
+
+	try
+	{
+		Microbench bench (filter, minTrialTime, trialCount);
+		RunAll (bench);
+
+		if (!outputPath.empty())
+		{
+			ofstream output (outputPath.c_str());
+			output << Microbench::ToJson (bench.GetResults());
+
+			if (!output)
+				throw SystemException (SRC_POS, StringConverter::ToWide (outputPath));
+		}
+
+		if (!baselinePath.empty() && !Microbench::Compare (bench.GetResults(), baselinePath, threshold))
+			return 1;
+	}
+	catch (exception &e)
+	{
+		cerr << StringConverter::ToSingle (StringConverter::ToExceptionString (e)) << endl;
+		return 2;
+	}
+
+	return 0;
+}
@@ -0,0 +1,802 @@
+#include "../../unittesting.h"
+
+#include "../../../Common/GfMul.h"
+#include "../../../Platform/Finally.h"
+#include "../../../Volume/EncryptionAlgorithm.h"
+#include "../../../Volume/EncryptionModeLRW.h"
+#include "../../../Volume/EncryptionModeXTS.h"
+#include "../../../Volume/EncryptionThreadPool.h"
+#include "../../../Volume/Hash.h"
+
+extern "C"
+{
+	// Common/Xts.c, built as for the driver and, without 64-bit integers, as for the boot loader (see faux/ciphershed)
+	void EncryptBufferXTS (unsigned __int8 *buffer, TC_LARGEST_COMPILER_UINT length, const UINT64_STRUCT *startDataUnitNo, unsigned int startCipherBlockNo, unsigned __int8 *ks, unsigned __int8 *ks2, int cipher);
+	void DecryptBufferXTS (unsigned __int8 *buffer, TC_LARGEST_COMPILER_UINT length, const UINT64_STRUCT *startDataUnitNo, unsigned int startCipherBlockNo, unsigned __int8 *ks, unsigned __int8 *ks2, int cipher);
+	void EncryptBufferXTS32 (unsigned __int8 *buffer, TC_LARGEST_COMPILER_UINT length, const UINT64_STRUCT *startDataUnitNo, unsigned int startCipherBlockNo, unsigned __int8 *ks, unsigned __int8 *ks2, int cipher);
+	void DecryptBufferXTS32 (unsigned __int8 *buffer, TC_LARGEST_COMPILER_UINT length, const UINT64_STRUCT *startDataUnitNo, unsigned int startCipherBlockNo, unsigned __int8 *ks, unsigned __int8 *ks2, int cipher);
+}
+
+namespace CipherShed_Tests_Algo
+{
+	using namespace CipherShed;
+
+	/**
+	Exposes the XTS entry point taking a start block within the first data unit, which the volume code
+	always calls with a start block of zero.
+	*/
+	class ConformanceXtsMode : public EncryptionModeXTS
+	{
+	public:
+		void DecryptAt (byte *data, uint64 length, uint64 dataUnitNo, unsigned int startBlock) const
+		{
+			CipherList::const_iterator iSecondaryCipher = SecondaryCiphers.end();
+
+			for (CipherList::const_reverse_iterator iCipher = Ciphers.rbegin(); iCipher != Ciphers.rend(); ++iCipher)
+			{
+				--iSecondaryCipher;
+				DecryptBufferXTS (**iCipher, **iSecondaryCipher, data, length, dataUnitNo, startBlock);
+			}
+		}
+
+		void EncryptAt (byte *data, uint64 length, uint64 dataUnitNo, unsigned int startBlock) const
+		{
+			CipherList::const_iterator iSecondaryCipher = SecondaryCiphers.begin();
+
+			for (CipherList::const_iterator iCipher = Ciphers.begin(); iCipher != Ciphers.end(); ++iCipher)
+			{
+				EncryptBufferXTS (**iCipher, **iSecondaryCipher, data, length, dataUnitNo, startBlock);
+				++iSecondaryCipher;
+			}
+		}
+	};
+
+	/**
+	Differential tests comparing the optimized crypto code paths (multi-block and hardware-accelerated
+	cipher kernels, table-driven GF multiplication, XTS whitening and the encryption thread pool) with
+	straightforward reference implementations on randomized input. The generator is seeded with a fixed
+	value so that any failure is reproducible.
+	*/
+	TESTCLASS
+	PUBLIC_REF_CLASS ConformanceTest TESTCLASSEXTENDS
+	{
+	private:
+		TESTCONTEXT testContextInstance;
+
+		static const uint64 Seed = 0x9E3779B97F4A7C15ULL;
+		static const int Iterations = 64;
+
+		// Cipher IDs of AES and Serpent in Common/Crypto.h
+		static const int ParallelCipherId = 1;
+		static const int NonParallelCipherId = 2;
+
+		class Random
+		{
+		public:
+			Random (uint64 seed) : State (seed) { }
+
+			uint64 Next ()
+			{
+				State ^= State >> 12;
+				State ^= State << 25;
+				State ^= State >> 27;
+				return State * 2685821657736338717ULL;
+			}
+
+			size_t Next (size_t range) { return (size_t) (Next() % range); }
+
+			void Fill (byte *data, size_t size)
+			{
+				for (size_t i = 0; i < size; ++i)
+					data[i] = (byte) Next();
+			}
+
+		protected:
+			uint64 State;
+		};
+
+		static list <bool> GetKernelVariants ()
+		{
+			list <bool> variants;
+			variants.push_back (false);
+
+			bool hwEnabled = CipherShed::Cipher::IsHwSupportEnabled();
+			CipherShed::Cipher::EnableHwSupport (true);
+
+			bool hwAvailable = false;
+			foreach (shared_ptr <CipherShed::Cipher> cipher, CipherShed::Cipher::GetAvailableCiphers())
+			{
+				if (cipher->IsHwSupportAvailable())
+					hwAvailable = true;
+			}
+
+			CipherShed::Cipher::EnableHwSupport (hwEnabled);
+
+			if (hwAvailable)
+				variants.push_back (true);
+
+			return variants;
+		}
+
+		static void MultiplyTweak (byte *tweak)
+		{
+			byte carry = (tweak[15] & 0x80) ? 135 : 0;
+
+			for (int i = 15; i > 0; --i)
+				tweak[i] = (byte) ((tweak[i] << 1) | (tweak[i - 1] >> 7));
+
+			tweak[0] = (byte) ((tweak[0] << 1) ^ carry);
+		}
+
+		// IEEE 1619 XTS processing one block at a time with a single-block cipher interface
+		static void ReferenceXts (const CipherShed::Cipher &cipher, const CipherShed::Cipher &secondaryCipher, byte *data, uint64 length, uint64 dataUnitNo, unsigned int startBlock, bool decrypt)
+		{
+			byte tweak[16];
+			unsigned int block = startBlock;
+
+			for (uint64 offset = 0; offset < length; offset += 16)
+			{
+				if (offset == 0 || block == 0)
+				{
+					memset (tweak, 0, sizeof (tweak));
+					for (int i = 0; i < 8; ++i)
+						tweak[i] = (byte) (dataUnitNo >> (i * 8));
+
+					secondaryCipher.EncryptBlock (tweak);
+
+					for (unsigned int i = 0; i < block; ++i)
+						MultiplyTweak (tweak);
+				}
+
+				for (int i = 0; i < 16; ++i)
+					data[offset + i] ^= tweak[i];
+
+				if (decrypt)
+					cipher.DecryptBlock (data + offset);
+				else
+					cipher.EncryptBlock (data + offset);
+
+				for (int i = 0; i < 16; ++i)
+					data[offset + i] ^= tweak[i];
+
+				MultiplyTweak (tweak);
+
+				if (++block == BLOCKS_PER_XTS_DATA_UNIT)
+				{
+					block = 0;
+					++dataUnitNo;
+				}
+			}
+		}
+
+		static void ReferenceXts (const CipherList &ciphers, const CipherList &secondaryCiphers, byte *data, uint64 length, uint64 dataUnitNo, unsigned int startBlock, bool decrypt)
+		{
+			vector <const CipherShed::Cipher *> primary, secondary;
+			foreach_ref (const CipherShed::Cipher &cipher, ciphers)
+				primary.push_back (&cipher);
+			foreach_ref (const CipherShed::Cipher &cipher, secondaryCiphers)
+				secondary.push_back (&cipher);
+
+			for (size_t i = 0; i < primary.size(); ++i)
+			{
+				size_t c = decrypt ? primary.size() - 1 - i : i;
+				ReferenceXts (*primary[c], *secondary[c], data, length, dataUnitNo, startBlock, decrypt);
+			}
+		}
+
+		static CipherList GetKeyedCiphers (const CipherList &ciphers, const ConstBufferPtr &key)
+		{
+			CipherList keyed;
+			size_t keyOffset = 0;
+
+			foreach_ref (const CipherShed::Cipher &cipher, ciphers)
+			{
+				shared_ptr <CipherShed::Cipher> c = cipher.GetNew();
+				c->SetKey (key.GetRange (keyOffset, c->GetKeySize()));
+				keyOffset += c->GetKeySize();
+				keyed.push_back (c);
+			}
+
+			return keyed;
+		}
+
+		/**
+		Runs XTS encryption and decryption through the public mode interface and the partial data unit entry
+		point and compares both with the reference. sectorOffset is applied to the data unit number as it is
+		for hidden and partition volumes.
+		*/
+		static bool CheckXts (Random &random, const CipherShed::EncryptionAlgorithm &eaTemplate, bool useThreadPool)
+		{
+			bool result = true;
+			list <bool> variants = GetKernelVariants();
+
+			for (int iteration = 0; iteration < Iterations; ++iteration)
+			{
+				shared_ptr <CipherShed::EncryptionAlgorithm> ea = eaTemplate.GetNew();
+				shared_ptr <EncryptionMode> mode (new EncryptionModeXTS);
+				ConformanceXtsMode xts;
+
+				SecureBuffer key (ea->GetKeySize());
+				SecureBuffer secondaryKey (ea->GetKeySize());
+				random.Fill (key.Ptr(), key.Size());
+				random.Fill (secondaryKey.Ptr(), secondaryKey.Size());
+
+				ea->SetKey (key);
+				mode->SetKey (secondaryKey);
+				ea->SetMode (mode);
+
+				// SetMode() accepts only the exact mode class, so the derived mode is attached to the ciphers directly
+				xts.SetCiphers (ea->GetCiphers());
+				xts.SetKey (secondaryKey);
+
+				uint64 sectorOffset = (random.Next (4) == 0) ? 0 : random.Next() >> 8;
+				mode->SetSectorOffset ((int64) sectorOffset);
+				xts.SetSectorOffset ((int64) sectorOffset);
+
+				CipherList ciphers = GetKeyedCiphers (ea->GetCiphers(), key);
+				CipherList secondaryCiphers = GetKeyedCiphers (ea->GetCiphers(), secondaryKey);
+
+				uint64 sectorIndex = random.Next() >> 24;
+				uint64 sectorCount = 1 + random.Next (useThreadPool ? 96 : 8);
+				uint64 dataUnitNo = random.Next() >> 16;
+				unsigned int startBlock = (unsigned int) random.Next (BLOCKS_PER_XTS_DATA_UNIT);
+				uint64 length = 16 * (1 + random.Next (3 * BLOCKS_PER_XTS_DATA_UNIT));
+				size_t misalignment = random.Next (16);
+
+				uint64 sectorLength = sectorCount * ENCRYPTION_DATA_UNIT_SIZE;
+				size_t bufferSize = (size_t) (sectorLength > length ? sectorLength : length);
+
+				SecureBuffer plaintext (bufferSize);
+				random.Fill (plaintext.Ptr(), plaintext.Size());
+
+				SecureBuffer sectorReference (bufferSize);
+				sectorReference.CopyFrom (plaintext);
+
+				SecureBuffer partialReference (bufferSize);
+				partialReference.CopyFrom (plaintext);
+
+				bool hwEnabled = CipherShed::Cipher::IsHwSupportEnabled();
+				finally_do_arg (bool, hwEnabled, { CipherShed::Cipher::EnableHwSupport (finally_arg); });
+
+				CipherShed::Cipher::EnableHwSupport (false);
+				ReferenceXts (ciphers, secondaryCiphers, sectorReference.Ptr(), sectorLength, sectorIndex + sectorOffset, 0, false);
+				ReferenceXts (ciphers, secondaryCiphers, partialReference.Ptr(), length, dataUnitNo + sectorOffset, startBlock, false);
+
+				SecureBuffer work (bufferSize + 16);
+				byte *data = work.Ptr() + misalignment;
+
+				foreach (bool hw, variants)
+				{
+					CipherShed::Cipher::EnableHwSupport (hw);
+
+					memcpy (data, plaintext.Ptr(), (size_t) sectorLength);
+					if (useThreadPool)
+						ea->EncryptSectors (data, sectorIndex, sectorCount, ENCRYPTION_DATA_UNIT_SIZE);
+					else
+						mode->EncryptSectorsCurrentThread (data, sectorIndex, sectorCount, ENCRYPTION_DATA_UNIT_SIZE);
+
+					if (memcmp (data, sectorReference.Ptr(), (size_t) sectorLength) != 0)
+						result = false;
+
+					if (useThreadPool)
+						ea->DecryptSectors (data, sectorIndex, sectorCount, ENCRYPTION_DATA_UNIT_SIZE);
+					else
+						mode->DecryptSectorsCurrentThread (data, sectorIndex, sectorCount, ENCRYPTION_DATA_UNIT_SIZE);
+
+					if (memcmp (data, plaintext.Ptr(), (size_t) sectorLength) != 0)
+						result = false;
+
+					memcpy (data, plaintext.Ptr(), (size_t) length);
+					xts.EncryptAt (data, length, dataUnitNo, startBlock);
+
+					if (memcmp (data, partialReference.Ptr(), (size_t) length) != 0)
+						result = false;
+
+					xts.DecryptAt (data, length, dataUnitNo, startBlock);
+
+					if (memcmp (data, plaintext.Ptr(), (size_t) length) != 0)
+						result = false;
+				}
+
+				// Decryption of arbitrary data must also match, not only the round trip
+				CipherShed::Cipher::EnableHwSupport (false);
+				partialReference.CopyFrom (plaintext);
+				ReferenceXts (ciphers, secondaryCiphers, partialReference.Ptr(), length, dataUnitNo + sectorOffset, startBlock, true);
+
+				foreach (bool hw, variants)
+				{
+					CipherShed::Cipher::EnableHwSupport (hw);
+
+					memcpy (data, plaintext.Ptr(), (size_t) length);
+					xts.DecryptAt (data, length, dataUnitNo, startBlock);
+
+					if (memcmp (data, partialReference.Ptr(), (size_t) length) != 0)
+						result = false;
+				}
+			}
+
+			return result;
+		}
+
+		typedef void (*XtsFunction) (unsigned __int8 *, TC_LARGEST_COMPILER_UINT, const UINT64_STRUCT *, unsigned int, unsigned __int8 *, unsigned __int8 *, int);
+
+		// Applies an XTS function of Common/Xts.c to each cipher of a cascade as the driver does. The key schedules are cipher objects.
+		static void DriverXts (XtsFunction xts, const CipherList &ciphers, const CipherList &secondaryCiphers, byte *data, uint64 length, uint64 dataUnitNo, unsigned int startBlock, int cipherId, bool decrypt)
+		{
+			vector <CipherShed::Cipher *> primary, secondary;
+			foreach (shared_ptr <CipherShed::Cipher> cipher, ciphers)
+				primary.push_back (cipher.get());
+			foreach (shared_ptr <CipherShed::Cipher> cipher, secondaryCiphers)
+				secondary.push_back (cipher.get());
+
+			UINT64_STRUCT startDataUnitNo;
+			startDataUnitNo.Value = dataUnitNo;
+
+			for (size_t i = 0; i < primary.size(); ++i)
+			{
+				size_t c = decrypt ? primary.size() - 1 - i : i;
+				xts (data, length, &startDataUnitNo, startBlock, (unsigned __int8 *) primary[c], (unsigned __int8 *) secondary[c], cipherId);
+			}
+		}
+
+		/**
+		Compares both builds of Common/Xts.c with the reference. The faux key schedule functions select the code
+		path for ciphers supporting parallel processing of a data unit with the cipher ID of AES.
+		*/
+		static bool CheckDriverXts (Random &random, const CipherShed::EncryptionAlgorithm &eaTemplate)
+		{
+			static const XtsFunction encryptFunctions[] = { EncryptBufferXTS, EncryptBufferXTS32 };
+			static const XtsFunction decryptFunctions[] = { DecryptBufferXTS, DecryptBufferXTS32 };
+			static const int cipherIds[] = { ParallelCipherId, NonParallelCipherId };
+
+			bool result = true;
+			list <bool> variants = GetKernelVariants();
+
+			bool hwEnabled = CipherShed::Cipher::IsHwSupportEnabled();
+			finally_do_arg (bool, hwEnabled, { CipherShed::Cipher::EnableHwSupport (finally_arg); });
+
+			for (int iteration = 0; iteration < Iterations; ++iteration)
+			{
+				shared_ptr <CipherShed::EncryptionAlgorithm> ea = eaTemplate.GetNew();
+
+				SecureBuffer key (ea->GetKeySize());
+				SecureBuffer secondaryKey (ea->GetKeySize());
+				random.Fill (key.Ptr(), key.Size());
+				random.Fill (secondaryKey.Ptr(), secondaryKey.Size());
+
+				CipherList ciphers = GetKeyedCiphers (ea->GetCiphers(), key);
+				CipherList secondaryCiphers = GetKeyedCiphers (ea->GetCiphers(), secondaryKey);
+
+				uint64 dataUnitNo = random.Next() >> 16;
+				unsigned int startBlock = (unsigned int) random.Next (BLOCKS_PER_XTS_DATA_UNIT);
+				uint64 length = 16 * (1 + random.Next (3 * BLOCKS_PER_XTS_DATA_UNIT));
+				size_t misalignment = random.Next (16);
+
+				SecureBuffer plaintext ((size_t) length);
+				random.Fill (plaintext.Ptr(), plaintext.Size());
+
+				SecureBuffer encryptReference (plaintext.Size());
+				encryptReference.CopyFrom (plaintext);
+
+				SecureBuffer decryptReference (plaintext.Size());
+				decryptReference.CopyFrom (plaintext);
+
+				CipherShed::Cipher::EnableHwSupport (false);
+				ReferenceXts (ciphers, secondaryCiphers, encryptReference.Ptr(), length, dataUnitNo, startBlock, false);
+				ReferenceXts (ciphers, secondaryCiphers, decryptReference.Ptr(), length, dataUnitNo, startBlock, true);
+
+				SecureBuffer work (plaintext.Size() + 16);
+				byte *data = work.Ptr() + misalignment;
+
+				foreach (bool hw, variants)
+				{
+					CipherShed::Cipher::EnableHwSupport (hw);
+
+					for (size_t f = 0; f < sizeof (encryptFunctions) / sizeof (encryptFunctions[0]); ++f)
+					{
+						for (size_t c = 0; c < sizeof (cipherIds) / sizeof (cipherIds[0]); ++c)
+						{
+							memcpy (data, plaintext.Ptr(), plaintext.Size());
+							DriverXts (encryptFunctions[f], ciphers, secondaryCiphers, data, length, dataUnitNo, startBlock, cipherIds[c], false);
+
+							if (memcmp (data, encryptReference.Ptr(), encryptReference.Size()) != 0)
+								result = false;
+
+							memcpy (data, plaintext.Ptr(), plaintext.Size());
+							DriverXts (decryptFunctions[f], ciphers, secondaryCiphers, data, length, dataUnitNo, startBlock, cipherIds[c], true);
+
+							if (memcmp (data, decryptReference.Ptr(), decryptReference.Size()) != 0)
+								result = false;
+						}
+					}
+				}
+			}
+
+			return result;
+		}
+
+		// Multiplication in GF(2^64) or GF(2^128) of polynomials stored as big-endian integers, one bit at a time
+		static void ReferenceGfMul (const byte *a, const byte *b, byte *product, size_t size)
+		{
+			byte v[16];
+			memcpy (v, a, size);
+			memset (product, 0, size);
+
+			for (size_t bit = 0; bit < size * 8; ++bit)
+			{
+				if (b[size - 1 - bit / 8] & (1 << (bit % 8)))
+				{
+					for (size_t i = 0; i < size; ++i)
+						product[i] ^= v[i];
+				}
+
+				byte carry = v[0] & 0x80;
+
+				for (size_t i = 0; i < size - 1; ++i)
+					v[i] = (byte) ((v[i] << 1) | (v[i + 1] >> 7));
+
+				v[size - 1] = (byte) (v[size - 1] << 1);
+
+				if (carry)
+					v[size - 1] ^= (size == 16 ? 0x87 : 0x1b);
+			}
+		}
+
+		// LRW whitening each block with the product of the tweak key and the index of the block
+		static void ReferenceLrw (const CipherList &ciphers, const byte *tweakKey, byte *data, uint64 length, uint64 blockIndex, bool decrypt)
+		{
+			size_t blockSize = ciphers.front()->GetBlockSize();
+			byte index[16], whitening[16];
+
+			for (uint64 offset = 0; offset < length; offset += blockSize, ++blockIndex)
+			{
+				memset (index, 0, sizeof (index));
+				for (int i = 0; i < 8; ++i)
+					index[blockSize - 1 - i] = (byte) (blockIndex >> (i * 8));
+
+				ReferenceGfMul (tweakKey, index, whitening, blockSize);
+
+				for (size_t i = 0; i < blockSize; ++i)
+					data[offset + i] ^= whitening[i];
+
+				if (decrypt)
+				{
+					for (CipherList::const_reverse_iterator iCipher = ciphers.rbegin(); iCipher != ciphers.rend(); ++iCipher)
+						(*iCipher)->DecryptBlock (data + offset);
+				}
+				else
+				{
+					foreach_ref (const CipherShed::Cipher &cipher, ciphers)
+						cipher.EncryptBlock (data + offset);
+				}
+
+				for (size_t i = 0; i < blockSize; ++i)
+					data[offset + i] ^= whitening[i];
+			}
+		}
+
+		/**
+		Runs LRW encryption and decryption through the sector and buffer interfaces of the mode and compares
+		both with the reference. Sectors start at block index 1 and sectorOffset is subtracted from their index.
+		*/
+		static bool CheckLrw (Random &random, const CipherShed::EncryptionAlgorithm &eaTemplate)
+		{
+			bool result = true;
+			list <bool> variants = GetKernelVariants();
+
+			bool hwEnabled = CipherShed::Cipher::IsHwSupportEnabled();
+			finally_do_arg (bool, hwEnabled, { CipherShed::Cipher::EnableHwSupport (finally_arg); });
+
+			for (int iteration = 0; iteration < Iterations; ++iteration)
+			{
+				shared_ptr <CipherShed::EncryptionAlgorithm> ea = eaTemplate.GetNew();
+				shared_ptr <EncryptionMode> mode (new EncryptionModeLRW);
+
+				SecureBuffer key (ea->GetKeySize());
+				SecureBuffer tweakKey (mode->GetKeySize());
+				random.Fill (key.Ptr(), key.Size());
+				random.Fill (tweakKey.Ptr(), tweakKey.Size());
+
+				ea->SetKey (key);
+				mode->SetKey (tweakKey);
+				ea->SetMode (mode);
+
+				uint64 sectorOffset = (random.Next (4) == 0) ? 0 : random.Next() >> 40;
+				mode->SetSectorOffset ((int64) sectorOffset);
+
+				CipherList ciphers = GetKeyedCiphers (ea->GetCiphers(), key);
+				size_t blockSize = ciphers.front()->GetBlockSize();
+
+				uint64 sectorIndex = random.Next() >> 24;
+				uint64 sectorCount = 1 + random.Next (8);
+				uint64 sectorBlockIndex = ((sectorIndex - sectorOffset) * (ENCRYPTION_DATA_UNIT_SIZE / blockSize)) | 1;
+				uint64 length = blockSize * (1 + random.Next (3 * ENCRYPTION_DATA_UNIT_SIZE / blockSize));
+				size_t misalignment = random.Next (16);
+
+				uint64 sectorLength = sectorCount * ENCRYPTION_DATA_UNIT_SIZE;
+				size_t bufferSize = (size_t) (sectorLength > length ? sectorLength : length);
+
+				SecureBuffer plaintext (bufferSize);
+				random.Fill (plaintext.Ptr(), plaintext.Size());
+
+				SecureBuffer sectorReference (bufferSize);
+				sectorReference.CopyFrom (plaintext);
+
+				SecureBuffer encryptReference (bufferSize);
+				encryptReference.CopyFrom (plaintext);
+
+				SecureBuffer decryptReference (bufferSize);
+				decryptReference.CopyFrom (plaintext);
+
+				CipherShed::Cipher::EnableHwSupport (false);
+				ReferenceLrw (ciphers, tweakKey.Ptr(), sectorReference.Ptr(), sectorLength, sectorBlockIndex, false);
+				ReferenceLrw (ciphers, tweakKey.Ptr(), encryptReference.Ptr(), length, 1, false);
+				ReferenceLrw (ciphers, tweakKey.Ptr(), decryptReference.Ptr(), length, 1, true);
+
+				SecureBuffer work (bufferSize + 16);
+				byte *data = work.Ptr() + misalignment;
+
+				foreach (bool hw, variants)
+				{
+					CipherShed::Cipher::EnableHwSupport (hw);
+
+					memcpy (data, plaintext.Ptr(), (size_t) sectorLength);
+					mode->EncryptSectorsCurrentThread (data, sectorIndex, sectorCount, ENCRYPTION_DATA_UNIT_SIZE);
+
+					if (memcmp (data, sectorReference.Ptr(), (size_t) sectorLength) != 0)
+						result = false;
+
+					mode->DecryptSectorsCurrentThread (data, sectorIndex, sectorCount, ENCRYPTION_DATA_UNIT_SIZE);
+
+					if (memcmp (data, plaintext.Ptr(), (size_t) sectorLength) != 0)
+						result = false;
+
+					memcpy (data, plaintext.Ptr(), (size_t) length);
+					mode->Encrypt (data, length);
+
+					if (memcmp (data, encryptReference.Ptr(), (size_t) length) != 0)
+						result = false;
+
+					memcpy (data, plaintext.Ptr(), (size_t) length);
+					mode->Decrypt (data, length);
+
+					if (memcmp (data, decryptReference.Ptr(), (size_t) length) != 0)
+						result = false;
+				}
+			}
+
+			return result;
+		}
+
+		static EncryptionAlgorithmList GetAlgorithms (const EncryptionMode &mode)
+		{
+			EncryptionAlgorithmList algorithms;
+
+			foreach (shared_ptr <CipherShed::EncryptionAlgorithm> ea, CipherShed::EncryptionAlgorithm::GetAvailableAlgorithms())
+			{
+				if (ea->IsModeSupported (mode))
+					algorithms.push_back (ea);
+			}
+
+			return algorithms;
+		}
+
+	public:
+		/// <summary>
+		///Gets or sets the test context which provides
+		///information about and functionality for the current test run.
+		///</summary>
+		TESTCONTEXTPROP
+
+		/**
+		Multi-block cipher kernels, including the 32-block hardware AES path, must match the single-block
+		software implementation for misaligned buffers of any length.
+		*/
+		TESTMETHOD
+		void testCipherBlocks()
+		{
+			Random random (Seed);
+			list <bool> variants = GetKernelVariants();
+			bool hwEnabled = CipherShed::Cipher::IsHwSupportEnabled();
+			finally_do_arg (bool, hwEnabled, { CipherShed::Cipher::EnableHwSupport (finally_arg); });
+
+			foreach (shared_ptr <CipherShed::Cipher> cipher, CipherShed::Cipher::GetAvailableCiphers())
+			{
+				for (int iteration = 0; iteration < Iterations; ++iteration)
+				{
+					SecureBuffer key (cipher->GetKeySize());
+					random.Fill (key.Ptr(), key.Size());
+					cipher->SetKey (key);
+
+					size_t blockSize = cipher->GetBlockSize();
+					size_t blockCount = (iteration % 2) ? 32 * (1 + random.Next (4)) : 1 + random.Next (100);
+					size_t misalignment = random.Next (16);
+
+					SecureBuffer plaintext (blockCount * blockSize);
+					random.Fill (plaintext.Ptr(), plaintext.Size());
+
+					SecureBuffer reference (plaintext.Size());
+					reference.CopyFrom (plaintext);
+
+					CipherShed::Cipher::EnableHwSupport (false);
+					for (size_t i = 0; i < blockCount; ++i)
+						cipher->EncryptBlock (reference.Ptr() + i * blockSize);
+
+					SecureBuffer work (plaintext.Size() + 16);
+					byte *data = work.Ptr() + misalignment;
+
+					foreach (bool hw, variants)
+					{
+						CipherShed::Cipher::EnableHwSupport (hw);
+
+						memcpy (data, plaintext.Ptr(), plaintext.Size());
+						cipher->EncryptBlocks (data, blockCount);
+						TEST_ASSERT (memcmp (data, reference.Ptr(), reference.Size()) == 0);
+
+						cipher->DecryptBlocks (data, blockCount);
+						TEST_ASSERT (memcmp (data, plaintext.Ptr(), plaintext.Size()) == 0);
+					}
+				}
+			}
+		};
+
+		/**
+		XTS encryption of every algorithm and cascade must match the reference for random keys, data unit
+		numbers, sector offsets, start blocks, lengths and buffer alignments.
+		*/
+		TESTMETHOD
+		void testXts()
+		{
+			Random random (Seed + 1);
+			EncryptionModeXTS xts;
+
+			foreach (shared_ptr <CipherShed::EncryptionAlgorithm> ea, GetAlgorithms (xts))
+			{
+				TEST_ASSERT (CheckXts (random, *ea, false));
+			}
+		};
+
+		/**
+		Splitting work among the encryption threads must not change the result.
+		*/
+		TESTMETHOD
+		void testXtsThreadPool()
+		{
+			bool poolRunning = EncryptionThreadPool::IsRunning();
+			if (!poolRunning)
+				EncryptionThreadPool::Start (4);
+
+			finally_do_arg (bool, poolRunning, { if (!finally_arg) EncryptionThreadPool::Stop(); });
+
+			Random random (Seed + 2);
+			EncryptionModeXTS xts;
+
+			foreach (shared_ptr <CipherShed::EncryptionAlgorithm> ea, GetAlgorithms (xts))
+			{
+				TEST_ASSERT (CheckXts (random, *ea, true));
+			}
+		};
+
+		/**
+		Common/Xts.c, built as for the driver and as for the boot loader, must match the reference on both of its
+		code paths for random keys, data unit numbers, start blocks, lengths and buffer alignments.
+		*/
+		TESTMETHOD
+		void testDriverXts()
+		{
+			Random random (Seed + 5);
+			EncryptionModeXTS xts;
+
+			foreach (shared_ptr <CipherShed::EncryptionAlgorithm> ea, GetAlgorithms (xts))
+			{
+				TEST_ASSERT (CheckDriverXts (random, *ea));
+			}
+		};
+
+		/**
+		LRW encryption of every algorithm supporting the mode, including the legacy 64-bit block ciphers, must
+		match the reference for sectors and for buffers.
+		*/
+		TESTMETHOD
+		void testLrw()
+		{
+			Random random (Seed + 6);
+			EncryptionModeLRW lrw;
+
+			foreach (shared_ptr <CipherShed::EncryptionAlgorithm> ea, GetAlgorithms (lrw))
+			{
+				TEST_ASSERT (CheckLrw (random, *ea));
+			}
+		};
+
+		/**
+		The table-driven multiplication used for LRW tweaks must match the bitwise multiplication. The table
+		works on MSB-first bit order whereas GfMul128 uses the LSB-first order of the GCM specification.
+		*/
+		TESTMETHOD
+		void testGfMultiplication()
+		{
+			Random random (Seed + 3);
+			GfCtx *ctx = (GfCtx *) TCalloc (sizeof (GfCtx));
+			TEST_ASSERT (ctx != nullptr);
+			if (!ctx)
+				return;
+
+			finally_do_arg (GfCtx *, ctx, { burn (finally_arg, sizeof (GfCtx)); TCfree (finally_arg); });
+
+			for (int iteration = 0; iteration < Iterations * 4; ++iteration)
+			{
+				byte a[16], b[16], tabProduct[16];
+				random.Fill (a, sizeof (a));
+				random.Fill (b, sizeof (b));
+				memset (b, 0, 8);
+
+				TEST_ASSERT (Gf128Tab64Init (a, ctx) != 0);
+				Gf128MulBy64Tab (b + 8, tabProduct, ctx);
+
+				MirrorBits128 (a);
+				MirrorBits128 (b);
+				GfMul128 (a, b);
+				MirrorBits128 (a);
+
+				TEST_ASSERT (memcmp (a, tabProduct, sizeof (a)) == 0);
+			}
+		};
+
+		/**
+		Hashing data in arbitrary, misaligned chunks must produce the same digest as hashing it at once.
+		*/
+		TESTMETHOD
+		void testHashChunking()
+		{
+			Random random (Seed + 4);
+
+			foreach (shared_ptr <CipherShed::Hash> hash, CipherShed::Hash::GetAvailableAlgorithms())
+			{
+				for (int iteration = 0; iteration < Iterations; ++iteration)
+				{
+					size_t size = random.Next (3000);
+					SecureBuffer work (size + 16);
+					size_t misalignment = random.Next (16);
+					BufferPtr data (work.Ptr() + misalignment, size);
+					random.Fill (data.Get(), data.Size());
+
+					SecureBuffer digest (hash->GetDigestSize());
+					SecureBuffer chunkedDigest (hash->GetDigestSize());
+
+					hash->Init();
+					hash->ProcessData (data);
+					hash->GetDigest (digest);
+
+					hash->Init();
+					for (size_t offset = 0; offset < size; )
+					{
+						size_t chunkSize = 1 + random.Next (random.Next (2) ? 7 : 300);
+						if (chunkSize > size - offset)
+							chunkSize = size - offset;
+
+						hash->ProcessData (data.GetRange (offset, chunkSize));
+						offset += chunkSize;
+					}
+					hash->GetDigest (chunkedDigest);
+
+					TEST_ASSERT (memcmp (digest.Ptr(), chunkedDigest.Ptr(), digest.Size()) == 0);
+				}
+			}
+		};
+
+		/**
+		The constructor needs the add each test method for the non-VS unit test execution.
+		*/
+		ConformanceTest()
+		{
+			TEST_ADD(ConformanceTest::testCipherBlocks);
+			TEST_ADD(ConformanceTest::testXts);
+			TEST_ADD(ConformanceTest::testXtsThreadPool);
+			TEST_ADD(ConformanceTest::testDriverXts);
+			TEST_ADD(ConformanceTest::testLrw);
+			TEST_ADD(ConformanceTest::testGfMultiplication);
+			TEST_ADD(ConformanceTest::testHashChunking);
+		}
+	};
+}
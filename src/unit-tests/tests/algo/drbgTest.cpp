@@ -0,0 +1,121 @@
+#include "../../unittesting.h"
+
+#include "../../../Core/HmacDrbg.h"
+#include "../../../Core/RandomNumberGenerator.h"
+
+namespace CipherShed_Tests_Algo
+{
+	using namespace CipherShed;
+
+	TESTCLASS
+	PUBLIC_REF_CLASS DrbgTest TESTCLASSEXTENDS
+	{
+	private:
+		TESTCONTEXT testContextInstance;
+
+		static void FillSequence (const BufferPtr &buffer, byte first)
+		{
+			for (size_t i = 0; i < buffer.Size(); ++i)
+				buffer[i] = (byte) (first + i);
+		}
+
+	public:
+		/// <summary>
+		///Gets or sets the test context which provides
+		///information about and functionality for the current test run.
+		///</summary>
+		TESTCONTEXTPROP
+
+		/**
+		Known-answer test of HMAC_DRBG with SHA-512 (instantiate, generate twice, reseed, generate with additional input).
+		*/
+		TESTMETHOD
+		void testKnownAnswer()
+		{
+			static const byte firstOutput[] =
+			{
+				0x16, 0x50, 0xa3, 0x8c, 0xe3, 0xb6, 0x1c, 0x13, 0xd1, 0x05,
+				0x81, 0xc8, 0x5e, 0x4f, 0x0f, 0xd0, 0xdf, 0x75, 0x66, 0x3e,
+				0x4d, 0xb3, 0x26, 0x22, 0xf8, 0x54, 0x45, 0x63, 0x10, 0xf9,
+				0x7d, 0x96, 0xb2, 0xe3, 0x1b, 0x3d, 0x08, 0x6d, 0x56, 0x8b,
+				0xe8, 0x88, 0xaa, 0x0f, 0x8f, 0x99, 0xfa, 0xaf, 0xd5, 0x6e,
+				0xc1, 0x9f, 0x08, 0xbe, 0x23, 0x64, 0xbb, 0xe1, 0xb1, 0xba,
+				0xf2, 0x7b, 0x78, 0x62, 0x90, 0xc2, 0xb2, 0xfc, 0x52, 0x3a,
+				0x15, 0x7b, 0x35, 0xc0, 0xf7, 0x36, 0xc6, 0x80, 0x19, 0xc9,
+				0xf8, 0x76, 0x04, 0xb6, 0x06, 0xb2, 0xec, 0x11, 0x5d, 0x06,
+				0x37, 0x47, 0xfe, 0x62, 0x91, 0x4b, 0xef, 0x58, 0xab, 0x6b
+			};
+
+			static const byte secondOutput[] =
+			{
+				0x66, 0x93, 0xee, 0x05, 0xfa, 0xba, 0xea, 0x6d, 0x92, 0xa0,
+				0x62, 0xc4, 0xaf, 0x23, 0x21, 0x97, 0x9c, 0x24, 0x86, 0xa6,
+				0x6b, 0xe7, 0x80, 0x57, 0x5e, 0x69, 0x37, 0x52, 0x47, 0xbb,
+				0xb3, 0x06, 0x71, 0xd8, 0x85, 0x98, 0x1c, 0x3c, 0xb7, 0x29,
+				0xb7, 0x46, 0x63, 0x9b, 0x6b, 0xf4, 0x2a, 0x95, 0x16, 0x7c,
+				0x30, 0xe6, 0x28, 0xdd, 0x4e, 0xf8, 0x1e, 0xcd, 0xca, 0x4c,
+				0xa2, 0xc6, 0xf3, 0x1e, 0x0c, 0x08, 0x6a, 0x84, 0xa0, 0xef,
+				0xa2, 0x50, 0xfd, 0x4e, 0xf7, 0xdf, 0xaf, 0xd7, 0x0f, 0xbb,
+				0xca, 0xcd, 0x60, 0xa3, 0x0b, 0xe7, 0x39, 0x04, 0x54, 0xf6,
+				0x60, 0xf3, 0x1d, 0x77, 0xee, 0x9e, 0xfc, 0xc8, 0xfc, 0xec
+			};
+
+			SecureBuffer entropy (32), nonce (16), personalization (32);
+			FillSequence (entropy, 0x00);
+			FillSequence (nonce, 0x20);
+			FillSequence (personalization, 0x40);
+
+			HmacDrbg drbg;
+			drbg.Instantiate (entropy, nonce, personalization);
+
+			SecureBuffer output (sizeof (firstOutput));
+			drbg.Generate (output);
+			drbg.Generate (output);
+			TEST_ASSERT (memcmp (output.Ptr(), firstOutput, sizeof (firstOutput)) == 0);
+
+			SecureBuffer additionalInput (16);
+			FillSequence (entropy, 0x80);
+			FillSequence (additionalInput, 0xa0);
+			drbg.Reseed (entropy, additionalInput);
+
+			FillSequence (additionalInput, 0xc0);
+			drbg.Generate (output, additionalInput);
+			TEST_ASSERT (memcmp (output.Ptr(), secondOutput, sizeof (secondOutput)) == 0);
+			TEST_ASSERT (drbg.GetReseedCounter() == 2);
+		};
+
+		/**
+		Requests larger than the pool and larger than a single DRBG request must be served.
+		*/
+		TESTMETHOD
+		void testLargeRequest()
+		{
+			RandomNumberGenerator::Start();
+
+			SecureBuffer buffer (HmacDrbg::MaxBytesPerRequest * 3 + 100);
+			buffer.Zero();
+			RandomNumberGenerator::GetData (buffer);
+
+			size_t zeroBytes = 0;
+			for (size_t i = 0; i < buffer.Size(); ++i)
+			{
+				if (buffer[i] == 0)
+					++zeroBytes;
+			}
+
+			TEST_ASSERT (zeroBytes < buffer.Size() / 128);
+			TEST_ASSERT (memcmp (buffer.Ptr(), buffer.Ptr() + HmacDrbg::MaxBytesPerRequest, 64) != 0);
+
+			RandomNumberGenerator::Stop();
+		};
+
+		/**
+		The constructor needs the add each test method for the non-VS unit test execution.
+		*/
+		DrbgTest()
+		{
+			TEST_ADD(DrbgTest::testKnownAnswer);
+			TEST_ADD(DrbgTest::testLargeRequest);
+		}
+	};
+}
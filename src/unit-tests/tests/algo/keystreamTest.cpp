@@ -0,0 +1,84 @@
+#include "../../unittesting.h"
+
+#include "../../../Volume/EncryptionAlgorithm.h"
+#include "../../../Volume/RandomKeystream.h"
+
+namespace CipherShed_Tests_Algo
+{
+	using namespace CipherShed;
+
+	TESTCLASS
+	PUBLIC_REF_CLASS KeystreamTest TESTCLASSEXTENDS
+	{
+	private:
+		TESTCONTEXT testContextInstance;
+
+		static void InitKey (SecureBuffer &key)
+		{
+			for (size_t i = 0; i < key.Size(); ++i)
+				key[i] = (byte) i;
+		}
+
+	public:
+		/// <summary>
+		///Gets or sets the test context which provides
+		///information about and functionality for the current test run.
+		///</summary>
+		TESTCONTEXTPROP
+
+		/**
+		Each keystream block must be the AES encryption of its big-endian block number.
+		*/
+		TESTMETHOD
+		void testBlockMatchesCipher()
+		{
+			RandomKeystream keystream;
+			SecureBuffer key (keystream.GetKeySize());
+			InitKey (key);
+			keystream.SetKey (key);
+
+			SecureBuffer data (ENCRYPTION_DATA_UNIT_SIZE);
+			keystream.GetData (data, 3 * ENCRYPTION_DATA_UNIT_SIZE);
+
+			CipherAES cipher;
+			cipher.SetKey (key);
+
+			SecureBuffer counter (cipher.GetBlockSize());
+			counter.Zero();
+			counter[15] = 3 * ENCRYPTION_DATA_UNIT_SIZE / 16 + 1;
+			cipher.EncryptBlock (counter);
+
+			TEST_ASSERT (memcmp (counter.Ptr(), data.Ptr() + 16, 16) == 0);
+		};
+
+		/**
+		Keystream must depend only on the position, not on the size of the requested range.
+		*/
+		TESTMETHOD
+		void testPositionConsistency()
+		{
+			RandomKeystream keystream;
+			SecureBuffer key (keystream.GetKeySize());
+			InitKey (key);
+			keystream.SetKey (key);
+
+			SecureBuffer whole (8 * ENCRYPTION_DATA_UNIT_SIZE);
+			keystream.GetData (whole, 0);
+
+			SecureBuffer part (2 * ENCRYPTION_DATA_UNIT_SIZE);
+			keystream.GetData (part, 5 * ENCRYPTION_DATA_UNIT_SIZE);
+
+			TEST_ASSERT (memcmp (whole.Ptr() + 5 * ENCRYPTION_DATA_UNIT_SIZE, part.Ptr(), part.Size()) == 0);
+			TEST_ASSERT (memcmp (whole.Ptr(), whole.Ptr() + ENCRYPTION_DATA_UNIT_SIZE, ENCRYPTION_DATA_UNIT_SIZE) != 0);
+		};
+
+		/**
+		The constructor needs the add each test method for the non-VS unit test execution.
+		*/
+		KeystreamTest()
+		{
+			TEST_ADD(KeystreamTest::testBlockMatchesCipher);
+			TEST_ADD(KeystreamTest::testPositionConsistency);
+		}
+	};
+}
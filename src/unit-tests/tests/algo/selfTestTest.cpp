@@ -0,0 +1,141 @@
+#include "../../unittesting.h"
+
+#include "../../../Volume/Cipher.h"
+#include "../../../Volume/EncryptionTest.h"
+#include <new>
+
+namespace CipherShed_Tests_Algo
+{
+	using namespace CipherShed;
+
+	static bool PassingTestFinished = false;
+
+	static void PassingTest ()
+	{
+		PassingTestFinished = true;
+	}
+
+	static void FailingTest ()
+	{
+		throw TestFailed (SRC_POS);
+	}
+
+	static void FailingStdTest ()
+	{
+		throw std::bad_alloc();
+	}
+
+	TESTCLASS
+	PUBLIC_REF_CLASS SelfTestTest TESTCLASSEXTENDS
+	{
+	private:
+		TESTCONTEXT testContextInstance;
+
+		// Exposes the state of the self-tests; never instantiated
+		class TestEncryptionTest : public EncryptionTest
+		{
+		public:
+			typedef EncryptionTest::TestFunction TestFunction;
+
+			static uint64 GetRunCount () { return RunCount; }
+
+			static void ResetTestedState ()
+			{
+				ScopeLock lock (TestMutex);
+				HwSupportTested = false;
+				SoftwareTested = false;
+			}
+
+			static void RunTestsInParallel (const TestFunction *tests, size_t testCount) { EncryptionTest::RunTestsInParallel (tests, testCount); }
+		};
+
+	public:
+		/// <summary>
+		///Gets or sets the test context which provides
+		///information about and functionality for the current test run.
+		///</summary>
+		TESTCONTEXTPROP
+
+		/**
+		The self-tests must run only once per process for each state of hardware support, while
+		explicit tests must always run.
+		*/
+		TESTMETHOD
+		void testTestAllOnce()
+		{
+			bool hwSupportEnabled = CipherShed::Cipher::IsHwSupportEnabled();
+			finally_do_arg (bool, hwSupportEnabled, { CipherShed::Cipher::EnableHwSupport (finally_arg); });
+
+			CipherShed::Cipher::EnableHwSupport (false);
+			TestEncryptionTest::ResetTestedState();
+			uint64 runCount = TestEncryptionTest::GetRunCount();
+
+			EncryptionTest::TestAllOnce();
+			TEST_ASSERT (TestEncryptionTest::GetRunCount() == runCount + 1);
+
+			// A second call is skipped
+			EncryptionTest::TestAllOnce();
+			TEST_ASSERT (TestEncryptionTest::GetRunCount() == runCount + 1);
+
+			EncryptionTest::TestAll (false);
+			TEST_ASSERT (TestEncryptionTest::GetRunCount() == runCount + 2);
+
+			// Hardware support enabled after the first call is tested before its first use
+			CipherShed::Cipher::EnableHwSupport (true);
+			EncryptionTest::TestAllOnce();
+			TEST_ASSERT (TestEncryptionTest::GetRunCount() == runCount + 3);
+
+			EncryptionTest::TestAllOnce();
+			TEST_ASSERT (TestEncryptionTest::GetRunCount() == runCount + 3);
+		};
+
+		/**
+		Exceptions thrown by tests running on worker threads must reach the caller after all tests have finished.
+		*/
+		TESTMETHOD
+		void testWorkerException()
+		{
+			static const TestEncryptionTest::TestFunction tests[] = { &FailingTest, &PassingTest };
+
+			PassingTestFinished = false;
+			bool failureReported = false;
+			try
+			{
+				TestEncryptionTest::RunTestsInParallel (tests, array_capacity (tests));
+			}
+			catch (TestFailed&)
+			{
+				failureReported = true;
+			}
+			TEST_ASSERT (failureReported);
+			TEST_ASSERT (PassingTestFinished);
+
+			// Exceptions of the standard library are converted to exceptions which can be rethrown
+			static const TestEncryptionTest::TestFunction stdTests[] = { &PassingTest, &FailingStdTest };
+
+			failureReported = false;
+			try
+			{
+				TestEncryptionTest::RunTestsInParallel (stdTests, array_capacity (stdTests));
+			}
+			catch (ExternalException&)
+			{
+				failureReported = true;
+			}
+			TEST_ASSERT (failureReported);
+
+			// No exception is reported when all tests pass
+			static const TestEncryptionTest::TestFunction passingTests[] = { &PassingTest, &PassingTest };
+			TestEncryptionTest::RunTestsInParallel (passingTests, array_capacity (passingTests));
+		};
+
+		/**
+		The constructor needs the add each test method for the non-VS unit test execution.
+		*/
+		SelfTestTest()
+		{
+			TEST_ADD(SelfTestTest::testTestAllOnce);
+			TEST_ADD(SelfTestTest::testWorkerException);
+		}
+	};
+}
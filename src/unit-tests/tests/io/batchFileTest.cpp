@@ -0,0 +1,240 @@
+#include "../../unittesting.h"
+
+#include "../../../Core/BatchFile.h"
+#include "../../../Platform/MemoryStream.h"
+
+namespace CipherShed_Tests_IO
+{
+	using namespace CipherShed;
+
+	TESTCLASS
+	PUBLIC_REF_CLASS BatchFileTest TESTCLASSEXTENDS
+	{
+	private:
+		TESTCONTEXT testContextInstance;
+
+		// Mounts volumes without accessing them. Volumes whose paths contain "wrong" fail to mount.
+		class TestCore : public CoreBase
+		{
+		public:
+			TestCore () : FailedMountRequestResultCount (0), FailDismountRequests (false), FailMountRequests (false) { }
+
+			virtual void CheckFilesystem (shared_ptr <VolumeInfo> mountedVolume, bool repair = false) const { throw NotApplicable (SRC_POS); }
+			virtual void DismountFilesystem (const DirectoryPath &mountPoint, bool force) const { throw NotApplicable (SRC_POS); }
+			virtual bool FilesystemSupportsLargeFiles (const FilePath &filePath) const { throw NotApplicable (SRC_POS); }
+			virtual DirectoryPath GetDeviceMountPoint (const DevicePath &devicePath) const { throw NotApplicable (SRC_POS); }
+			virtual uint32 GetDeviceSectorSize (const DevicePath &devicePath) const { throw NotApplicable (SRC_POS); }
+			virtual uint64 GetDeviceSize (const DevicePath &devicePath) const { throw NotApplicable (SRC_POS); }
+			virtual HostDeviceList GetHostDevices (bool pathListOnly = false) const { throw NotApplicable (SRC_POS); }
+			virtual VolumeInfoList GetMountedVolumes (const VolumePath &volumePath = VolumePath()) const { return MountedVolumes; }
+			virtual int GetOSMajorVersion () const { throw NotApplicable (SRC_POS); }
+			virtual int GetOSMinorVersion () const { throw NotApplicable (SRC_POS); }
+			virtual bool HasAdminPrivileges () const { return false; }
+			virtual bool IsDevicePresent (const DevicePath &device) const { throw NotApplicable (SRC_POS); }
+			virtual bool IsInPortableMode () const { return false; }
+			virtual bool IsMountPointAvailable (const DirectoryPath &mountPoint) const { return true; }
+			virtual bool IsOSVersion (int major, int minor) const { throw NotApplicable (SRC_POS); }
+			virtual bool IsOSVersionLower (int major, int minor) const { throw NotApplicable (SRC_POS); }
+			virtual bool IsPasswordCacheEmpty () const { return true; }
+			virtual VolumeSlotNumber MountPointToSlotNumber (const DirectoryPath &mountPoint) const { throw NotApplicable (SRC_POS); }
+			virtual void SetFileOwner (const FilesystemPath &path, const UserId &owner) const { throw NotApplicable (SRC_POS); }
+			virtual DirectoryPath SlotNumberToMountPoint (VolumeSlotNumber slotNumber) const { return DirectoryPath (); }
+			virtual void WipePasswordCache () const { }
+
+			virtual shared_ptr <VolumeInfo> DismountVolume (shared_ptr <VolumeInfo> mountedVolume, bool ignoreOpenFiles = false, bool syncVolumeInfo = false)
+			{
+				MountedVolumes.remove (mountedVolume);
+				return mountedVolume;
+			}
+
+			virtual DismountResultList DismountVolumes (const VolumeInfoList &mountedVolumes, bool ignoreOpenFiles = false)
+			{
+				if (FailDismountRequests)
+					throw UserAbort (SRC_POS);
+
+				return CoreBase::DismountVolumes (mountedVolumes, ignoreOpenFiles);
+			}
+
+			virtual shared_ptr <VolumeInfo> MountVolume (MountOptions &options)
+			{
+				if (wstring (*options.Path).find (L"wrong") != wstring::npos)
+					throw PasswordIncorrect (SRC_POS);
+
+				make_shared_auto (VolumeInfo, volume);
+				volume->Path = *options.Path;
+				volume->SlotNumber = options.SlotNumber != 0 ? options.SlotNumber : GetFirstFreeSlotNumber();
+				if (options.MountPoint)
+					volume->MountPoint = *options.MountPoint;
+
+				MountedVolumes.push_back (volume);
+				return volume;
+			}
+
+			// A failing request may report the results of some volumes before it fails
+			virtual MountResultList MountVolumes (MountOptions &options, const VolumePathList &volumePaths, MountResultFunctor *resultFunctor = nullptr)
+			{
+				if (!FailMountRequests)
+					return CoreBase::MountVolumes (options, volumePaths, resultFunctor);
+
+				VolumePathList reportedPaths;
+				foreach (const VolumePath &volumePath, volumePaths)
+				{
+					if (reportedPaths.size() < FailedMountRequestResultCount)
+						reportedPaths.push_back (volumePath);
+				}
+
+				CoreBase::MountVolumes (options, reportedPaths, resultFunctor);
+				throw UserAbort (SRC_POS);
+			}
+
+			size_t FailedMountRequestResultCount;
+			bool FailDismountRequests;
+			bool FailMountRequests;
+			VolumeInfoList MountedVolumes;
+		};
+
+		// Collects the result lines and reports errors by the type of the exception
+		class TestBatchFile : public BatchFile
+		{
+		public:
+			TestBatchFile (CoreBase &core, MountOptions &options) : BatchFile (core, options, false) { }
+
+			virtual wstring GetAbsolutePath (const wstring &path) const { return path; }
+			virtual wstring GetErrorMessage (const exception &e) const { return StringConverter::ToWide (StringConverter::GetTypeName (typeid (e))); }
+			virtual void WriteLine (const wstring &line) { Lines.push_back (line); }
+
+			void Process (const string &text)
+			{
+				shared_ptr <Stream> stream (new MemoryStream (ConstBufferPtr ((const byte *) text.c_str(), text.size())));
+				TextReader reader (stream);
+				BatchFile::Process (reader);
+			}
+
+			list <wstring> Lines;
+		};
+
+		static bool LinesMatch (const list <wstring> &lines, const wchar_t *expectedLines[], size_t expectedLineCount)
+		{
+			if (lines.size() != expectedLineCount)
+				return false;
+
+			size_t i = 0;
+			foreach (const wstring &line, lines)
+			{
+				if (line != expectedLines[i++])
+					return false;
+			}
+
+			return true;
+		}
+
+	public:
+		/// <summary>
+		///Gets or sets the test context which provides
+		///information about and functionality for the current test run.
+		///</summary>
+		TESTCONTEXTPROP
+
+		/**
+		Each command must produce one result line per volume. Queued commands must be executed
+		by empty lines, by commands which cannot be queued with them and at the end of the file.
+		*/
+		TESTMETHOD
+		void testCommands()
+		{
+			TestCore core;
+			MountOptions options;
+			TestBatchFile batchFile (core, options);
+
+			batchFile.Process (
+				"# comment\n"
+				"mount /v/a\n"
+				"mount\t/v/wrong\n"
+				"\n"
+				"mount /v/c /mnt/c/\n"
+				"bogus x\n"
+				"mount\n"
+				"dismount /v/a\n"
+				"dismount /v/none\n"
+				"mount /v/d");
+
+			const wchar_t *expectedLines[] =
+			{
+				L"2\tmount\tok\t/v/a\t1\t\n",
+				L"3\tmount\terror\t/v/wrong\t-\tCipherShed::PasswordIncorrect\n",
+				L"5\tmount\tok\t/v/c\t2\t/mnt/c\n",
+				L"6\tbogus\terror\tx\t-\tCipherShed::BatchCommandIncorrect\n",
+				L"7\tmount\terror\t\t-\tCipherShed::BatchCommandIncorrect\n",
+				L"9\tdismount\terror\t/v/none\t-\tCipherShed::VolumeNotMounted\n",
+				L"8\tdismount\tok\t/v/a\t1\t\n",
+				L"10\tmount\tok\t/v/d\t1\t\n"
+			};
+
+			TEST_ASSERT (LinesMatch (batchFile.Lines, expectedLines, array_capacity (expectedLines)));
+			TEST_ASSERT (batchFile.GetErrorCount() == 4);
+			TEST_ASSERT (core.MountedVolumes.size() == 2);
+		};
+
+		/**
+		A failed core request must produce one error line for each queued volume whose result
+		has not been written, with the line number of the command which has queued the volume.
+		*/
+		TESTMETHOD
+		void testFailedRequests()
+		{
+			TestCore core;
+			core.FailMountRequests = true;
+			core.FailDismountRequests = true;
+
+			MountOptions options;
+			TestBatchFile batchFile (core, options);
+
+			batchFile.Process (
+				"mount /v/a\n"
+				"mount /v/b\n"
+				"\n"
+				"mount /v/c\n"
+				"mount /v/d /mnt/d\n"
+				"dismount /mnt/d\n"
+				"dismount all\n"
+				"mount /v/e\n");
+
+			const wchar_t *expectedLines[] =
+			{
+				L"1\tmount\terror\t/v/a\t-\tCipherShed::UserAbort\n",
+				L"2\tmount\terror\t/v/b\t-\tCipherShed::UserAbort\n",
+				L"4\tmount\terror\t/v/c\t-\tCipherShed::UserAbort\n",
+				L"5\tmount\tok\t/v/d\t1\t/mnt/d\n",
+				L"6\tdismount\terror\t/v/d\t-\tCipherShed::UserAbort\n",
+				L"7\tdismount\terror\t/v/d\t-\tCipherShed::UserAbort\n",
+				L"8\tmount\terror\t/v/e\t-\tCipherShed::UserAbort\n"
+			};
+
+			TEST_ASSERT (LinesMatch (batchFile.Lines, expectedLines, array_capacity (expectedLines)));
+			TEST_ASSERT (batchFile.GetErrorCount() == 6);
+
+			// Results written before a request fails must not be repeated
+			core.FailedMountRequestResultCount = 1;
+			TestBatchFile partialBatchFile (core, options);
+			partialBatchFile.Process ("mount /v/f\nmount /v/g\n");
+
+			const wchar_t *expectedPartialLines[] =
+			{
+				L"1\tmount\tok\t/v/f\t2\t\n",
+				L"2\tmount\terror\t/v/g\t-\tCipherShed::UserAbort\n"
+			};
+
+			TEST_ASSERT (LinesMatch (partialBatchFile.Lines, expectedPartialLines, array_capacity (expectedPartialLines)));
+			TEST_ASSERT (partialBatchFile.GetErrorCount() == 1);
+		};
+
+		/**
+		The constructor needs the add each test method for the non-VS unit test execution.
+		*/
+		BatchFileTest()
+		{
+			TEST_ADD(BatchFileTest::testCommands);
+			TEST_ADD(BatchFileTest::testFailedRequests);
+		}
+	};
+}
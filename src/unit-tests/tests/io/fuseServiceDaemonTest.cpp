@@ -0,0 +1,252 @@
+#include "../../unittesting.h"
+
+#include "../../../Driver/Fuse/FuseServiceDaemon.h"
+#include "../../../Platform/Thread.h"
+#include "../../../Volume/Pkcs5Kdf.h"
+#include "../../../Volume/VolumeLayout.h"
+#include <unistd.h>
+
+namespace CipherShed_Tests_IO
+{
+	using namespace CipherShed;
+
+	TESTCLASS
+	PUBLIC_REF_CLASS FuseServiceDaemonTest TESTCLASSEXTENDS
+	{
+	private:
+		TESTCONTEXT testContextInstance;
+
+		// Keeps received volumes mounted until the test requests all of them to be unmounted
+		struct TestMountHandler : public FuseServiceDaemon::MountHandler
+		{
+			TestMountHandler () : UnmountRequested (false) { }
+
+			virtual Functor *Mount (shared_ptr <Volume> volume, VolumeSlotNumber slotNumber, const string &mountPoint)
+			{
+				if (mountPoint.empty())
+					throw ParameterIncorrect (SRC_POS);
+
+				struct MountLoopFunctor : public Functor
+				{
+					MountLoopFunctor (TestMountHandler &handler) : Handler (handler) { }
+					virtual void operator() ()
+					{
+						while (true)
+						{
+							{
+								ScopeLock lock (Handler.AccessMutex);
+								if (Handler.UnmountRequested)
+									return;
+							}
+							Thread::Sleep (10);
+						}
+					}
+					TestMountHandler &Handler;
+				};
+
+				ScopeLock lock (AccessMutex);
+				MountedVolumes[mountPoint] = volume;
+				MountedSlots[mountPoint] = slotNumber;
+
+				return new MountLoopFunctor (*this);
+			}
+
+			Mutex AccessMutex;
+			map <string, shared_ptr <Volume> > MountedVolumes;
+			map <string, VolumeSlotNumber> MountedSlots;
+			bool UnmountRequested;
+		};
+
+		struct DaemonFunctor : public Functor
+		{
+			DaemonFunctor (FuseServiceDaemon &daemon, bool &runReturned) : Daemon (daemon), RunReturned (runReturned) { }
+			virtual void operator() ()
+			{
+				Daemon.Run();
+				RunReturned = true;
+			}
+			FuseServiceDaemon &Daemon;
+			bool &RunReturned;
+		};
+
+		static shared_ptr <VolumePassword> GetPassword ()
+		{
+			return shared_ptr <VolumePassword> (new VolumePassword (wstring (L"fuse service test")));
+		}
+
+		static string GetTempPath (const string &name)
+		{
+			stringstream path;
+			path << "/tmp/ciphershed-" << name << "-" << getpid();
+			return path.str();
+		}
+
+		static void CreateVolume (const string &path)
+		{
+			VolumeLayoutV2Normal layout;
+			const uint64 hostSize = 1024 * 1024;
+
+			File volumeFile;
+			volumeFile.Open (FilePath (StringConverter::ToWide (path)), File::CreateReadWrite);
+
+			SecureBuffer zeroes (hostSize);
+			zeroes.Zero();
+			volumeFile.Write (zeroes);
+
+			shared_ptr <CipherShed::EncryptionAlgorithm> ea (new CipherShed::AES);
+			shared_ptr <Pkcs5Kdf> kdf (new Pkcs5HmacSha512);
+
+			SecureBuffer dataKey (ea->GetKeySize() * 2);
+			SecureBuffer salt (VolumeHeader::GetSaltSize());
+			for (size_t i = 0; i < dataKey.Size(); ++i)
+				dataKey[i] = (byte) (i * 7);
+			for (size_t i = 0; i < salt.Size(); ++i)
+				salt[i] = (byte) i;
+
+			SecureBuffer headerKey (VolumeHeader::GetLargestSerializedKeySize());
+			kdf->DeriveKey (headerKey, *GetPassword(), salt);
+
+			VolumeHeaderCreationOptions options;
+			options.DataKey = dataKey;
+			options.EA = ea;
+			options.Kdf = kdf;
+			options.HeaderKey = headerKey;
+			options.Salt = salt;
+			options.SectorSize = TC_SECTOR_SIZE_FILE_HOSTED_VOLUME;
+			options.Type = VolumeType::Normal;
+			options.VolumeDataStart = layout.GetHeaderSize() * 2;
+			options.VolumeDataSize = layout.GetMaxDataSize (hostSize);
+
+			SecureBuffer header (layout.GetHeaderSize());
+			layout.GetHeader()->Create (header, options);
+
+			volumeFile.SeekAt (layout.GetHeaderOffset());
+			volumeFile.Write (header);
+		}
+
+		static shared_ptr <Volume> OpenVolume (const string &path, byte sectorValue)
+		{
+			make_shared_auto (Volume, volume);
+			volume->Open (VolumePath (StringConverter::ToWide (path)), false, GetPassword(), shared_ptr <KeyfileList> ());
+
+			SecureBuffer sector (volume->GetSectorSize());
+			sector.Erase();
+			for (size_t i = 0; i < sector.Size(); ++i)
+				sector[i] = (byte) (sectorValue + i);
+
+			volume->WriteSectors (sector, 0);
+			return volume;
+		}
+
+		static bool SectorsMatch (shared_ptr <Volume> volume1, shared_ptr <Volume> volume2)
+		{
+			SecureBuffer sector1 (volume1->GetSectorSize());
+			SecureBuffer sector2 (volume2->GetSectorSize());
+
+			volume1->ReadSectors (sector1, 0);
+			volume2->ReadSectors (sector2, 0);
+
+			return sector1.Size() == sector2.Size() && memcmp (sector1.Ptr(), sector2.Ptr(), sector1.Size()) == 0;
+		}
+
+	public:
+		/// <summary>
+		///Gets or sets the test context which provides
+		///information about and functionality for the current test run.
+		///</summary>
+		TESTCONTEXTPROP
+
+		/**
+		Volumes must be mounted through the service concurrently with idle clients, mount
+		errors must be reported to the client, and the service must exit after the last unmount.
+		*/
+		TESTMETHOD
+		void testMountAndUnmount()
+		{
+			stringstream socketName;
+			socketName << "fuse-service-test-" << getpid();
+			string volumePath1 = GetTempPath ("fuse-service-test-1.tc");
+			string volumePath2 = GetTempPath ("fuse-service-test-2.tc");
+
+			CreateVolume (volumePath1);
+			CreateVolume (volumePath2);
+
+			shared_ptr <Volume> volume1 = OpenVolume (volumePath1, 1);
+			shared_ptr <Volume> volume2 = OpenVolume (volumePath2, 2);
+
+			shared_ptr <LocalSocket> listenSocket = LocalSocket::Listen (socketName.str(), geteuid());
+			TEST_ASSERT (listenSocket);
+
+			// A second instance of the service must not replace the running one
+			TEST_ASSERT (!LocalSocket::Listen (socketName.str(), geteuid()));
+
+			TestMountHandler handler;
+			FuseServiceDaemon daemon (listenSocket, handler);
+
+			bool runReturned = false;
+			Thread daemonThread;
+			daemonThread.Start (new DaemonFunctor (daemon, runReturned));
+
+			// A client which has not sent its request yet must not block other clients
+			shared_ptr <LocalSocket> idleClient = LocalSocket::Connect (socketName.str(), geteuid());
+			TEST_ASSERT (idleClient);
+
+			shared_ptr <LocalSocket> client = LocalSocket::Connect (socketName.str(), geteuid());
+			TEST_ASSERT (client);
+			TEST_ASSERT (FuseServiceDaemon::MountVolume (*client, volume2, 2, "/mnt/2"));
+
+			bool errorReported = false;
+			client = LocalSocket::Connect (socketName.str(), geteuid());
+			try
+			{
+				FuseServiceDaemon::MountVolume (*client, volume2, 3, string());
+			}
+			catch (ParameterIncorrect&)
+			{
+				errorReported = true;
+			}
+			TEST_ASSERT (errorReported);
+
+			TEST_ASSERT (FuseServiceDaemon::MountVolume (*idleClient, volume1, 1, "/mnt/1"));
+
+			{
+				ScopeLock lock (handler.AccessMutex);
+				TEST_ASSERT (handler.MountedVolumes.size() == 2);
+				TEST_ASSERT (handler.MountedSlots["/mnt/1"] == 1);
+				TEST_ASSERT (handler.MountedSlots["/mnt/2"] == 2);
+			}
+
+			// The service must decrypt the data with the master keys it has received
+			TEST_ASSERT (SectorsMatch (volume1, handler.MountedVolumes["/mnt/1"]));
+			TEST_ASSERT (SectorsMatch (volume2, handler.MountedVolumes["/mnt/2"]));
+			TEST_ASSERT (handler.MountedVolumes["/mnt/1"]->GetSize() == volume1->GetSize());
+			TEST_ASSERT (handler.MountedVolumes["/mnt/1"]->GetPath() == volume1->GetPath());
+
+			{
+				ScopeLock lock (handler.AccessMutex);
+				handler.MountedVolumes.clear();
+				handler.UnmountRequested = true;
+			}
+
+			daemonThread.Join();
+			TEST_ASSERT (runReturned);
+
+			listenSocket->Close();
+			LocalSocket::Unlink (socketName.str());
+			TEST_ASSERT (!LocalSocket::Connect (socketName.str(), geteuid()));
+
+			volume1->Close();
+			volume2->Close();
+			unlink (volumePath1.c_str());
+			unlink (volumePath2.c_str());
+		};
+
+		/**
+		The constructor needs the add each test method for the non-VS unit test execution.
+		*/
+		FuseServiceDaemonTest()
+		{
+			TEST_ADD(FuseServiceDaemonTest::testMountAndUnmount);
+		}
+	};
+}
@@ -0,0 +1,174 @@
+#include "../../unittesting.h"
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../../../Volume/Pkcs5Kdf.h"
+#include "../../../Volume/VolumeHeader.h"
+#include "../../../Volume/VolumeHeaderKeyCache.h"
+
+namespace CipherShed_Tests_IO
+{
+	using namespace CipherShed;
+
+	class TestVolumeHeaderKeyCache : public VolumeHeaderKeyCache
+	{
+	public:
+		// Forked processes never use the cache, whose access mutex is held by the forking thread of the parent
+		static size_t GetEntryCount () { return Entries.size(); }
+	};
+
+	TESTCLASS
+	PUBLIC_REF_CLASS HeaderKeyCacheTest TESTCLASSEXTENDS
+	{
+	private:
+		TESTCONTEXT testContextInstance;
+
+		static void Fill (const BufferPtr &buffer, byte value)
+		{
+			for (size_t i = 0; i < buffer.Size(); ++i)
+				buffer[i] = (byte) (value + i);
+		}
+
+	public:
+		/// <summary>
+		///Gets or sets the test context which provides
+		///information about and functionality for the current test run.
+		///</summary>
+		TESTCONTEXTPROP
+
+		/**
+		A stored header key must be returned only for the password, salt and KDF it has been derived from.
+		*/
+		TESTMETHOD
+		void testHitAndMiss()
+		{
+			VolumeHeaderKeyCache::Clear();
+
+			VolumePassword password (wstring (L"header key cache test"));
+			VolumePassword otherPassword (wstring (L"header key cache test 2"));
+			Pkcs5HmacSha512 kdf;
+			Pkcs5HmacRipemd160 otherKdf;
+
+			SecureBuffer salt (VolumeHeader::GetSaltSize());
+			SecureBuffer otherSalt (VolumeHeader::GetSaltSize());
+			Fill (salt, 1);
+			Fill (otherSalt, 2);
+
+			SecureBuffer headerKey (VolumeHeader::GetLargestSerializedKeySize());
+			SecureBuffer cachedKey (headerKey.Size());
+			Fill (headerKey, 3);
+
+			TEST_ASSERT (VolumeHeaderKeyCache::IsEmpty());
+			TEST_ASSERT (!VolumeHeaderKeyCache::Get (password, salt, kdf, cachedKey));
+
+			VolumeHeaderKeyCache::Store (password, salt, kdf, headerKey);
+			TEST_ASSERT (!VolumeHeaderKeyCache::IsEmpty());
+
+			cachedKey.Zero();
+			TEST_ASSERT (VolumeHeaderKeyCache::Get (password, salt, kdf, cachedKey));
+			TEST_ASSERT (ConstBufferPtr (cachedKey).IsDataEqual (headerKey));
+
+			TEST_ASSERT (!VolumeHeaderKeyCache::Get (otherPassword, salt, kdf, cachedKey));
+			TEST_ASSERT (!VolumeHeaderKeyCache::Get (password, otherSalt, kdf, cachedKey));
+			TEST_ASSERT (!VolumeHeaderKeyCache::Get (password, salt, otherKdf, cachedKey));
+
+			// Keys of a different size must not be returned
+			SecureBuffer shortKey (headerKey.Size() / 2);
+			TEST_ASSERT (!VolumeHeaderKeyCache::Get (password, salt, kdf, shortKey));
+
+			VolumeHeaderKeyCache::Remove (password, salt, kdf);
+			TEST_ASSERT (!VolumeHeaderKeyCache::Get (password, salt, kdf, cachedKey));
+			TEST_ASSERT (VolumeHeaderKeyCache::IsEmpty());
+		};
+
+		/**
+		Wiping the cache must remove all keys, and the least recently used keys must be evicted first.
+		*/
+		TESTMETHOD
+		void testWipeAndEviction()
+		{
+			VolumeHeaderKeyCache::Clear();
+
+			VolumePassword password (wstring (L"header key cache test"));
+			Pkcs5HmacSha512 kdf;
+
+			SecureBuffer headerKey (VolumeHeader::GetLargestSerializedKeySize());
+			Fill (headerKey, 4);
+
+			SecureBuffer firstSalt (VolumeHeader::GetSaltSize());
+			Fill (firstSalt, 0);
+			VolumeHeaderKeyCache::Store (password, firstSalt, kdf, headerKey);
+
+			SecureBuffer salt (VolumeHeader::GetSaltSize());
+			for (size_t i = 1; i < VolumeHeaderKeyCache::Capacity; ++i)
+			{
+				Fill (salt, (byte) i);
+				VolumeHeaderKeyCache::Store (password, salt, kdf, headerKey);
+			}
+
+			// Using the first key makes the second one the least recently used
+			SecureBuffer cachedKey (headerKey.Size());
+			TEST_ASSERT (VolumeHeaderKeyCache::Get (password, firstSalt, kdf, cachedKey));
+
+			Fill (salt, (byte) VolumeHeaderKeyCache::Capacity);
+			VolumeHeaderKeyCache::Store (password, salt, kdf, headerKey);
+
+			TEST_ASSERT (VolumeHeaderKeyCache::Get (password, firstSalt, kdf, cachedKey));
+			TEST_ASSERT (VolumeHeaderKeyCache::Get (password, salt, kdf, cachedKey));
+
+			Fill (salt, 1);
+			TEST_ASSERT (!VolumeHeaderKeyCache::Get (password, salt, kdf, cachedKey));
+
+			VolumeHeaderKeyCache::Clear();
+			TEST_ASSERT (VolumeHeaderKeyCache::IsEmpty());
+			TEST_ASSERT (!VolumeHeaderKeyCache::Get (password, firstSalt, kdf, cachedKey));
+		};
+
+		/**
+		Processes forked after keys have been stored must not keep copies of the keys, while the forking process must.
+		*/
+		TESTMETHOD
+		void testForkedProcess()
+		{
+			VolumeHeaderKeyCache::Clear();
+
+			VolumePassword password (wstring (L"header key cache test"));
+			Pkcs5HmacSha512 kdf;
+
+			SecureBuffer salt (VolumeHeader::GetSaltSize());
+			Fill (salt, 5);
+
+			SecureBuffer headerKey (VolumeHeader::GetLargestSerializedKeySize());
+			SecureBuffer cachedKey (headerKey.Size());
+			Fill (headerKey, 6);
+
+			VolumeHeaderKeyCache::Store (password, salt, kdf, headerKey);
+
+			int pid = fork();
+			TEST_ASSERT (pid != -1);
+
+			if (pid == 0)
+				_exit (TestVolumeHeaderKeyCache::GetEntryCount() == 0 ? 0 : 1);
+
+			int status;
+			TEST_ASSERT (waitpid (pid, &status, 0) == pid);
+			TEST_ASSERT (WIFEXITED (status) && WEXITSTATUS (status) == 0);
+
+			TEST_ASSERT (VolumeHeaderKeyCache::Get (password, salt, kdf, cachedKey));
+			TEST_ASSERT (ConstBufferPtr (cachedKey).IsDataEqual (headerKey));
+
+			VolumeHeaderKeyCache::Clear();
+		};
+
+		/**
+		The constructor needs the add each test method for the non-VS unit test execution.
+		*/
+		HeaderKeyCacheTest()
+		{
+			TEST_ADD(HeaderKeyCacheTest::testHitAndMiss);
+			TEST_ADD(HeaderKeyCacheTest::testWipeAndEviction);
+			TEST_ADD(HeaderKeyCacheTest::testForkedProcess);
+		}
+	};
+}
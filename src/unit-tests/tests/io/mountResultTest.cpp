@@ -0,0 +1,142 @@
+#include "../../unittesting.h"
+
+#include "../../../Core/CoreBase.h"
+
+namespace CipherShed_Tests_IO
+{
+	using namespace CipherShed;
+
+	TESTCLASS
+	PUBLIC_REF_CLASS MountResultTest TESTCLASSEXTENDS
+	{
+	private:
+		TESTCONTEXT testContextInstance;
+
+		// Mounts volumes without accessing them. Volumes whose paths contain "wrong" fail to mount.
+		class TestCore : public CoreBase
+		{
+		public:
+			TestCore () : ResultsReportedBeforeMount (true) { }
+
+			virtual void CheckFilesystem (shared_ptr <VolumeInfo> mountedVolume, bool repair = false) const { throw NotApplicable (SRC_POS); }
+			virtual void DismountFilesystem (const DirectoryPath &mountPoint, bool force) const { throw NotApplicable (SRC_POS); }
+			virtual shared_ptr <VolumeInfo> DismountVolume (shared_ptr <VolumeInfo> mountedVolume, bool ignoreOpenFiles = false, bool syncVolumeInfo = false) { throw NotApplicable (SRC_POS); }
+			virtual bool FilesystemSupportsLargeFiles (const FilePath &filePath) const { throw NotApplicable (SRC_POS); }
+			virtual DirectoryPath GetDeviceMountPoint (const DevicePath &devicePath) const { throw NotApplicable (SRC_POS); }
+			virtual uint32 GetDeviceSectorSize (const DevicePath &devicePath) const { throw NotApplicable (SRC_POS); }
+			virtual uint64 GetDeviceSize (const DevicePath &devicePath) const { throw NotApplicable (SRC_POS); }
+			virtual HostDeviceList GetHostDevices (bool pathListOnly = false) const { throw NotApplicable (SRC_POS); }
+			virtual VolumeInfoList GetMountedVolumes (const VolumePath &volumePath = VolumePath()) const { return MountedVolumes; }
+			virtual int GetOSMajorVersion () const { throw NotApplicable (SRC_POS); }
+			virtual int GetOSMinorVersion () const { throw NotApplicable (SRC_POS); }
+			virtual bool HasAdminPrivileges () const { return false; }
+			virtual bool IsDevicePresent (const DevicePath &device) const { throw NotApplicable (SRC_POS); }
+			virtual bool IsInPortableMode () const { return false; }
+			virtual bool IsMountPointAvailable (const DirectoryPath &mountPoint) const { return true; }
+			virtual bool IsOSVersion (int major, int minor) const { throw NotApplicable (SRC_POS); }
+			virtual bool IsOSVersionLower (int major, int minor) const { throw NotApplicable (SRC_POS); }
+			virtual bool IsPasswordCacheEmpty () const { return true; }
+			virtual VolumeSlotNumber MountPointToSlotNumber (const DirectoryPath &mountPoint) const { throw NotApplicable (SRC_POS); }
+			virtual void SetFileOwner (const FilesystemPath &path, const UserId &owner) const { throw NotApplicable (SRC_POS); }
+			virtual DirectoryPath SlotNumberToMountPoint (VolumeSlotNumber slotNumber) const { return DirectoryPath (); }
+			virtual void WipePasswordCache () const { }
+
+			virtual shared_ptr <VolumeInfo> MountVolume (MountOptions &options)
+			{
+				// Each volume must be reported before the next one is mounted
+				if (ReportedPaths.size() != MountedPaths.size())
+					ResultsReportedBeforeMount = false;
+
+				MountedPaths.push_back (*options.Path);
+
+				if (wstring (*options.Path).find (L"wrong") != wstring::npos)
+					throw PasswordIncorrect (SRC_POS);
+
+				make_shared_auto (VolumeInfo, volume);
+				volume->Path = *options.Path;
+				volume->SlotNumber = options.SlotNumber;
+				MountedVolumes.push_back (volume);
+
+				return volume;
+			}
+
+			VolumePathList MountedPaths;
+			VolumeInfoList MountedVolumes;
+			VolumePathList ReportedPaths;
+			bool ResultsReportedBeforeMount;
+		};
+
+		struct ResultFunctor : public MountResultFunctor
+		{
+			ResultFunctor (TestCore &core) : Core (core) { }
+
+			virtual void operator() (shared_ptr <MountResult> result)
+			{
+				Core.ReportedPaths.push_back (result->Path);
+				Results.push_back (result);
+			}
+
+			TestCore &Core;
+			MountResultList Results;
+		};
+
+	public:
+		/// <summary>
+		///Gets or sets the test context which provides
+		///information about and functionality for the current test run.
+		///</summary>
+		TESTCONTEXTPROP
+
+		/**
+		Each volume must be reported as soon as it has been mounted or has failed to mount,
+		in the order of the volume paths and with the results returned at the end.
+		*/
+		TESTMETHOD
+		void testResultsReportedPerVolume()
+		{
+			TestCore core;
+			VolumePathList volumePaths;
+			volumePaths.push_back (VolumePath (wstring (L"/dev/test1")));
+			volumePaths.push_back (VolumePath (wstring (L"/dev/wrong2")));
+			volumePaths.push_back (VolumePath (wstring (L"/dev/test3")));
+
+			MountOptions options;
+			ResultFunctor resultFunctor (core);
+			MountResultList results = core.MountVolumes (options, volumePaths, &resultFunctor);
+
+			TEST_ASSERT (core.ResultsReportedBeforeMount);
+			TEST_ASSERT (core.MountedPaths.size() == 3);
+			TEST_ASSERT (resultFunctor.Results.size() == 3);
+			TEST_ASSERT (results.size() == 3);
+
+			MountResultList::const_iterator reported = resultFunctor.Results.begin();
+			MountResultList::const_iterator returned = results.begin();
+			foreach (const VolumePath &volumePath, volumePaths)
+			{
+				TEST_ASSERT ((*reported)->Path == volumePath);
+				TEST_ASSERT (*reported == *returned);
+				++reported;
+				++returned;
+			}
+
+			reported = resultFunctor.Results.begin();
+			TEST_ASSERT ((*reported)->MountedVolume && (*reported)->MountedVolume->SlotNumber == 1 && !(*reported)->Error);
+			++reported;
+			TEST_ASSERT (!(*reported)->MountedVolume && dynamic_cast <PasswordIncorrect *> ((*reported)->Error.get()));
+			++reported;
+			TEST_ASSERT ((*reported)->MountedVolume && (*reported)->MountedVolume->SlotNumber == 2 && !(*reported)->Error);
+
+			// Results are optional
+			core.MountedVolumes.clear();
+			TEST_ASSERT (core.MountVolumes (options, volumePaths).size() == 3);
+		};
+
+		/**
+		The constructor needs the add each test method for the non-VS unit test execution.
+		*/
+		MountResultTest()
+		{
+			TEST_ADD(MountResultTest::testResultsReportedPerVolume);
+		}
+	};
+}
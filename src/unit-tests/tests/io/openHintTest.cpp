@@ -0,0 +1,197 @@
+#include "../../unittesting.h"
+
+#include "../../../Core/MountOptions.h"
+#include "../../../Core/Unix/CoreServiceRequest.h"
+#include "../../../Platform/MemoryStream.h"
+#include "../../../Volume/Pkcs5Kdf.h"
+#include "../../../Volume/VolumeLayout.h"
+#include "../../../Volume/VolumeOpenHints.h"
+#include <sstream>
+#include <unistd.h>
+
+namespace CipherShed_Tests_IO
+{
+	using namespace CipherShed;
+
+	TESTCLASS
+	PUBLIC_REF_CLASS OpenHintTest TESTCLASSEXTENDS
+	{
+	private:
+		TESTCONTEXT testContextInstance;
+
+		static shared_ptr <VolumePassword> GetPassword ()
+		{
+			return shared_ptr <VolumePassword> (new VolumePassword (wstring (L"open hint test")));
+		}
+
+		static string GetTempPath ()
+		{
+			stringstream path;
+			path << "/tmp/ciphershed-open-hint-test-" << getpid() << ".tc";
+			return path.str();
+		}
+
+		static void CreateVolume (const string &path)
+		{
+			VolumeLayoutV2Normal layout;
+			const uint64 hostSize = 1024 * 1024;
+
+			File volumeFile;
+			volumeFile.Open (FilePath (StringConverter::ToWide (path)), File::CreateReadWrite);
+
+			SecureBuffer zeroes (hostSize);
+			zeroes.Zero();
+			volumeFile.Write (zeroes);
+
+			shared_ptr <CipherShed::EncryptionAlgorithm> ea (new CipherShed::AES);
+			shared_ptr <Pkcs5Kdf> kdf (new Pkcs5HmacSha512);
+
+			SecureBuffer dataKey (ea->GetKeySize() * 2);
+			SecureBuffer salt (VolumeHeader::GetSaltSize());
+			for (size_t i = 0; i < dataKey.Size(); ++i)
+				dataKey[i] = (byte) (i * 5);
+			for (size_t i = 0; i < salt.Size(); ++i)
+				salt[i] = (byte) (i * 3);
+
+			SecureBuffer headerKey (VolumeHeader::GetLargestSerializedKeySize());
+			kdf->DeriveKey (headerKey, *GetPassword(), salt);
+
+			VolumeHeaderCreationOptions options;
+			options.DataKey = dataKey;
+			options.EA = ea;
+			options.Kdf = kdf;
+			options.HeaderKey = headerKey;
+			options.Salt = salt;
+			options.SectorSize = TC_SECTOR_SIZE_FILE_HOSTED_VOLUME;
+			options.Type = VolumeType::Normal;
+			options.VolumeDataStart = layout.GetHeaderSize() * 2;
+			options.VolumeDataSize = layout.GetMaxDataSize (hostSize);
+
+			SecureBuffer header (layout.GetHeaderSize());
+			layout.GetHeader()->Create (header, options);
+
+			volumeFile.SeekAt (layout.GetHeaderOffset());
+			volumeFile.Write (header);
+		}
+
+		static bool OpenVolume (const string &path, const VolumeOpenHint &openHint)
+		{
+			Volume volume;
+			volume.Open (VolumePath (StringConverter::ToWide (path)), false, GetPassword(), shared_ptr <KeyfileList> (),
+				VolumeProtection::None, shared_ptr <VolumePassword> (), shared_ptr <KeyfileList> (), false, VolumeType::Unknown, false, false, false, openHint);
+
+			bool opened = volume.GetEncryptionAlgorithm()->GetName() == CipherShed::AES().GetName()
+				&& volume.GetPkcs5Kdf()->GetName() == Pkcs5HmacSha512().GetName();
+
+			volume.Close();
+			return opened;
+		}
+
+	public:
+		/// <summary>
+		///Gets or sets the test context which provides
+		///information about and functionality for the current test run.
+		///</summary>
+		TESTCONTEXTPROP
+
+		/**
+		Hints must be stored per path, and empty hints must remove stored ones.
+		*/
+		TESTMETHOD
+		void testStore()
+		{
+			VolumeOpenHints::Clear();
+
+			VolumePath path1 (wstring (L"/home/user/volume1.tc"));
+			VolumePath path2 (wstring (L"/home/user/volume2.tc"));
+
+			TEST_ASSERT (VolumeOpenHints::Get (path1).IsEmpty());
+
+			VolumeOpenHints::Set (path1, VolumeOpenHint (L"HMAC-SHA-512", L"AES"));
+			VolumeOpenHints::Set (path2, VolumeOpenHint (L"HMAC-RIPEMD-160", L"Serpent"));
+
+			TEST_ASSERT (VolumeOpenHints::Get (path1).Pkcs5PrfName == L"HMAC-SHA-512");
+			TEST_ASSERT (VolumeOpenHints::Get (path1).EncryptionAlgorithmName == L"AES");
+			TEST_ASSERT (VolumeOpenHints::Get (path2).EncryptionAlgorithmName == L"Serpent");
+
+			VolumeOpenHints::Set (path1, VolumeOpenHint());
+			TEST_ASSERT (VolumeOpenHints::Get (path1).IsEmpty());
+			TEST_ASSERT (!VolumeOpenHints::Get (path2).IsEmpty());
+
+			bool exceptionThrown = false;
+			try
+			{
+				VolumeOpenHints::Set (VolumePath(), VolumeOpenHint (L"HMAC-SHA-512", L"AES"));
+			}
+			catch (ParameterIncorrect&)
+			{
+				exceptionThrown = true;
+			}
+			TEST_ASSERT (exceptionThrown);
+
+			VolumeOpenHints::Clear();
+			TEST_ASSERT (VolumeOpenHints::Get (path2).IsEmpty());
+		};
+
+		/**
+		Hints of the volumes of a batch mount must be passed to the core service.
+		*/
+		TESTMETHOD
+		void testMountVolumesRequest()
+		{
+			MountOptions options;
+			options.OpenHints[L"/home/user/volume1.tc"] = VolumeOpenHint (L"HMAC-SHA-512", L"AES");
+			options.OpenHints[L"/home/user/volume2.tc"] = VolumeOpenHint (L"HMAC-Whirlpool", L"Twofish");
+
+			VolumePathList volumePaths;
+			volumePaths.push_back (VolumePath (wstring (L"/home/user/volume1.tc")));
+			volumePaths.push_back (VolumePath (wstring (L"/home/user/volume2.tc")));
+
+			MountVolumesRequest request (&options, volumePaths);
+
+			shared_ptr <Stream> stream (new MemoryStream);
+			request.Serialize (stream);
+
+			shared_ptr <Stream> readStream (new MemoryStream (ConstBufferPtr (dynamic_cast <MemoryStream &> (*stream))));
+			shared_ptr <MountVolumesRequest> deserializedRequest = Serializable::DeserializeNew <MountVolumesRequest> (readStream);
+
+			VolumeOpenHintMap &hints = deserializedRequest->Options->OpenHints;
+			TEST_ASSERT (hints.size() == 2);
+			TEST_ASSERT (hints[L"/home/user/volume1.tc"].Pkcs5PrfName == L"HMAC-SHA-512");
+			TEST_ASSERT (hints[L"/home/user/volume1.tc"].EncryptionAlgorithmName == L"AES");
+			TEST_ASSERT (hints[L"/home/user/volume2.tc"].Pkcs5PrfName == L"HMAC-Whirlpool");
+			TEST_ASSERT (hints[L"/home/user/volume2.tc"].EncryptionAlgorithmName == L"Twofish");
+
+			MountOptions copiedOptions (options);
+			TEST_ASSERT (copiedOptions.OpenHints.size() == 2);
+		};
+
+		/**
+		Volumes must be opened with matching, stale and partial hints.
+		*/
+		TESTMETHOD
+		void testOpen()
+		{
+			string volumePath = GetTempPath();
+			CreateVolume (volumePath);
+
+			TEST_ASSERT (OpenVolume (volumePath, VolumeOpenHint()));
+			TEST_ASSERT (OpenVolume (volumePath, VolumeOpenHint (Pkcs5HmacSha512().GetName(), CipherShed::AES().GetName())));
+			TEST_ASSERT (OpenVolume (volumePath, VolumeOpenHint (Pkcs5HmacWhirlpool().GetName(), CipherShed::Serpent().GetName())));
+			TEST_ASSERT (OpenVolume (volumePath, VolumeOpenHint (wstring(), CipherShed::Twofish().GetName())));
+			TEST_ASSERT (OpenVolume (volumePath, VolumeOpenHint (L"unknown", L"unknown")));
+
+			unlink (volumePath.c_str());
+		};
+
+		/**
+		The constructor needs the add each test method for the non-VS unit test execution.
+		*/
+		OpenHintTest()
+		{
+			TEST_ADD(OpenHintTest::testStore);
+			TEST_ADD(OpenHintTest::testMountVolumesRequest);
+			TEST_ADD(OpenHintTest::testOpen);
+		}
+	};
+}
@@ -0,0 +1,166 @@
+#include "../../unittesting.h"
+
+#include "../../../Core/MountOptions.h"
+#include "../../../Core/Unix/CoreServiceRequest.h"
+#include "../../../Platform/MemoryStream.h"
+#include "../../../Volume/VolumeInfo.h"
+
+namespace CipherShed_Tests_lib
+{
+	using namespace CipherShed;
+
+	TESTCLASS
+	PUBLIC_REF_CLASS SerializerTest TESTCLASSEXTENDS
+	{
+	private:
+		TESTCONTEXT testContextInstance;
+
+		static void InitVolumeInfo (VolumeInfo &info)
+		{
+			info.AuxMountPoint = L"/tmp/.ciphershed_aux_mnt1";
+			info.EncryptionAlgorithmBlockSize = 16;
+			info.EncryptionAlgorithmKeySize = 32;
+			info.EncryptionAlgorithmMinBlockSize = 16;
+			info.EncryptionAlgorithmName = L"AES";
+			info.EncryptionModeName = L"XTS";
+			info.HeaderCreationTime = 129876543210ULL;
+			info.HiddenVolumeProtectionTriggered = false;
+			info.LoopDevice = L"/dev/loop0";
+			info.MinRequiredProgramVersion = 0x600;
+			info.MountPoint = L"/media/ciphershed1";
+			info.Path = VolumePath (wstring (L"/home/user/volume.tc"));
+			info.Pkcs5IterationCount = 1000;
+			info.Pkcs5PrfName = L"HMAC-RIPEMD-160";
+			info.ProgramVersion = 0x71a;
+			info.Protection = VolumeProtection::None;
+			info.SerialInstanceNumber = 123456789;
+			info.Size = 1024 * 1024 * 1024ULL;
+			info.SlotNumber = 1;
+			info.SystemEncryption = false;
+			info.TopWriteOffset = 0;
+			info.TotalDataRead = 4096;
+			info.TotalDataWritten = 8192;
+			info.Type = VolumeType::Normal;
+			info.VirtualDevice = L"/dev/mapper/ciphershed1";
+			info.VolumeCreationTime = 129876543210ULL;
+		}
+
+		static void InitMountOptions (MountOptions &options)
+		{
+			options.FilesystemType = L"ext4";
+			options.MountPoint.reset (new DirectoryPath (L"/media/ciphershed1"));
+			options.Path.reset (new VolumePath (wstring (L"/home/user/volume.tc")));
+			options.SlotNumber = 1;
+		}
+
+		static shared_ptr <Stream> NewStream (SerializationFormat::Enum format)
+		{
+			shared_ptr <Stream> stream (new MemoryStream);
+			stream->SetSerializationFormat (format);
+			return stream;
+		}
+
+		static shared_ptr <Stream> NewReadStream (shared_ptr <Stream> stream)
+		{
+			// Readers always start in the default format and detect the encoding from the object header
+			return shared_ptr <Stream> (new MemoryStream (GetData (stream)));
+		}
+
+		static ConstBufferPtr GetData (shared_ptr <Stream> stream)
+		{
+			return dynamic_cast <MemoryStream &> (*stream);
+		}
+
+		static void CheckVolumeInfo (SerializationFormat::Enum format)
+		{
+			VolumeInfo info;
+			InitVolumeInfo (info);
+
+			shared_ptr <Stream> stream = NewStream (format);
+			info.Serialize (stream);
+
+			shared_ptr <Stream> readStream = NewReadStream (stream);
+			shared_ptr <VolumeInfo> deserializedInfo = Serializable::DeserializeNew <VolumeInfo> (readStream);
+
+			TEST_ASSERT (readStream->GetSerializationFormat() == format);
+			TEST_ASSERT (wstring (deserializedInfo->AuxMountPoint) == wstring (info.AuxMountPoint));
+			TEST_ASSERT (deserializedInfo->EncryptionAlgorithmName == info.EncryptionAlgorithmName);
+			TEST_ASSERT (deserializedInfo->HeaderCreationTime == info.HeaderCreationTime);
+			TEST_ASSERT (wstring (deserializedInfo->MountPoint) == wstring (info.MountPoint));
+			TEST_ASSERT (wstring (deserializedInfo->Path) == wstring (info.Path));
+			TEST_ASSERT (deserializedInfo->Pkcs5PrfName == info.Pkcs5PrfName);
+			TEST_ASSERT (deserializedInfo->SerialInstanceNumber == info.SerialInstanceNumber);
+			TEST_ASSERT (deserializedInfo->Size == info.Size);
+			TEST_ASSERT (deserializedInfo->SlotNumber == info.SlotNumber);
+			TEST_ASSERT (deserializedInfo->TotalDataWritten == info.TotalDataWritten);
+			TEST_ASSERT (wstring (deserializedInfo->VirtualDevice) == wstring (info.VirtualDevice));
+		}
+
+		static void CheckMountVolumeRequest (SerializationFormat::Enum format)
+		{
+			MountOptions options;
+			InitMountOptions (options);
+
+			MountVolumeRequest request (&options);
+			request.RequestId = 42;
+
+			shared_ptr <Stream> stream = NewStream (format);
+			request.Serialize (stream);
+
+			shared_ptr <MountVolumeRequest> deserializedRequest = Serializable::DeserializeNew <MountVolumeRequest> (NewReadStream (stream));
+
+			TEST_ASSERT (deserializedRequest->RequestId == request.RequestId);
+			TEST_ASSERT (deserializedRequest->Options->FilesystemType == options.FilesystemType);
+			TEST_ASSERT (wstring (*deserializedRequest->Options->MountPoint) == wstring (*options.MountPoint));
+			TEST_ASSERT (wstring (*deserializedRequest->Options->Path) == wstring (*options.Path));
+			TEST_ASSERT (deserializedRequest->Options->SlotNumber == options.SlotNumber);
+			TEST_ASSERT (!deserializedRequest->Options->Password);
+		}
+
+	public:
+		/// <summary>
+		///Gets or sets the test context which provides
+		///information about and functionality for the current test run.
+		///</summary>
+		TESTCONTEXTPROP
+
+		TESTMETHOD
+		void testVolumeInfoRoundTrip()
+		{
+			CheckVolumeInfo (SerializationFormat::Named);
+			CheckVolumeInfo (SerializationFormat::Compact);
+		};
+
+		TESTMETHOD
+		void testMountVolumeRequestRoundTrip()
+		{
+			CheckMountVolumeRequest (SerializationFormat::Named);
+			CheckMountVolumeRequest (SerializationFormat::Compact);
+		};
+
+		TESTMETHOD
+		void testCompactEncodingIsSmaller()
+		{
+			VolumeInfo info;
+			InitVolumeInfo (info);
+
+			shared_ptr <Stream> namedStream = NewStream (SerializationFormat::Named);
+			info.Serialize (namedStream);
+
+			shared_ptr <Stream> compactStream = NewStream (SerializationFormat::Compact);
+			info.Serialize (compactStream);
+
+			TEST_ASSERT (GetData (compactStream).Size() < GetData (namedStream).Size());
+		};
+
+		/**
+		The constructor needs the add each test method for the non-VS unit test execution.
+		*/
+		SerializerTest()
+		{
+			TEST_ADD(SerializerTest::testVolumeInfoRoundTrip);
+			TEST_ADD(SerializerTest::testMountVolumeRequestRoundTrip);
+			TEST_ADD(SerializerTest::testCompactEncodingIsSmaller);
+		}
+	};
+}
@@ -62,11 +62,21 @@ namespace unittesting
 }
 
 #ifndef _MSC_FULL_VER
+#include "tests/algo/conformanceTest.cpp"
 #include "tests/algo/crcTest.cpp"
+#include "tests/algo/drbgTest.cpp"
 #include "tests/algo/endianTest.cpp"
+#include "tests/algo/keystreamTest.cpp"
 #include "tests/algo/passwordTest.cpp"
+#include "tests/algo/selfTestTest.cpp"
+#include "tests/io/batchFileTest.cpp"
+#include "tests/io/fuseServiceDaemonTest.cpp"
+#include "tests/io/headerKeyCacheTest.cpp"
+#include "tests/io/mountResultTest.cpp"
+#include "tests/io/openHintTest.cpp"
 #include "tests/lib/unicodeTest.cpp"
 #include "tests/lib/stringUtilTest.cpp"
+#include "tests/lib/serializerTest.cpp"
 #endif
 
 #pragma warning( push )
@@ -78,8 +88,18 @@ int main(int argc, char *argv[], char *envp[])
 	MAINADDTEST(new CipherShed_Tests_Algo::PasswordTest);
 	MAINADDTEST(new crc::CrcTest);
 	MAINADDTEST(new CipherShed_Tests_Algo::EndianTest);
+	MAINADDTEST(new CipherShed_Tests_Algo::KeystreamTest);
+	MAINADDTEST(new CipherShed_Tests_Algo::DrbgTest);
+	MAINADDTEST(new CipherShed_Tests_Algo::ConformanceTest);
+	MAINADDTEST(new CipherShed_Tests_Algo::SelfTestTest);
+	MAINADDTEST(new CipherShed_Tests_IO::BatchFileTest);
+	MAINADDTEST(new CipherShed_Tests_IO::FuseServiceDaemonTest);
+	MAINADDTEST(new CipherShed_Tests_IO::HeaderKeyCacheTest);
+	MAINADDTEST(new CipherShed_Tests_IO::MountResultTest);
+	MAINADDTEST(new CipherShed_Tests_IO::OpenHintTest);
 	MAINADDTEST(new CipherShed_Tests_lib::UnicodeTest);
 	MAINADDTEST(new CipherShed_Tests_lib::StringUtilTest);
+	MAINADDTEST(new CipherShed_Tests_lib::SerializerTest);
 	MAINTESTRUN
 
 }